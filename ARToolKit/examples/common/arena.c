@@ -0,0 +1,101 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct ArenaBlock_T {
+	struct ArenaBlock_T	*next;
+	size_t				size;		// Bytes of data.
+	size_t				used;
+	double				data[1];	// Aligned for any type malloc() returns.
+} ArenaBlock_T;
+
+struct Arena_T {
+	ArenaBlock_T		*blocks;	// Current block first.
+	size_t				blockSize;
+	size_t				used;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static ArenaBlock_T *arenaNewBlock(size_t size)
+{
+	ArenaBlock_T *block;
+
+	if ((block = (ArenaBlock_T *)calloc(1, offsetof(ArenaBlock_T, data) + size)) == NULL) return (NULL);
+	block->size = size;
+	return (block);
+}
+
+Arena_T *arenaCreate(size_t blockSize)
+{
+	Arena_T *arena;
+
+	if ((arena = (Arena_T *)calloc(1, sizeof(Arena_T))) == NULL) return (NULL);
+	arena->blockSize = (blockSize > 0 ? blockSize : ARENA_BLOCK_SIZE);
+	return (arena);
+}
+
+void arenaDestroy(Arena_T *arena)
+{
+	ArenaBlock_T *block, *next;
+
+	if (arena == NULL) return;
+	for (block = arena->blocks; block != NULL; block = next) {
+		next = block->next;
+		free(block);
+	}
+	free(arena);
+}
+
+void *arenaAlloc(Arena_T *arena, size_t size, size_t align)
+{
+	ArenaBlock_T *block = arena->blocks;
+	size_t pad = 0;
+	char *base;
+
+	if (align == 0 || (align & (align - 1)) != 0) {
+		fprintf(stderr, "arenaAlloc(): Alignment %lu is not a power of two.\n", (unsigned long)align);
+		return (NULL);
+	}
+
+	if (block != NULL) {
+		base = (char *)block->data + block->used;
+		pad = (align - ((size_t)base & (align - 1))) & (align - 1);
+	}
+	if (block == NULL || block->used + pad + size > block->size) {
+		// Worst case padding, so the aligned allocation always fits.
+		if ((block = arenaNewBlock(size + align > arena->blockSize ? size + align : arena->blockSize)) == NULL) return (NULL);
+		if (arena->blocks != NULL && size + align > arena->blockSize) {
+			// Oversized, keep filling the current block afterwards.
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		} else {
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+		base = (char *)block->data;
+		pad = (align - ((size_t)base & (align - 1))) & (align - 1);
+	}
+
+	base = (char *)block->data + block->used + pad;
+	block->used += pad + size;
+	arena->used += size;
+	return (base);
+}
+
+size_t arenaUsed(Arena_T *arena)
+{
+	return (arena->used);
+}
@@ -0,0 +1,41 @@
+#ifndef __arena_h__
+#define __arena_h__
+
+// ============================================================================
+//	Arena allocator
+// ============================================================================
+//
+//	Allocations are carved one after another out of large blocks and are
+//	only released together by arenaDestroy(). Data loaded once and used
+//	until exit, like the object data, stays contiguous instead of being
+//	scattered over the heap, and there is a single free for all of it.
+//
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARENA_BLOCK_SIZE	65536	// Default block size in bytes.
+#define ARENA_CACHE_LINE	64
+
+typedef struct Arena_T Arena_T;
+
+// blockSize 0 for ARENA_BLOCK_SIZE. Larger allocations get a block of
+// their own.
+Arena_T *arenaCreate(size_t blockSize);
+void arenaDestroy(Arena_T *arena);
+
+// Zeroed memory aligned to align, a power of two, e.g. ARENA_CACHE_LINE for
+// arrays walked every frame. Returns NULL when out of memory.
+void *arenaAlloc(Arena_T *arena, size_t size, size_t align);
+
+// Bytes handed out so far.
+size_t arenaUsed(Arena_T *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __arena_h__
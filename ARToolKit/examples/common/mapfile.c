@@ -0,0 +1,78 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+#include <string.h>
+
+#include "mapfile.h"
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+int mapFileOpen(MapFile_T *map, const char *path)
+{
+#ifdef _WIN32
+	HANDLE file, mapping;
+	DWORD high, low;
+	void *view;
+
+	memset(map, 0, sizeof(MapFile_T));
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return (FALSE);
+	low = GetFileSize(file, &high);
+	if (low == 0 || high != 0 || (mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+		CloseHandle(file);
+		return (FALSE);
+	}
+	if ((view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return (FALSE);
+	}
+	map->data = (const ARUint8 *)view;
+	map->size = low;
+	map->file = file;
+	map->mapping = mapping;
+#else
+	struct stat st;
+	void *view;
+	int fd;
+
+	memset(map, 0, sizeof(MapFile_T));
+	if ((fd = open(path, O_RDONLY)) < 0) return (FALSE);
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return (FALSE);
+	}
+	view = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) return (FALSE);
+	map->data = (const ARUint8 *)view;
+	map->size = st.st_size;
+#endif
+	return (TRUE);
+}
+
+void mapFileClose(MapFile_T *map)
+{
+	if (map->size == 0) return;
+#ifdef _WIN32
+	UnmapViewOfFile((LPCVOID)map->data);
+	CloseHandle((HANDLE)map->mapping);
+	CloseHandle((HANDLE)map->file);
+#else
+	munmap((void *)map->data, map->size);
+#endif
+	map->data = NULL;
+	map->size = 0;
+}
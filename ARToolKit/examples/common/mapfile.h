@@ -0,0 +1,37 @@
+#ifndef __mapfile_h__
+#define __mapfile_h__
+
+// ============================================================================
+//	Read-only file mapping
+// ============================================================================
+//
+//	Maps a whole file into memory with MapViewOfFile() or mmap(), so
+//	compiled data can be used in place without reading and copying it.
+//
+
+#include <stddef.h>
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	const ARUint8	*data;
+	size_t			size;			// 0 when not mapped.
+#ifdef _WIN32
+	void			*file;			// HANDLEs.
+	void			*mapping;
+#endif
+} MapFile_T;
+
+// Returns FALSE when the file is missing, empty or cannot be mapped.
+int mapFileOpen(MapFile_T *map, const char *path);
+void mapFileClose(MapFile_T *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __mapfile_h__
@@ -0,0 +1,27 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <AR/ar.h>
+
+#include "markertable.h"
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+void markerTableBuild(MarkerTable_T *table, ARMarkerInfo *marker_info, int marker_num)
+{
+	int i, j, k;
+
+	for (i = 0; i < AR_PATT_NUM_MAX; i++) table->best[i] = -1;
+
+	for (j = 0; j < marker_num; j++) {
+		i = marker_info[j].id;
+		if ((unsigned)i >= AR_PATT_NUM_MAX) continue;	// Unknown pattern (-1).
+
+		// First marker of the pattern, or higher confidence than the one kept.
+		k = table->best[i];
+		if (k == -1 || marker_info[k].cf < marker_info[j].cf) table->best[i] = j;
+	}
+}
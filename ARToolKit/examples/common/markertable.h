@@ -0,0 +1,33 @@
+#ifndef __markertable_h__
+#define __markertable_h__
+
+// ============================================================================
+//	Best detection per pattern id
+// ============================================================================
+//
+//	One pass over the detected markers buckets them by pattern id and keeps
+//	the highest confidence candidate of each, so every object resolves its
+//	marker with a single lookup of its pattern id (as returned by
+//	arLoadPatt()) instead of scanning all detections.
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	int		best[AR_PATT_NUM_MAX];	// Index into marker_info, -1 if the pattern was not seen.
+} MarkerTable_T;
+
+void markerTableBuild(MarkerTable_T *table, ARMarkerInfo *marker_info, int marker_num);
+
+// Index of the best detection of pattern id, or -1.
+#define markerTableBest(table, id)	(((unsigned)(id) < AR_PATT_NUM_MAX) ? (table)->best[(id)] : -1)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __markertable_h__
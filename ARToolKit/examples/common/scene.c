@@ -0,0 +1,684 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/arMulti.h>
+
+#include "scene.h"
+#include "arena.h"
+#include "mapfile.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define SCENE_MAGIC				"MTSSCEN\032"
+#define SCENE_VERSION			1
+#define SCENE_ALIGN				16
+#define SCENE_FNV_BASIS			2166136261U
+#define SCENE_FNV_PRIME			16777619U
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+// Start of the compiled file, followed by the objects, the markers, the
+// patterns, the strings and the pattern data. Offsets are from the start
+// of the file, strings are offsets into the string table.
+typedef struct {
+	char		magic[8];
+	ARUint32	version;
+	ARUint32	size;			// Whole file.
+	ARUint32	hash;			// FNV-1a of everything after the header.
+	ARUint32	objectCount;
+	ARUint32	objectOffset;
+	ARUint32	markerCount;
+	ARUint32	markerOffset;
+	ARUint32	patternCount;
+	ARUint32	patternOffset;
+	ARUint32	stringSize;
+	ARUint32	stringOffset;
+} SceneHeader_T;
+
+typedef struct {
+	ARUint32	name;
+	ARUint32	type;
+	ARUint32	pattern;
+	ARUint32	reserved;
+	double		markerWidth;
+	double		markerCenter[2];
+	double		anchor[6];
+} SceneObjectRecord_T;
+
+typedef struct {
+	ARUint32	pattern;
+	ARUint32	reserved;
+	double		width;
+	double		center[2];
+	double		trans[3][4];
+} SceneMarkerRecord_T;
+
+typedef struct {
+	ARUint32	path;
+	ARUint32	data;			// SCENE_PATTERN_SIZE bytes.
+} ScenePatternRecord_T;
+
+struct SceneStore_T {
+	Arena_T		*arena;
+	MapFile_T	map;			// Compiled scene, not mapped for text files.
+};
+
+// Text file being parsed, a line at a time.
+typedef struct {
+	const char	*file;
+	const char	*p, *end;
+	int			line;
+	const char	*lineStart;		// Of the current line, for parseUnread().
+	char		*buf;			// Current line without the newline.
+	size_t		cap;
+	char		*next;			// Rest of the line for parseWord().
+	int			error;
+} SceneParse_T;
+
+// ============================================================================
+//	Text files
+// ============================================================================
+
+static int parseError(SceneParse_T *ps, const char *message, const char *what)
+{
+	if (!ps->error) fprintf(stderr, "sceneOpen(): %s:%d: %s%s.\n", ps->file, ps->line, message, what);
+	ps->error = TRUE;
+	return (FALSE);
+}
+
+static int isSpace(char c)
+{
+	return (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f');
+}
+
+// Next line that is not blank or a comment. Returns FALSE at the end.
+static int parseLine(SceneParse_T *ps)
+{
+	const char *start, *q;
+	size_t n;
+	char *buf;
+
+	while (ps->p < ps->end && !ps->error) {
+		start = ps->lineStart = ps->p;
+		for (q = start; q < ps->end && *q != '\n'; q++);
+		ps->p = (q < ps->end ? q + 1 : q);
+		ps->line++;
+
+		while (start < q && isSpace(*start)) start++;
+		if (start == q || *start == '#') continue;
+		if (memchr(start, '\0', q - start) != NULL) return (parseError(ps, "Not a text file", ""));
+
+		n = q - start;
+		if (n + 1 > ps->cap) {
+			if ((buf = (char *)realloc(ps->buf, n + 1)) == NULL) return (parseError(ps, "Out of memory", ""));
+			ps->buf = buf;
+			ps->cap = n + 1;
+		}
+		memcpy(ps->buf, start, n);
+		ps->buf[n] = '\0';
+		ps->next = ps->buf;
+		return (TRUE);
+	}
+	return (FALSE);
+}
+
+// The current line is returned by parseLine() again.
+static void parseUnread(SceneParse_T *ps)
+{
+	ps->p = ps->lineStart;
+	ps->line--;
+}
+
+// Next word of the current line, NULL at its end.
+static char *parseWord(SceneParse_T *ps)
+{
+	char *word;
+
+	while (isSpace(*ps->next)) ps->next++;
+	if (*ps->next == '\0') return (NULL);
+	word = ps->next;
+	while (*ps->next != '\0' && !isSpace(*ps->next)) ps->next++;
+	if (*ps->next != '\0') *ps->next++ = '\0';
+	return (word);
+}
+
+static int parseDoubles(SceneParse_T *ps, double *v, int count, const char *what)
+{
+	char *word, *end;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if ((word = parseWord(ps)) == NULL) return (parseError(ps, "Expected ", what));
+		v[i] = strtod(word, &end);
+		if (*end != '\0') return (parseError(ps, "Expected ", what));
+	}
+	return (TRUE);
+}
+
+// Nothing may follow on the line.
+static int parseEnd(SceneParse_T *ps)
+{
+	char *word;
+
+	if ((word = parseWord(ps)) != NULL) return (parseError(ps, "Unexpected ", word));
+	return (TRUE);
+}
+
+static int parseCount(SceneParse_T *ps, int *count, const char *what)
+{
+	double v;
+
+	if (!parseLine(ps)) return (parseError(ps, "Expected ", what));
+	if (!parseDoubles(ps, &v, 1, what) || !parseEnd(ps)) return (FALSE);
+	if (v < 1.0 || v > AR_PATT_NUM_MAX || v != (int)v) return (parseError(ps, "Expected ", what));
+	*count = (int)v;
+	return (TRUE);
+}
+
+static const char *storeString(Scene_T *scene, const char *s)
+{
+	char *copy;
+
+	if ((copy = (char *)arenaAlloc(scene->store->arena, strlen(s) + 1, 1)) == NULL) return (NULL);
+	strcpy(copy, s);
+	return (copy);
+}
+
+// Index of the pattern file, added when new.
+static int addPattern(Scene_T *scene, const char *path)
+{
+	int i;
+
+	for (i = 0; i < scene->patternCount; i++) {
+		if (strcmp(scene->patterns[i].path, path) == 0) return (i);
+	}
+	if (i == AR_PATT_NUM_MAX) return (-1);
+	if ((scene->patterns[i].path = storeString(scene, path)) == NULL) return (-1);
+	scene->patternCount++;
+	return (i);
+}
+
+static int parsePattern(Scene_T *scene, SceneParse_T *ps, int *pattern)
+{
+	char *word;
+
+	if (!parseLine(ps) || (word = parseWord(ps)) == NULL) return (parseError(ps, "Expected ", "the pattern file"));
+	if (!parseEnd(ps)) return (FALSE);
+	if ((*pattern = addPattern(scene, word)) < 0) return (parseError(ps, "Too many patterns or out of memory", ""));
+	return (TRUE);
+}
+
+static int parseMarkerSize(SceneParse_T *ps, double *width, double center[2])
+{
+	if (!parseLine(ps) || !parseDoubles(ps, width, 1, "the marker width") || !parseEnd(ps)) return (parseError(ps, "Expected ", "the marker width"));
+	if (*width <= 0.0) return (parseError(ps, "Expected ", "a positive marker width"));
+	if (!parseLine(ps) || !parseDoubles(ps, center, 2, "the marker center x y") || !parseEnd(ps)) return (parseError(ps, "Expected ", "the marker center x y"));
+	return (TRUE);
+}
+
+static int parseObjects(Scene_T *scene, SceneParse_T *ps)
+{
+	SceneObject_T *object;
+	const char *type;
+	char *name;
+	int i;
+
+	if (!parseCount(ps, &scene->objectCount, "the number of objects")) return (FALSE);
+	if ((scene->objects = (SceneObject_T *)arenaAlloc(scene->store->arena, scene->objectCount * sizeof(SceneObject_T), SCENE_ALIGN)) == NULL) {
+		return (parseError(ps, "Out of memory", ""));
+	}
+
+	for (i = 0; i < scene->objectCount; i++) {
+		object = &scene->objects[i];
+
+		// Model type and file, or only the object name.
+		if (!parseLine(ps) || (type = parseWord(ps)) == NULL) return (parseError(ps, "Expected ", "the next object"));
+		if ((name = parseWord(ps)) == NULL) {
+			name = (char *)type;
+			type = "";
+		}
+		if (!parseEnd(ps)) return (FALSE);
+		if ((object->type = storeString(scene, type)) == NULL || (object->name = storeString(scene, name)) == NULL) {
+			return (parseError(ps, "Out of memory", ""));
+		}
+
+		if (!parsePattern(scene, ps, &object->pattern)) return (FALSE);
+		if (!parseMarkerSize(ps, &object->markerWidth, object->markerCenter)) return (FALSE);
+
+		// Optional anchor, otherwise the line is the next object's.
+		if (!parseLine(ps)) continue;
+		if (strncmp(ps->buf, "ANCHOR", 6) == 0 && (ps->buf[6] == '\0' || isSpace(ps->buf[6]))) {
+			parseWord(ps);
+			if (!parseDoubles(ps, object->anchor, 6, "the anchor tx ty tz rx ry rz") || !parseEnd(ps)) return (FALSE);
+		} else {
+			parseUnread(ps);
+		}
+	}
+	if (parseLine(ps)) return (parseError(ps, "Unexpected ", ps->buf));
+	return (!ps->error);
+}
+
+static int parseMarkers(Scene_T *scene, SceneParse_T *ps)
+{
+	SceneMarker_T *marker;
+	int i, j;
+
+	if (!parseCount(ps, &scene->markerCount, "the number of markers")) return (FALSE);
+	if ((scene->markers = (SceneMarker_T *)arenaAlloc(scene->store->arena, scene->markerCount * sizeof(SceneMarker_T), SCENE_ALIGN)) == NULL) {
+		return (parseError(ps, "Out of memory", ""));
+	}
+
+	for (i = 0; i < scene->markerCount; i++) {
+		marker = &scene->markers[i];
+		if (!parsePattern(scene, ps, &marker->pattern)) return (FALSE);
+		if (!parseMarkerSize(ps, &marker->width, marker->center)) return (FALSE);
+		for (j = 0; j < 3; j++) {
+			if (!parseLine(ps)) return (parseError(ps, "Expected ", "a row of the marker transformation"));
+			if (!parseDoubles(ps, marker->trans[j], 4, "a row of the marker transformation") || !parseEnd(ps)) return (FALSE);
+		}
+	}
+	if (parseLine(ps)) return (parseError(ps, "Unexpected ", ps->buf));
+	return (!ps->error);
+}
+
+static int parseFile(Scene_T *scene, const char *path, int (*parse)(Scene_T *, SceneParse_T *))
+{
+	SceneParse_T ps;
+	MapFile_T map;
+	int ok;
+
+	if (!mapFileOpen(&map, path)) {
+		fprintf(stderr, "sceneOpen(): Unable to read %s.\n", path);
+		return (FALSE);
+	}
+	memset(&ps, 0, sizeof(ps));
+	ps.file = path;
+	ps.p = (const char *)map.data;
+	ps.end = ps.p + map.size;
+	ok = parse(scene, &ps);
+	free(ps.buf);
+	mapFileClose(&map);
+	return (ok);
+}
+
+// ============================================================================
+//	Compiled files
+// ============================================================================
+
+static ARUint32 fnv1a(const ARUint8 *data, size_t size, ARUint32 hash)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= SCENE_FNV_PRIME;
+	}
+	return (hash);
+}
+
+static ARUint32 alignUp(ARUint32 offset, ARUint32 align)
+{
+	return ((offset + align - 1) / align * align);
+}
+
+static const char *compiledString(const SceneHeader_T *header, const ARUint8 *blob, ARUint32 offset)
+{
+	return (offset < header->stringSize ? (const char *)blob + header->stringOffset + offset : NULL);
+}
+
+// Check the mapped file and point the scene into it.
+static int useCompiled(Scene_T *scene, const char *path)
+{
+	const ARUint8 *blob = scene->store->map.data;
+	size_t size = scene->store->map.size;
+	const SceneHeader_T *header = (const SceneHeader_T *)blob;
+	const SceneObjectRecord_T *objects;
+	const SceneMarkerRecord_T *markers;
+	const ScenePatternRecord_T *patterns;
+	int i;
+
+	if (size < sizeof(SceneHeader_T) || header->version != SCENE_VERSION || header->size != size
+		|| header->hash != fnv1a(blob + sizeof(SceneHeader_T), size - sizeof(SceneHeader_T), SCENE_FNV_BASIS)) {
+		fprintf(stderr, "sceneOpen(): %s is damaged or from another version, compile it again.\n", path);
+		return (FALSE);
+	}
+	if (header->objectCount == 0 || header->objectCount > AR_PATT_NUM_MAX || header->markerCount > AR_PATT_NUM_MAX || header->patternCount > AR_PATT_NUM_MAX
+		|| header->objectOffset + (double)header->objectCount * sizeof(SceneObjectRecord_T) > size
+		|| header->markerOffset + (double)header->markerCount * sizeof(SceneMarkerRecord_T) > size
+		|| header->patternOffset + (double)header->patternCount * sizeof(ScenePatternRecord_T) > size
+		|| header->stringSize == 0 || header->stringOffset + (double)header->stringSize > size
+		|| blob[header->stringOffset + header->stringSize - 1] != '\0') {
+		fprintf(stderr, "sceneOpen(): %s is damaged.\n", path);
+		return (FALSE);
+	}
+
+	scene->objectCount = header->objectCount;
+	scene->markerCount = header->markerCount;
+	scene->patternCount = header->patternCount;
+	scene->objects = (SceneObject_T *)arenaAlloc(scene->store->arena, scene->objectCount * sizeof(SceneObject_T), SCENE_ALIGN);
+	scene->markers = (SceneMarker_T *)arenaAlloc(scene->store->arena, (scene->markerCount + 1) * sizeof(SceneMarker_T), SCENE_ALIGN);
+	if (scene->objects == NULL || scene->markers == NULL) {
+		fprintf(stderr, "sceneOpen(): Out of memory.\n");
+		return (FALSE);
+	}
+
+	patterns = (const ScenePatternRecord_T *)(blob + header->patternOffset);
+	for (i = 0; i < scene->patternCount; i++) {
+		scene->patterns[i].path = compiledString(header, blob, patterns[i].path);
+		scene->patterns[i].data = blob + patterns[i].data;
+		if (scene->patterns[i].path == NULL || patterns[i].data + (double)SCENE_PATTERN_SIZE > size) {
+			fprintf(stderr, "sceneOpen(): %s is damaged.\n", path);
+			return (FALSE);
+		}
+	}
+	objects = (const SceneObjectRecord_T *)(blob + header->objectOffset);
+	for (i = 0; i < scene->objectCount; i++) {
+		scene->objects[i].name = compiledString(header, blob, objects[i].name);
+		scene->objects[i].type = compiledString(header, blob, objects[i].type);
+		scene->objects[i].pattern = (int)objects[i].pattern;
+		scene->objects[i].markerWidth = objects[i].markerWidth;
+		memcpy(scene->objects[i].markerCenter, objects[i].markerCenter, sizeof(objects[i].markerCenter));
+		memcpy(scene->objects[i].anchor, objects[i].anchor, sizeof(objects[i].anchor));
+		if (scene->objects[i].name == NULL || scene->objects[i].type == NULL || objects[i].pattern >= header->patternCount) {
+			fprintf(stderr, "sceneOpen(): %s is damaged.\n", path);
+			return (FALSE);
+		}
+	}
+	markers = (const SceneMarkerRecord_T *)(blob + header->markerOffset);
+	for (i = 0; i < scene->markerCount; i++) {
+		scene->markers[i].pattern = (int)markers[i].pattern;
+		scene->markers[i].width = markers[i].width;
+		memcpy(scene->markers[i].center, markers[i].center, sizeof(markers[i].center));
+		memcpy(scene->markers[i].trans, markers[i].trans, sizeof(markers[i].trans));
+		if (markers[i].pattern >= header->patternCount) {
+			fprintf(stderr, "sceneOpen(): %s is damaged.\n", path);
+			return (FALSE);
+		}
+	}
+	scene->compiled = TRUE;
+	return (TRUE);
+}
+
+// Lay out the compiled file in memory.
+static ARUint8 *buildBlob(Scene_T *scene)
+{
+	SceneHeader_T header;
+	SceneObjectRecord_T *objects;
+	SceneMarkerRecord_T *markers;
+	ScenePatternRecord_T *patterns;
+	ARUint8 *blob;
+	ARUint32 size, strings = 0;
+	int i;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SCENE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_VERSION;
+	header.objectCount = scene->objectCount;
+	header.markerCount = scene->markerCount;
+	header.patternCount = scene->patternCount;
+	for (i = 0; i < scene->objectCount; i++) strings += (ARUint32)(strlen(scene->objects[i].name) + strlen(scene->objects[i].type) + 2);
+	for (i = 0; i < scene->patternCount; i++) strings += (ARUint32)(strlen(scene->patterns[i].path) + 1);
+	header.stringSize = strings;
+	header.objectOffset = alignUp(sizeof(SceneHeader_T), SCENE_ALIGN);
+	header.markerOffset = alignUp(header.objectOffset + scene->objectCount * sizeof(SceneObjectRecord_T), SCENE_ALIGN);
+	header.patternOffset = alignUp(header.markerOffset + scene->markerCount * sizeof(SceneMarkerRecord_T), SCENE_ALIGN);
+	header.stringOffset = alignUp(header.patternOffset + scene->patternCount * sizeof(ScenePatternRecord_T), SCENE_ALIGN);
+	size = alignUp(header.stringOffset + strings, SCENE_ALIGN);
+	header.size = size + scene->patternCount * SCENE_PATTERN_SIZE;
+
+	if ((blob = (ARUint8 *)calloc(1, header.size)) == NULL) return (NULL);
+	objects = (SceneObjectRecord_T *)(blob + header.objectOffset);
+	markers = (SceneMarkerRecord_T *)(blob + header.markerOffset);
+	patterns = (ScenePatternRecord_T *)(blob + header.patternOffset);
+
+	// Strings in the order they were counted.
+	strings = 0;
+	for (i = 0; i < scene->objectCount; i++) {
+		objects[i].name = strings;
+		strcpy((char *)blob + header.stringOffset + strings, scene->objects[i].name);
+		strings += (ARUint32)strlen(scene->objects[i].name) + 1;
+		objects[i].type = strings;
+		strcpy((char *)blob + header.stringOffset + strings, scene->objects[i].type);
+		strings += (ARUint32)strlen(scene->objects[i].type) + 1;
+		objects[i].pattern = scene->objects[i].pattern;
+		objects[i].markerWidth = scene->objects[i].markerWidth;
+		memcpy(objects[i].markerCenter, scene->objects[i].markerCenter, sizeof(objects[i].markerCenter));
+		memcpy(objects[i].anchor, scene->objects[i].anchor, sizeof(objects[i].anchor));
+	}
+	for (i = 0; i < scene->patternCount; i++) {
+		patterns[i].path = strings;
+		strcpy((char *)blob + header.stringOffset + strings, scene->patterns[i].path);
+		strings += (ARUint32)strlen(scene->patterns[i].path) + 1;
+		patterns[i].data = size + i * SCENE_PATTERN_SIZE;
+		memcpy(blob + patterns[i].data, scene->patterns[i].data, SCENE_PATTERN_SIZE);
+	}
+	for (i = 0; i < scene->markerCount; i++) {
+		markers[i].pattern = scene->markers[i].pattern;
+		markers[i].width = scene->markers[i].width;
+		memcpy(markers[i].center, scene->markers[i].center, sizeof(markers[i].center));
+		memcpy(markers[i].trans, scene->markers[i].trans, sizeof(markers[i].trans));
+	}
+
+	header.hash = fnv1a(blob + sizeof(SceneHeader_T), header.size - sizeof(SceneHeader_T), SCENE_FNV_BASIS);
+	memcpy(blob, &header, sizeof(header));
+	return (blob);
+}
+
+// The .dat of arVrmlLoadFile() and the .wrl it names, relative to it.
+static int checkModel(const char *datFile)
+{
+	FILE *fp;
+	char buf[1024], name[1024], wrlFile[1024 + 256], *p;
+	size_t n;
+
+	if ((fp = fopen(datFile, "r")) == NULL) {
+		fprintf(stderr, "sceneCompile(): Unable to read model %s.\n", datFile);
+		return (FALSE);
+	}
+	do {
+		p = fgets(buf, sizeof(buf), fp);
+	} while (p != NULL && (buf[0] == '\n' || buf[0] == '#'));
+	fclose(fp);
+	if (p == NULL || sscanf(buf, "%1023s", name) != 1) {
+		fprintf(stderr, "sceneCompile(): %s names no VRML file.\n", datFile);
+		return (FALSE);
+	}
+
+	// Relative to the directory of the .dat.
+	n = strlen(datFile);
+	while (n > 0 && datFile[n - 1] != '/' && datFile[n - 1] != '\\') n--;
+	if (n >= 256) n = 0;
+	memcpy(wrlFile, datFile, n);
+	strcpy(wrlFile + n, name);
+	if ((fp = fopen(wrlFile, "rb")) == NULL) {
+		fprintf(stderr, "sceneCompile(): Unable to read %s of model %s.\n", wrlFile, datFile);
+		return (FALSE);
+	}
+	fclose(fp);
+	return (TRUE);
+}
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+Scene_T *sceneOpen(const char *path, const char *multiPath)
+{
+	Scene_T *scene;
+	Arena_T *arena;
+	int ok;
+
+	if ((arena = arenaCreate(0)) == NULL) return (NULL);
+	scene = (Scene_T *)arenaAlloc(arena, sizeof(Scene_T), SCENE_ALIGN);
+	if (scene == NULL || (scene->store = (struct SceneStore_T *)arenaAlloc(arena, sizeof(struct SceneStore_T), SCENE_ALIGN)) == NULL
+		|| (scene->patterns = (ScenePattern_T *)arenaAlloc(arena, AR_PATT_NUM_MAX * sizeof(ScenePattern_T), SCENE_ALIGN)) == NULL) {
+		fprintf(stderr, "sceneOpen(): Out of memory.\n");
+		arenaDestroy(arena);
+		return (NULL);
+	}
+	scene->store->arena = arena;
+
+	if (!mapFileOpen(&scene->store->map, path)) {
+		fprintf(stderr, "sceneOpen(): Unable to read %s.\n", path);
+		arenaDestroy(arena);
+		return (NULL);
+	}
+	if (scene->store->map.size >= sizeof(((SceneHeader_T *)0)->magic) && memcmp(scene->store->map.data, SCENE_MAGIC, sizeof(((SceneHeader_T *)0)->magic)) == 0) {
+		ok = useCompiled(scene, path);
+	} else {
+		// Text, parsed from a mapping of its own.
+		mapFileClose(&scene->store->map);
+		ok = parseFile(scene, path, parseObjects);
+		if (ok && multiPath != NULL) ok = parseFile(scene, multiPath, parseMarkers);
+	}
+	if (!ok) {
+		sceneClose(scene);
+		return (NULL);
+	}
+	return (scene);
+}
+
+void sceneClose(Scene_T *scene)
+{
+	if (scene == NULL) return;
+	mapFileClose(&scene->store->map);
+	arenaDestroy(scene->store->arena);
+}
+
+int sceneStale(const char *compiledPath, const char *path, const char *multiPath)
+{
+	struct stat compiled, source;
+
+	if (stat(compiledPath, &compiled) != 0) return (TRUE);
+	if (stat(path, &source) == 0 && source.st_mtime > compiled.st_mtime) return (TRUE);
+	if (multiPath != NULL && stat(multiPath, &source) == 0 && source.st_mtime > compiled.st_mtime) return (TRUE);
+	return (FALSE);
+}
+
+int sceneReadPatterns(Scene_T *scene)
+{
+	FILE *fp;
+	ARUint8 *data;
+	int i, j, v, ok;
+
+	for (i = 0; i < scene->patternCount; i++) {
+		if (scene->patterns[i].data != NULL) continue;
+		if ((data = (ARUint8 *)arenaAlloc(scene->store->arena, SCENE_PATTERN_SIZE, SCENE_ALIGN)) == NULL) {
+			fprintf(stderr, "sceneReadPatterns(): Out of memory.\n");
+			return (FALSE);
+		}
+		if ((fp = fopen(scene->patterns[i].path, "r")) == NULL) {
+			fprintf(stderr, "sceneReadPatterns(): Unable to read pattern %s.\n", scene->patterns[i].path);
+			return (FALSE);
+		}
+		// Same layout as arLoadPatt() reads.
+		for (j = 0, ok = TRUE; j < SCENE_PATTERN_SIZE && ok; j++) {
+			ok = (fscanf(fp, "%d", &v) == 1 && v >= 0 && v <= 255);
+			data[j] = (ARUint8)v;
+		}
+		fclose(fp);
+		if (!ok) {
+			fprintf(stderr, "sceneReadPatterns(): %s is not a pattern file, expected %d values from 0 to 255.\n", scene->patterns[i].path, SCENE_PATTERN_SIZE);
+			return (FALSE);
+		}
+		scene->patterns[i].data = data;
+	}
+	return (TRUE);
+}
+
+int sceneCompile(Scene_T *scene, const char *compiledPath)
+{
+	FILE *fp;
+	ARUint8 *blob;
+	ARUint32 size;
+	char *tmpPath;
+	int i, ok = TRUE;
+
+	if (!sceneReadPatterns(scene)) return (FALSE);
+	for (i = 0; i < scene->objectCount; i++) {
+		if (strcmp(scene->objects[i].type, "VRML") == 0 && !checkModel(scene->objects[i].name)) ok = FALSE;
+	}
+	if (!ok) return (FALSE);
+
+	if ((blob = buildBlob(scene)) == NULL || (tmpPath = (char *)malloc(strlen(compiledPath) + 5)) == NULL) {
+		fprintf(stderr, "sceneCompile(): Out of memory.\n");
+		free(blob);
+		return (FALSE);
+	}
+	size = ((SceneHeader_T *)blob)->size;
+
+	// Replaced in one step, a running application never sees half a file.
+	sprintf(tmpPath, "%s.tmp", compiledPath);
+	if ((fp = fopen(tmpPath, "wb")) == NULL) {
+		fprintf(stderr, "sceneCompile(): Unable to write %s.\n", tmpPath);
+		ok = FALSE;
+	} else {
+		if (fwrite(blob, 1, size, fp) != size) ok = FALSE;
+		if (fclose(fp) != 0) ok = FALSE;
+		remove(compiledPath);
+		if (!ok || rename(tmpPath, compiledPath) != 0) {
+			fprintf(stderr, "sceneCompile(): Unable to write %s.\n", compiledPath);
+			remove(tmpPath);
+			ok = FALSE;
+		}
+	}
+	free(tmpPath);
+	free(blob);
+	return (ok);
+}
+
+ARMultiMarkerInfoT *sceneMultiConfig(Scene_T *scene)
+{
+	ARMultiMarkerInfoT *config;
+	ARMultiEachMarkerInfoT *marker;
+	double corner[4][2], hw;
+	int i, j, k;
+
+	if (scene->markerCount <= 0) return (NULL);
+	if ((config = (ARMultiMarkerInfoT *)calloc(1, sizeof(ARMultiMarkerInfoT))) == NULL) return (NULL);
+	if ((config->marker = (ARMultiEachMarkerInfoT *)calloc(scene->markerCount, sizeof(ARMultiEachMarkerInfoT))) == NULL) {
+		free(config);
+		return (NULL);
+	}
+	config->marker_num = scene->markerCount;
+
+	for (i = 0; i < scene->markerCount; i++) {
+		marker = &config->marker[i];
+		if ((marker->patt_id = arLoadPatt(scene->patterns[scene->markers[i].pattern].path)) < 0) {
+			fprintf(stderr, "sceneMultiConfig(): Unable to load pattern %s.\n", scene->patterns[scene->markers[i].pattern].path);
+			arMultiFreeConfig(config);
+			return (NULL);
+		}
+		marker->width = scene->markers[i].width;
+		marker->center[0] = scene->markers[i].center[0];
+		marker->center[1] = scene->markers[i].center[1];
+		memcpy(marker->trans, scene->markers[i].trans, sizeof(marker->trans));
+		arUtilMatInv(marker->trans, marker->itrans);
+
+		// Corners as arMultiReadConfigFile() places them.
+		hw = marker->width * 0.5;
+		corner[0][0] = marker->center[0] - hw;	corner[0][1] = marker->center[1] + hw;
+		corner[1][0] = marker->center[0] + hw;	corner[1][1] = marker->center[1] + hw;
+		corner[2][0] = marker->center[0] + hw;	corner[2][1] = marker->center[1] - hw;
+		corner[3][0] = marker->center[0] - hw;	corner[3][1] = marker->center[1] - hw;
+		for (j = 0; j < 4; j++) {
+			for (k = 0; k < 3; k++) {
+				marker->pos3d[j][k] = marker->trans[k][0] * corner[j][0] + marker->trans[k][1] * corner[j][1] + marker->trans[k][3];
+			}
+		}
+	}
+	return (config);
+}
@@ -0,0 +1,95 @@
+#ifndef __scene_h__
+#define __scene_h__
+
+// ============================================================================
+//	Scene description: objects, multi marker layout and patterns
+// ============================================================================
+//
+//	One loader for the object files of the examples and the multi marker
+//	config of arMultiReadConfigFile(). The object file is
+//
+//	    <number of objects>
+//	    [<model type>] <name>       e.g. VRML Wrl/mantis.dat, or Hiro
+//	    <pattern file>
+//	    <marker width>
+//	    <center x> <center y>
+//	    [ANCHOR tx ty tz rx ry rz]  see object.h of mantis
+//	    ...
+//
+//	with blank lines and # comments anywhere. Lines may be of any length,
+//	and errors name the file and the line.
+//
+//	sceneCompile() checks that every pattern and model file can be read and
+//	writes the whole description, the pattern files included, to one
+//	versioned binary file. sceneOpen() recognizes that file by its header,
+//	maps it and uses it in place, so an application starts with a scene
+//	that already passed all checks. The embedded patterns are for the
+//	pattern bank; ARToolKit's own table is still filled by arLoadPatt()
+//	from the pattern files, which must stay next to the scene.
+//
+
+#include <AR/ar.h>
+#include <AR/arMulti.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCENE_PATTERN_SIZE	(4 * 3 * AR_PATT_SIZE_Y * AR_PATT_SIZE_X)
+
+typedef struct {
+	const char		*path;			// Pattern file for arLoadPatt().
+	const ARUint8	*data;			// The values of the file, 4 rotations of 3 color planes of rows, NULL when not read.
+} ScenePattern_T;
+
+typedef struct {
+	const char		*name;			// Model file, or the object name.
+	const char		*type;			// Model type, empty without one.
+	int				pattern;		// Into patterns.
+	double			markerWidth;
+	double			markerCenter[2];
+	double			anchor[6];		// Translation X Y Z, rotation around X Y Z in degrees.
+} SceneObject_T;
+
+typedef struct {
+	int				pattern;		// Into patterns.
+	double			width;
+	double			center[2];
+	double			trans[3][4];	// Marker in multi marker coordinates.
+} SceneMarker_T;
+
+typedef struct Scene_T {
+	int				objectCount;
+	SceneObject_T	*objects;
+	int				markerCount;	// Multi marker layout, 0 without one.
+	SceneMarker_T	*markers;
+	int				patternCount;	// Every pattern file once.
+	ScenePattern_T	*patterns;
+	int				compiled;		// Mapped from a sceneCompile() file.
+	struct SceneStore_T *store;		// Memory of the scene.
+} Scene_T;
+
+// A compiled scene, or the object file at path and the multi marker config
+// at multiPath, NULL for none. multiPath is not used with a compiled scene.
+Scene_T *sceneOpen(const char *path, const char *multiPath);
+void sceneClose(Scene_T *scene);
+
+// TRUE if the compiled scene is missing or older than one of the text
+// files it is compiled from, multiPath may be NULL.
+int sceneStale(const char *compiledPath, const char *path, const char *multiPath);
+
+// Read the pattern files into the scene, done by sceneCompile().
+int sceneReadPatterns(Scene_T *scene);
+
+// Check the pattern and model files and write the compiled scene.
+int sceneCompile(Scene_T *scene, const char *compiledPath);
+
+// Multi marker config of the layout like arMultiReadConfigFile(), with the
+// patterns loaded by arLoadPatt(). NULL without a layout or on error.
+ARMultiMarkerInfoT *sceneMultiConfig(Scene_T *scene);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __scene_h__
@@ -17,6 +17,7 @@
 #include <AR/video.h>
 
 #include "object.h"
+#include "markertable.h"
 
 #define COLLIDE_DIST 30000.0
 
@@ -24,6 +25,8 @@
 char            *model_name = "Data/object_data_lighting";
 ObjectData_T    *object;
 int             objectnum;
+int             pattKnown[AR_PATT_NUM_MAX];	/* pattern id is used by an object */
+MarkerTable_T   markerTable;
 
 int             xsize, ysize;
 int				thresh = 100;
@@ -159,22 +162,20 @@ static void mainLoop(void)
 		//argDrawSquare(marker_info[i].vertex,0,0);
 	}
 
+	/* best pattern (highest confidence factor) for every pattern id */
+	markerTableBuild(&markerTable, marker_info, marker_num);
+
+	for( j = 0; j < marker_num; j++ ) {
+		if( (unsigned)marker_info[j].id < AR_PATT_NUM_MAX && pattKnown[marker_info[j].id] ) {
+			/* you've found a pattern */
+			glColor3f( 0.0, 1.0, 0.0 );
+			argDrawSquare(marker_info[j].vertex,0,0);
+		}
+	}
+
 	/* check for known patterns */
     for( i = 0; i < objectnum; i++ ) {
-		k = -1;
-		for( j = 0; j < marker_num; j++ ) {
-	        if( object[i].id == marker_info[j].id) {
-
-				/* you've found a pattern */
-				//printf("Found pattern: %d ",patt_id);
-				glColor3f( 0.0, 1.0, 0.0 );
-				argDrawSquare(marker_info[j].vertex,0,0);
-
-				if( k == -1 ) k = j;
-		        else /* make sure you have the best pattern (highest confidence factor) */
-					if( marker_info[k].cf < marker_info[j].cf ) k = j;
-			}
-		}
+		k = markerTableBest(&markerTable, object[i].id);
 		if( k == -1 ) {
 			object[i].visible = 0;
 			continue;
@@ -206,6 +207,7 @@ static void mainLoop(void)
 static void init( void )
 {
 	ARParam  wparam;
+	int      i;
 
     /* open the video path */
     if( arVideoOpen( vconf ) < 0 ) exit(0);
@@ -226,6 +228,7 @@ static void init( void )
 	/* load in the object data - trained markers and associated bitmap files */
     if( (object=read_ObjData(model_name, &objectnum)) == NULL ) exit(0);
     printf("Objectfile num = %d\n", objectnum);
+    for( i = 0; i < objectnum; i++ ) pattKnown[object[i].id] = 1;
 	printf("--------------------------------------\n");
 
     /* open the graphics window */
@@ -28,73 +28,43 @@
 #include <string.h>
 #include <AR/ar.h>
 #include "object.h"
-
-static char *get_buff( char *buf, int n, FILE *fp );
+#include "scene.h"
 
 ObjectData_T *read_ObjData( char *name, int *objectnum )
 {
-    FILE          *fp;
+    Scene_T       *scene;
     ObjectData_T  *object;
-    char           buf[256], buf1[256];
     int            i;
 
 	printf("Opening Data File %s\n",name);
 
-    if( (fp=fopen(name, "r")) == NULL ) {
-		printf("Can't find the file - quitting \n");
+    // An object file or a compiled scene, errors are reported by sceneOpen().
+    if( (scene = sceneOpen(name, NULL)) == NULL ) {
+		printf("Can't read the file - quitting \n");
 		return(0);
 	}
-
-    get_buff(buf, 256, fp);
-    if( sscanf(buf, "%d", objectnum) != 1 ) {fclose(fp); return(0);}
+    *objectnum = scene->objectCount;
 
 	printf("About to load %d Models\n",*objectnum);
 
-    object = (ObjectData_T *)malloc( sizeof(ObjectData_T) * *objectnum );
-    if( object == NULL ) return(0);
+    object = (ObjectData_T *)calloc( *objectnum, sizeof(ObjectData_T) );
+    if( object == NULL ) {sceneClose(scene); return(0);}
 
     for( i = 0; i < *objectnum; i++ ) {
 		object[i].visible = 0;        
-		
-		get_buff(buf, 256, fp);
-        if( sscanf(buf, "%s", object[i].name) != 1 ) {
-            fclose(fp); free(object); return(0);
-        }
+        strncpy(object[i].name, scene->objects[i].name, sizeof(object[i].name) - 1);
 
 		printf("Read in No.%d \n", i+1);
 
-        get_buff(buf, 256, fp);
-        if( sscanf(buf, "%s", buf1) != 1 ) {
-          fclose(fp); free(object); return(0);}
-        
-        if( (object[i].id = arLoadPatt(buf1)) < 0 )
-            {fclose(fp); free(object); return(0);}
+        if( (object[i].id = arLoadPatt(scene->patterns[scene->objects[i].pattern].path)) < 0 )
+            {sceneClose(scene); free(object); return(0);}
 
-        get_buff(buf, 256, fp);
-        if( sscanf(buf, "%lf", &object[i].marker_width) != 1 ) {
-            fclose(fp); free(object); return(0);
-        }
-
-        get_buff(buf, 256, fp);
-        if( sscanf(buf, "%lf %lf", &object[i].marker_center[0],
-            &object[i].marker_center[1]) != 2 ) {
-            fclose(fp); free(object); return(0);
-        }
-        
+        object[i].marker_width = scene->objects[i].markerWidth;
+        object[i].marker_center[0] = scene->objects[i].markerCenter[0];
+        object[i].marker_center[1] = scene->objects[i].markerCenter[1];
     }
 
-    fclose(fp);
+    sceneClose(scene);
 
     return( object );
 }
-
-static char *get_buff( char *buf, int n, FILE *fp )
-{
-    char *ret;
-
-    for(;;) {
-        ret = fgets( buf, n, fp );
-        if( ret == NULL ) return(NULL);
-        if( buf[0] != '\n' && buf[0] != '#' ) return(ret);
-    }
-}
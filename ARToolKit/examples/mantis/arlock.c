@@ -0,0 +1,82 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/param.h>
+#include <AR/ar.h>
+
+#include "arlock.h"
+#include "thread.h"
+
+// ============================================================================
+//	Globals
+// ============================================================================
+
+static Mutex_T				*gMutex = NULL;
+static ARParam				gInstalled;			// Last parameters given to arInitCparam().
+static int					gInstalledValid = FALSE;
+static THREAD_LOCAL int		gHeld = FALSE;		// The calling thread holds the lock.
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+int arLockInit(void)
+{
+	if (gMutex != NULL) return (TRUE);
+	if ((gMutex = mutexCreate()) == NULL) {
+		fprintf(stderr, "arLockInit(): Unable to create mutex.\n");
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+void arLockFinal(void)
+{
+	mutexDestroy(gMutex);
+	gMutex = NULL;
+}
+
+void arLockInstall(const ARParam *cparam)
+{
+	if (cparam == NULL) return;
+	if (gInstalledValid && memcmp(&gInstalled, cparam, sizeof(ARParam)) == 0) return;
+	gInstalled = *cparam;
+	gInstalledValid = TRUE;
+	arInitCparam(&gInstalled);
+}
+
+void arLock(const ARParam *cparam)
+{
+	if (gMutex != NULL) mutexLock(gMutex);
+	gHeld = TRUE;
+	arLockInstall(cparam);
+}
+
+void arUnlock(void)
+{
+	gHeld = FALSE;
+	if (gMutex != NULL) mutexUnlock(gMutex);
+}
+
+void arLockSuspend(ArLockState_T *state)
+{
+	state->held = (gHeld && gMutex != NULL);
+	if (!state->held) return;
+	state->installed = gInstalledValid;
+	if (gInstalledValid) state->cparam = gInstalled;
+	state->procMode = arImageProcMode;
+	arUnlock();
+}
+
+void arLockResume(ArLockState_T *state)
+{
+	if (!state->held) return;
+	arLock(state->installed ? &state->cparam : NULL);
+	arImageProcMode = state->procMode;
+}
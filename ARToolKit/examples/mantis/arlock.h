@@ -0,0 +1,59 @@
+#ifndef __arlock_h__
+#define __arlock_h__
+
+// ============================================================================
+//	Lock around the global state of ARToolKit
+// ============================================================================
+//
+//	ARToolKit keeps the camera parameters of arInitCparam(), the frame size,
+//	the buffers of arDetectMarker2() and arGetMarkerInfo() and the marker
+//	history of arDetectMarker() in globals, so detection threads of several
+//	cameras must take turns. The lock cannot separate the history, the
+//	cameras' markers would mix in it; frontendDetect() keeps one per front
+//	end instead. arLock() makes the camera parameters of the calling thread
+//	current, installing them only when another camera's are in place.
+//
+//	The front end binarizes and labels a frame without ARToolKit, it lets go
+//	of the lock meanwhile with arLockSuspend(), so the per pixel work of the
+//	cameras runs in parallel.
+//
+//	Without arLockInit() there is no mutex, for single threaded programs,
+//	and the functions only keep track of the installed parameters.
+//
+
+#include <AR/param.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	int			held;
+	int			installed;		// cparam was current.
+	ARParam		cparam;
+	int			procMode;		// arImageProcMode.
+} ArLockState_T;
+
+// Create the mutex before the threads start, and free it after they end.
+int  arLockInit(void);
+void arLockFinal(void);
+
+// Take the lock and make cparam current.
+void arLock(const ARParam *cparam);
+void arUnlock(void);
+
+// Switch the current parameters while holding the lock, instead of calling
+// arInitCparam() directly.
+void arLockInstall(const ARParam *cparam);
+
+// Let other threads use ARToolKit for a while. arLockResume() takes the
+// lock again and restores the parameters and the arImageProcMode that were
+// current. Does nothing when the lock is not held by the caller.
+void arLockSuspend(ArLockState_T *state);
+void arLockResume(ArLockState_T *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __arlock_h__
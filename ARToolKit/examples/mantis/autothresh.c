@@ -0,0 +1,260 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "autothresh.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define AUTOTHRESH_TILE			64		// Tile size in pixels, see ThresholdMap_T.
+#define AUTOTHRESH_SAMPLE		4		// Every 4th pixel of every 4th row is sampled.
+#define AUTOTHRESH_BINS			64		// Tile histogram bins.
+#define AUTOTHRESH_MIN_CONTRAST	32		// Flatter tiles use the global threshold.
+#define AUTOTHRESH_MISS_FRAMES	8		// Frames without a marker before switching strategy.
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+struct AutoThresh_T {
+	AutoThreshMode_T	mode;
+	int					manual;
+	int					bias;
+	int					xsize;
+	int					ysize;
+
+	int					global[256];	// Histogram of the whole frame.
+	unsigned short		*tiles;			// AUTOTHRESH_BINS per tile.
+	int					*level;			// Tile threshold before smoothing, -1 when flat.
+	ThresholdMap_T		map;
+	int					mapValid;		// The map holds the previous frame's thresholds.
+
+	int					otsu;
+	int					misses;
+	int					fallback;
+	int					tileMin;
+	int					tileMax;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+AutoThresh_T *autoThreshCreate(int xsize, int ysize)
+{
+	AutoThresh_T *thresh;
+	int count;
+
+	if ((thresh = (AutoThresh_T *)calloc(1, sizeof(AutoThresh_T))) == NULL) return (NULL);
+	thresh->mode = AUTOTHRESH_ADAPTIVE;
+	thresh->manual = 100;
+	thresh->otsu = 100;
+	thresh->xsize = xsize;
+	thresh->ysize = ysize;
+	thresh->map.tileSize = AUTOTHRESH_TILE;
+	thresh->map.tilesX = (xsize + AUTOTHRESH_TILE - 1) / AUTOTHRESH_TILE;
+	thresh->map.tilesY = (ysize + AUTOTHRESH_TILE - 1) / AUTOTHRESH_TILE;
+	count = thresh->map.tilesX * thresh->map.tilesY;
+	thresh->tiles = (unsigned short *)malloc(count * AUTOTHRESH_BINS * sizeof(unsigned short));
+	thresh->level = (int *)malloc(count * sizeof(int));
+	thresh->map.thresh = (ARUint8 *)malloc(count);
+	if (thresh->tiles == NULL || thresh->level == NULL || thresh->map.thresh == NULL) {
+		autoThreshDestroy(thresh);
+		return (NULL);
+	}
+	return (thresh);
+}
+
+void autoThreshDestroy(AutoThresh_T *thresh)
+{
+	if (thresh == NULL) return;
+	free(thresh->tiles);
+	free(thresh->level);
+	free(thresh->map.thresh);
+	free(thresh);
+}
+
+void autoThreshSetMode(AutoThresh_T *thresh, AutoThreshMode_T mode)
+{
+	thresh->mode = mode;
+	thresh->misses = 0;
+	thresh->fallback = FALSE;
+	thresh->mapValid = FALSE;
+}
+
+AutoThreshMode_T autoThreshMode(AutoThresh_T *thresh)
+{
+	return (thresh->mode);
+}
+
+const char *autoThreshModeName(AutoThreshMode_T mode)
+{
+	static const char *names[AUTOTHRESH_MODE_COUNT] = { "manual", "adaptive", "otsu" };
+
+	return (mode >= 0 && mode < AUTOTHRESH_MODE_COUNT ? names[mode] : "unknown");
+}
+
+void autoThreshSetManual(AutoThresh_T *thresh, int value)
+{
+	thresh->manual = value;
+}
+
+void autoThreshSetBias(AutoThresh_T *thresh, int bias)
+{
+	thresh->bias = bias;
+}
+
+static int clampLevel(int value)
+{
+	return (value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Sample the frame into the global and the tile histograms. The level of
+// a pixel is the mean of its colour bytes, which arLabeling() compares
+// with the threshold.
+static void sampleFrame(AutoThresh_T *thresh, const ARUint8 *image)
+{
+	const ARUint8 *p;
+	unsigned short *tileRow;
+	int x, y, level;
+
+	memset(thresh->global, 0, sizeof(thresh->global));
+	memset(thresh->tiles, 0, thresh->map.tilesX * thresh->map.tilesY * AUTOTHRESH_BINS * sizeof(unsigned short));
+	for (y = AUTOTHRESH_SAMPLE / 2; y < thresh->ysize; y += AUTOTHRESH_SAMPLE) {
+		tileRow = thresh->tiles + (y / AUTOTHRESH_TILE) * thresh->map.tilesX * AUTOTHRESH_BINS;
+		p = image + (y * thresh->xsize + AUTOTHRESH_SAMPLE / 2) * AR_PIX_SIZE_DEFAULT + FRONTEND_CHANNEL;
+		for (x = AUTOTHRESH_SAMPLE / 2; x < thresh->xsize; x += AUTOTHRESH_SAMPLE, p += AUTOTHRESH_SAMPLE * AR_PIX_SIZE_DEFAULT) {
+			level = (p[0] + p[1] + p[2]) / 3;
+			thresh->global[level]++;
+			tileRow[(x / AUTOTHRESH_TILE) * AUTOTHRESH_BINS + level * AUTOTHRESH_BINS / 256]++;
+		}
+	}
+}
+
+// Otsu's threshold of the global histogram: the level that maximises the
+// variance between the dark and the bright class.
+static int otsuLevel(const int hist[256])
+{
+	double sum = 0.0, sumDark = 0.0, mDark, mBright, between, best = -1.0;
+	int total = 0, dark = 0, i, level = 100;
+
+	for (i = 0; i < 256; i++) {
+		total += hist[i];
+		sum += (double)i * hist[i];
+	}
+	for (i = 0; i < 256; i++) {
+		dark += hist[i];
+		if (dark == 0) continue;
+		if (dark == total) break;
+		sumDark += (double)i * hist[i];
+		mDark = sumDark / dark;
+		mBright = (sum - sumDark) / (total - dark);
+		between = (double)dark * (total - dark) * (mDark - mBright) * (mDark - mBright);
+		if (between > best) {
+			best = between;
+			level = i;
+		}
+	}
+	return (level);
+}
+
+// Halfway between the 10th and 90th percentile of a tile, or -1 for a tile
+// without an edge.
+static int tileLevel(const unsigned short *hist)
+{
+	int total = 0, count = 0, dark = -1, bright = -1, i;
+
+	for (i = 0; i < AUTOTHRESH_BINS; i++) total += hist[i];
+	if (total == 0) return (-1);
+	for (i = 0; i < AUTOTHRESH_BINS; i++) {
+		count += hist[i];
+		if (dark < 0 && count * 10 >= total) dark = i;
+		if (bright < 0 && count * 10 >= total * 9) bright = i;
+	}
+	dark = dark * 256 / AUTOTHRESH_BINS;
+	bright = bright * 256 / AUTOTHRESH_BINS + 256 / AUTOTHRESH_BINS - 1;
+	if (bright - dark < AUTOTHRESH_MIN_CONTRAST) return (-1);
+	return ((dark + bright) / 2);
+}
+
+// Tile thresholds averaged with their neighbours, so a marker across a
+// tile border sees similar thresholds on both sides, and with the previous
+// frame against flicker.
+static void buildMap(AutoThresh_T *thresh)
+{
+	ThresholdMap_T *map = &thresh->map;
+	int tx, ty, nx, ny, i, sum, n, value;
+
+	for (i = 0; i < map->tilesX * map->tilesY; i++) {
+		thresh->level[i] = tileLevel(thresh->tiles + i * AUTOTHRESH_BINS);
+		if (thresh->level[i] < 0) thresh->level[i] = thresh->otsu;
+	}
+
+	thresh->tileMin = 255;
+	thresh->tileMax = 0;
+	for (ty = 0; ty < map->tilesY; ty++) {
+		for (tx = 0; tx < map->tilesX; tx++) {
+			sum = n = 0;
+			for (ny = ty - 1; ny <= ty + 1; ny++) {
+				for (nx = tx - 1; nx <= tx + 1; nx++) {
+					if (nx < 0 || ny < 0 || nx >= map->tilesX || ny >= map->tilesY) continue;
+					sum += thresh->level[ny * map->tilesX + nx];
+					n++;
+				}
+			}
+			value = clampLevel(sum / n + thresh->bias);
+			i = ty * map->tilesX + tx;
+			if (thresh->mapValid) value = (value + map->thresh[i] + 1) / 2;
+			map->thresh[i] = (ARUint8)value;
+			if (value < thresh->tileMin) thresh->tileMin = value;
+			if (value > thresh->tileMax) thresh->tileMax = value;
+		}
+	}
+	thresh->mapValid = TRUE;
+}
+
+int autoThreshUpdate(AutoThresh_T *thresh, ARUint8 *image, const ThresholdMap_T **map)
+{
+	*map = NULL;
+	if (thresh->mode == AUTOTHRESH_MANUAL) return (thresh->manual);
+
+	sampleFrame(thresh, image);
+	thresh->otsu = (thresh->otsu + otsuLevel(thresh->global) + 1) / 2;
+
+	if (thresh->mode == AUTOTHRESH_ADAPTIVE && !thresh->fallback) {
+		buildMap(thresh);
+		*map = &thresh->map;
+	} else {
+		thresh->mapValid = FALSE;
+	}
+	return (clampLevel(thresh->otsu + thresh->bias));
+}
+
+void autoThreshFeedback(AutoThresh_T *thresh, int found)
+{
+	if (found || thresh->mode != AUTOTHRESH_ADAPTIVE) {
+		thresh->misses = 0;
+		return;
+	}
+	if (++thresh->misses >= AUTOTHRESH_MISS_FRAMES) {
+		thresh->fallback = !thresh->fallback;
+		thresh->misses = 0;
+	}
+}
+
+void autoThreshStats(AutoThresh_T *thresh, int *global, int *tileMin, int *tileMax, int *fallback)
+{
+	*global = (thresh->mode == AUTOTHRESH_MANUAL ? thresh->manual : clampLevel(thresh->otsu + thresh->bias));
+	*tileMin = (thresh->mapValid ? thresh->tileMin : *global);
+	*tileMax = (thresh->mapValid ? thresh->tileMax : *global);
+	*fallback = thresh->fallback;
+}
@@ -0,0 +1,63 @@
+#ifndef __autothresh_h__
+#define __autothresh_h__
+
+// ============================================================================
+//	Automatic threshold selection
+// ============================================================================
+//
+//	Builds a histogram per 64x64 tile from a fixed grid of sample pixels, so
+//	the cost per frame does not depend on the scene. In the adaptive mode
+//	every tile with enough contrast is thresholded halfway between its dark
+//	and bright levels, the flat tiles use an Otsu threshold of the whole
+//	frame. When nothing has been detected for a few frames the adaptive mode
+//	falls back to the global Otsu threshold alone, and back again.
+//
+//	The bias is added to every automatic threshold, the manual mode uses
+//	the manual threshold like before.
+//
+
+#include <AR/ar.h>
+
+#include "frontend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	AUTOTHRESH_MANUAL,
+	AUTOTHRESH_ADAPTIVE,
+	AUTOTHRESH_OTSU,
+	AUTOTHRESH_MODE_COUNT
+} AutoThreshMode_T;
+
+typedef struct AutoThresh_T AutoThresh_T;
+
+// xsize and ysize are the camera frame size.
+AutoThresh_T *autoThreshCreate(int xsize, int ysize);
+void autoThreshDestroy(AutoThresh_T *thresh);
+
+void autoThreshSetMode(AutoThresh_T *thresh, AutoThreshMode_T mode);
+AutoThreshMode_T autoThreshMode(AutoThresh_T *thresh);
+const char *autoThreshModeName(AutoThreshMode_T mode);
+
+void autoThreshSetManual(AutoThresh_T *thresh, int value);
+void autoThreshSetBias(AutoThresh_T *thresh, int bias);
+
+// Analyse a camera frame. Returns the global threshold and sets map to the
+// tile thresholds, or to NULL when the global one applies everywhere. The
+// map stays valid until the next call.
+int autoThreshUpdate(AutoThresh_T *thresh, ARUint8 *image, const ThresholdMap_T **map);
+
+// Whether the last analysed frame had any identified marker.
+void autoThreshFeedback(AutoThresh_T *thresh, int found);
+
+// Thresholds of the last frame for the debug text. fallback is TRUE while
+// the adaptive mode uses the global threshold alone.
+void autoThreshStats(AutoThresh_T *thresh, int *global, int *tileMin, int *tileMax, int *fallback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __autothresh_h__
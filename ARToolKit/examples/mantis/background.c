@@ -0,0 +1,474 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  define GL_GLEXT_PROTOTYPES
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/param.h>
+
+#include "background.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define BACKGROUND_GRID			20		// Distortion compensation grid, like argl.
+#define BACKGROUND_WAIT			100000000	// Fence wait slice in nanoseconds.
+
+// OpenGL 1.5 to 4.4, opengl32.lib only exports 1.1.
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#  define GL_PIXEL_UNPACK_BUFFER	0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#  define GL_STREAM_DRAW			0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#  define GL_WRITE_ONLY				0x88B9
+#endif
+#ifndef GL_MAP_READ_BIT
+#  define GL_MAP_READ_BIT			0x0001
+#  define GL_MAP_WRITE_BIT			0x0002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#  define GL_MAP_PERSISTENT_BIT		0x0040
+#  define GL_MAP_COHERENT_BIT		0x0080
+#  define GL_CLIENT_STORAGE_BIT		0x0200
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#  define GL_SYNC_GPU_COMMANDS_COMPLETE	0x9117
+#  define GL_SYNC_FLUSH_COMMANDS_BIT	0x00000001
+#  define GL_TIMEOUT_EXPIRED		0x911B
+#endif
+#ifndef GL_BGR
+#  define GL_BGR					0x80E0
+#endif
+#ifndef GL_BGRA
+#  define GL_BGRA					0x80E1
+#endif
+#ifndef GL_ABGR_EXT
+#  define GL_ABGR_EXT				0x8000
+#endif
+#ifndef GL_UNSIGNED_INT_8_8_8_8
+#  define GL_UNSIGNED_INT_8_8_8_8	0x8035
+#endif
+#ifndef GL_UNSIGNED_INT_8_8_8_8_REV
+#  define GL_UNSIGNED_INT_8_8_8_8_REV	0x8367
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#  define GL_CLAMP_TO_EDGE			0x812F
+#endif
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+#ifdef _WIN32
+typedef unsigned __int64 Timeout_T;
+#else
+typedef unsigned long long Timeout_T;
+#endif
+typedef void (APIENTRY *GenBuffers_T)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffers_T)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBuffer_T)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferData_T)(GLenum target, ptrdiff_t size, const GLvoid *data, GLenum usage);
+typedef GLvoid *(APIENTRY *MapBuffer_T)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY *UnmapBuffer_T)(GLenum target);
+typedef void (APIENTRY *BufferStorage_T)(GLenum target, ptrdiff_t size, const GLvoid *data, GLbitfield flags);
+typedef GLvoid *(APIENTRY *MapBufferRange_T)(GLenum target, ptrdiff_t offset, ptrdiff_t length, GLbitfield access);
+typedef void *(APIENTRY *FenceSync_T)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY *ClientWaitSync_T)(void *sync, GLbitfield flags, Timeout_T timeout);
+typedef void (APIENTRY *DeleteSync_T)(void *sync);
+
+struct Background_T {
+	int			xsize;
+	int			ysize;
+	int			imageSize;
+	GLenum		format;
+	GLenum		type;
+
+	GLuint		texture;
+	int			textureWidth;		// Power of two, the frame fills the lower left corner.
+	int			textureHeight;
+	GLfloat		*texcoords;			// Distortion compensation grid, (BACKGROUND_GRID + 1)^2 points.
+	GLfloat		*vertices;
+
+	GLuint		buffers[BACKGROUND_BUFFERS];
+	int			next;				// Ring position when copying per frame.
+	int			persistent;
+	ARUint8		*memory[BACKGROUND_BUFFERS];	// Persistent mappings.
+	void		*fence[BACKGROUND_BUFFERS];		// Set when a draw read the buffer.
+	int			last;				// Buffer of the last draw, -1 for none.
+};
+
+// ============================================================================
+//	Globals
+// ============================================================================
+
+static GenBuffers_T		gGenBuffers = NULL;
+static DeleteBuffers_T	gDeleteBuffers = NULL;
+static BindBuffer_T		gBindBuffer = NULL;
+static BufferData_T		gBufferData = NULL;
+static MapBuffer_T		gMapBuffer = NULL;
+static UnmapBuffer_T	gUnmapBuffer = NULL;
+static BufferStorage_T	gBufferStorage = NULL;
+static MapBufferRange_T	gMapBufferRange = NULL;
+static FenceSync_T		gFenceSync = NULL;
+static ClientWaitSync_T	gClientWaitSync = NULL;
+static DeleteSync_T		gDeleteSync = NULL;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static int backgroundExtension(const char *name)
+{
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS), *p;
+	size_t length = strlen(name);
+
+	if (extensions == NULL) return (FALSE);
+	for (p = strstr(extensions, name); p != NULL; p = strstr(p + length, name)) {
+		if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) return (TRUE);
+	}
+	return (FALSE);
+}
+
+static int backgroundVersion(int wantMajor, int wantMinor)
+{
+	const char *version;
+	int major = 1, minor = 0;
+
+	if ((version = (const char *)glGetString(GL_VERSION)) != NULL) sscanf(version, "%d.%d", &major, &minor);
+	return (major > wantMajor || (major == wantMajor && minor >= wantMinor));
+}
+
+// Pixel buffer objects need OpenGL 2.1 or GL_ARB_pixel_buffer_object,
+// persistent mapping OpenGL 4.4 or GL_ARB_buffer_storage with sync objects.
+static int backgroundFunctions(void)
+{
+	if (!backgroundVersion(2, 1) && !backgroundExtension("GL_ARB_pixel_buffer_object")) return (FALSE);
+#ifdef _WIN32
+	gGenBuffers = (GenBuffers_T)wglGetProcAddress("glGenBuffers");
+	gDeleteBuffers = (DeleteBuffers_T)wglGetProcAddress("glDeleteBuffers");
+	gBindBuffer = (BindBuffer_T)wglGetProcAddress("glBindBuffer");
+	gBufferData = (BufferData_T)wglGetProcAddress("glBufferData");
+	gMapBuffer = (MapBuffer_T)wglGetProcAddress("glMapBuffer");
+	gUnmapBuffer = (UnmapBuffer_T)wglGetProcAddress("glUnmapBuffer");
+	if (gGenBuffers == NULL) {
+		gGenBuffers = (GenBuffers_T)wglGetProcAddress("glGenBuffersARB");
+		gDeleteBuffers = (DeleteBuffers_T)wglGetProcAddress("glDeleteBuffersARB");
+		gBindBuffer = (BindBuffer_T)wglGetProcAddress("glBindBufferARB");
+		gBufferData = (BufferData_T)wglGetProcAddress("glBufferDataARB");
+		gMapBuffer = (MapBuffer_T)wglGetProcAddress("glMapBufferARB");
+		gUnmapBuffer = (UnmapBuffer_T)wglGetProcAddress("glUnmapBufferARB");
+	}
+	if (backgroundVersion(4, 4) || (backgroundExtension("GL_ARB_buffer_storage") && backgroundExtension("GL_ARB_sync"))) {
+		gBufferStorage = (BufferStorage_T)wglGetProcAddress("glBufferStorage");
+		gMapBufferRange = (MapBufferRange_T)wglGetProcAddress("glMapBufferRange");
+		gFenceSync = (FenceSync_T)wglGetProcAddress("glFenceSync");
+		gClientWaitSync = (ClientWaitSync_T)wglGetProcAddress("glClientWaitSync");
+		gDeleteSync = (DeleteSync_T)wglGetProcAddress("glDeleteSync");
+	}
+#else
+	gGenBuffers = (GenBuffers_T)glGenBuffers;
+	gDeleteBuffers = (DeleteBuffers_T)glDeleteBuffers;
+	gBindBuffer = (BindBuffer_T)glBindBuffer;
+	gBufferData = (BufferData_T)glBufferData;
+	gMapBuffer = (MapBuffer_T)glMapBuffer;
+	gUnmapBuffer = (UnmapBuffer_T)glUnmapBuffer;
+#  ifdef GL_VERSION_4_4
+	if (backgroundVersion(4, 4) || (backgroundExtension("GL_ARB_buffer_storage") && backgroundExtension("GL_ARB_sync"))) {
+		gBufferStorage = (BufferStorage_T)glBufferStorage;
+		gMapBufferRange = (MapBufferRange_T)glMapBufferRange;
+		gFenceSync = (FenceSync_T)glFenceSync;
+		gClientWaitSync = (ClientWaitSync_T)glClientWaitSync;
+		gDeleteSync = (DeleteSync_T)glDeleteSync;
+	}
+#  endif
+#endif
+	if (gBufferStorage == NULL || gMapBufferRange == NULL || gFenceSync == NULL || gClientWaitSync == NULL || gDeleteSync == NULL) {
+		gBufferStorage = NULL;
+	}
+	return (gGenBuffers != NULL && gDeleteBuffers != NULL && gBindBuffer != NULL && gBufferData != NULL &&
+		gMapBuffer != NULL && gUnmapBuffer != NULL);
+}
+
+// The upload format of the camera pixels, as arglDispImage() uses it.
+static int backgroundFormat(GLenum *format, GLenum *type)
+{
+	*type = GL_UNSIGNED_BYTE;
+	switch (AR_DEFAULT_PIXEL_FORMAT) {
+		case AR_PIXEL_FORMAT_RGB:	*format = GL_RGB; break;
+		case AR_PIXEL_FORMAT_BGR:	*format = GL_BGR; break;
+		case AR_PIXEL_FORMAT_RGBA:	*format = GL_RGBA; break;
+		case AR_PIXEL_FORMAT_BGRA:	*format = GL_BGRA; break;
+		case AR_PIXEL_FORMAT_ABGR:	*format = GL_ABGR_EXT; break;
+		case AR_PIXEL_FORMAT_ARGB:
+			*format = GL_BGRA;
+#ifdef AR_BIG_ENDIAN
+			*type = GL_UNSIGNED_INT_8_8_8_8_REV;
+#else
+			*type = GL_UNSIGNED_INT_8_8_8_8;
+#endif
+			break;
+		default:
+			return (FALSE);
+	}
+	return (TRUE);
+}
+
+static int backgroundPowerOfTwo(int size)
+{
+	int result = 1;
+
+	while (result < size) result *= 2;
+	return (result);
+}
+
+// Texture coordinates sample the observed (distorted) frame, the vertices
+// sit at the ideal screen positions, like argl's distortion compensation.
+static void backgroundGrid(Background_T *bg, const ARParam *cparam)
+{
+	double ox, oy, ix, iy;
+	int i, j, k;
+
+	for (j = 0; j <= BACKGROUND_GRID; j++) {
+		oy = (double)cparam->ysize * j / BACKGROUND_GRID;
+		for (i = 0; i <= BACKGROUND_GRID; i++) {
+			ox = (double)cparam->xsize * i / BACKGROUND_GRID;
+			arParamObserv2Ideal(cparam->dist_factor, ox, oy, &ix, &iy);
+			k = (j * (BACKGROUND_GRID + 1) + i) * 2;
+			bg->texcoords[k] = (GLfloat)(ox / bg->textureWidth);
+			bg->texcoords[k + 1] = (GLfloat)(oy / bg->textureHeight);
+			bg->vertices[k] = (GLfloat)ix;
+			bg->vertices[k + 1] = (GLfloat)(cparam->ysize - iy);
+		}
+	}
+}
+
+Background_T *backgroundCreate(const ARParam *cparam)
+{
+	Background_T *bg;
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	int i;
+
+	if (!backgroundFunctions()) {
+		fprintf(stderr, "backgroundCreate(): No pixel buffer objects.\n");
+		return (NULL);
+	}
+	if ((bg = (Background_T *)calloc(1, sizeof(Background_T))) == NULL) return (NULL);
+	if (!backgroundFormat(&bg->format, &bg->type)) {
+		fprintf(stderr, "backgroundCreate(): Pixel format not supported.\n");
+		free(bg);
+		return (NULL);
+	}
+	bg->xsize = cparam->xsize;
+	bg->ysize = cparam->ysize;
+	bg->imageSize = cparam->xsize * cparam->ysize * AR_PIX_SIZE_DEFAULT;
+	bg->textureWidth = backgroundPowerOfTwo(cparam->xsize);
+	bg->textureHeight = backgroundPowerOfTwo(cparam->ysize);
+	bg->last = -1;
+	bg->texcoords = (GLfloat *)malloc((BACKGROUND_GRID + 1) * (BACKGROUND_GRID + 1) * 2 * sizeof(GLfloat));
+	bg->vertices = (GLfloat *)malloc((BACKGROUND_GRID + 1) * (BACKGROUND_GRID + 1) * 2 * sizeof(GLfloat));
+	if (bg->texcoords == NULL || bg->vertices == NULL) {
+		backgroundDestroy(bg);
+		return (NULL);
+	}
+	backgroundGrid(bg, cparam);
+
+	glGenTextures(1, &bg->texture);
+	glBindTexture(GL_TEXTURE_2D, bg->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, bg->textureWidth, bg->textureHeight, 0, bg->format, bg->type, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// The snapshot images are read by arglDispImage() in the other draw
+	// modes, so ask for cached client memory rather than write-combined.
+	gGenBuffers(BACKGROUND_BUFFERS, bg->buffers);
+	bg->persistent = (gBufferStorage != NULL);
+	for (i = 0; i < BACKGROUND_BUFFERS; i++) {
+		gBindBuffer(GL_PIXEL_UNPACK_BUFFER, bg->buffers[i]);
+		if (bg->persistent) {
+			gBufferStorage(GL_PIXEL_UNPACK_BUFFER, bg->imageSize, NULL, flags | GL_CLIENT_STORAGE_BIT);
+			if ((bg->memory[i] = (ARUint8 *)gMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bg->imageSize, flags)) == NULL) {
+				fprintf(stderr, "backgroundCreate(): Persistent mapping failed, mapping per frame.\n");
+				bg->persistent = FALSE;
+			}
+		} else {
+			gBufferData(GL_PIXEL_UNPACK_BUFFER, bg->imageSize, NULL, GL_STREAM_DRAW);
+		}
+	}
+	gBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// Buffers with immutable storage cannot be orphaned, start over.
+	if (gBufferStorage != NULL && !bg->persistent) {
+		for (i = 0; i < BACKGROUND_BUFFERS; i++) {
+			if (bg->memory[i] == NULL) continue;
+			gBindBuffer(GL_PIXEL_UNPACK_BUFFER, bg->buffers[i]);
+			gUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			bg->memory[i] = NULL;
+		}
+		gBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		gDeleteBuffers(BACKGROUND_BUFFERS, bg->buffers);
+		gGenBuffers(BACKGROUND_BUFFERS, bg->buffers);
+		for (i = 0; i < BACKGROUND_BUFFERS; i++) {
+			gBindBuffer(GL_PIXEL_UNPACK_BUFFER, bg->buffers[i]);
+			gBufferData(GL_PIXEL_UNPACK_BUFFER, bg->imageSize, NULL, GL_STREAM_DRAW);
+		}
+		gBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	return (bg);
+}
+
+void backgroundDestroy(Background_T *bg)
+{
+	int i;
+
+	if (bg == NULL) return;
+	if (bg->texture != 0) {
+		backgroundRelease(bg);
+		for (i = 0; i < BACKGROUND_BUFFERS; i++) {
+			if (bg->fence[i] != NULL) gDeleteSync(bg->fence[i]);
+			if (bg->memory[i] == NULL) continue;
+			gBindBuffer(GL_PIXEL_UNPACK_BUFFER, bg->buffers[i]);
+			gUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		gBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		gDeleteBuffers(BACKGROUND_BUFFERS, bg->buffers);
+		glDeleteTextures(1, &bg->texture);
+	}
+	free(bg->texcoords);
+	free(bg->vertices);
+	free(bg);
+}
+
+int backgroundPersistent(Background_T *bg)
+{
+	return (bg->persistent);
+}
+
+ARUint8 *backgroundImageMemory(Background_T *bg, int index)
+{
+	if (!bg->persistent || index < 0 || index >= BACKGROUND_BUFFERS) return (NULL);
+	return (bg->memory[index]);
+}
+
+// Start the transfer of a frame into the texture. A frame in one of the
+// persistent buffers is read from there, any other frame is copied into
+// the next buffer of the ring. Its previous contents are orphaned, so the
+// copy never waits for an upload still in flight.
+static void backgroundUpload(Background_T *bg, ARUint8 *image)
+{
+	ARUint8 *dest;
+	const GLvoid *pixels = NULL;
+	int i;
+
+	for (i = 0; i < BACKGROUND_BUFFERS; i++) {
+		if (bg->memory[i] != NULL && bg->memory[i] == image) break;
+	}
+	if (i < BACKGROUND_BUFFERS) {
+		gBindBuffer(GL_PIXEL_UNPACK_BUFFER, bg->buffers[i]);
+	} else if (bg->persistent) {
+		// The pipeline is not using the buffers, upload from client memory.
+		pixels = image;
+	} else {
+		i = bg->next;
+		bg->next = (bg->next + 1) % BACKGROUND_BUFFERS;
+		gBindBuffer(GL_PIXEL_UNPACK_BUFFER, bg->buffers[i]);
+		gBufferData(GL_PIXEL_UNPACK_BUFFER, bg->imageSize, NULL, GL_STREAM_DRAW);
+		if ((dest = (ARUint8 *)gMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY)) != NULL) {
+			memcpy(dest, image, bg->imageSize);
+			gUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, bg->texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, (AR_PIX_SIZE_DEFAULT == 4 ? 4 : 1));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, bg->xsize, bg->ysize, bg->format, bg->type, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	gBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// The pipeline writes into a persistent buffer again once the snapshot
+	// is handed back, see backgroundRelease().
+	if (i < BACKGROUND_BUFFERS && bg->memory[i] != NULL) {
+		if (bg->fence[i] != NULL) gDeleteSync(bg->fence[i]);
+		bg->fence[i] = gFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		bg->last = i;
+	}
+}
+
+void backgroundDraw(Background_T *bg, ARUint8 *image)
+{
+	int i, j, k;
+
+	if (image != NULL) backgroundUpload(bg, image);
+	else glBindTexture(GL_TEXTURE_2D, bg->texture);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, bg->xsize, 0.0, bg->ysize, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_BLEND);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_TEXTURE_2D);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+	for (j = 0; j < BACKGROUND_GRID; j++) {
+		glBegin(GL_QUAD_STRIP);
+		for (i = 0; i <= BACKGROUND_GRID; i++) {
+			k = (j * (BACKGROUND_GRID + 1) + i) * 2;
+			glTexCoord2fv(bg->texcoords + k);
+			glVertex2fv(bg->vertices + k);
+			k += (BACKGROUND_GRID + 1) * 2;
+			glTexCoord2fv(bg->texcoords + k);
+			glVertex2fv(bg->vertices + k);
+		}
+		glEnd();
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+void backgroundRelease(Background_T *bg)
+{
+	if (bg == NULL || bg->last < 0) return;
+	if (bg->fence[bg->last] != NULL) {
+		while (gClientWaitSync(bg->fence[bg->last], GL_SYNC_FLUSH_COMMANDS_BIT, BACKGROUND_WAIT) == GL_TIMEOUT_EXPIRED);
+		gDeleteSync(bg->fence[bg->last]);
+		bg->fence[bg->last] = NULL;
+	}
+	bg->last = -1;
+}
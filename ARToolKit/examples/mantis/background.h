@@ -0,0 +1,56 @@
+#ifndef __background_h__
+#define __background_h__
+
+// ============================================================================
+//	Camera background streamed through pixel buffer objects
+// ============================================================================
+//
+//	Draws the video frame like arglDispImage() in full resolution texture
+//	mode, with the same lens distortion compensation, but uploads it from a
+//	ring of pixel buffer objects so glTexSubImage2D() returns immediately and
+//	the transfer overlaps with rendering.
+//
+//	Where the driver has GL_ARB_buffer_storage, the buffers stay mapped for
+//	the whole run and the pipeline snapshots use them as their image memory
+//	(see pipelineSetImageMemory()), so the detection thread copies each
+//	camera frame straight into memory the GPU reads from. Otherwise every
+//	draw maps the next buffer of the ring and copies the frame into it.
+//
+
+#include <AR/ar.h>
+#include <AR/param.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BACKGROUND_BUFFERS		3	// One per pipeline snapshot.
+
+typedef struct Background_T Background_T;
+
+// cparam is the camera parameter set with arInitCparam(). Must be called
+// from the GL thread. Returns NULL when the driver has no pixel buffer
+// objects or the pixel format cannot be uploaded as is.
+Background_T *backgroundCreate(const ARParam *cparam);
+void backgroundDestroy(Background_T *bg);
+
+// TRUE when the buffers are mapped persistently. backgroundImageMemory()
+// then returns one xsize * ysize * AR_PIX_SIZE_DEFAULT image per buffer,
+// NULL otherwise. The memory stays valid until backgroundDestroy().
+int backgroundPersistent(Background_T *bg);
+ARUint8 *backgroundImageMemory(Background_T *bg, int index);
+
+// Draw a frame. image may be a persistently mapped buffer or any other
+// memory, which is then copied into the ring. NULL draws the last frame
+// again without uploading it.
+void backgroundDraw(Background_T *bg, ARUint8 *image);
+
+// Wait until the GPU has read the last frame drawn from mapped memory.
+// Call before pipelineAcquire() hands that snapshot back to the pipeline.
+void backgroundRelease(Background_T *bg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __background_h__
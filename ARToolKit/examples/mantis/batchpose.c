@@ -0,0 +1,334 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <AR/config.h>
+#include <AR/param.h>
+#include <AR/ar.h>
+
+#include "batchpose.h"
+#include "thread.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define BATCHPOSE_ITERATIONS		5		// Gauss-Newton steps, converged well within a pixel from the last frame's pose.
+#define BATCHPOSE_DAMPING			1e-6	// Relative diagonal damping, keeps degenerate views solvable.
+#define BATCHPOSE_THREAD_MARKERS	16		// Fewest markers worth a thread of their own.
+#define BATCHPOSE_THREADS_MAX		8
+#define BATCHPOSE_ARRAYS			56		// Per marker values, see BatchPose_T.
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	struct BatchPose_T	*batch;
+	int					begin;
+	int					end;
+} BatchPoseRange_T;
+
+struct BatchPose_T {
+	int					capacity;
+	int					count;
+	int					threads;
+	double				mat[3][4];			// Projection of ideal screen coordinates.
+	double				*block;				// All arrays below, capacity values each.
+	double				*r[9];				// Rotation, row major.
+	double				*t[3];
+	double				*x[4], *y[4];		// Corners in marker coordinates, z is 0.
+	double				*u[4], *v[4];		// Detected corners.
+	double				*h[21];				// Normal equations, packed upper triangle.
+	double				*g[6];
+	double				*err;
+	BatchPoseRange_T	ranges[BATCHPOSE_THREADS_MAX];
+};
+
+// Index of element (i, j), i <= j, in a packed 6x6 upper triangle.
+static const int gPacked[6][6] = {
+	{  0,  1,  2,  3,  4,  5 },
+	{  1,  6,  7,  8,  9, 10 },
+	{  2,  7, 11, 12, 13, 14 },
+	{  3,  8, 12, 15, 16, 17 },
+	{  4,  9, 13, 16, 18, 19 },
+	{  5, 10, 14, 17, 19, 20 }
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+BatchPose_T *batchPoseCreate(int capacity, const ARParam *cparam)
+{
+	BatchPose_T *batch;
+	double *p;
+	int i;
+
+	if ((batch = (BatchPose_T *)calloc(1, sizeof(BatchPose_T))) == NULL) return (NULL);
+	if (capacity < 1) capacity = 1;
+	if ((batch->block = (double *)calloc((size_t)capacity * BATCHPOSE_ARRAYS, sizeof(double))) == NULL) {
+		free(batch);
+		return (NULL);
+	}
+	batch->capacity = capacity;
+	batch->threads = 1;
+	memcpy(batch->mat, cparam->mat, sizeof(batch->mat));
+
+	p = batch->block;
+	for (i = 0; i < 9; i++, p += capacity) batch->r[i] = p;
+	for (i = 0; i < 3; i++, p += capacity) batch->t[i] = p;
+	for (i = 0; i < 4; i++, p += capacity) batch->x[i] = p;
+	for (i = 0; i < 4; i++, p += capacity) batch->y[i] = p;
+	for (i = 0; i < 4; i++, p += capacity) batch->u[i] = p;
+	for (i = 0; i < 4; i++, p += capacity) batch->v[i] = p;
+	for (i = 0; i < 21; i++, p += capacity) batch->h[i] = p;
+	for (i = 0; i < 6; i++, p += capacity) batch->g[i] = p;
+	batch->err = p;
+	return (batch);
+}
+
+void batchPoseDestroy(BatchPose_T *batch)
+{
+	if (batch == NULL) return;
+	free(batch->block);
+	free(batch);
+}
+
+void batchPoseSetThreads(BatchPose_T *batch, int threads)
+{
+	if (threads < 1) threads = 1;
+	if (threads > BATCHPOSE_THREADS_MAX) threads = BATCHPOSE_THREADS_MAX;
+	batch->threads = threads;
+}
+
+void batchPoseClear(BatchPose_T *batch)
+{
+	batch->count = 0;
+}
+
+int batchPoseAdd(BatchPose_T *batch, ARMarkerInfo *marker_info, double center[2], double width, double prev[3][4])
+{
+	double r[3][3], len, dot, hw = width * 0.5;
+	int k = batch->count, dir = marker_info->dir, c, i;
+
+	if (k >= batch->capacity) return (-1);
+
+	// Corner order of arGetTransMat(), starting at the pattern's top left.
+	for (c = 0; c < 4; c++) {
+		batch->u[c][k] = marker_info->vertex[(4 - dir + c) % 4][0];
+		batch->v[c][k] = marker_info->vertex[(4 - dir + c) % 4][1];
+	}
+	batch->x[0][k] = center[0] - hw;	batch->y[0][k] = center[1] + hw;
+	batch->x[1][k] = center[0] + hw;	batch->y[1][k] = center[1] + hw;
+	batch->x[2][k] = center[0] + hw;	batch->y[2][k] = center[1] - hw;
+	batch->x[3][k] = center[0] - hw;	batch->y[3][k] = center[1] - hw;
+
+	// Poses refined frame after frame drift off a rotation, orthonormalize.
+	for (i = 0; i < 3; i++) {
+		r[0][i] = prev[0][i];
+		r[1][i] = prev[1][i];
+	}
+	len = sqrt(r[0][0] * r[0][0] + r[0][1] * r[0][1] + r[0][2] * r[0][2]);
+	for (i = 0; i < 3; i++) r[0][i] /= len;
+	dot = r[0][0] * r[1][0] + r[0][1] * r[1][1] + r[0][2] * r[1][2];
+	for (i = 0; i < 3; i++) r[1][i] -= dot * r[0][i];
+	len = sqrt(r[1][0] * r[1][0] + r[1][1] * r[1][1] + r[1][2] * r[1][2]);
+	for (i = 0; i < 3; i++) r[1][i] /= len;
+	r[2][0] = r[0][1] * r[1][2] - r[0][2] * r[1][1];
+	r[2][1] = r[0][2] * r[1][0] - r[0][0] * r[1][2];
+	r[2][2] = r[0][0] * r[1][1] - r[0][1] * r[1][0];
+
+	for (i = 0; i < 9; i++) batch->r[i][k] = r[i / 3][i % 3];
+	for (i = 0; i < 3; i++) batch->t[i][k] = prev[i][3];
+	batch->count++;
+	return (k);
+}
+
+// Accumulate the normal equations of all corners, or only the error when
+// normal is FALSE. Rotations are perturbed on the camera side,
+// R' = exp(w) R, so the rotation columns of the Jacobian are (R X) x grad.
+static void batchPoseNormal(BatchPose_T *b, int begin, int end, int normal)
+{
+	double (*m)[4] = b->mat;
+	double *r0 = b->r[0], *r1 = b->r[1], *r3 = b->r[3], *r4 = b->r[4], *r6 = b->r[6], *r7 = b->r[7];
+	double *t0 = b->t[0], *t1 = b->t[1], *t2 = b->t[2];
+	double *xc, *yc, *uc, *vc, *err = b->err;
+	double ax, ay, az, px, py, pz, iz, pu, pv, ru, rv;
+	double gu[3], gv[3], ju[6], jv[6];
+	int c, k, i, j;
+
+	for (k = begin; k < end; k++) err[k] = 0.0;
+	if (normal) {
+		for (i = 0; i < 21; i++) memset(&b->h[i][begin], 0, (end - begin) * sizeof(double));
+		for (i = 0; i < 6; i++) memset(&b->g[i][begin], 0, (end - begin) * sizeof(double));
+	}
+
+	for (c = 0; c < 4; c++) {
+		xc = b->x[c];
+		yc = b->y[c];
+		uc = b->u[c];
+		vc = b->v[c];
+		for (k = begin; k < end; k++) {
+			ax = r0[k] * xc[k] + r1[k] * yc[k];
+			ay = r3[k] * xc[k] + r4[k] * yc[k];
+			az = r6[k] * xc[k] + r7[k] * yc[k];
+			px = ax + t0[k];
+			py = ay + t1[k];
+			pz = az + t2[k];
+			iz = 1.0 / (m[2][0] * px + m[2][1] * py + m[2][2] * pz + m[2][3]);
+			pu = (m[0][0] * px + m[0][1] * py + m[0][2] * pz + m[0][3]) * iz;
+			pv = (m[1][0] * px + m[1][1] * py + m[1][2] * pz + m[1][3]) * iz;
+			ru = uc[k] - pu;
+			rv = vc[k] - pv;
+			err[k] += ru * ru + rv * rv;
+			if (!normal) continue;
+
+			for (i = 0; i < 3; i++) {
+				gu[i] = (m[0][i] - pu * m[2][i]) * iz;
+				gv[i] = (m[1][i] - pv * m[2][i]) * iz;
+			}
+			ju[0] = ay * gu[2] - az * gu[1];
+			ju[1] = az * gu[0] - ax * gu[2];
+			ju[2] = ax * gu[1] - ay * gu[0];
+			jv[0] = ay * gv[2] - az * gv[1];
+			jv[1] = az * gv[0] - ax * gv[2];
+			jv[2] = ax * gv[1] - ay * gv[0];
+			for (i = 0; i < 3; i++) {
+				ju[3 + i] = gu[i];
+				jv[3 + i] = gv[i];
+			}
+			for (i = 0; i < 6; i++) {
+				for (j = i; j < 6; j++) b->h[gPacked[i][j]][k] += ju[i] * ju[j] + jv[i] * jv[j];
+				b->g[i][k] += ju[i] * ru + jv[i] * rv;
+			}
+		}
+	}
+	for (k = begin; k < end; k++) err[k] *= 0.25;
+}
+
+// Solve every marker's normal equations by Cholesky and apply the step.
+static void batchPoseStep(BatchPose_T *b, int begin, int end)
+{
+	double a[21], d[6], e[3][3], r[3][3];
+	double sum, theta, s, cs, w0, w1, w2;
+	int k, i, j, n, ok;
+
+	for (k = begin; k < end; k++) {
+		for (i = 0; i < 21; i++) a[i] = b->h[i][k];
+		for (i = 0; i < 6; i++) {
+			a[gPacked[i][i]] += BATCHPOSE_DAMPING * a[gPacked[i][i]] + 1e-12;
+			d[i] = b->g[i][k];
+		}
+
+		// a = L L^T in place, L^T in the upper triangle.
+		ok = TRUE;
+		for (i = 0; i < 6; i++) {
+			sum = a[gPacked[i][i]];
+			for (n = 0; n < i; n++) sum -= a[gPacked[n][i]] * a[gPacked[n][i]];
+			if (sum <= 0.0) {
+				ok = FALSE;
+				sum = 1.0;
+			}
+			a[gPacked[i][i]] = sqrt(sum);
+			for (j = i + 1; j < 6; j++) {
+				sum = a[gPacked[i][j]];
+				for (n = 0; n < i; n++) sum -= a[gPacked[n][i]] * a[gPacked[n][j]];
+				a[gPacked[i][j]] = sum / a[gPacked[i][i]];
+			}
+		}
+		for (i = 0; i < 6; i++) {
+			for (n = 0; n < i; n++) d[i] -= a[gPacked[n][i]] * d[n];
+			d[i] /= a[gPacked[i][i]];
+		}
+		for (i = 5; i >= 0; i--) {
+			for (n = i + 1; n < 6; n++) d[i] -= a[gPacked[i][n]] * d[n];
+			d[i] /= a[gPacked[i][i]];
+		}
+		if (!ok) continue;
+
+		// R = exp(w) R by Rodrigues, t += dt.
+		w0 = d[0];
+		w1 = d[1];
+		w2 = d[2];
+		theta = sqrt(w0 * w0 + w1 * w1 + w2 * w2);
+		if (theta < 1e-12) {
+			s = 1.0;
+			cs = 0.5;
+		} else {
+			s = sin(theta) / theta;
+			cs = (1.0 - cos(theta)) / (theta * theta);
+		}
+		e[0][0] = 1.0 - cs * (w1 * w1 + w2 * w2);
+		e[0][1] = -s * w2 + cs * w0 * w1;
+		e[0][2] = s * w1 + cs * w0 * w2;
+		e[1][0] = s * w2 + cs * w0 * w1;
+		e[1][1] = 1.0 - cs * (w0 * w0 + w2 * w2);
+		e[1][2] = -s * w0 + cs * w1 * w2;
+		e[2][0] = -s * w1 + cs * w0 * w2;
+		e[2][1] = s * w0 + cs * w1 * w2;
+		e[2][2] = 1.0 - cs * (w0 * w0 + w1 * w1);
+		for (i = 0; i < 3; i++) {
+			for (j = 0; j < 3; j++) {
+				r[i][j] = e[i][0] * b->r[j][k] + e[i][1] * b->r[3 + j][k] + e[i][2] * b->r[6 + j][k];
+			}
+		}
+		for (i = 0; i < 9; i++) b->r[i][k] = r[i / 3][i % 3];
+		for (i = 0; i < 3; i++) b->t[i][k] += d[3 + i];
+	}
+}
+
+static void batchPoseRefineRange(void *arg)
+{
+	BatchPoseRange_T *range = (BatchPoseRange_T *)arg;
+	int i;
+
+	for (i = 0; i < BATCHPOSE_ITERATIONS; i++) {
+		batchPoseNormal(range->batch, range->begin, range->end, TRUE);
+		batchPoseStep(range->batch, range->begin, range->end);
+	}
+	batchPoseNormal(range->batch, range->begin, range->end, FALSE);
+}
+
+void batchPoseRefine(BatchPose_T *batch)
+{
+	Thread_T *threads[BATCHPOSE_THREADS_MAX];
+	int n, per, i;
+
+	if (batch->count == 0) return;
+	n = batch->count / BATCHPOSE_THREAD_MARKERS;
+	if (n > batch->threads) n = batch->threads;
+	if (n < 1) n = 1;
+	per = (batch->count + n - 1) / n;
+	for (i = 0; i < n; i++) {
+		batch->ranges[i].batch = batch;
+		batch->ranges[i].begin = i * per;
+		batch->ranges[i].end = (i == n - 1 ? batch->count : (i + 1) * per);
+	}
+
+	// The caller takes the first range.
+	for (i = 1; i < n; i++) threads[i] = threadCreate(batchPoseRefineRange, &batch->ranges[i]);
+	batchPoseRefineRange(&batch->ranges[0]);
+	for (i = 1; i < n; i++) {
+		if (threads[i] != NULL) threadJoin(threads[i]);
+		else batchPoseRefineRange(&batch->ranges[i]);
+	}
+}
+
+double batchPoseResult(BatchPose_T *batch, int slot, double trans[3][4])
+{
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		trans[i][0] = batch->r[i * 3][slot];
+		trans[i][1] = batch->r[i * 3 + 1][slot];
+		trans[i][2] = batch->r[i * 3 + 2][slot];
+		trans[i][3] = batch->t[i][slot];
+	}
+	return (batch->err[slot]);
+}
@@ -0,0 +1,56 @@
+#ifndef __batchpose_h__
+#define __batchpose_h__
+
+// ============================================================================
+//	Batched pose refinement of tracked markers
+// ============================================================================
+//
+//	Refines the poses of all markers tracked from the previous frame
+//	together, in place of one arGetTransMatCont() call per marker. The
+//	markers of a batch are kept as a structure of arrays, one array per
+//	rotation, translation and corner coordinate, and every Gauss-Newton
+//	step of the reprojection error runs across all markers in the same
+//	loops, which the compiler vectorizes. Large batches can be split over
+//	threads.
+//
+//	Corners are the ideal screen coordinates of arGetMarkerInfo(), so the
+//	refinement matches ARToolKit's AR_FITTING_TO_IDEAL mode. The error is
+//	the mean squared corner distance in pixels like arGetTransMat() returns.
+//
+
+#include <AR/ar.h>
+#include <AR/param.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BATCHPOSE_MAX_FIT_ERROR		1.0		// Above this, try arGetTransMat() like arGetTransMatCont() does.
+
+typedef struct BatchPose_T BatchPose_T;
+
+// capacity is the most markers per batch, cparam the camera parameters
+// set with arInitCparam().
+BatchPose_T *batchPoseCreate(int capacity, const ARParam *cparam);
+void batchPoseDestroy(BatchPose_T *batch);
+
+// Split batches over up to this many threads, 1 by default. Small batches
+// always run on the calling thread.
+void batchPoseSetThreads(BatchPose_T *batch, int threads);
+
+void batchPoseClear(BatchPose_T *batch);
+
+// Add a marker to refine from its previous pose, with the center and width
+// of arGetTransMatCont(). Returns its slot, -1 when the batch is full.
+int batchPoseAdd(BatchPose_T *batch, ARMarkerInfo *marker_info, double center[2], double width, double prev[3][4]);
+
+void batchPoseRefine(BatchPose_T *batch);
+
+// Refined pose of a slot. Returns the fitting error.
+double batchPoseResult(BatchPose_T *batch, int slot, double trans[3][4]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __batchpose_h__
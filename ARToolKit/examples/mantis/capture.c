@@ -0,0 +1,164 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "capture.h"
+#include "thread.h"
+#include "profile.h"
+#include "hrtimer.h"
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+struct Capture_T {
+	FrameSource_T	*source;
+	int				camera;			// For the trace.
+	FramePool_T		*pool;
+	int				imageSize;
+	long			sequence;
+
+	Mutex_T			*mutex;			// Guards latest.
+	Frame_T			*latest;		// Newest frame, not taken yet.
+
+	volatile long	captured;
+	volatile long	dropped;
+	volatile long	overruns;
+	volatile long	quit;
+	Thread_T		*thread;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+Capture_T *captureCreate(FrameSource_T *source, int camera, int xsize, int ysize, int holders)
+{
+	Capture_T *capture;
+
+	if ((capture = (Capture_T *)calloc(1, sizeof(Capture_T))) == NULL) return (NULL);
+	capture->source = source;
+	capture->camera = camera;
+	capture->imageSize = xsize * ysize * AR_PIX_SIZE_DEFAULT;
+	if ((capture->pool = framePoolCreate(holders + 2, capture->imageSize)) == NULL || (capture->mutex = mutexCreate()) == NULL) {
+		fprintf(stderr, "captureCreate(): Out of memory.\n");
+		captureDestroy(capture);
+		return (NULL);
+	}
+	return (capture);
+}
+
+void captureDestroy(Capture_T *capture)
+{
+	if (capture == NULL) return;
+	captureStop(capture);
+	frameRelease(capture->latest);
+	framePoolDestroy(capture->pool);
+	mutexDestroy(capture->mutex);
+	free(capture);
+}
+
+Frame_T *captureTake(Capture_T *capture)
+{
+	Frame_T *frame;
+
+	mutexLock(capture->mutex);
+	frame = capture->latest;
+	capture->latest = NULL;
+	mutexUnlock(capture->mutex);
+	return (frame);
+}
+
+// Publish a frame as the newest one.
+static void capturePublish(Capture_T *capture, Frame_T *frame)
+{
+	Frame_T *old;
+
+	mutexLock(capture->mutex);
+	old = capture->latest;
+	capture->latest = frame;
+	mutexUnlock(capture->mutex);
+	if (old != NULL) {
+		atomicAdd(&capture->dropped, 1);
+		frameRelease(old);
+	}
+}
+
+static void captureWorker(void *arg)
+{
+	Capture_T *capture = (Capture_T *)arg;
+	Frame_T *frame;
+	ARUint8 *image;
+	double t, grabbed;
+
+#ifdef _WIN32
+	CoInitialize(NULL);
+#endif
+	profileSetCamera(capture->camera);
+
+	while (!atomicLoad(&capture->quit)) {
+		t = profileBegin();
+		if ((image = frameSourceGetImage(capture->source)) == NULL) {
+			arUtilSleep(1);
+			continue;
+		}
+		grabbed = hrtimerNow();
+		atomicAdd(&capture->captured, 1);
+
+		// The camera buffer goes back right after the copy. Without a free
+		// buffer the frame still waiting is overwritten, the newest wins.
+		if ((frame = framePoolTake(capture->pool)) == NULL && (frame = captureTake(capture)) != NULL) atomicAdd(&capture->dropped, 1);
+		if (frame != NULL) {
+			memcpy(frame->image, image, capture->imageSize);
+			frame->sequence = capture->sequence;
+			frame->time = grabbed;
+		} else {
+			atomicAdd(&capture->overruns, 1);
+		}
+		capture->sequence++;
+		frameSourceCapNext(capture->source);
+		profileEnd(PROFILE_GRAB, t);
+
+		if (frame != NULL) capturePublish(capture, frame);
+	}
+
+#ifdef _WIN32
+	CoUninitialize();
+#endif
+}
+
+int captureStart(Capture_T *capture)
+{
+	if (capture->thread != NULL) return (TRUE);
+	atomicStore(&capture->quit, 0);
+	if ((capture->thread = threadCreate(captureWorker, capture)) == NULL) {
+		fprintf(stderr, "captureStart(): Unable to start capture thread.\n");
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+void captureStop(Capture_T *capture)
+{
+	if (capture->thread == NULL) return;
+	atomicStore(&capture->quit, 1);
+	threadJoin(capture->thread);
+	capture->thread = NULL;
+}
+
+void captureTakeStats(Capture_T *capture, CaptureStats_T *stats)
+{
+	stats->captured = atomicExchange(&capture->captured, 0);
+	stats->dropped = atomicExchange(&capture->dropped, 0);
+	stats->overruns = atomicExchange(&capture->overruns, 0);
+}
@@ -0,0 +1,57 @@
+#ifndef __capture_h__
+#define __capture_h__
+
+// ============================================================================
+//	Capture thread handing out the latest camera frame
+// ============================================================================
+//
+//	One thread per frame source grabs every frame as soon as the camera has
+//	it, copies it into a frame of a pool (see framepool.h) and gives the
+//	camera buffer straight back with frameSourceCapNext(). The camera thus
+//	never waits for detection or drawing.
+//
+//	Only the newest frame is kept for the consumer. A frame replaced before
+//	it was taken counts as dropped; when the consumers hold every pool
+//	buffer, the waiting frame is overwritten. A frame that finds no buffer
+//	at all counts as an overrun and is lost.
+//
+
+#include <AR/ar.h>
+
+#include "framesource.h"
+#include "framepool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	long		captured;		// Frames grabbed from the source.
+	long		dropped;		// Replaced by a newer frame before being taken.
+	long		overruns;		// Lost, every pool buffer was held.
+} CaptureStats_T;
+
+typedef struct Capture_T Capture_T;
+
+// The source must be capturing already. holders is the number of frames
+// the consumers keep at most at the same time; the pool has two more, for
+// the frame being grabbed and the one waiting to be taken. camera numbers
+// the capture thread in the trace, see profileSetCamera().
+Capture_T *captureCreate(FrameSource_T *source, int camera, int xsize, int ysize, int holders);
+void captureDestroy(Capture_T *capture);
+
+int  captureStart(Capture_T *capture);
+void captureStop(Capture_T *capture);
+
+// The newest frame not taken yet, with a reference for the caller to
+// release, or NULL when there is none.
+Frame_T *captureTake(Capture_T *capture);
+
+// Counts since the last call.
+void captureTakeStats(Capture_T *capture, CaptureStats_T *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __capture_h__
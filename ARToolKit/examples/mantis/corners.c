@@ -0,0 +1,224 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <AR/config.h>
+#include <AR/param.h>
+#include <AR/ar.h>
+
+#include "corners.h"
+#include "frontend.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define CORNERS_SAMPLES			32		// Profiles across an edge at most.
+#define CORNERS_SAMPLES_MIN		6		// Edge points a line is fitted to at least.
+#define CORNERS_SPACING			2.0		// Pixels between the profiles at least.
+#define CORNERS_REACH			4		// Profile half length in pixels, covers the error of the half image.
+#define CORNERS_REACH_MIN		2
+#define CORNERS_BORDER_PART		8		// Reach at most this part of the edge, inside the black border.
+#define CORNERS_CONTRAST		60		// Least colour sum step across two pixels.
+#define CORNERS_OUTLIER			1.0		// Pixels off the first line fit.
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	double		x[CORNERS_SAMPLES];
+	double		y[CORNERS_SAMPLES];
+	int			count;
+} CornersEdge_T;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+// Colour sum of a pixel, the brightness arLabeling() thresholds.
+#define CORNERS_GRAY(p)		((int)(p)[0] + (int)(p)[1] + (int)(p)[2])
+
+// Bilinear colour sum at x y, which must be inside the frame.
+static double cornersGray(const ARUint8 *image, int xsize, double x, double y)
+{
+	const int row = xsize * AR_PIX_SIZE_DEFAULT;
+	const ARUint8 *p;
+	int ix = (int)floor(x), iy = (int)floor(y);
+	double fx = x - ix, fy = y - iy;
+
+	p = image + iy * row + ix * AR_PIX_SIZE_DEFAULT + FRONTEND_CHANNEL;
+	return ((1.0 - fy) * ((1.0 - fx) * CORNERS_GRAY(p) + fx * CORNERS_GRAY(p + AR_PIX_SIZE_DEFAULT)) +
+			fy * ((1.0 - fx) * CORNERS_GRAY(p + row) + fx * CORNERS_GRAY(p + row + AR_PIX_SIZE_DEFAULT)));
+}
+
+// Subpixel position of the dark to bright step along the profile from x y
+// in the direction nx ny, as an offset in pixels. FALSE without one.
+static int cornersProfile(const ARUint8 *image, int xsize, int ysize, double x, double y, double nx, double ny, int reach, double *offset)
+{
+	double value[2 * CORNERS_REACH + 3], g[2 * CORNERS_REACH + 1];
+	double px, py, denom;
+	int k, n = 2 * reach + 3, best = -1;
+
+	for (k = 0; k < n; k += n - 1) {
+		px = x + (k - reach - 1) * nx;
+		py = y + (k - reach - 1) * ny;
+		if (px < 0.0 || py < 0.0 || px >= xsize - 1 || py >= ysize - 1) return (FALSE);
+	}
+	for (k = 0; k < n; k++) value[k] = cornersGray(image, xsize, x + (k - reach - 1) * nx, y + (k - reach - 1) * ny);
+	for (k = 0; k < n - 2; k++) {
+		g[k] = value[k + 2] - value[k];
+		if (best < 0 || g[k] > g[best]) best = k;
+	}
+
+	// The step must lie inside the profile, and be one.
+	if (best == 0 || best == n - 3 || g[best] < CORNERS_CONTRAST) return (FALSE);
+	denom = g[best - 1] - 2.0 * g[best] + g[best + 1];
+	*offset = best - reach + (denom < 0.0 ? 0.5 * (g[best - 1] - g[best + 1]) / denom : 0.0);
+	return (TRUE);
+}
+
+// Least squares line through the points as arGetLine() puts it, the normal
+// a b across the main axis. skip marks points left out, may be NULL.
+static int cornersFitLine(const CornersEdge_T *edge, const int *skip, double line[3])
+{
+	double mx = 0.0, my = 0.0, sxx = 0.0, sxy = 0.0, syy = 0.0, dx, dy, ex, ey, len, lambda;
+	int i, n = 0;
+
+	for (i = 0; i < edge->count; i++) {
+		if (skip != NULL && skip[i]) continue;
+		mx += edge->x[i];
+		my += edge->y[i];
+		n++;
+	}
+	if (n < CORNERS_SAMPLES_MIN) return (FALSE);
+	mx /= n;
+	my /= n;
+	for (i = 0; i < edge->count; i++) {
+		if (skip != NULL && skip[i]) continue;
+		dx = edge->x[i] - mx;
+		dy = edge->y[i] - my;
+		sxx += dx * dx;
+		sxy += dx * dy;
+		syy += dy * dy;
+	}
+
+	// Eigenvector of the larger eigenvalue of the 2x2 covariance.
+	lambda = 0.5 * (sxx + syy) + sqrt(0.25 * (sxx - syy) * (sxx - syy) + sxy * sxy);
+	if (sxy != 0.0) {
+		ex = sxy;
+		ey = lambda - sxx;
+	} else if (sxx >= syy) {
+		ex = 1.0;
+		ey = 0.0;
+	} else {
+		ex = 0.0;
+		ey = 1.0;
+	}
+	len = sqrt(ex * ex + ey * ey);
+	line[0] = ey / len;
+	line[1] = -ex / len;
+	line[2] = -(line[0] * mx + line[1] * my);
+	return (TRUE);
+}
+
+// Edge points along the side from the ideal corners a to b, found in the
+// observed frame. cx cy is the ideal centre of the square.
+static void cornersFindEdge(const ARUint8 *image, const double a[2], const double b[2], double cx, double cy, int reach, CornersEdge_T *edge)
+{
+	double len, dx, dy, nx, ny, margin, t, ix, iy, ox, oy, ox1, oy1, onx, ony, olen, offset;
+	int samples, i;
+
+	edge->count = 0;
+	dx = b[0] - a[0];
+	dy = b[1] - a[1];
+	if ((len = sqrt(dx * dx + dy * dy)) == 0.0) return;
+	dx /= len;
+	dy /= len;
+
+	// Outward normal, the border inside is dark.
+	nx = dy;
+	ny = -dx;
+	if (nx * (0.5 * (a[0] + b[0]) - cx) + ny * (0.5 * (a[1] + b[1]) - cy) < 0.0) {
+		nx = -nx;
+		ny = -ny;
+	}
+
+	// Keep the profiles clear of the other sides at the corners.
+	margin = reach + 1.0;
+	samples = (int)((len - 2.0 * margin) / CORNERS_SPACING);
+	if (samples > CORNERS_SAMPLES) samples = CORNERS_SAMPLES;
+	for (i = 0; i < samples; i++) {
+		t = margin + (len - 2.0 * margin) * (i + 0.5) / samples;
+		ix = a[0] + t * dx;
+		iy = a[1] + t * dy;
+		arParamIdeal2Observ(arParam.dist_factor, ix, iy, &ox, &oy);
+		arParamIdeal2Observ(arParam.dist_factor, ix + nx, iy + ny, &ox1, &oy1);
+		onx = ox1 - ox;
+		ony = oy1 - oy;
+		if ((olen = sqrt(onx * onx + ony * ony)) == 0.0) continue;
+		onx /= olen;
+		ony /= olen;
+		if (!cornersProfile(image, arImXsize, arImYsize, ox, oy, onx, ony, reach, &offset)) continue;
+		arParamObserv2Ideal(arParam.dist_factor, ox + offset * onx, oy + offset * ony, &edge->x[edge->count], &edge->y[edge->count]);
+		edge->count++;
+	}
+}
+
+int cornersRefine(ARMarkerInfo *marker, const ARUint8 *image)
+{
+	CornersEdge_T edge;
+	double line[4][3], vertex[4][2], cx = 0.0, cy = 0.0, dx, dy, len, edgeMin = -1.0, w;
+	int skip[CORNERS_SAMPLES], fitted[4], reach, moved = 0, i, j, k;
+
+	if (!FRONTEND_FORMAT_OK) return (0);
+
+	for (i = 0; i < 4; i++) {
+		cx += 0.25 * marker->vertex[i][0];
+		cy += 0.25 * marker->vertex[i][1];
+		j = (i + 1) % 4;
+		dx = marker->vertex[j][0] - marker->vertex[i][0];
+		dy = marker->vertex[j][1] - marker->vertex[i][1];
+		len = sqrt(dx * dx + dy * dy);
+		if (edgeMin < 0.0 || len < edgeMin) edgeMin = len;
+	}
+	reach = (int)(edgeMin / CORNERS_BORDER_PART);
+	if (reach > CORNERS_REACH) reach = CORNERS_REACH;
+	if (reach < CORNERS_REACH_MIN) return (0);
+
+	// Edge i runs from vertex i to vertex i + 1, like arGetLine() has it.
+	// An edge without enough points keeps its line.
+	for (i = 0; i < 4; i++) {
+		memcpy(line[i], marker->line[i], sizeof(line[i]));
+		cornersFindEdge(image, marker->vertex[i], marker->vertex[(i + 1) % 4], cx, cy, reach, &edge);
+		if (!(fitted[i] = cornersFitLine(&edge, NULL, line[i]))) continue;
+		for (k = 0; k < edge.count; k++) {
+			skip[k] = (fabs(line[i][0] * edge.x[k] + line[i][1] * edge.y[k] + line[i][2]) > CORNERS_OUTLIER);
+		}
+		cornersFitLine(&edge, skip, line[i]);
+	}
+
+	// Corners where the lines meet, as in arGetLine(). A corner between two
+	// unfitted edges stays.
+	for (i = 0; i < 4; i++) {
+		j = (i + 3) % 4;
+		if (!fitted[i] && !fitted[j]) {
+			vertex[i][0] = marker->vertex[i][0];
+			vertex[i][1] = marker->vertex[i][1];
+			continue;
+		}
+		w = line[j][0] * line[i][1] - line[i][0] * line[j][1];
+		if (fabs(w) < 0.0001) return (0);
+		vertex[i][0] = (line[j][1] * line[i][2] - line[i][1] * line[j][2]) / w;
+		vertex[i][1] = (line[i][0] * line[j][2] - line[j][0] * line[i][2]) / w;
+		if (fabs(vertex[i][0] - marker->vertex[i][0]) > 2 * reach || fabs(vertex[i][1] - marker->vertex[i][1]) > 2 * reach) return (0);
+		moved++;
+	}
+	memcpy(marker->line, line, sizeof(line));
+	memcpy(marker->vertex, vertex, sizeof(vertex));
+	return (moved);
+}
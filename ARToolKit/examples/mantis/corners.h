@@ -0,0 +1,37 @@
+#ifndef __corners_h__
+#define __corners_h__
+
+// ============================================================================
+//	Subpixel refinement of marker corners
+// ============================================================================
+//
+//	Squares found in the half image have corners fitted to contours of every
+//	other pixel. Each edge is looked at again in the full frame: along up to
+//	32 short profiles across it the dark to bright step is found to a
+//	fraction of a pixel, a line is fitted to the steps, refitted without the
+//	ones far off it, and the corners are put where the lines meet.
+//
+//	Vertices stay in ideal coordinates like arGetLine() returns them, the
+//	window is looked at in the observed frame through the distortion of the
+//	installed camera parameters. Uses arParam and the frame size, so it must
+//	be called with ARToolKit locked, see arlock.h.
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Refine the corners of a marker in image, a frame of the arInitCparam()
+// size. Returns the number of corners moved, 0 when nothing changed: for
+// small squares, pixel formats other than 32 bit or corners that would move
+// further than the half image can be off. An edge without enough clear
+// steps, say near the frame border, keeps its line.
+int cornersRefine(ARMarkerInfo *marker, const ARUint8 *image);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __corners_h__
@@ -0,0 +1,109 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "framepool.h"
+#include "thread.h"
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+struct FramePool_T {
+	Frame_T			*frames;
+	int				count;
+	ARUint8			*memory;		// All images, unaligned.
+	Mutex_T			*mutex;			// Guards the free stack.
+	Frame_T			**free;
+	int				freeNum;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+FramePool_T *framePoolCreate(int count, int imageSize)
+{
+	FramePool_T *pool;
+	ARUint8 *base;
+	int stride, i;
+
+	if ((pool = (FramePool_T *)calloc(1, sizeof(FramePool_T))) == NULL) return (NULL);
+	stride = (imageSize + FRAMEPOOL_ALIGN - 1) / FRAMEPOOL_ALIGN * FRAMEPOOL_ALIGN;
+	pool->count = count;
+	pool->frames = (Frame_T *)calloc(count, sizeof(Frame_T));
+	pool->free = (Frame_T **)malloc(count * sizeof(Frame_T *));
+	pool->memory = (ARUint8 *)malloc(count * stride + FRAMEPOOL_ALIGN);
+	pool->mutex = mutexCreate();
+	if (pool->frames == NULL || pool->free == NULL || pool->memory == NULL || pool->mutex == NULL) {
+		fprintf(stderr, "framePoolCreate(): Out of memory.\n");
+		framePoolDestroy(pool);
+		return (NULL);
+	}
+
+	base = pool->memory + (FRAMEPOOL_ALIGN - (size_t)pool->memory % FRAMEPOOL_ALIGN) % FRAMEPOOL_ALIGN;
+	for (i = 0; i < count; i++) {
+		pool->frames[i].image = base + i * stride;
+		pool->frames[i].pool = pool;
+		pool->free[i] = &pool->frames[i];
+	}
+	pool->freeNum = count;
+	return (pool);
+}
+
+void framePoolDestroy(FramePool_T *pool)
+{
+	if (pool == NULL) return;
+	if (pool->frames != NULL && pool->freeNum != pool->count) {
+		fprintf(stderr, "framePoolDestroy(): %d frames still held.\n", pool->count - pool->freeNum);
+	}
+	free(pool->frames);
+	free(pool->free);
+	free(pool->memory);
+	mutexDestroy(pool->mutex);
+	free(pool);
+}
+
+Frame_T *framePoolTake(FramePool_T *pool)
+{
+	Frame_T *frame = NULL;
+
+	mutexLock(pool->mutex);
+	if (pool->freeNum > 0) frame = pool->free[--pool->freeNum];
+	mutexUnlock(pool->mutex);
+	if (frame != NULL) atomicStore(&frame->refs, 1);
+	return (frame);
+}
+
+int framePoolAvailable(FramePool_T *pool)
+{
+	int n;
+
+	mutexLock(pool->mutex);
+	n = pool->freeNum;
+	mutexUnlock(pool->mutex);
+	return (n);
+}
+
+void frameRetain(Frame_T *frame)
+{
+	atomicAdd(&frame->refs, 1);
+}
+
+void frameRelease(Frame_T *frame)
+{
+	FramePool_T *pool;
+
+	if (frame == NULL || atomicAdd(&frame->refs, -1) > 0) return;
+	pool = frame->pool;
+	mutexLock(pool->mutex);
+	pool->free[pool->freeNum++] = frame;
+	mutexUnlock(pool->mutex);
+}
@@ -0,0 +1,58 @@
+#ifndef __framepool_h__
+#define __framepool_h__
+
+// ============================================================================
+//	Pool of reference counted camera frames
+// ============================================================================
+//
+//	All frame buffers are allocated up front and aligned for SIMD loads. A
+//	frame taken from the pool carries one reference; every further holder,
+//	e.g. the detection thread or a pose snapshot waiting to be drawn, adds
+//	its own with frameRetain() and drops it with frameRelease(). The last
+//	release puts the buffer back into the pool, so holders never copy a
+//	frame to keep it and never wait for each other.
+//
+//	Taking, retaining and releasing are safe from any thread.
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAMEPOOL_ALIGN		64		// Bytes, a cache line and the widest vector load.
+
+typedef struct FramePool_T FramePool_T;
+
+typedef struct {
+	ARUint8			*image;			// Pixels of the frame, FRAMEPOOL_ALIGN aligned.
+	long			sequence;		// Number of the frame from its source, gaps are dropped frames.
+	double			time;			// hrtimerNow() when the frame was grabbed.
+
+	volatile long	refs;
+	FramePool_T		*pool;
+} Frame_T;
+
+// count buffers of imageSize bytes. NULL when out of memory.
+FramePool_T *framePoolCreate(int count, int imageSize);
+
+// All frames must have been released.
+void framePoolDestroy(FramePool_T *pool);
+
+// A free frame with one reference, NULL when all are held.
+Frame_T *framePoolTake(FramePool_T *pool);
+
+// Number of frames in the pool that nobody holds.
+int framePoolAvailable(FramePool_T *pool);
+
+void frameRetain(Frame_T *frame);
+
+// Drop a reference, frame may be NULL.
+void frameRelease(Frame_T *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __framepool_h__
@@ -0,0 +1,156 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/video.h>
+
+#include "framesource.h"
+#include "replay.h"
+#include "hrtimer.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define REPLAY_PREFIX			"replay:"
+#define REPLAY_DEFAULT_FPS		30.0
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+struct FrameSource_T {
+	AR2VideoParamT	*video;			// Live camera, or
+	Replay_T		*replay;		// recorded sequence.
+
+	ARUint8			*image;			// Replay frame handed out, not yet released.
+	double			period;			// Seconds between replayed frames, 0 for unpaced.
+	double			due;			// Time the next replayed frame is due.
+	int				ended;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static FrameSource_T *frameSourceOpenReplay(const char *spec)
+{
+	FrameSource_T *source;
+	char path[256], *opt;
+	int xsize = 0, ysize = 0, loop = TRUE;
+	double fps = -1.0;
+
+	if (strlen(spec) >= sizeof(path)) return (NULL);
+	strcpy(path, spec);
+
+	// Options follow the path, separated by ';'.
+	if ((opt = strchr(path, ';')) != NULL) *opt++ = '\0';
+	while (opt != NULL) {
+		char *nextOpt = strchr(opt, ';');
+		if (nextOpt != NULL) *nextOpt++ = '\0';
+
+		if (sscanf(opt, "size=%dx%d", &xsize, &ysize) == 2) {
+		} else if (sscanf(opt, "fps=%lf", &fps) == 1) {
+		} else if (strcmp(opt, "once") == 0) {
+			loop = FALSE;
+		} else {
+			fprintf(stderr, "frameSourceOpen(): Unknown replay option '%s'.\n", opt);
+			return (NULL);
+		}
+		opt = nextOpt;
+	}
+
+	if ((source = (FrameSource_T *)calloc(1, sizeof(FrameSource_T))) == NULL) return (NULL);
+	if ((source->replay = replayOpen(path, xsize, ysize, loop)) == NULL) {
+		free(source);
+		return (NULL);
+	}
+	if (fps < 0.0) {
+		// Not given, use the rate stored in the file.
+		fps = replayFrameRate(source->replay);
+		if (fps <= 0.0) fps = REPLAY_DEFAULT_FPS;
+	}
+	source->period = (fps > 0.0 ? 1.0 / fps : 0.0);
+	return (source);
+}
+
+FrameSource_T *frameSourceOpen(char *vconf)
+{
+	FrameSource_T *source;
+
+	if (strncmp(vconf, REPLAY_PREFIX, strlen(REPLAY_PREFIX)) == 0) {
+		return (frameSourceOpenReplay(vconf + strlen(REPLAY_PREFIX)));
+	}
+
+	if ((source = (FrameSource_T *)calloc(1, sizeof(FrameSource_T))) == NULL) return (NULL);
+	if ((source->video = ar2VideoOpen(vconf)) == NULL) {
+		free(source);
+		return (NULL);
+	}
+	return (source);
+}
+
+void frameSourceClose(FrameSource_T *source)
+{
+	if (source == NULL) return;
+	if (source->video) ar2VideoClose(source->video);
+	if (source->replay) replayClose(source->replay);
+	free(source);
+}
+
+int frameSourceInqSize(FrameSource_T *source, int *xsize, int *ysize)
+{
+	if (source->video) return (ar2VideoInqSize(source->video, xsize, ysize));
+	replayInqSize(source->replay, xsize, ysize);
+	return (0);
+}
+
+int frameSourceCapStart(FrameSource_T *source)
+{
+	if (source->video) return (ar2VideoCapStart(source->video));
+	source->due = hrtimerNow();
+	return (0);
+}
+
+int frameSourceCapStop(FrameSource_T *source)
+{
+	if (source->video) return (ar2VideoCapStop(source->video));
+	return (0);
+}
+
+ARUint8 *frameSourceGetImage(FrameSource_T *source)
+{
+	double now;
+
+	if (source->video) return (ar2VideoGetImage(source->video));
+
+	// Like a camera, hand out one frame until it is released.
+	if (source->image != NULL) return (source->image);
+	if (source->ended) return (NULL);
+	if (source->period > 0.0) {
+		now = hrtimerNow();
+		if (now < source->due) return (NULL);
+		source->due += source->period;
+		if (source->due < now) source->due = now;	// Don't try to catch up after a stall.
+	}
+	if ((source->image = replayNextFrame(source->replay)) == NULL) source->ended = TRUE;
+	return (source->image);
+}
+
+int frameSourceCapNext(FrameSource_T *source)
+{
+	if (source->video) return (ar2VideoCapNext(source->video));
+	source->image = NULL;
+	return (0);
+}
+
+int frameSourceEnded(FrameSource_T *source)
+{
+	return (source->ended);
+}
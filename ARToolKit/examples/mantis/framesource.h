@@ -0,0 +1,45 @@
+#ifndef __framesource_h__
+#define __framesource_h__
+
+// ============================================================================
+//	Camera or replay frame source
+// ============================================================================
+//
+//	Wraps the ARToolKit video library so a recorded sequence can stand in
+//	for the camera. A video config of the form
+//
+//	    replay:<path>[;size=WxH][;fps=N][;once]
+//
+//	opens the file with the replay module (see replay.h), everything else
+//	is passed to ar2VideoOpen(). Replayed frames are paced to fps (from the
+//	file or 30 by default, 0 disables pacing) and loop unless once is given.
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct FrameSource_T FrameSource_T;
+
+FrameSource_T *frameSourceOpen(char *vconf);
+void frameSourceClose(FrameSource_T *source);
+
+int frameSourceInqSize(FrameSource_T *source, int *xsize, int *ysize);
+int frameSourceCapStart(FrameSource_T *source);
+int frameSourceCapStop(FrameSource_T *source);
+
+// Same contract as arVideoGetImage()/arVideoCapNext(): NULL when no new
+// frame is ready, and the image is valid until frameSourceCapNext().
+ARUint8 *frameSourceGetImage(FrameSource_T *source);
+int frameSourceCapNext(FrameSource_T *source);
+
+// A replay without looping has delivered its last frame.
+int frameSourceEnded(FrameSource_T *source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __framesource_h__
@@ -0,0 +1,937 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "frontend.h"
+#include "corners.h"
+#include "arlock.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#  define FRONTEND_HAVE_SSE2
+#  include <emmintrin.h>
+#  if (defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#    define FRONTEND_HAVE_AVX2
+#    include <immintrin.h>
+#  endif
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
+
+// GCC and clang only emit AVX2 code in functions marked for it.
+#if defined(FRONTEND_HAVE_AVX2) && defined(__GNUC__)
+#  define TARGET_AVX2		__attribute__((target("avx2")))
+#else
+#  define TARGET_AVX2
+#endif
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define FRONTEND_LABEL_MAX		32767		// Labels have to fit the ARInt16 label image.
+#define FRONTEND_HISTORY_COUNT	4			// Frames a lost marker is kept, as in arDetectMarker().
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	int			x0, x1, y;
+	int			label;			// Provisional label.
+} Run_T;
+
+typedef struct {
+	ARMarkerInfo	marker;
+	int				count;
+} PrevMarker_T;
+
+typedef struct {
+	int			area;
+	int			clip[4];
+	double		pos[2];
+} Component_T;
+
+typedef void (*BinarizeRow_T)(const ARUint8 *src, ARUint8 *dst, int n, int step, int thresh3);
+
+struct Frontend_T {
+	FrontendMode_T	mode;
+	FrontendResolution_T resolution;
+	int				capacity;			// Pixels.
+
+	ARUint8			*mask;				// 0xFF for dark pixels, one byte per label image pixel.
+	ARUint8			*maskRef;			// Scalar binarization for frontendVerify().
+	ARInt16			*limage;
+	ARUint8			*debugImage;		// Binarized frame in the arImage format.
+	int				debugValid;
+
+	const ThresholdMap_T *map;
+	const PatternBank_T *bank;
+	ARUint8			patterns[AR_SQUARE_MAX][AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];	// Of the squares, for the bank.
+	int				originX;
+	int				originY;
+
+	Run_T			*runs;
+	int				*parent;			// Union-find over provisional labels.
+	int				*final;				// Provisional root to final label.
+
+	int				labelNum;
+	int				*labelRef;
+	int				*area;
+	int				*clip;
+	double			*pos;
+	double			*sum;
+
+	ARMarkerInfo	markers[2 * AR_SQUARE_MAX];
+	PrevMarker_T	prev[AR_SQUARE_MAX];
+	int				prevNum;
+};
+
+// ============================================================================
+//	CPU features
+// ============================================================================
+
+static int cpuHasSSE2(void)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return (TRUE);
+#elif defined(FRONTEND_HAVE_SSE2) && defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 1);
+	return ((info[3] & (1 << 26)) != 0);
+#elif defined(FRONTEND_HAVE_SSE2) && defined(__GNUC__)
+	return (__builtin_cpu_supports("sse2"));
+#else
+	return (FALSE);
+#endif
+}
+
+static int cpuHasAVX2(void)
+{
+#if defined(FRONTEND_HAVE_AVX2) && defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7) return (FALSE);
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return (FALSE);	// OSXSAVE and AVX.
+	if ((_xgetbv(0) & 6) != 6) return (FALSE);										// OS saves the YMM state.
+	__cpuidex(info, 7, 0);
+	return ((info[1] & (1 << 5)) != 0);
+#elif defined(FRONTEND_HAVE_AVX2) && defined(__GNUC__)
+	return (__builtin_cpu_supports("avx2"));
+#else
+	return (FALSE);
+#endif
+}
+
+int frontendModeAvailable(FrontendMode_T mode)
+{
+	static int sse2 = -1, avx2 = -1;
+
+	if (sse2 < 0) {
+		sse2 = cpuHasSSE2();
+		avx2 = sse2 && cpuHasAVX2();
+	}
+	switch (mode) {
+		case FRONTEND_ARTOOLKIT:	return (TRUE);
+		case FRONTEND_SCALAR:		return (FRONTEND_FORMAT_OK);
+		case FRONTEND_SSE2:			return (FRONTEND_FORMAT_OK && sse2);
+		case FRONTEND_AVX2:			return (FRONTEND_FORMAT_OK && avx2);
+		default:					return (FALSE);
+	}
+}
+
+FrontendMode_T frontendBestMode(void)
+{
+	int mode;
+
+	for (mode = FRONTEND_MODE_COUNT - 1; mode > FRONTEND_ARTOOLKIT; mode--) {
+		if (frontendModeAvailable((FrontendMode_T)mode)) return ((FrontendMode_T)mode);
+	}
+	return (FRONTEND_ARTOOLKIT);
+}
+
+const char *frontendModeName(FrontendMode_T mode)
+{
+	static const char *names[FRONTEND_MODE_COUNT] = { "artoolkit", "scalar", "sse2", "avx2" };
+
+	return (mode >= 0 && mode < FRONTEND_MODE_COUNT ? names[mode] : "unknown");
+}
+
+// ============================================================================
+//	Binarization
+// ============================================================================
+//
+//	A pixel is dark when the sum of its colour bytes is at most three times
+//	the threshold, like in arLabeling(). In half mode every other pixel of
+//	every other row is used.
+//
+
+static void binarizeRowScalar(const ARUint8 *src, ARUint8 *dst, int n, int step, int thresh3)
+{
+	int x;
+
+	src += FRONTEND_CHANNEL;
+	for (x = 0; x < n; x++, src += step * AR_PIX_SIZE_DEFAULT) {
+		dst[x] = (src[0] + src[1] + src[2] <= thresh3 ? 0xFF : 0);
+	}
+}
+
+#ifdef FRONTEND_HAVE_SSE2
+// Colour sums of four pixels as 32 bit lanes.
+static __m128i sumSSE2(__m128i pixels, __m128i weights)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+	__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+
+	return (_mm_madd_epi16(_mm_packs_epi32(lo, hi), _mm_set1_epi16(1)));
+}
+
+// Four pixels, every other one in half mode.
+static __m128i loadSSE2(const ARUint8 *src, int step)
+{
+	__m128i a = _mm_loadu_si128((const __m128i *)src);
+	__m128i b;
+
+	if (step == 1) return (a);
+	b = _mm_loadu_si128((const __m128i *)(src + 16));
+	return (_mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0))));
+}
+
+static void binarizeRowSSE2(const ARUint8 *src, ARUint8 *dst, int n, int step, int thresh3)
+{
+	const __m128i weights = (FRONTEND_CHANNEL == 0 ? _mm_set_epi16(0, 1, 1, 1, 0, 1, 1, 1) : _mm_set_epi16(1, 1, 1, 0, 1, 1, 1, 0));
+	const __m128i limit = _mm_set1_epi32(thresh3 + 1);
+	const int block = 4 * step * AR_PIX_SIZE_DEFAULT;
+	__m128i m0, m1, m2, m3;
+	int x;
+
+	for (x = 0; x + 16 <= n; x += 16, src += 4 * block) {
+		m0 = _mm_cmpgt_epi32(limit, sumSSE2(loadSSE2(src, step), weights));
+		m1 = _mm_cmpgt_epi32(limit, sumSSE2(loadSSE2(src + block, step), weights));
+		m2 = _mm_cmpgt_epi32(limit, sumSSE2(loadSSE2(src + 2 * block, step), weights));
+		m3 = _mm_cmpgt_epi32(limit, sumSSE2(loadSSE2(src + 3 * block, step), weights));
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_packs_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3)));
+	}
+	binarizeRowScalar(src, dst + x, n - x, step, thresh3);
+}
+#endif
+
+#ifdef FRONTEND_HAVE_AVX2
+// Colour sums of eight pixels as 32 bit lanes, in order.
+TARGET_AVX2 static __m256i sumAVX2(__m256i pixels, __m256i weights)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), weights);
+	__m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), weights);
+
+	return (_mm256_madd_epi16(_mm256_packs_epi32(lo, hi), _mm256_set1_epi16(1)));
+}
+
+// Eight pixels, every other one in half mode.
+TARGET_AVX2 static __m256i loadAVX2(const ARUint8 *src, int step)
+{
+	__m256i a = _mm256_loadu_si256((const __m256i *)src);
+	__m256i b;
+
+	if (step == 1) return (a);
+	b = _mm256_loadu_si256((const __m256i *)(src + 32));
+	a = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+	return (_mm256_permute4x64_epi64(a, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+TARGET_AVX2 static void binarizeRowAVX2(const ARUint8 *src, ARUint8 *dst, int n, int step, int thresh3)
+{
+	const __m256i weights = (FRONTEND_CHANNEL == 0 ? _mm256_set_epi16(0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1) : _mm256_set_epi16(1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0));
+	const __m256i limit = _mm256_set1_epi32(thresh3 + 1);
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);	// Undo the per lane packing.
+	const int block = 8 * step * AR_PIX_SIZE_DEFAULT;
+	__m256i m0, m1, m2, m3, m;
+	int x;
+
+	for (x = 0; x + 32 <= n; x += 32, src += 4 * block) {
+		m0 = _mm256_cmpgt_epi32(limit, sumAVX2(loadAVX2(src, step), weights));
+		m1 = _mm256_cmpgt_epi32(limit, sumAVX2(loadAVX2(src + block, step), weights));
+		m2 = _mm256_cmpgt_epi32(limit, sumAVX2(loadAVX2(src + 2 * block, step), weights));
+		m3 = _mm256_cmpgt_epi32(limit, sumAVX2(loadAVX2(src + 3 * block, step), weights));
+		m = _mm256_packs_epi16(_mm256_packs_epi32(m0, m1), _mm256_packs_epi32(m2, m3));
+		_mm256_storeu_si256((__m256i *)(dst + x), _mm256_permutevar8x32_epi32(m, order));
+	}
+	binarizeRowScalar(src, dst + x, n - x, step, thresh3);
+}
+#endif
+
+static BinarizeRow_T binarizeRowFunc(FrontendMode_T mode)
+{
+#ifdef FRONTEND_HAVE_AVX2
+	if (mode == FRONTEND_AVX2) return (binarizeRowAVX2);
+#endif
+#ifdef FRONTEND_HAVE_SSE2
+	if (mode == FRONTEND_SSE2) return (binarizeRowSSE2);
+#endif
+	return (binarizeRowScalar);
+}
+
+// Label image size for the current arInitCparam() frame and processing mode.
+static int labelSize(int *lxsize, int *lysize)
+{
+	int step = (arImageProcMode == AR_IMAGE_PROC_IN_HALF ? 2 : 1);
+
+	*lxsize = arImXsize / step;
+	*lysize = arImYsize / step;
+	return (step);
+}
+
+// Binarize one label image row with the tile thresholds, a run of pixels
+// per tile.
+static void binarizeRowMap(Frontend_T *frontend, BinarizeRow_T row, const ARUint8 *src, ARUint8 *dst, int y, int lxsize, int step)
+{
+	const ThresholdMap_T *map = frontend->map;
+	const ARUint8 *thresh;
+	int x, end, tx, ty;
+
+	ty = (y * step + frontend->originY) / map->tileSize;
+	if (ty >= map->tilesY) ty = map->tilesY - 1;
+	thresh = map->thresh + ty * map->tilesX;
+
+	for (x = 0; x < lxsize; x = end) {
+		tx = (x * step + frontend->originX) / map->tileSize;
+		if (tx >= map->tilesX - 1) {
+			tx = map->tilesX - 1;
+			end = lxsize;
+		} else {
+			end = ((tx + 1) * map->tileSize - frontend->originX + step - 1) / step;
+			if (end > lxsize) end = lxsize;
+		}
+		row(src + x * step * AR_PIX_SIZE_DEFAULT, dst + x, end - x, step, thresh[tx] * 3);
+	}
+}
+
+// The border is left clear, arLabeling() does not look at it either.
+static void binarize(Frontend_T *frontend, FrontendMode_T mode, ARUint8 *image, int xsize, int thresh, ARUint8 *mask, int lxsize, int lysize, int step)
+{
+	BinarizeRow_T row = binarizeRowFunc(mode);
+	ARUint8 *src;
+	int y;
+
+	memset(mask, 0, lxsize);
+	memset(mask + (lysize - 1) * lxsize, 0, lxsize);
+	for (y = 1; y < lysize - 1; y++) {
+		src = image + y * step * xsize * AR_PIX_SIZE_DEFAULT;
+		if (frontend->map != NULL) binarizeRowMap(frontend, row, src, mask + y * lxsize, y, lxsize, step);
+		else row(src, mask + y * lxsize, lxsize, step, thresh * 3);
+		mask[y * lxsize] = 0;
+		mask[y * lxsize + lxsize - 1] = 0;
+	}
+}
+
+// Dark pixels white, the rest black, like arLabeling() draws arImage.
+static void drawDebugImage(Frontend_T *frontend, int xsize, int ysize, int lxsize, int step)
+{
+	ARUint8 *dst = frontend->debugImage;
+	const ARUint8 *mask;
+	int x, y;
+
+	for (y = 0; y < ysize; y++) {
+		mask = frontend->mask + (y / step) * lxsize;
+		for (x = 0; x < xsize; x++, dst += AR_PIX_SIZE_DEFAULT) {
+			memset(dst, mask[x / step], AR_PIX_SIZE_DEFAULT);
+		}
+	}
+	frontend->debugValid = TRUE;
+}
+
+// Binarize a row of a gray image, dark is at most thresh.
+static void binarizeGrayRow(const ARUint8 *src, ARUint8 *dst, int n, int thresh, int simd)
+{
+	int x = 0;
+#ifdef FRONTEND_HAVE_SSE2
+	const __m128i t = _mm_set1_epi8((char)thresh);
+	__m128i v;
+
+	if (simd) {
+		for (; x + 16 <= n; x += 16) {
+			v = _mm_loadu_si128((const __m128i *)(src + x));
+			_mm_storeu_si128((__m128i *)(dst + x), _mm_cmpeq_epi8(_mm_min_epu8(v, t), v));
+		}
+	}
+#endif
+	for (; x < n; x++) dst[x] = (src[x] <= thresh ? 0xFF : 0);
+}
+
+// ============================================================================
+//	Labeling
+// ============================================================================
+//
+//	Dark pixels are collected into runs per row and the runs are joined with
+//	the 8-connected runs of the previous row by union-find. The second pass
+//	writes the final labels into the label image and collects the area,
+//	centroid and bounding box of every component in the layout returned by
+//	arLabeling(), with an identity label_ref.
+//
+
+static int scanSet(const ARUint8 *row, int x, int end, int simd)
+{
+#ifdef FRONTEND_HAVE_SSE2
+	if (simd) {
+		while (x + 16 <= end && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(row + x))) == 0) x += 16;
+	}
+#endif
+	while (x < end && row[x] == 0) x++;
+	return (x);
+}
+
+static int scanClear(const ARUint8 *row, int x, int end, int simd)
+{
+#ifdef FRONTEND_HAVE_SSE2
+	if (simd) {
+		while (x + 16 <= end && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(row + x))) == 0xFFFF) x += 16;
+	}
+#endif
+	while (x < end && row[x] != 0) x++;
+	return (x);
+}
+
+static int findRoot(int *parent, int i)
+{
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return (i);
+}
+
+static void joinLabels(int *parent, int a, int b)
+{
+	a = findRoot(parent, a);
+	b = findRoot(parent, b);
+	if (a < b) parent[b] = a;
+	else if (b < a) parent[a] = b;
+}
+
+static void labelMask(Frontend_T *frontend, int lxsize, int lysize)
+{
+	const int simd = (frontend->mode >= FRONTEND_SSE2);
+	Run_T *run;
+	ARUint8 *row;
+	ARInt16 *lrow;
+	int runNum = 0, provNum = 0, labelNum = 0;
+	int prevBegin = 0, rowBegin, p, q;
+	int x, end, y, i, k, root, label, len;
+
+	// Runs and provisional labels.
+	for (y = 1; y < lysize - 1; y++) {
+		row = frontend->mask + y * lxsize;
+		rowBegin = runNum;
+		p = prevBegin;
+		x = 1;
+		while ((x = scanSet(row, x, lxsize - 1, simd)) < lxsize - 1) {
+			end = scanClear(row, x, lxsize - 1, simd);
+			run = &frontend->runs[runNum++];
+			run->x0 = x;
+			run->x1 = end - 1;
+			run->y = y;
+			run->label = -1;
+
+			while (p < rowBegin && frontend->runs[p].x1 < x - 1) p++;
+			for (q = p; q < rowBegin && frontend->runs[q].x0 <= end; q++) {
+				if (run->label < 0) run->label = frontend->runs[q].label;
+				else joinLabels(frontend->parent, run->label, frontend->runs[q].label);
+			}
+			if (run->label < 0) {
+				frontend->parent[provNum] = provNum;
+				run->label = provNum++;
+			}
+			x = end;
+		}
+		prevBegin = rowBegin;
+	}
+
+	// Final labels and component statistics.
+	memset(frontend->limage, 0, lxsize * lysize * sizeof(ARInt16));
+	for (i = 0; i < provNum; i++) frontend->final[i] = 0;
+	for (i = 0; i < runNum; i++) {
+		run = &frontend->runs[i];
+		root = findRoot(frontend->parent, run->label);
+		if ((label = frontend->final[root]) == 0) {
+			if (labelNum == FRONTEND_LABEL_MAX) continue;		// Left out like unlabeled noise.
+			label = frontend->final[root] = ++labelNum;
+			k = label - 1;
+			frontend->area[k] = 0;
+			frontend->sum[k * 2 + 0] = frontend->sum[k * 2 + 1] = 0.0;
+			frontend->clip[k * 4 + 0] = run->x0;
+			frontend->clip[k * 4 + 1] = run->x1;
+			frontend->clip[k * 4 + 2] = run->y;
+			frontend->clip[k * 4 + 3] = run->y;
+		}
+		k = label - 1;
+		len = run->x1 - run->x0 + 1;
+		frontend->area[k] += len;
+		frontend->sum[k * 2 + 0] += (double)((run->x0 + run->x1) * len / 2);
+		frontend->sum[k * 2 + 1] += (double)run->y * len;
+		if (run->x0 < frontend->clip[k * 4 + 0]) frontend->clip[k * 4 + 0] = run->x0;
+		if (run->x1 > frontend->clip[k * 4 + 1]) frontend->clip[k * 4 + 1] = run->x1;
+		frontend->clip[k * 4 + 3] = run->y;
+
+		lrow = frontend->limage + run->y * lxsize;
+		for (x = run->x0; x <= run->x1; x++) lrow[x] = (ARInt16)label;
+	}
+
+	for (k = 0; k < labelNum; k++) {
+		frontend->pos[k * 2 + 0] = frontend->sum[k * 2 + 0] / frontend->area[k];
+		frontend->pos[k * 2 + 1] = frontend->sum[k * 2 + 1] / frontend->area[k];
+		frontend->labelRef[k] = k + 1;
+	}
+	frontend->labelNum = labelNum;
+}
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+Frontend_T *frontendCreate(int xsize, int ysize)
+{
+	Frontend_T *frontend;
+	int runCap = (xsize / 2 + 1) * ysize;
+
+	if ((frontend = (Frontend_T *)calloc(1, sizeof(Frontend_T))) == NULL) return (NULL);
+	frontend->capacity = xsize * ysize;
+	frontend->mask = (ARUint8 *)malloc(frontend->capacity);
+	frontend->maskRef = (ARUint8 *)malloc(frontend->capacity);
+	frontend->limage = (ARInt16 *)malloc(frontend->capacity * sizeof(ARInt16));
+	frontend->debugImage = (ARUint8 *)malloc(frontend->capacity * AR_PIX_SIZE_DEFAULT);
+	frontend->runs = (Run_T *)malloc(runCap * sizeof(Run_T));
+	frontend->parent = (int *)malloc(runCap * sizeof(int));
+	frontend->final = (int *)malloc(runCap * sizeof(int));
+	frontend->labelRef = (int *)malloc(FRONTEND_LABEL_MAX * sizeof(int));
+	frontend->area = (int *)malloc(FRONTEND_LABEL_MAX * sizeof(int));
+	frontend->clip = (int *)malloc(FRONTEND_LABEL_MAX * 4 * sizeof(int));
+	frontend->pos = (double *)malloc(FRONTEND_LABEL_MAX * 2 * sizeof(double));
+	frontend->sum = (double *)malloc(FRONTEND_LABEL_MAX * 2 * sizeof(double));
+	if (!frontend->mask || !frontend->maskRef || !frontend->limage || !frontend->debugImage || !frontend->runs || !frontend->parent || !frontend->final ||
+		!frontend->labelRef || !frontend->area || !frontend->clip || !frontend->pos || !frontend->sum) {
+		frontendDestroy(frontend);
+		return (NULL);
+	}
+	frontend->mode = frontendBestMode();
+	frontend->resolution = (arImageProcMode == AR_IMAGE_PROC_IN_HALF ? FRONTEND_RES_HALF : FRONTEND_RES_FULL);
+	return (frontend);
+}
+
+void frontendDestroy(Frontend_T *frontend)
+{
+	if (frontend == NULL) return;
+	free(frontend->mask);
+	free(frontend->maskRef);
+	free(frontend->limage);
+	free(frontend->debugImage);
+	free(frontend->runs);
+	free(frontend->parent);
+	free(frontend->final);
+	free(frontend->labelRef);
+	free(frontend->area);
+	free(frontend->clip);
+	free(frontend->pos);
+	free(frontend->sum);
+	free(frontend);
+}
+
+void frontendSetMode(Frontend_T *frontend, FrontendMode_T mode)
+{
+	frontend->mode = (frontendModeAvailable(mode) ? mode : frontendBestMode());
+}
+
+FrontendMode_T frontendMode(Frontend_T *frontend)
+{
+	return (frontend->mode);
+}
+
+void frontendSetResolution(Frontend_T *frontend, FrontendResolution_T resolution)
+{
+	if (resolution >= 0 && resolution < FRONTEND_RES_COUNT) frontend->resolution = resolution;
+}
+
+FrontendResolution_T frontendResolution(Frontend_T *frontend)
+{
+	return (frontend->resolution);
+}
+
+const char *frontendResolutionName(FrontendResolution_T resolution)
+{
+	static const char *names[FRONTEND_RES_COUNT] = { "full", "half", "hybrid" };
+
+	return (resolution >= 0 && resolution < FRONTEND_RES_COUNT ? names[resolution] : "unknown");
+}
+
+void frontendSetThresholdMap(Frontend_T *frontend, const ThresholdMap_T *map)
+{
+	frontend->map = map;
+}
+
+void frontendSetPatternBank(Frontend_T *frontend, const PatternBank_T *bank)
+{
+	frontend->bank = bank;
+}
+
+void frontendSetOrigin(Frontend_T *frontend, int x0, int y0)
+{
+	frontend->originX = x0;
+	frontend->originY = y0;
+}
+
+ARUint8 *frontendDebugImage(Frontend_T *frontend)
+{
+	return (frontend != NULL && frontend->debugValid ? frontend->debugImage : NULL);
+}
+
+// Also installs the resolution, ARToolKit is locked by the caller.
+static int frontendUsable(Frontend_T *frontend)
+{
+	if (frontend == NULL) return (FALSE);
+	frontend->debugValid = FALSE;
+	arImageProcMode = (frontend->resolution == FRONTEND_RES_FULL ? AR_IMAGE_PROC_IN_FULL : AR_IMAGE_PROC_IN_HALF);
+	return (frontend->mode != FRONTEND_ARTOOLKIT && arImXsize * arImYsize <= frontend->capacity);
+}
+
+// arGetMarkerInfo() with the bank in place of arGetCode(). The lines and
+// the patterns of the squares need ARToolKit, the matching runs without
+// the lock.
+static int frontendIdentify(Frontend_T *frontend, ARUint8 *image, ARMarkerInfo2 *info2, int num)
+{
+	ARMarkerInfo *marker;
+	ArLockState_T lock;
+	int i, n;
+
+	if (num > AR_SQUARE_MAX) num = AR_SQUARE_MAX;
+	for (i = n = 0; i < num; i++) {
+		marker = &frontend->markers[n];
+		marker->area = info2[i].area;
+		marker->pos[0] = info2[i].pos[0];
+		marker->pos[1] = info2[i].pos[1];
+		if (arGetLine(info2[i].x_coord, info2[i].y_coord, info2[i].coord_num, info2[i].vertex, marker->line, marker->vertex) < 0) continue;
+		arGetPatt(image, info2[i].x_coord, info2[i].y_coord, info2[i].vertex, frontend->patterns[n]);
+		n++;
+	}
+
+	arLockSuspend(&lock);
+	for (i = 0; i < n; i++) {
+		marker = &frontend->markers[i];
+		patternBankMatch(frontend->bank, frontend->patterns[i], &marker->id, &marker->dir, &marker->cf);
+	}
+	arLockResume(&lock);
+	return (n);
+}
+
+// Corners of the squares found in the half image, in the full frame.
+static void frontendRefine(Frontend_T *frontend, ARUint8 *image, ARMarkerInfo *markers, int num)
+{
+	int i;
+
+	if (frontend == NULL || frontend->resolution != FRONTEND_RES_HYBRID) return;
+	for (i = 0; i < num; i++) cornersRefine(&markers[i], image);
+}
+
+// Binarize, label and detect the squares. Returns the number of markers
+// copied into frontend->markers, or -1 on error. Only the contour tracing
+// and pattern matching need ARToolKit, other cameras may use it while this
+// frame is labeled, see arlock.h.
+static int frontendMarkers(Frontend_T *frontend, ARUint8 *image, int thresh)
+{
+	ARMarkerInfo2 *info2;
+	ARMarkerInfo *info;
+	ArLockState_T lock;
+	int xsize = arImXsize, ysize = arImYsize, lxsize, lysize, step, num;
+
+	if (thresh < 0) thresh = 0;
+	if (thresh > 255) thresh = 255;
+
+	step = labelSize(&lxsize, &lysize);
+	arLockSuspend(&lock);
+	binarize(frontend, frontend->mode, image, xsize, thresh, frontend->mask, lxsize, lysize, step);
+	if (arDebug) drawDebugImage(frontend, xsize, ysize, lxsize, step);
+	labelMask(frontend, lxsize, lysize);
+	arLockResume(&lock);
+
+	info2 = arDetectMarker2(frontend->limage, frontend->labelNum, frontend->labelRef, frontend->area, frontend->pos, frontend->clip,
+							AR_AREA_MAX, AR_AREA_MIN, 1.0, &num);
+	if (info2 == NULL) return (-1);
+	if (frontend->bank != NULL) {
+		num = frontendIdentify(frontend, image, info2, num);
+	} else {
+		if ((info = arGetMarkerInfo(image, info2, &num)) == NULL) return (-1);
+		if (num > AR_SQUARE_MAX) num = AR_SQUARE_MAX;
+		memcpy(frontend->markers, info, num * sizeof(ARMarkerInfo));
+	}
+	frontendRefine(frontend, image, frontend->markers, num);
+	return (num);
+}
+
+int frontendDetectLite(Frontend_T *frontend, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num)
+{
+	int i, num;
+
+	if (!frontendUsable(frontend)) {
+		if (arDetectMarkerLite(image, thresh, marker_info, marker_num) < 0) return (-1);
+		frontendRefine(frontend, image, *marker_info, *marker_num);
+		return (0);
+	}
+
+	*marker_num = 0;
+	if ((num = frontendMarkers(frontend, image, thresh)) < 0) return (-1);
+	for (i = 0; i < num; i++) {
+		if (frontend->markers[i].cf < 0.5) frontend->markers[i].id = -1;
+	}
+	*marker_info = frontend->markers;
+	*marker_num = num;
+	return (0);
+}
+
+// Whether a marker from an earlier frame and a new one are the same square.
+static int sameSquare(const ARMarkerInfo *prev, const ARMarkerInfo *cur, double *rlen)
+{
+	double rarea = (double)prev->area / (double)cur->area;
+	double dx = cur->pos[0] - prev->pos[0];
+	double dy = cur->pos[1] - prev->pos[1];
+
+	if (rarea < 0.7 || rarea > 1.43) return (FALSE);
+	*rlen = (dx * dx + dy * dy) / cur->area;
+	return (*rlen < 0.5);
+}
+
+// The marker history of arDetectMarker(): a square keeps the better
+// identification of the last frames and a lost marker is reported for a
+// few frames more. The history is the front end's, the one of
+// arDetectMarker() is shared by the cameras, so the ARToolKit mode takes
+// the squares of arDetectMarkerLite().
+int frontendDetect(Frontend_T *frontend, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num)
+{
+	ARMarkerInfo *markers;
+	PrevMarker_T *prev;
+	double rlen, rlenmin, diff, diffmin, dx, dy;
+	int num, i, j, k, cid, cdir;
+
+	if (frontend == NULL) return (arDetectMarker(image, thresh, marker_info, marker_num));
+
+	*marker_num = 0;
+	if (!frontendUsable(frontend)) {
+		if (arDetectMarkerLite(image, thresh, &markers, &num) < 0) return (-1);
+		if (num > AR_SQUARE_MAX) num = AR_SQUARE_MAX;
+		memcpy(frontend->markers, markers, num * sizeof(ARMarkerInfo));
+		frontendRefine(frontend, image, frontend->markers, num);
+	} else if ((num = frontendMarkers(frontend, image, thresh)) < 0) {
+		return (-1);
+	}
+	markers = frontend->markers;
+
+	for (i = 0; i < frontend->prevNum; i++) {
+		prev = &frontend->prev[i];
+		rlenmin = 10.0;
+		cid = -1;
+		for (j = 0; j < num; j++) {
+			if (sameSquare(&prev->marker, &markers[j], &rlen) && rlen < rlenmin) {
+				rlenmin = rlen;
+				cid = j;
+			}
+		}
+		if (cid >= 0 && markers[cid].cf < prev->marker.cf) {
+			markers[cid].cf = prev->marker.cf;
+			markers[cid].id = prev->marker.id;
+			diffmin = 10000.0 * 10000.0;
+			cdir = -1;
+			for (j = 0; j < 4; j++) {
+				diff = 0.0;
+				for (k = 0; k < 4; k++) {
+					dx = prev->marker.vertex[k][0] - markers[cid].vertex[(j + k) % 4][0];
+					dy = prev->marker.vertex[k][1] - markers[cid].vertex[(j + k) % 4][1];
+					diff += dx * dx + dy * dy;
+				}
+				if (diff < diffmin) {
+					diffmin = diff;
+					cdir = (prev->marker.dir - j + 4) % 4;
+				}
+			}
+			markers[cid].dir = cdir;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		if (markers[i].cf < 0.5) markers[i].id = -1;
+	}
+
+	// Age the history and add this frame's identified markers.
+	for (i = j = 0; i < frontend->prevNum; i++) {
+		if (++frontend->prev[i].count < FRONTEND_HISTORY_COUNT) frontend->prev[j++] = frontend->prev[i];
+	}
+	frontend->prevNum = j;
+	for (i = 0; i < num; i++) {
+		if (markers[i].id < 0) continue;
+		for (j = 0; j < frontend->prevNum; j++) {
+			if (frontend->prev[j].marker.id == markers[i].id) break;
+		}
+		if (j == AR_SQUARE_MAX) continue;
+		frontend->prev[j].marker = markers[i];
+		frontend->prev[j].count = 1;
+		if (j == frontend->prevNum) frontend->prevNum++;
+	}
+
+	// Report the recently lost markers that no square matches.
+	for (i = 0; i < frontend->prevNum && num < 2 * AR_SQUARE_MAX; i++) {
+		for (j = 0; j < num; j++) {
+			if (sameSquare(&frontend->prev[i].marker, &markers[j], &rlen)) break;
+		}
+		if (j == num) markers[num++] = frontend->prev[i].marker;
+	}
+
+	*marker_info = markers;
+	*marker_num = num;
+	return (0);
+}
+
+int frontendBlobs(Frontend_T *frontend, const ARUint8 *gray, int xsize, int ysize, int scale, int thresh, int areaMin, int areaMax,
+				  FrontendBlob_T *blobs, int capacity)
+{
+	const ThresholdMap_T *map;
+	const int simd = (frontend != NULL && frontend->mode >= FRONTEND_SSE2);
+	const ARUint8 *src, *tile;
+	ARUint8 *dst;
+	int x, y, end, tx, ty, k, num = 0;
+
+	if (frontend == NULL || frontend->mode == FRONTEND_ARTOOLKIT || xsize * ysize > frontend->capacity || xsize < 3 || ysize < 3) return (-1);
+	if (thresh < 0) thresh = 0;
+	if (thresh > 255) thresh = 255;
+
+	// Tiles are multiples of 64 frame pixels, a reduced pixel lies in one.
+	map = frontend->map;
+	memset(frontend->mask, 0, xsize);
+	memset(frontend->mask + (ysize - 1) * xsize, 0, xsize);
+	for (y = 1; y < ysize - 1; y++) {
+		src = gray + y * xsize;
+		dst = frontend->mask + y * xsize;
+		if (map == NULL) {
+			binarizeGrayRow(src, dst, xsize, thresh, simd);
+		} else {
+			ty = y * scale / map->tileSize;
+			if (ty >= map->tilesY) ty = map->tilesY - 1;
+			tile = map->thresh + ty * map->tilesX;
+			for (x = 0; x < xsize; x = end) {
+				tx = x * scale / map->tileSize;
+				if (tx >= map->tilesX - 1) {
+					tx = map->tilesX - 1;
+					end = xsize;
+				} else {
+					end = ((tx + 1) * map->tileSize + scale - 1) / scale;
+					if (end > xsize) end = xsize;
+				}
+				binarizeGrayRow(src + x, dst + x, end - x, tile[tx], simd);
+			}
+		}
+		dst[0] = 0;
+		dst[xsize - 1] = 0;
+	}
+	labelMask(frontend, xsize, ysize);
+
+	for (k = 0; k < frontend->labelNum; k++) {
+		if (frontend->area[k] < areaMin || frontend->area[k] > areaMax) continue;
+		if (num < capacity) {
+			blobs[num].area = frontend->area[k];
+			blobs[num].x0 = frontend->clip[k * 4 + 0] * scale;
+			blobs[num].x1 = (frontend->clip[k * 4 + 1] + 1) * scale;
+			blobs[num].y0 = frontend->clip[k * 4 + 2] * scale;
+			blobs[num].y1 = (frontend->clip[k * 4 + 3] + 1) * scale;
+		}
+		num++;
+	}
+	return (num);
+}
+
+// ============================================================================
+//	Verification
+// ============================================================================
+
+static int compareComponents(const void *a, const void *b)
+{
+	const Component_T *ca = (const Component_T *)a, *cb = (const Component_T *)b;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		if (ca->clip[i] != cb->clip[i]) return (ca->clip[i] < cb->clip[i] ? -1 : 1);
+	}
+	if (ca->area != cb->area) return (ca->area < cb->area ? -1 : 1);
+	if (ca->pos[0] != cb->pos[0]) return (ca->pos[0] < cb->pos[0] ? -1 : 1);
+	if (ca->pos[1] != cb->pos[1]) return (ca->pos[1] < cb->pos[1] ? -1 : 1);
+	return (0);
+}
+
+static Component_T *collectComponents(int num, const int *area, const double *pos, const int *clip)
+{
+	Component_T *comps;
+	int i;
+
+	if ((comps = (Component_T *)malloc((num > 0 ? num : 1) * sizeof(Component_T))) == NULL) return (NULL);
+	for (i = 0; i < num; i++) {
+		comps[i].area = area[i];
+		memcpy(comps[i].clip, &clip[i * 4], sizeof(comps[i].clip));
+		comps[i].pos[0] = pos[i * 2 + 0];
+		comps[i].pos[1] = pos[i * 2 + 1];
+	}
+	qsort(comps, num, sizeof(Component_T), compareComponents);
+	return (comps);
+}
+
+int frontendVerify(Frontend_T *frontend, ARUint8 *image, int thresh)
+{
+	Component_T *ours, *theirs;
+	ARInt16 *limage;
+	int *area, *clip, *labelRef;
+	double *pos;
+	int lxsize, lysize, step, labelNum, i, j, cmp, mismatch = 0;
+
+	if (!frontendUsable(frontend)) return (-1);
+	if (thresh < 0) thresh = 0;
+	if (thresh > 255) thresh = 255;
+
+	// Binarization, byte for byte.
+	step = labelSize(&lxsize, &lysize);
+	binarize(frontend, FRONTEND_SCALAR, image, arImXsize, thresh, frontend->maskRef, lxsize, lysize, step);
+	binarize(frontend, frontend->mode, image, arImXsize, thresh, frontend->mask, lxsize, lysize, step);
+	for (i = 0; i < lxsize * lysize; i++) {
+		if (frontend->mask[i] != frontend->maskRef[i]) mismatch++;
+	}
+
+	// Connected components against arLabeling(), which numbers them in
+	// its own order. It knows only the single threshold.
+	if (frontend->map != NULL) return (mismatch);
+	labelMask(frontend, lxsize, lysize);
+	if ((limage = arLabeling(image, thresh, &labelNum, &area, &pos, &clip, &labelRef)) == NULL) return (mismatch + frontend->labelNum);
+	ours = collectComponents(frontend->labelNum, frontend->area, frontend->pos, frontend->clip);
+	theirs = collectComponents(labelNum, area, pos, clip);
+	if (ours == NULL || theirs == NULL) {
+		free(ours);
+		free(theirs);
+		return (-1);
+	}
+	for (i = j = 0; i < frontend->labelNum || j < labelNum; ) {
+		cmp = (i == frontend->labelNum ? 1 : j == labelNum ? -1 : compareComponents(&ours[i], &theirs[j]));
+		if (cmp == 0) {
+			i++;
+			j++;
+		} else {
+			mismatch++;
+			if (cmp < 0) i++;
+			else j++;
+		}
+	}
+	free(ours);
+	free(theirs);
+	return (mismatch);
+}
@@ -0,0 +1,148 @@
+#ifndef __frontend_h__
+#define __frontend_h__
+
+// ============================================================================
+//	Vectorized thresholding and labeling front end
+// ============================================================================
+//
+//	Replaces arLabeling(), the per pixel part of arDetectMarker(). The
+//	camera image is binarized with SSE2 or AVX2, chosen at runtime, and the
+//	dark pixels are labeled as 8-connected runs. The labels are handed to
+//	arDetectMarker2() and arGetMarkerInfo(), so contour tracing, pattern
+//	matching and the marker history behave like arDetectMarker().
+//
+//	The scalar mode binarizes exactly like arLabeling() and is kept for
+//	bit-exact comparison, see frontendVerify(). Pixel formats other than
+//	32 bit fall back to the ARToolKit functions.
+//
+//	The squares are found in the full image, in the half image like with
+//	AR_IMAGE_PROC_IN_HALF, or in the half image with their corners refined
+//	in the full frame, see corners.h.
+//
+//	The labeling also finds dark blobs in gray images, the levels of a
+//	pyramid, see pyramid.h.
+//
+//	Instead of the single threshold the front end can binarize with a
+//	threshold per tile of the image, see autothresh.h, and identify the
+//	squares with a pattern bank instead of ARToolKit, see patternbank.h.
+//
+//	All functions accept a NULL front end and then call ARToolKit directly.
+//	A front end must only be used from one thread.
+//
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "patternbank.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Offset of the first of the three colour bytes in a pixel.
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA) || (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
+#  define FRONTEND_FORMAT_OK	TRUE
+#  define FRONTEND_CHANNEL		0
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB) || (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
+#  define FRONTEND_FORMAT_OK	TRUE
+#  define FRONTEND_CHANNEL		1
+#else
+#  define FRONTEND_FORMAT_OK	FALSE
+#  define FRONTEND_CHANNEL		0
+#endif
+
+typedef enum {
+	FRONTEND_ARTOOLKIT,		// arDetectMarkerLite() and the front end's marker history.
+	FRONTEND_SCALAR,
+	FRONTEND_SSE2,
+	FRONTEND_AVX2,
+	FRONTEND_MODE_COUNT
+} FrontendMode_T;
+
+// Resolution the squares are found at. Sets arImageProcMode for every
+// detection, also of the ARToolKit mode.
+typedef enum {
+	FRONTEND_RES_FULL,
+	FRONTEND_RES_HALF,
+	FRONTEND_RES_HYBRID,	// Half image, corners refined in the full frame.
+	FRONTEND_RES_COUNT
+} FrontendResolution_T;
+
+// Thresholds for square tiles of the full camera frame, row by row.
+typedef struct {
+	int			tileSize;		// Image pixels, a multiple of 64.
+	int			tilesX;
+	int			tilesY;
+	ARUint8		*thresh;
+} ThresholdMap_T;
+
+// Dark blob of a reduced image, the box in frame pixels.
+typedef struct {
+	int			area;			// Reduced image pixels.
+	int			x0, y0, x1, y1;	// x1 and y1 exclusive.
+} FrontendBlob_T;
+
+typedef struct Frontend_T Frontend_T;
+
+// xsize and ysize are the largest frame the front end will see.
+Frontend_T *frontendCreate(int xsize, int ysize);
+void frontendDestroy(Frontend_T *frontend);
+
+// Whether the CPU and the build support a mode, and the fastest one that is.
+int frontendModeAvailable(FrontendMode_T mode);
+FrontendMode_T frontendBestMode(void);
+const char *frontendModeName(FrontendMode_T mode);
+
+// Unavailable modes are replaced by the best available one.
+void frontendSetMode(Frontend_T *frontend, FrontendMode_T mode);
+FrontendMode_T frontendMode(Frontend_T *frontend);
+
+// Defaults to the arImageProcMode at frontendCreate().
+void frontendSetResolution(Frontend_T *frontend, FrontendResolution_T resolution);
+FrontendResolution_T frontendResolution(Frontend_T *frontend);
+const char *frontendResolutionName(FrontendResolution_T resolution);
+
+// Binarize with the tile thresholds instead of the thresh argument, or
+// with thresh again when map is NULL. The map must stay valid while set.
+// The ARToolKit mode always uses thresh.
+void frontendSetThresholdMap(Frontend_T *frontend, const ThresholdMap_T *map);
+
+// Identify the squares with bank instead of arGetMarkerInfo(), or with
+// ARToolKit again when bank is NULL. The bank must stay valid while set.
+// The ARToolKit mode always uses arGetMarkerInfo().
+void frontendSetPatternBank(Frontend_T *frontend, const PatternBank_T *bank);
+
+// Position of the detected image within the frame the map covers, for
+// detection in windows of the frame.
+void frontendSetOrigin(Frontend_T *frontend, int x0, int y0);
+
+// Binarized frame of the last detection in threshold debug mode, in the
+// arImage format, or NULL when the last frame went through ARToolKit.
+ARUint8 *frontendDebugImage(Frontend_T *frontend);
+
+// Drop-in replacements for arDetectMarker() and arDetectMarkerLite(),
+// for the frame size set with arInitCparam(). Each front end keeps the
+// marker history of its own camera. Return -1 on error.
+int frontendDetect(Frontend_T *frontend, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num);
+int frontendDetectLite(Frontend_T *frontend, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num);
+
+// Label the dark pixels of a gray image scale times smaller than the frame,
+// e.g. a pyramid level, with thresh or the threshold map. Blobs of areaMin
+// to areaMax pixels are stored, up to capacity of them. Returns how many
+// there are, more than capacity when they did not fit, or -1 when the
+// front end is not in use.
+int frontendBlobs(Frontend_T *frontend, const ARUint8 *gray, int xsize, int ysize, int scale, int thresh, int areaMin, int areaMax,
+				  FrontendBlob_T *blobs, int capacity);
+
+// Binarize the image with the scalar code and the current mode and label
+// it with arLabeling() and the front end. Returns the number of differing
+// binarized pixels plus the number of unmatched connected components, so
+// 0 means both agree exactly, or -1 when the front end is not in use.
+// With a threshold map only the binarization is compared.
+int frontendVerify(Frontend_T *frontend, ARUint8 *image, int thresh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __frontend_h__
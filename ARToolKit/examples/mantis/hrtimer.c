@@ -0,0 +1,47 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#elif defined(__APPLE__)
+#  include <mach/mach_time.h>
+#else
+#  include <time.h>
+#endif
+
+#include "hrtimer.h"
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+double hrtimerNow(void)
+{
+#ifdef _WIN32
+	static double period = 0.0;
+	LARGE_INTEGER counter;
+
+	if (period == 0.0) {
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		period = 1.0 / (double)freq.QuadPart;
+	}
+	QueryPerformanceCounter(&counter);
+	return ((double)counter.QuadPart * period);
+#elif defined(__APPLE__)
+	static double period = 0.0;
+
+	if (period == 0.0) {
+		mach_timebase_info_data_t info;
+		mach_timebase_info(&info);
+		period = (double)info.numer / (double)info.denom * 1e-9;
+	}
+	return ((double)mach_absolute_time() * period);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec + (double)ts.tv_nsec * 1e-9);
+#endif
+}
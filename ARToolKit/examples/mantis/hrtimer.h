@@ -0,0 +1,20 @@
+#ifndef __hrtimer_h__
+#define __hrtimer_h__
+
+// ============================================================================
+//	High resolution monotonic timer
+// ============================================================================
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Seconds since an arbitrary fixed point, monotonic and sub-microsecond
+// where the platform allows it. Safe to call from any thread.
+double hrtimerNow(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __hrtimer_h__
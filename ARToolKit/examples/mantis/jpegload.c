@@ -0,0 +1,100 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <jpeglib.h>
+#ifdef __cplusplus
+}
+#endif
+
+#include "jpegload.h"
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+// libjpeg calls exit() on errors unless the error handler jumps out.
+typedef struct {
+	struct jpeg_error_mgr	mgr;
+	jmp_buf					jump;
+} JpegError_T;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static void jpegErrorExit(j_common_ptr cinfo)
+{
+	JpegError_T *error = (JpegError_T *)cinfo->err;
+	char message[JMSG_LENGTH_MAX];
+
+	(*cinfo->err->format_message)(cinfo, message);
+	fprintf(stderr, "jpegLoad(): %s\n", message);
+	longjmp(error->jump, 1);
+}
+
+ARUint8 *jpegLoad(const char *filename, int *width, int *height)
+{
+	struct jpeg_decompress_struct cinfo;
+	JpegError_T error;
+	FILE *fp;
+	ARUint8 * volatile pixels = NULL;	// Modified after setjmp().
+	ARUint8 * volatile row = NULL;
+	JSAMPROW rowp;
+	int x, y, stride;
+
+	if ((fp = fopen(filename, "rb")) == NULL) {
+		fprintf(stderr, "jpegLoad(): Unable to open %s.\n", filename);
+		return (NULL);
+	}
+	cinfo.err = jpeg_std_error(&error.mgr);
+	error.mgr.error_exit = jpegErrorExit;
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&cinfo);
+		free(pixels);
+		free(row);
+		fclose(fp);
+		return (NULL);
+	}
+	jpeg_create_decompress(&cinfo);
+	jpeg_stdio_src(&cinfo, fp);
+	jpeg_read_header(&cinfo, TRUE);
+	if (cinfo.jpeg_color_space == JCS_GRAYSCALE) cinfo.out_color_space = JCS_GRAYSCALE;
+	else cinfo.out_color_space = JCS_RGB;
+	jpeg_start_decompress(&cinfo);
+
+	*width = cinfo.output_width;
+	*height = cinfo.output_height;
+	stride = *width * 3;
+	pixels = (ARUint8 *)malloc(stride * *height);
+	row = (ARUint8 *)malloc(*width * cinfo.output_components);
+	if (pixels == NULL || row == NULL) {
+		fprintf(stderr, "jpegLoad(): Out of memory for %s.\n", filename);
+		longjmp(error.jump, 1);
+	}
+	while (cinfo.output_scanline < cinfo.output_height) {
+		y = *height - 1 - cinfo.output_scanline;
+		rowp = row;
+		jpeg_read_scanlines(&cinfo, &rowp, 1);
+		if (cinfo.output_components == 3) {
+			memcpy(pixels + y * stride, row, stride);
+		} else {
+			for (x = 0; x < *width; x++) {
+				pixels[y * stride + x * 3] = pixels[y * stride + x * 3 + 1] = pixels[y * stride + x * 3 + 2] = row[x];
+			}
+		}
+	}
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	free(row);
+	fclose(fp);
+	return (pixels);
+}
@@ -0,0 +1,27 @@
+#ifndef __jpegload_h__
+#define __jpegload_h__
+
+// ============================================================================
+//	JPEG texture decoding
+// ============================================================================
+//
+//	Kept apart from the modules that include windows.h, whose boolean type
+//	clashes with the one of jpeglib.h.
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Decode a JPEG file to 24 bit RGB, bottom row first like glTexImage2D()
+// expects. Greyscale files are expanded to RGB. Returns NULL on error,
+// the caller frees the pixels.
+ARUint8 *jpegLoad(const char *filename, int *width, int *height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __jpegload_h__
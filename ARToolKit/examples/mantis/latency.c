@@ -0,0 +1,135 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <string.h>
+
+#include "latency.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#ifndef TRUE
+#  define TRUE 1
+#endif
+#ifndef FALSE
+#  define FALSE 0
+#endif
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	long	bins[LATENCY_BINS];
+	long	count;
+	double	sum;
+	double	min;
+	double	max;
+} LatencyHistogram_T;
+
+// ============================================================================
+//	Global variables
+// ============================================================================
+
+static const char *gStageNames[LATENCY_STAGE_COUNT] = {
+	"camera to poses", "poses to swap", "camera to swap"
+};
+
+static LatencyHistogram_T gHistograms[LATENCY_STAGE_COUNT];
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static void latencyRecord(LatencyStage_T stage, double seconds)
+{
+	LatencyHistogram_T *h = &gHistograms[stage];
+	double ms = seconds * 1000.0;
+	int bin;
+
+	if (ms < 0.0) ms = 0.0;
+	bin = (int)(ms / LATENCY_BIN_MS);
+	if (bin >= LATENCY_BINS) bin = LATENCY_BINS - 1;
+	h->bins[bin]++;
+	if (h->count == 0 || ms < h->min) h->min = ms;
+	if (h->count == 0 || ms > h->max) h->max = ms;
+	h->sum += ms;
+	h->count++;
+}
+
+void latencyFrame(double grabbed, double published, double swapped)
+{
+	latencyRecord(LATENCY_DETECT, published - grabbed);
+	latencyRecord(LATENCY_DISPLAY, swapped - published);
+	latencyRecord(LATENCY_TOTAL, swapped - grabbed);
+}
+
+const char *latencyStageName(LatencyStage_T stage)
+{
+	return (gStageNames[stage]);
+}
+
+// Upper edge of the bin holding the fraction p of the samples, clamped to
+// the measured range.
+static double latencyPercentile(const LatencyHistogram_T *h, double p)
+{
+	long rank = (long)(p * (h->count - 1) + 0.5), seen = 0;
+	double edge;
+	int bin;
+
+	for (bin = 0; bin < LATENCY_BINS - 1; bin++) {
+		if ((seen += h->bins[bin]) > rank) break;
+	}
+	edge = (bin + 1) * LATENCY_BIN_MS;
+	if (edge > h->max) edge = h->max;
+	if (edge < h->min) edge = h->min;
+	return (edge);
+}
+
+int latencyStats(LatencyStage_T stage, LatencyStats_T *stats)
+{
+	const LatencyHistogram_T *h = &gHistograms[stage];
+
+	if (h->count == 0) return (FALSE);
+	stats->count = h->count;
+	stats->min = h->min;
+	stats->mean = h->sum / h->count;
+	stats->p50 = latencyPercentile(h, 0.50);
+	stats->p90 = latencyPercentile(h, 0.90);
+	stats->p99 = latencyPercentile(h, 0.99);
+	stats->max = h->max;
+	return (TRUE);
+}
+
+void latencyReset(void)
+{
+	memset(gHistograms, 0, sizeof(gHistograms));
+}
+
+void latencyReport(int histogram)
+{
+	const LatencyHistogram_T *h;
+	LatencyStats_T stats;
+	int stage, bin;
+
+	printf("%-16s %7s %8s %8s %8s %8s %8s %8s\n", "latency [ms]", "frames", "min", "mean", "p50", "p90", "p99", "max");
+	for (stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+		if (!latencyStats((LatencyStage_T)stage, &stats)) continue;
+		printf("%-16s %7ld %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", gStageNames[stage], stats.count,
+			   stats.min, stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+	}
+	if (!histogram) return;
+
+	for (stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+		h = &gHistograms[stage];
+		if (h->count == 0) continue;
+		printf("\n%s, frames per %.1f ms bin:\n", gStageNames[stage], LATENCY_BIN_MS);
+		for (bin = 0; bin < LATENCY_BINS; bin++) {
+			if (h->bins[bin] == 0) continue;
+			printf("   %6.1f - %6.1f%s %7ld\n", bin * LATENCY_BIN_MS, (bin + 1) * LATENCY_BIN_MS, (bin == LATENCY_BINS - 1 ? "+" : " "), h->bins[bin]);
+		}
+	}
+}
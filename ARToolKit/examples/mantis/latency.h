@@ -0,0 +1,62 @@
+#ifndef __latency_h__
+#define __latency_h__
+
+// ============================================================================
+//	Camera to screen latency histograms
+// ============================================================================
+//
+//	Every camera frame carries the hrtimerNow() time it was grabbed at, see
+//	capture.h, and its snapshot the time its poses were published. When a
+//	frame is shown for the first time, the render thread records how long
+//	it took from the camera to the poses, from the poses to the buffer swap,
+//	and both together: the motion to photon latency up to the swap, without
+//	the delay of the display itself.
+//
+//	Latencies are counted into bins of LATENCY_BIN_MS, percentiles are exact
+//	to a bin. Recorded from the render thread only.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_BIN_MS		0.5
+#define LATENCY_BINS		400			// 200 ms, longer ones go to the last bin.
+
+typedef enum {
+	LATENCY_DETECT,			// Grabbed to poses published.
+	LATENCY_DISPLAY,		// Poses published to swapped.
+	LATENCY_TOTAL,			// Grabbed to swapped.
+	LATENCY_STAGE_COUNT
+} LatencyStage_T;
+
+// In milliseconds.
+typedef struct {
+	long		count;
+	double		min;
+	double		mean;
+	double		p50;
+	double		p90;
+	double		p99;
+	double		max;
+} LatencyStats_T;
+
+// Record one shown frame, all times from hrtimerNow().
+void latencyFrame(double grabbed, double published, double swapped);
+
+const char *latencyStageName(LatencyStage_T stage);
+
+// Statistics since the last reset. Returns FALSE if nothing was recorded.
+int latencyStats(LatencyStage_T stage, LatencyStats_T *stats);
+
+void latencyReset(void);
+
+// Print the statistics of every stage to stdout, with the non-empty bins
+// when histogram is set.
+void latencyReport(int histogram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __latency_h__
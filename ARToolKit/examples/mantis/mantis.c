@@ -25,6 +25,20 @@
 #include <AR/arvrml.h>
 
 #include "object.h"
+#include "scene.h"
+#include "framesource.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "model.h"
+#include "background.h"
+#include "rig.h"
+#include "arlock.h"
+#include "tracker.h"
+#include "hrtimer.h"
+#include "posefilter.h"
+#include "redraw.h"
+#include "textatlas.h"
+#include "latency.h"
 
 // ============================================================================
 //	Constants
@@ -36,6 +50,15 @@
 #define VIEW_DISTANCE_MIN		4.0			// Objects closer to the camera than this will not be displayed.
 #define VIEW_DISTANCE_MAX		32000.0		// Objects further away from the camera than this will not be displayed.
 
+#define PROFILE_TRACE_FILE		"mantis_trace.json"	// Chrome trace of the frame stages, written on exit.
+#define LATENCY_TEST_DRAIN		0.5					// Seconds the replay test waits for the last frame.
+#define OBJECT_DATA_FILE		"Data/object_data_mantis"	// Patterns, models and anchors, saved by e.
+#define MULTI_DATA_FILE			"Data/multi/marker_mantis.dat"
+#define SCENE_FILE				"Data/mantis.scene"	// Both files compiled by scenec, used while newer than them.
+
+#define ANCHOR_STEP_POS			10.0		// Anchor tuning steps, model units and degrees.
+#define ANCHOR_STEP_ROT			2.5
+
 
 // ============================================================================
 //	Global variables
@@ -50,44 +73,80 @@ static int prefRefresh = 0;										// Fullscreen mode refresh rate. Set to 0 t
 static char prefCaption[64] = "Mantis Augmented Reality - Designblok 2010";		// Window caption
 
 // Image acquisition.
-static ARUint8		*gARTImage = NULL;
+// Cameras, see rig.h. The first one is shown and gARTCparam is its.
+static Rig_T			*gRig = NULL;
+static FrameSource_T	*gFrameSources[RIG_CAMERAS_MAX];	// Camera, or a recorded sequence.
+static ARParam			gCameraCparams[RIG_CAMERAS_MAX];
 
 // Marker detection.
 static int			gARTThreshhold = 100;
-static long			gCallCountMarkerDetect = 0;
-
-// Transformation matrix retrieval.
-static int			gPatt_found = FALSE;	// At least one marker.
-static int			gPatt_found_multi = FALSE;	// At least one multi marker.
+static AutoThreshMode_T	gThresholdMode = AUTOTHRESH_ADAPTIVE;
+static int			gThresholdBias = 0;		// Added to the automatic thresholds by w and s.
+static int			gRoiTracking = FALSE;	// Detect only around the tracked markers.
+static int			gPyramid = FALSE;		// Find the full scan candidates in an image pyramid.
+static int			gBatchPose = TRUE;		// Refine the tracked marker poses in one batch.
+static FrontendMode_T	gFrontendMode;		// Thresholding and labeling implementation.
+static FrontendResolution_T gResolution;	// Image the squares are found in.
+
+// Capture, detection and pose estimation, one thread per camera. Every
+// camera tracks with its own copy of the object data and multi marker
+// config, the first one uses gObjectData and gMultiMarkerConfig. The other
+// cameras' objects share the config of gObjectData.
+static Pipeline_T			*gPipelines[RIG_CAMERAS_MAX];
+static ObjectSet_T			*gCameraObjects[RIG_CAMERAS_MAX];
+static ARMultiMarkerInfoT	*gCameraMulti[RIG_CAMERAS_MAX];
+static PoseSnapshot_T		gFused;		// Poses of all cameras in the first one's view.
+
+// Pose filtering, see posefilter.h. One filter per object, then the multi
+// marker and the sculpture.
+#define FILTER_MULTI		(gObjectDataCount)
+#define FILTER_SCULPTURE	(gObjectDataCount + 1)
+#define FILTER_COUNT		(gObjectDataCount + 2)
+static PoseFilter_T			*gPoseFilters = NULL;
+static PoseFilterMode_T		gPoseFilterMode = POSEFILTER_SMOOTH;
+static double				gPoseFilterTime = 0.0;	// Time of the last detection fed to the filters.
+static double				gFrameInterval = 0.0;	// Smoothed time between displayed frames.
+static double				gFrameLast = 0.0;
 
 // Drawing.
 static ARParam		gARTCparam;
 static ARGL_CONTEXT_SETTINGS_REF gArglSettings = NULL;
+static Background_T	*gBackground = NULL;	// NULL without pixel buffer objects.
+static int			gBackgroundStream = FALSE;	// Draw the frame through gBackground.
+static long			gBackgroundFrame = -1;		// Camera frame in the texture of gBackground.
+static Redraw_T		gRedraw;
+static TextAtlas_T	*gTextAtlas = NULL;		// Debug text of the shader renderer, NULL without shaders.
 
 // Object Data.
-static ObjectData_T			*gObjectData;
-static int					gObjectDataCount;
+static ObjectSet_T			*gObjectData;
+static int					gObjectDataCount;		// gObjectData->count.
 static ARMultiMarkerInfoT	*gMultiMarkerConfig;
-static double				gErr;
-
-// Show current object model
-static int gObjectModel = 0;
+static PatternBank_T		*gPatternBank;			// Of all patterns, NULL for ARToolKit's matching.
+
+// The model is placed by all visible markers (-1), or for tuning its
+// anchor by this marker alone.
+static int gObjectModel = -1;
+
+// Startup time breakdown, reported after the first frame.
+static double				gStartupBegin;
+static double				gStartupCamera;
+static double				gStartupWindow;
+static double				gStartupObjects;
+static double				gStartupPipeline;
+static ObjectLoadStats_T	gStartupLoad;
+static int					gStartupReported = FALSE;
+
+// Camera to screen latency, see latency.h. The replay test prints the
+// histograms and quits once the replay has ended.
+static long					gLatencyFrame = -1;		// Camera frame last recorded.
+static int					gLatencyTest = FALSE;
+static double				gLatencyDrain = 0.0;	// Replay ended and no frame waiting since.
 
 // Switchers
 static int gDebugText;
 static int gDrawAlways;
 static int gFullscreen;
 
-// Position
-static float gPosX;
-static float gPosY;
-static float gPosZ;
-
-// Rotation
-static float gRotX;
-static float gRotY;
-static float gRotZ;
-
 
 // ============================================================================
 //	Declarations
@@ -102,33 +161,39 @@ static void draw( double trans1[3][4], double trans2[3][4], int mode );
 //	Functions
 // ============================================================================
 
-static int setupCamera(const char *cparam_name, char *vconf, ARParam *cparam)
+static int setupCamera(int index)
 {	
+	RigCamera_T		*camera = &gRig->cameras[index];
+	ARParam			*cparam = &gCameraCparams[index];
     ARParam			wparam;
 	int				xsize, ysize;
 
     // Open the video path.
-    if (arVideoOpen(vconf) < 0) {
-    	fprintf(stderr, "setupCamera(): Unable to open connection to camera.\n");
+    if ((gFrameSources[index] = frameSourceOpen(camera->vconf)) == NULL) {
+    	fprintf(stderr, "setupCamera(): Unable to open connection to camera %d.\n", index + 1);
     	return (FALSE);
 	}
 	
     // Find the size of the window.
-    if (arVideoInqSize(&xsize, &ysize) < 0) return (FALSE);
-    fprintf(stdout, "Camera image size (x,y) = (%d,%d)\n", xsize, ysize);
+    if (frameSourceInqSize(gFrameSources[index], &xsize, &ysize) < 0) return (FALSE);
+    fprintf(stdout, "Camera %d image size (x,y) = (%d,%d)\n", index + 1, xsize, ysize);
 	
 	// Load the camera parameters, resize for the window and init.
-    if (arParamLoad(cparam_name, 1, &wparam) < 0) {
-		fprintf(stderr, "setupCamera(): Error loading parameter file %s for camera.\n", cparam_name);
+    if (arParamLoad(camera->cparamName, 1, &wparam) < 0) {
+		fprintf(stderr, "setupCamera(): Error loading parameter file %s for camera.\n", camera->cparamName);
         return (FALSE);
     }
     arParamChangeSize(&wparam, xsize, ysize, cparam);
     fprintf(stdout, "*** Camera Parameter ***\n");
     arParamDisp(cparam);
 
-    arInitCparam(cparam);
+	// The pipelines make their camera's parameters current, see arlock.h.
+	if (index == 0) {
+		gARTCparam = *cparam;
+		arLockInstall(cparam);
+	}
 
-	if (arVideoCapStart() != 0) {
+	if (frameSourceCapStart(gFrameSources[index]) != 0) {
     	fprintf(stderr, "setupCamera(): Unable to begin camera data capture.\n");
 		return (FALSE);		
 	}
@@ -136,19 +201,46 @@ static int setupCamera(const char *cparam_name, char *vconf, ARParam *cparam)
 	return (TRUE);
 }
 
-static int setupMarkersObjects(char *objectDataFilename, char *objectDataFilenameMulti)
+static int setupMarkersObjects(ObjectLoad_T *objectLoad)
 {	
-	// Load in the object data - trained markers and associated bitmap files.
-    if ((gObjectData = read_VRMLdata(objectDataFilename, &gObjectDataCount)) == NULL) {
-        fprintf(stderr, "setupMarkersObjects(): read_VRMLdata returned error !!\n");
+	int i;
+
+	// Finish loading the object data - trained markers and associated models.
+    if ((gObjectData = objectLoadEnd(objectLoad, &gStartupLoad)) == NULL) {
+        fprintf(stderr, "setupMarkersObjects(): objectLoadEnd returned error !!\n");
         return (FALSE);
     }
+	gObjectDataCount = gObjectData->count;
     printf("Object count = %d\n", gObjectDataCount);
 
-	if((gMultiMarkerConfig = arMultiReadConfigFile(objectDataFilenameMulti)) == NULL) {
-        fprintf(stderr, "setupMarkersObjects(): arMultiReadConfigFile returned error !!\n");
+	if((gMultiMarkerConfig = sceneMultiConfig(gObjectData->scene)) == NULL) {
+        fprintf(stderr, "setupMarkersObjects(): sceneMultiConfig returned error !!\n");
 		return (FALSE);
     }
+
+	// The pipelines identify the markers with the bank, ARToolKit keeps its
+	// own copy of the patterns for the ARToolKit front end.
+	if ((gPatternBank = trackerPatternBank(gObjectData, gMultiMarkerConfig)) == NULL) {
+		fprintf(stderr, "setupMarkersObjects(): No pattern bank, matching with ARToolKit.\n");
+	}
+
+	// Tracking state for the other cameras, with the same patterns.
+	gCameraObjects[0] = gObjectData;
+	gCameraMulti[0] = gMultiMarkerConfig;
+	for (i = 1; i < gRig->cameraCount; i++) {
+		if ((gCameraObjects[i] = objectCloneTrack(gObjectData)) == NULL ||
+			(gCameraMulti[i] = trackerCopyMulti(gMultiMarkerConfig)) == NULL) {
+			fprintf(stderr, "setupMarkersObjects(): Out of memory.\n");
+			return (FALSE);
+		}
+	}
+	gFused.visible = (int *)calloc(gObjectDataCount, sizeof(int));
+	gFused.trans = (double (*)[3][4])calloc(gObjectDataCount, sizeof(double[3][4]));
+	gPoseFilters = (PoseFilter_T *)calloc(FILTER_COUNT, sizeof(PoseFilter_T));
+	if (gFused.visible == NULL || gFused.trans == NULL || gPoseFilters == NULL) {
+		fprintf(stderr, "setupMarkersObjects(): Out of memory.\n");
+		return (FALSE);
+	}
 	
 	return (TRUE);
 }
@@ -158,18 +250,23 @@ static int setupMarkersObjects(char *objectDataFilename, char *objectDataFilenam
 static void debugReportMode(void)
 {
 	if(arFittingMode == AR_FITTING_TO_INPUT ) {
-		fprintf(stderr, "FittingMode (Z): INPUT IMAGE\n");
+		fprintf(stderr, "FittingMode    : INPUT IMAGE\n");
 	} else {
-		fprintf(stderr, "FittingMode (Z): COMPENSATED IMAGE\n");
+		fprintf(stderr, "FittingMode    : COMPENSATED IMAGE\n");
 	}
 	
-	if( arImageProcMode == AR_IMAGE_PROC_IN_FULL ) {
-		fprintf(stderr, "ProcMode (X)   : FULL IMAGE\n");
+	if (gResolution == FRONTEND_RES_FULL) {
+		fprintf(stderr, "ProcMode (Y)   : FULL IMAGE\n");
+	} else if (gResolution == FRONTEND_RES_HALF) {
+		fprintf(stderr, "ProcMode (Y)   : HALF IMAGE\n");
 	} else {
-		fprintf(stderr, "ProcMode (X)   : HALF IMAGE\n");
+		fprintf(stderr, "ProcMode (Y)   : HALF IMAGE, FULL RESOLUTION CORNERS\n");
 	}
+	fprintf(stderr, "Pyramid (Z)    : %s\n", (gPyramid ? "CANDIDATES FROM LEVEL 2" : "OFF"));
 	
-	if (arglDrawModeGet(gArglSettings) == AR_DRAW_BY_GL_DRAW_PIXELS) {
+	if (gBackgroundStream) {
+		fprintf(stderr, "DrawMode (C)   : PIXEL BUFFER STREAMING (%s)\n", (backgroundPersistent(gBackground) ? "PERSISTENT" : "PER FRAME"));
+	} else if (arglDrawModeGet(gArglSettings) == AR_DRAW_BY_GL_DRAW_PIXELS) {
 		fprintf(stderr, "DrawMode (C)   : GL_DRAW_PIXELS\n");
 	} else if (arglTexmapModeGet(gArglSettings) == AR_DRAW_TEXTURE_FULL_IMAGE) {
 		fprintf(stderr, "DrawMode (C)   : TEXTURE MAPPING (FULL RESOLUTION)\n");
@@ -177,6 +274,9 @@ static void debugReportMode(void)
 		fprintf(stderr, "DrawMode (C)   : TEXTURE MAPPING (HALF RESOLUTION)\n");
 	}
 		
+	fprintf(stderr, "PoseFilter (P) : %s\n", poseFilterModeName(gPoseFilterMode));
+	fprintf(stderr, "BatchPose (B)  : %s\n", (gBatchPose ? "ON" : "OFF"));
+
 	if( arTemplateMatchingMode == AR_TEMPLATE_MATCHING_COLOR ) {
 		fprintf(stderr, "TemplateMatchingMode (M)   : Color Template\n");
 	} else {
@@ -184,26 +284,113 @@ static void debugReportMode(void)
 	}
 	
 	if( arMatchingPCAMode == AR_MATCHING_WITHOUT_PCA ) {
-		fprintf(stderr, "MatchingPCAMode (P)   : Without PCA\n");
+		fprintf(stderr, "MatchingPCAMode (M)   : Without PCA\n");
 	} else {
-		fprintf(stderr, "MatchingPCAMode (P)   : With PCA\n");
+		fprintf(stderr, "MatchingPCAMode (M)   : With PCA\n");
+	}
+	fprintf(stderr, "PatternBank    : %d patterns\n", patternBankCount(gPatternBank));
+
+	fprintf(stderr, "Renderer (N)   : %s\n", modelRendererName(modelRenderer()));
+}
+
+static void startupReport(void)
+{
+	fprintf(stdout, "--------------------------------------\n");
+	fprintf(stdout, "Startup: first frame after %.0f ms\n", (hrtimerNow() - gStartupBegin) * 1000.0);
+	fprintf(stdout, "   camera setup      %6.0f ms\n", gStartupCamera * 1000.0);
+	fprintf(stdout, "   window and GL     %6.0f ms\n", gStartupWindow * 1000.0);
+	fprintf(stdout, "   markers           %6.0f ms (arLoadPatt %.0f ms)\n", gStartupObjects * 1000.0, gStartupLoad.patternTime * 1000.0);
+	fprintf(stdout, "   models            %6.0f ms on worker threads, %.0f ms waited (%d files, %d shared)\n",
+		gStartupLoad.modelTime * 1000.0, gStartupLoad.waitTime * 1000.0, gStartupLoad.models, gStartupLoad.shared);
+	fprintf(stdout, "   pipeline start    %6.0f ms\n", gStartupPipeline * 1000.0);
+	fprintf(stdout, "--------------------------------------\n");
+}
+
+// Hand the detection settings to every camera's pipeline.
+static void updatePipelines(void)
+{
+	int i;
+
+	for (i = 0; i < gRig->cameraCount; i++) {
+		pipelineSetThreshold(gPipelines[i], gARTThreshhold);
+		pipelineSetThresholdBias(gPipelines[i], gThresholdBias);
+		pipelineSetThresholdMode(gPipelines[i], gThresholdMode);
+		pipelineSetRoiTracking(gPipelines[i], gRoiTracking);
+		pipelineSetPyramid(gPipelines[i], gPyramid);
+		pipelineSetBatchPose(gPipelines[i], gBatchPose);
+		pipelineSetFrontendMode(gPipelines[i], gFrontendMode);
+		pipelineSetResolution(gPipelines[i], gResolution);
+	}
+}
+
+// Hand every pipeline the markers placed by the current anchors.
+static void updateSculpture(void)
+{
+	ARMultiMarkerInfoT *config;
+	int i;
+
+	for (i = 0; i < gRig->cameraCount; i++) {
+		if ((config = trackerSculptureConfig(gObjectData, VIEW_SCALEFACTOR_4)) == NULL) {
+			fprintf(stderr, "updateSculpture(): Out of memory.\n");
+			return;
+		}
+		pipelineSetSculpture(gPipelines[i], config);
 	}
 }
 
 static void Quit(void)
 {
+	int i;
+
+	// Stop the detection threads before closing the cameras.
+	for (i = 0; i < RIG_CAMERAS_MAX; i++) {
+		pipelineDestroy(gPipelines[i]);
+		gPipelines[i] = NULL;
+	}
+	if (gLatencyTest) latencyReport(TRUE);
+	arLockFinal();
+	patternBankDestroy(gPatternBank);
+	gPatternBank = NULL;
+	backgroundDestroy(gBackground);	// Unmaps the snapshot images.
+	gBackground = NULL;
+	textAtlasDestroy(gTextAtlas);
+	gTextAtlas = NULL;
+	profileWriteTrace(PROFILE_TRACE_FILE);
 	arglCleanup(gArglSettings);
-	arVideoCapStop();
-	arVideoClose();
+	for (i = 0; i < RIG_CAMERAS_MAX; i++) {
+		if (gFrameSources[i] == NULL) continue;
+		frameSourceCapStop(gFrameSources[i]);
+		frameSourceClose(gFrameSources[i]);
+		gFrameSources[i] = NULL;
+	}
 #ifdef _WIN32
 	CoUninitialize();
 #endif
 	exit(0);
 }
 
+// Move the model of the current marker, see the anchors in object.h.
+static void tuneAnchor(int axis, double step)
+{
+	ObjectConfig_T *object;
+
+	if (gObjectModel < 0) {
+		printf("Select a marker with x to move the model on it\n");
+		return;
+	}
+	object = &gObjectData->config[gObjectModel];
+	object->anchor[axis] += step;
+	objectAnchorUpdate(object);
+	updateSculpture();
+	printf("Anchor #%d: position %.1f %.1f %.1f rotation %.1f %.1f %.1f\n", gObjectModel,
+		   object->anchor[0], object->anchor[1], object->anchor[2], object->anchor[3], object->anchor[4], object->anchor[5]);
+}
+
 static void Keyboard(unsigned char key, int x, int y)
 {
-	int mode;
+	long reasons[REDRAW_REASON_COUNT], frames, idle;
+	CaptureStats_T capture;
+	int mode, i;
 	switch (key) {
 		case 0x1B:						// Quit.
 		case 'Q':
@@ -212,80 +399,69 @@ static void Keyboard(unsigned char key, int x, int y)
 			break;
 		case 'U':
 		case 'u':
-			gPosX += 10;
 			printf("Transform X+\n");
-			printf("Position: %f %f %f\n", gPosX, gPosY, gPosZ);
+			tuneAnchor(0, ANCHOR_STEP_POS);
 			break;
 		case 'I':
 		case 'i':
-			gPosY += 10;
 			printf("Transform Y+\n");
-			printf("Position: %f %f %f\n", gPosX, gPosY, gPosZ);
+			tuneAnchor(1, ANCHOR_STEP_POS);
 			break;
 		case 'O':
 		case 'o':
-			gPosZ += 10;
 			printf("Transform Z+\n");
-			printf("Position: %f %f %f\n", gPosX, gPosY, gPosZ);
+			tuneAnchor(2, ANCHOR_STEP_POS);
 			break;
 		case 'J':
 		case 'j':
-			gPosX -= 10;
 			printf("Transform X-\n");
-			printf("Position: %f %f %f\n", gPosX, gPosY, gPosZ);
+			tuneAnchor(0, -ANCHOR_STEP_POS);
 			break;
 		case 'K':
 		case 'k':
-			gPosY -= 10;
 			printf("Transform Y-\n");
-			printf("Position: %f %f %f\n", gPosX, gPosY, gPosZ);
+			tuneAnchor(1, -ANCHOR_STEP_POS);
 			break;
 		case 'L':
 		case 'l':
-			gPosZ -= 10;
 			printf("Transform Z-\n");
-			printf("Position: %f %f %f\n", gPosX, gPosY, gPosZ);
+			tuneAnchor(2, -ANCHOR_STEP_POS);
 			break;
 		case '1':
 		case '+':
-			gRotX += 2.5;
 			printf("Rotate X+\n");
-			printf("Rotation: %f %f %f\n", gRotX, gRotY, gRotZ);
+			tuneAnchor(3, ANCHOR_STEP_ROT);
 			break;
 		case '2':
-		case '':
-			gRotY += 2.5;
+		case 'ě':
 			printf("Rotate Y+\n");
-			printf("Rotation: %f %f %f\n", gRotX, gRotY, gRotZ);
+			tuneAnchor(4, ANCHOR_STEP_ROT);
 			break;
 		case '3':
-		case '':
-			gRotZ += 2.5;
+		case 'š':
 			printf("Rotate Z+\n");
-			printf("Rotation: %f %f %f\n", gRotX, gRotY, gRotZ);
+			tuneAnchor(5, ANCHOR_STEP_ROT);
 			break;
 		case '4':
-		case '':
-			gRotX -= 2.5;
+		case 'č':
 			printf("Rotate X-\n");
-			printf("Rotation: %f %f %f\n", gRotX, gRotY, gRotZ);
+			tuneAnchor(3, -ANCHOR_STEP_ROT);
 			break;
 		case '5':
-		case '':
-			gRotY -= 2.5;
+		case 'ř':
 			printf("Rotate Y-\n");
-			printf("Rotation: %f %f %f\n", gRotX, gRotY, gRotZ);
+			tuneAnchor(4, -ANCHOR_STEP_ROT);
 			break;
 		case '6':
-		case '':
-			gRotZ -= 2.5;
+		case 'ž':
 			printf("Rotate Z-\n");
-			printf("Rotation: %f %f %f\n", gRotX, gRotY, gRotZ);
+			tuneAnchor(5, -ANCHOR_STEP_ROT);
 			break;
 		case 'X':
 		case 'x':
-			gObjectModel = (gObjectModel + 1) % gObjectDataCount;
-			printf("Switch 3D model: %d / %d\n", gObjectModel, gObjectDataCount);
+			gObjectModel = (gObjectModel + 2) % (gObjectDataCount + 1) - 1;
+			if (gObjectModel < 0) printf("Model placed by all markers\n");
+			else printf("Model placed by marker #%d (%s)\n", gObjectModel, gObjectData->config[gObjectModel].patt_name);
 			break;
 		case 'F':
 		case 'f':
@@ -303,18 +479,33 @@ static void Keyboard(unsigned char key, int x, int y)
 			break;
 		case 'C':
 		case 'c':
+			// Pixel buffer streaming, GL_DRAW_PIXELS, full and half
+			// resolution texture mapping.
 			mode = arglDrawModeGet(gArglSettings);
-			if (mode == AR_DRAW_BY_GL_DRAW_PIXELS) {
+			if (gBackgroundStream) {
+				gBackgroundStream = FALSE;
+				arglDrawModeSet(gArglSettings, AR_DRAW_BY_GL_DRAW_PIXELS);
+			} else if (mode == AR_DRAW_BY_GL_DRAW_PIXELS) {
 				arglDrawModeSet(gArglSettings, AR_DRAW_BY_TEXTURE_MAPPING);
 				arglTexmapModeSet(gArglSettings, AR_DRAW_TEXTURE_FULL_IMAGE);
 			} else {
 				mode = arglTexmapModeGet(gArglSettings);
 				if (mode == AR_DRAW_TEXTURE_FULL_IMAGE)	arglTexmapModeSet(gArglSettings, AR_DRAW_TEXTURE_HALF_IMAGE);
+				else if (gBackground != NULL) gBackgroundStream = TRUE;
 				else arglDrawModeSet(gArglSettings, AR_DRAW_BY_GL_DRAW_PIXELS);
 			}
 			fprintf(stderr, "--------------------------------------\n");
-			fprintf(stderr, "*** Camera - %f (frame/sec)\n", (double)gCallCountMarkerDetect/arUtilTimer());
-			gCallCountMarkerDetect = 0;
+			for (i = 0; i < gRig->cameraCount; i++) {
+				pipelineTakeCaptureStats(gPipelines[i], &capture);
+				fprintf(stderr, "*** Camera %d - %f (frame/sec), captured %ld, dropped %ld, overruns %ld\n", i + 1,
+						(double)pipelineTakeFrameCount(gPipelines[i])/arUtilTimer(), capture.captured, capture.dropped, capture.overruns);
+			}
+			latencyReport(FALSE);
+			latencyReset();
+			frames = redrawTakeCounts(&gRedraw, reasons, &idle);
+			fprintf(stderr, "*** Display - %f (frame/sec), drawn for", (double)frames/arUtilTimer());
+			for (i = 0; i < REDRAW_REASON_COUNT; i++) fprintf(stderr, " %s %ld,", redrawReasonName(i), reasons[i]);
+			fprintf(stderr, " idle %ld\n", idle);
 			arUtilTimerReset();
 			debugReportMode();
 			fprintf(stderr, "--------------------------------------\n");
@@ -343,16 +534,100 @@ static void Keyboard(unsigned char key, int x, int y)
 			break;
 		case 'W':
 		case 'w':
+			if (gThresholdMode != AUTOTHRESH_MANUAL) {
+				if (gThresholdBias < 100) gThresholdBias += 5;
+				updatePipelines();
+				printf("Increasing threshold bias: %d\n", gThresholdBias);
+				break;
+			}
 			gARTThreshhold += 5;
 			if(gARTThreshhold>255) gARTThreshhold=255;
+			updatePipelines();
 			printf("Increasing threshold: %d\n", gARTThreshhold);
 			break;
 		case 'S':
 		case 's':
+			if (gThresholdMode != AUTOTHRESH_MANUAL) {
+				if (gThresholdBias > -100) gThresholdBias -= 5;
+				updatePipelines();
+				printf("Decreasing threshold bias: %d\n", gThresholdBias);
+				break;
+			}
 			gARTThreshhold -= 5;
 			if(gARTThreshhold<0) gARTThreshhold=0;
+			updatePipelines();
 			printf("Decreasing threshold: %d\n", gARTThreshhold);
 			break;
+		case 'R':
+		case 'r':
+			gRoiTracking = !gRoiTracking;
+			updatePipelines();
+			printf("Region of interest tracking: %d\n", gRoiTracking);
+			break;
+		case 'B':
+		case 'b':
+			gBatchPose = !gBatchPose;
+			updatePipelines();
+			printf("Batch pose refinement: %d\n", gBatchPose);
+			break;
+		case 'G':
+		case 'g':
+			gThresholdMode = (AutoThreshMode_T)((gThresholdMode + 1) % AUTOTHRESH_MODE_COUNT);
+			updatePipelines();
+			printf("Threshold selection: %s\n", autoThreshModeName(gThresholdMode));
+			break;
+		case 'V':
+		case 'v':
+			do {
+				gFrontendMode = (FrontendMode_T)((gFrontendMode + 1) % FRONTEND_MODE_COUNT);
+			} while (!frontendModeAvailable(gFrontendMode));
+			updatePipelines();
+			printf("Thresholding and labeling: %s\n", frontendModeName(gFrontendMode));
+			break;
+		case 'Y':
+		case 'y':
+			gResolution = (FrontendResolution_T)((gResolution + 1) % FRONTEND_RES_COUNT);
+			updatePipelines();
+			printf("Detection resolution: %s\n", frontendResolutionName(gResolution));
+			break;
+		case 'Z':
+		case 'z':
+			gPyramid = !gPyramid;
+			updatePipelines();
+			printf("Pyramid candidate search: %d\n", gPyramid);
+			break;
+		case 'E':
+		case 'e':
+			if (objectSave(OBJECT_DATA_FILE, gObjectData)) printf("Anchors saved to %s\n", OBJECT_DATA_FILE);
+			break;
+		case 'P':
+		case 'p':
+			gPoseFilterMode = (PoseFilterMode_T)((gPoseFilterMode + 1) % POSEFILTER_MODE_COUNT);
+			printf("Pose filter: %s\n", poseFilterModeName(gPoseFilterMode));
+			break;
+		case 'M':
+		case 'm':
+			// Color, BW, then both again with PCA.
+			if (arTemplateMatchingMode == AR_TEMPLATE_MATCHING_COLOR) {
+				arTemplateMatchingMode = AR_TEMPLATE_MATCHING_BW;
+			} else {
+				arTemplateMatchingMode = AR_TEMPLATE_MATCHING_COLOR;
+				arMatchingPCAMode = (arMatchingPCAMode == AR_MATCHING_WITH_PCA ? AR_MATCHING_WITHOUT_PCA : AR_MATCHING_WITH_PCA);
+			}
+			printf("Template matching: %s%s\n", (arTemplateMatchingMode == AR_TEMPLATE_MATCHING_COLOR ? "color" : "BW"),
+				   (arMatchingPCAMode == AR_MATCHING_WITH_PCA ? " with PCA" : ""));
+			break;
+		case 'N':
+		case 'n':
+			// Shader, fixed function, OpenVRML, skipping what the driver
+			// cannot do.
+			mode = modelRenderer();
+			do {
+				mode = (mode + 1) % MODEL_RENDERER_COUNT;
+			} while (!modelRendererAvailable((ModelRenderer_T)mode));
+			modelSetRenderer((ModelRenderer_T)mode);
+			printf("Renderer: %s\n", modelRendererName(modelRenderer()));
+			break;
 		case '?':
 		case 'H':
 		case 'h':
@@ -361,18 +636,29 @@ static void Keyboard(unsigned char key, int x, int y)
 			printf("Copyright (c)2010 Petr Nohejl, www.jestrab.net\n\n");
 			printf("Usage:\n");
 			printf("   q or [esc]    Quit program\n");
-			printf("   x             Switch 3D model\n");
+			printf("   x             Place the model by all markers or by one marker\n");
 			printf("   f             Change fullscreen mode\n");
-			printf("   c             Change draw mode and texmap mode\n");
+			printf("   c             Change draw mode and texmap mode (pixel buffer streaming,\n");
+			printf("                 GL_DRAW_PIXELS, full and half resolution texture)\n");
 			printf("   d             Show debug mode displaying threshold\n");
-			printf("   t             Show debug text output\n");
+			printf("   t             Show debug text output, per-stage frame times and latency\n");
 			printf("   a             Draw 3D models always including pattern off\n");
-			printf("   w             Increase threshold\n");
-			printf("   s             Decrease threshold\n");
-			printf("   u i o         Increase position in X Y Z coordinates\n");
-			printf("   j k l         Decrease position in X Y Z coordinates\n");
-			printf("   1 2 3         Increase rotation in X Y Z coordinates\n");
-			printf("   4 5 6         Decrease rotation in X Y Z coordinates\n");
+			printf("   g             Switch threshold selection (manual, adaptive, Otsu)\n");
+			printf("   w             Increase threshold (bias of automatic thresholds)\n");
+			printf("   s             Decrease threshold (bias of automatic thresholds)\n");
+			printf("   r             Detect only around tracked markers (ROI tracking)\n");
+			printf("   b             Refine tracked marker poses in one batch or one by one\n");
+			printf("   v             Switch thresholding and labeling (ARToolKit, scalar, SSE2, AVX2)\n");
+			printf("   y             Switch detection resolution (full, half, half with full resolution corners)\n");
+			printf("   z             Search full frames only around the dark blobs of an image pyramid\n");
+			printf("   n             Switch model renderer (shader, fixed function, OpenVRML)\n");
+			printf("   m             Switch template matching (color, BW, with and without PCA)\n");
+			printf("   p             Switch pose filter (off, smooth, predict to display time)\n");
+			printf("   u i o         Move the model on the current marker in +X +Y +Z\n");
+			printf("   j k l         Move the model on the current marker in -X -Y -Z\n");
+			printf("   1 2 3         Rotate the model on the current marker around +X +Y +Z\n");
+			printf("   4 5 6         Rotate the model on the current marker around -X -Y -Z\n");
+			printf("   e             Save the model placements to the object file\n");
 			printf("   ? or h        Show this help\n");
 			printf("\nAdditionally, the ARVideo library supplied the following help text:\n");
 			arVideoDispOption();
@@ -381,87 +667,81 @@ static void Keyboard(unsigned char key, int x, int y)
 		default:
 			break;
 	}
+
+	// Modes and debug output show in the next frame.
+	redrawRequest(&gRedraw, REDRAW_UI);
 }
 
-static void Idle(void)
+//
+//	Feed new detections to the pose filters and replace the poses of snap
+//	with the filtered ones, at the frame time or predicted to the time the
+//	frame being drawn is shown, about one frame interval from now.
+//
+static void filterPoses(PoseSnapshot_T *snap)
 {
-	static int ms_prev;
-	int ms;
-	float s_elapsed;
-	ARUint8 *image;
-
-	ARMarkerInfo    *marker_info;					// Pointer to array holding the details of detected markers.
-    int             marker_num;						// Count of number of markers detected.
-    int             i, j, k;
-	
-	// Find out how long since Idle() last ran.
-	ms = glutGet(GLUT_ELAPSED_TIME);
-	s_elapsed = (float)(ms - ms_prev) * 0.001;
-	if (s_elapsed < 0.01f) return; // Don't update more often than 100 Hz.
-	ms_prev = ms;
-	
-	// Update drawing.
-	arVrmlTimerUpdate();
-	
-	// Grab a video frame.
-	if ((image = arVideoGetImage()) != NULL) {
-		gARTImage = image;	// Save the fetched image.
-		gPatt_found = FALSE;	// Invalidate any previous detected markers.
-		gPatt_found_multi = FALSE;	// Invalidate any previous detected multi markers.
-
-		gCallCountMarkerDetect++; // Increment ARToolKit FPS counter.
-		
-		// Detect the markers in the video frame.
-		if (arDetectMarker(gARTImage, gARTThreshhold, &marker_info, &marker_num) < 0) {
-			exit(-1);
-		}
-
+	double t;
+	int i;
 
-		// Check for object visibility.
+	if (snap->time > gPoseFilterTime) {
 		for (i = 0; i < gObjectDataCount; i++) {
-			// Check through the marker_info array for highest confidence
-			// visible marker matching our object's pattern.
-			k = -1;
-			for (j = 0; j < marker_num; j++) {
-				if (marker_info[j].id == gObjectData[i].id) {
-					if( k == -1 ) k = j; // First marker detected.
-					else if (marker_info[k].cf < marker_info[j].cf) k = j; // Higher confidence marker detected.
-				}
-			}
-
-			
-			if (k != -1) {
-				// Get the transformation between the marker and the real camera.
-				//fprintf(stderr, "Saw object %d.\n", i);
-				if (gObjectData[i].visible == 0) {
-					arGetTransMat(&marker_info[k], gObjectData[i].marker_center, gObjectData[i].marker_width, gObjectData[i].trans);
-				} else {
-					arGetTransMatCont(&marker_info[k], gObjectData[i].trans, gObjectData[i].marker_center, gObjectData[i].marker_width, gObjectData[i].trans);
-				}
-				gObjectData[i].visible = 1;
-				//printf("Vidim te! %d\n", i);
-				gPatt_found = TRUE;
-			} 
-			else {
-				gObjectData[i].visible = 0;
-				//printf("Nevidim te! %d\n", i);
-			}
+			if (snap->visible[i]) poseFilterUpdate(&gPoseFilters[i], snap->time, snap->trans[i]);
 		}
-	
+		if (snap->pattFoundMulti) poseFilterUpdate(&gPoseFilters[FILTER_MULTI], snap->time, snap->multiTrans);
+		if (snap->sculptureFound) poseFilterUpdate(&gPoseFilters[FILTER_SCULPTURE], snap->time, snap->sculptureTrans);
+		gPoseFilterTime = snap->time;
+	}
+	if (gPoseFilterMode == POSEFILTER_OFF) return;
 
-		// Tell GLUT to update the display.
-		glutPostRedisplay();
+	t = (gPoseFilterMode == POSEFILTER_PREDICT ? hrtimerNow() + gFrameInterval : snap->time);
+	snap->pattFound = FALSE;
+	for (i = 0; i < gObjectDataCount; i++) {
+		snap->visible[i] = poseFilterPose(&gPoseFilters[i], t, snap->trans[i]);
+		if (snap->visible[i]) snap->pattFound = TRUE;
+	}
+	snap->pattFoundMulti = poseFilterPose(&gPoseFilters[FILTER_MULTI], t, snap->multiTrans);
+	snap->sculptureFound = poseFilterPose(&gPoseFilters[FILTER_SCULPTURE], t, snap->sculptureTrans);
+}
 
+// Filter of the pose the model is drawn with, see Display().
+static PoseFilter_T *modelFilter(void)
+{
+	return (&gPoseFilters[gObjectModel < 0 ? FILTER_SCULPTURE : gObjectModel]);
+}
 
-		// Compute camera position in function of the multi-marker patterns (based on detected markers) 
-		if( (gErr = arMultiGetTransMat(marker_info, marker_num, gMultiMarkerConfig)) < 0 ) {
+static void Idle(void)
+{
+	double trans[3][4];
+	double now;
+	int i, visible;
 
+	// Update drawing.
+	arVrmlTimerUpdate();
+
+	// Capture and detection run on the pipeline threads. Redraw when one
+	// has published a new frame, or between frames when the predicted pose
+	// of the model moves, at most once per display refresh.
+	for (i = 0; i < gRig->cameraCount; i++) {
+		if (pipelineFresh(gPipelines[i])) {
+			redrawRequest(&gRedraw, REDRAW_FRAME);
+			break;
 		}
-		else
-		{
-			if(gMultiMarkerConfig->marker_num > 0) gPatt_found_multi = TRUE;
-		}
+	}
+	now = hrtimerNow();
+	if (gPoseFilterMode == POSEFILTER_PREDICT && poseFilterActive(modelFilter(), now)) {
+		visible = poseFilterPose(modelFilter(), now + gFrameInterval, trans);
+		redrawCheckPose(&gRedraw, visible, trans);
+	}
+
+	// The replay test ends once the last frame has had time to be shown.
+	if (gLatencyTest && frameSourceEnded(gFrameSources[0]) && !pipelineFresh(gPipelines[0])) {
+		if (gLatencyDrain == 0.0) gLatencyDrain = now;
+		else if (now - gLatencyDrain > LATENCY_TEST_DRAIN) Quit();
+	}
 
+	if (redrawDue(&gRedraw, now)) {
+		glutPostRedisplay();
+	} else {
+		arUtilSleep(1);
 	}
 }
 
@@ -472,6 +752,7 @@ static void Idle(void)
 static void Visibility(int visible)
 {
 	if (visible == GLUT_VISIBLE) {
+		redrawRequest(&gRedraw, REDRAW_UI);
 		glutIdleFunc(Idle);
 	} else {
 		glutIdleFunc(NULL);
@@ -493,6 +774,7 @@ static void Reshape(int w, int h)
 	glLoadIdentity();
 
 	// Call through to anyone else who needs to know about window sizing here.
+	redrawRequest(&gRedraw, REDRAW_UI);
 }
 
 
@@ -503,145 +785,99 @@ static void Display(void)
 {
     GLdouble p[16];
 	GLdouble m[16];
-
-	// Lights
-    GLfloat   light_position[]  = {gPosX, gPosY, gPosZ, 0.0};
-    GLfloat   ambi[]            = {0.1, 0.1, 0.1, 0.1};
-    GLfloat   lightZeroColor[]  = {0.9, 0.9, 0.9, 0.1};
+	PoseSnapshot_T *snaps[RIG_CAMERAS_MAX];
+	PoseSnapshot_T *snap;
+	double t;
+	int i, markers;
+
+	// Lights, specular and scene ambient are the OpenGL defaults.
+	static const ModelLight_T light = {
+		{0.0f, 0.0f, 0.0f, 0.0f},		// Position.
+		{0.1f, 0.1f, 0.1f, 0.1f},		// Ambient.
+		{0.9f, 0.9f, 0.9f, 0.1f},		// Diffuse.
+		{1.0f, 1.0f, 1.0f, 1.0f},		// Specular.
+		{0.2f, 0.2f, 0.2f, 1.0f}		// Scene ambient.
+	};
+
+	// Every redisplay draws the whole frame, also one the window system
+	// asks for without a reason; the reasons are only counted.
+	redrawBegin(&gRedraw, hrtimerNow());
+
+	// Latest frame and poses published by the pipeline threads. The previous
+	// frame goes back to the pipeline, so its upload must be complete.
+	// Slower cameras contribute their last snapshot.
+	backgroundRelease(gBackground);
+	for (i = 0; i < gRig->cameraCount; i++) snaps[i] = pipelineAcquire(gPipelines[i]);
+	if (!snaps[0]->valid) return;
+	rigFuse(gRig, snaps, gObjectDataCount, &gFused);
+	snap = &gFused;
+	filterPoses(snap);
 
 	// Select correct buffer for this context.
 	glDrawBuffer(GL_BACK);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the buffers for new frame.
 
 	// Display video frame
-	if( !arDebug ) {
-        arglDispImage(gARTImage, &gARTCparam, 1.0, gArglSettings);	// zoom = 1.0.
+	t = profileBegin();
+	if( !snap->debug ) {
+		// A frame already in the texture is not uploaded again, e.g. when
+		// only the predicted pose moved.
+		if (gBackgroundStream) {
+			backgroundDraw(gBackground, snap->frame != gBackgroundFrame ? snap->image : NULL);
+			gBackgroundFrame = snap->frame;
+		} else {
+			arglDispImage(snap->image, &gARTCparam, 1.0, gArglSettings);	// zoom = 1.0.
+			gBackgroundFrame = -1;
+		}
     }
 	// Threshold debug video frame
     else {
-		arglDispImage(gARTImage, &gARTCparam, 1.0, gArglSettings);
-		arglDispImage(arImage, &gARTCparam, 1.0, gArglSettings);
+		arglDispImage(snap->image, &gARTCparam, 1.0, gArglSettings);
+		arglDispImage(snap->debugImage, &gARTCparam, 1.0, gArglSettings);
+		gBackgroundFrame = -1;
     }
+	profileEnd(PROFILE_DISP_IMAGE, t);
 
-	arVideoCapNext();
-	gARTImage = NULL; // Image data is no longer valid after calling arVideoCapNext().
-
-	// Projection transformation.
+	// Projection transformation and lights, for the model renderer.
 	arglCameraFrustumRH(&gARTCparam, VIEW_DISTANCE_MIN, VIEW_DISTANCE_MAX, p);
-	glMatrixMode(GL_PROJECTION);
-	glLoadMatrixd(p);
-	glMatrixMode(GL_MODELVIEW);
-	
-	// Viewing transformation.
-	glLoadIdentity();
-
-	// Lighting and geometry that moves with the camera should go here.
-	// (I.e. must be specified before viewing transformations.)
-	//none
+	modelBegin(p, &light);
 
 
 	/*
 	// Draw VRML model for multi pattern
-	if(gDrawAlways || gPatt_found_multi)
+	if(gDrawAlways || snap->pattFoundMulti)
 	{
-		arglCameraViewRH(gMultiMarkerConfig->trans, m, VIEW_SCALEFACTOR_4);
-		glLoadMatrixd(m);
-		arVrmlDraw(gObjectData[ gObjectModel ].vrml_id);
+		arglCameraViewRH(snap->multiTrans, m, VIEW_SCALEFACTOR_4);
+		modelDraw(gObjectData->config[ gObjectModel ].model, m, NULL);
 	}
 	*/
 
 
-	glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
-    glLightfv(GL_LIGHT0, GL_POSITION, light_position);
-    glLightfv(GL_LIGHT0, GL_AMBIENT, ambi);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, lightZeroColor);
-
-
-	
-	// Pattern priority
-	if(arDebug) printf("VISIBILITY: %d %d %d %d %d\n", gObjectData[0].visible, gObjectData[1].visible, gObjectData[2].visible, gObjectData[3].visible, gObjectData[4].visible);
-	
-	if(gObjectData[0].visible) gObjectModel = 0;
-	else if(gObjectData[1].visible) gObjectModel = 1;
-	else if(gObjectData[2].visible) gObjectModel = 2;
-	else if(gObjectData[3].visible) gObjectModel = 3;
-	else if(gObjectData[4].visible) gObjectModel = 4;
 	
+	if(arDebug) printf("VISIBILITY: %d %d %d %d %d\n", snap->visible[0], snap->visible[1], snap->visible[2], snap->visible[3], snap->visible[4]);
 
+	// Pose for the check in Idle().
+	if (gObjectModel < 0) redrawDrawn(&gRedraw, snap->sculptureFound, snap->sculptureTrans);
+	else redrawDrawn(&gRedraw, snap->visible[ gObjectModel ], snap->trans[ gObjectModel ]);
 
-	
-	// Draw VRML model for single pattern
-	if(gDrawAlways || gPatt_found)
+	// Draw VRML model at the sculpture pose fitted to all visible markers,
+	// or placed by the anchor of the selected marker.
+	if (gObjectModel < 0 && (gDrawAlways || snap->sculptureFound))
 	{
-		arglCameraViewRH(gObjectData[ gObjectModel ].trans, m, VIEW_SCALEFACTOR_4);
-		glLoadMatrixd(m);
+		arglCameraViewRH(snap->sculptureTrans, m, VIEW_SCALEFACTOR_4);
 
-		
-		switch(gObjectModel)
-		{
-			case 0:
-				// position of C
-				glTranslatef( 210, -680, 4110 );
-				glRotatef(177.0, 1.0, 0.0, 0.0);
-				glRotatef(180.0, 0.0, 1.0, 0.0);
-				glRotatef(0.0, 0.0, 0.0, 1.0);
-				break;
-			case 1:
-				// position of sample1
-				glTranslatef( 0, 2580, 2100 );
-				glRotatef(65, 1.0, 0.0, 0.0);
-				glRotatef(180, 0.0, 1.0, 0.0);
-				glRotatef(0, 0.0, 0.0, 1.0);
-				break;
-			case 2:
-				// position of F
-				glTranslatef( 0, 4880, 2020 );
-				glRotatef(117.5, 1.0, 0.0, 0.0);
-				glRotatef(180.0, 0.0, 1.0, 0.0);
-				glRotatef(0.0, 0.0, 0.0, 1.0);
-				break;
-			case 3:
-				// position of hiro
-				glTranslatef( 920, 3160, 2470 );
-				glRotatef(102.5, 1.0, 0.0, 0.0);
-				glRotatef(192.5, 0.0, 1.0, 0.0);
-				glRotatef(2.5, 0.0, 0.0, 1.0);
-				break;
-			case 4:
-				// position of kanji
-				glTranslatef( -920, 3290, 2620 );
-				glRotatef(102.5, 1.0, 0.0, 0.0);
-				glRotatef(165.0, 0.0, 1.0, 0.0);
-				glRotatef(0.0, 0.0, 0.0, 1.0);
-				break;
-			case 5:
-				// position of A
-				glTranslatef( 2930, 3290, 2580 );
-				glRotatef(120, 1.0, 0.0, 0.0);
-				glRotatef(162.5, 0.0, 1.0, 0.0);
-				glRotatef(17.5, 0.0, 0.0, 1.0);
-				break;
-			case 6:
-				// position of sample2
-				glTranslatef( -3110, -2780, 2810 );
-				glRotatef(32.5, 1.0, 0.0, 0.0);
-				glRotatef(307.5, 0.0, 1.0, 0.0);
-				glRotatef(-797.5, 0.0, 0.0, 1.0);
-				break;
-			
-		}
-		
-
-		/*
-		// variable position 
-		glTranslatef( gPosX, gPosY, gPosZ );
-		glRotatef(gRotX, 1.0, 0.0, 0.0);
-		glRotatef(gRotY, 0.0, 1.0, 0.0);
-		glRotatef(gRotZ, 0.0, 0.0, 1.0);
-		*/
+		t = profileBegin();
+		modelDraw(gObjectData->config[ 0 ].model, m, NULL);
+		profileEnd(PROFILE_MODEL_DRAW, t);
+	}
+	else if (gObjectModel >= 0 && (gDrawAlways || snap->visible[ gObjectModel ]))
+	{
+		arglCameraViewRH(snap->trans[ gObjectModel ], m, VIEW_SCALEFACTOR_4);
 
-		arVrmlDraw(gObjectData[ 0 ].vrml_id);
+		t = profileBegin();
+		// Placed by the anchor of this marker.
+		modelDraw(gObjectData->config[ 0 ].model, m, gObjectData->config[ gObjectModel ].anchor_matrix);
+		profileEnd(PROFILE_MODEL_DRAW, t);
 	}
 	
 
@@ -649,25 +885,22 @@ static void Display(void)
 	// All other lighting and geometry goes here.
 	// Calculate the camera position for each object and draw it.
 	for (int i = 0; i < gObjectDataCount; i++) {
-		if ((gObjectData[i].visible != 0) && (gObjectData[i].vrml_id >= 0)) {
+		if ((snap->visible[i] != 0) && (gObjectData->config[i].model != NULL)) {
 			//fprintf(stderr, "About to draw object %i\n", i);
-			arglCameraViewRH(gObjectData[i].trans, m, VIEW_SCALEFACTOR_4);
-			glLoadMatrixd(m);
-
-			arVrmlDraw(gObjectData[i].vrml_id);
+			arglCameraViewRH(snap->trans[i], m, VIEW_SCALEFACTOR_4);
+			modelDraw(gObjectData->config[i].model, m, NULL);
 		}			
 	}
 	*/
 
 	// Lights off
-	glDisable( GL_LIGHT0 );
-	glDisable( GL_LIGHTING );
+	modelEnd();
 
 
 	// Debug text info
-	if (gPatt_found_multi) {
+	if (snap->pattFoundMulti) {
 		char string[256];
-		sprintf(string, "Multi [x: %3.1f] [y: %3.1f] [z: %3.1f] [err: %3.1f]", gMultiMarkerConfig->trans[0][3], gMultiMarkerConfig->trans[1][3], gMultiMarkerConfig->trans[2][3], gErr);
+		sprintf(string, "Multi [x: %3.1f] [y: %3.1f] [z: %3.1f] [err: %3.1f]", snap->multiTrans[0][3], snap->multiTrans[1][3], snap->multiTrans[2][3], snap->multiErr);
 		printString(string, 0.73);
 	}
 	else
@@ -675,9 +908,15 @@ static void Display(void)
 		printString("No multi pattern detected", 0.73);
 	}
 
-	if (gPatt_found) {	
+	if (gObjectModel < 0 && snap->sculptureFound) {
 		char string[256];
-		sprintf(string, "Single #%d [x: %3.1f] [y: %3.1f] [z: %3.1f]", gObjectModel, gObjectData[ gObjectModel ].trans[0][3],gObjectData[ gObjectModel ].trans[1][3],gObjectData[ gObjectModel ].trans[2][3]);
+		for (i = 0, markers = 0; i < gObjectDataCount; i++) markers += (snap->visible[i] != 0);
+		sprintf(string, "Sculpture [x: %3.1f] [y: %3.1f] [z: %3.1f] [err: %3.1f] [markers: %d]", snap->sculptureTrans[0][3], snap->sculptureTrans[1][3], snap->sculptureTrans[2][3], snap->sculptureErr, markers);
+		printString(string, 0.83);
+	}
+	else if (gObjectModel >= 0 && snap->visible[ gObjectModel ]) {
+		char string[256];
+		sprintf(string, "Single #%d [x: %3.1f] [y: %3.1f] [z: %3.1f]", gObjectModel, snap->trans[ gObjectModel ][0][3],snap->trans[ gObjectModel ][1][3],snap->trans[ gObjectModel ][2][3]);
 		printString(string, 0.83);
 	}
 	else
@@ -685,17 +924,84 @@ static void Display(void)
 		printString("No single pattern detected", 0.83);
 	}
 
+	// Thresholds of this frame
+	if (gDebugText) {
+		char string[256];
+		if (snap->thresholdMode == AUTOTHRESH_ADAPTIVE && !snap->thresholdFallback) {
+			sprintf(string, "Threshold %s %d-%d [otsu: %d]", autoThreshModeName(snap->thresholdMode), snap->thresholdMin, snap->thresholdMax, snap->threshold);
+		} else {
+			sprintf(string, "Threshold %s %d%s", autoThreshModeName(snap->thresholdMode), snap->threshold, snap->thresholdFallback ? " [otsu fallback]" : "");
+		}
+		printString(string, 0.93);
+	}
+
+	// Frame time per stage
+	if (gDebugText) {
+		char string[256];
+		double min, avg, p99;
+		int stage;
+		for (stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+			if (!profileStats((ProfileStage_T)stage, &min, &avg, &p99)) continue;
+			sprintf(string, "%-19s %6.2f %6.2f %6.2f ms min/avg/p99", profileStageName((ProfileStage_T)stage), min, avg, p99);
+			printString(string, 0.63 - 0.1 * stage);
+		}
+	}
+
+	// Camera to screen latency of the shown frames
+	if (gDebugText) {
+		char string[256];
+		LatencyStats_T stats;
+		int stage;
+		for (stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+			if (!latencyStats((LatencyStage_T)stage, &stats)) continue;
+			sprintf(string, "%-19s %6.2f %6.2f %6.2f ms p50/p90/p99", latencyStageName((LatencyStage_T)stage), stats.p50, stats.p90, stats.p99);
+			printString(string, 0.63 - 0.1 * (PROFILE_STAGE_COUNT + stage));
+		}
+	}
+
+	textAtlasDraw(gTextAtlas);
+
+	t = profileBegin();
 	glutSwapBuffers();
+	profileEnd(PROFILE_SWAP, t);
+
+	// Time until the next frame is shown, for the pose prediction.
+	t = hrtimerNow();
+	if (gFrameLast > 0.0 && t - gFrameLast < POSEFILTER_EXTRAPOLATE_MAX) {
+		gFrameInterval += 0.1 * ((t - gFrameLast) - gFrameInterval);
+	}
+	gFrameLast = t;
+
+	// Latency of a camera frame the first time it is on screen, from the
+	// second frame on; the first one waited for the startup.
+	if (snap->frame != gLatencyFrame) {
+		if (gStartupReported) latencyFrame(snap->time, snap->published, t);
+		gLatencyFrame = snap->frame;
+	}
+
+	if (!gStartupReported) {
+		gStartupReported = TRUE;
+		startupReport();
+	}
 }
 
 
 
 void printString( char *string, double position )
 {
+  static const float panel[4] = {0.1f, 0.1f, 0.1f, 1.0f};
+  static const float text[4] = {0.0f, 1.0f, 0.0f, 1.0f};
   int len;
   int i;
 
   if(!gDebugText) return;
+
+  // The shader renderer queues the lines, Display() draws them at once.
+  if (gTextAtlas != NULL && modelRenderer() == MODEL_RENDERER_SHADER) {
+      textAtlasRect(gTextAtlas, -0.95f, (float)position, 0.55f, (float)(position + 0.1), panel);
+      textAtlasString(gTextAtlas, -0.93f, (float)(position + 0.035), string, text);
+      return;
+  }
 	
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
@@ -772,16 +1078,19 @@ int parseConfig(char *filename)
 
 int main(int argc, char** argv)
 {
-	int i;
 	char glutGamemode[32];
+	ObjectLoad_T *objectLoad;
+	Scene_T *scene = NULL;
+	ARUint8 *images[PIPELINE_SNAPSHOTS];
+	double t;
+	int i;
 	const char *cparam_name = "Data/camera_para.dat";
 #ifdef _WIN32
 	char			*vconf = "Data\\WDM_camera_flipV.xml";
 #else
 	char			*vconf = "";
 #endif
-	char objectDataFilename[] = "Data/object_data_mantis";
-	char objectDataFilenameMulti[] = "Data/multi/marker_mantis.dat";
+	const char *camerasFilename = "Data/cameras.dat";
 
 	// Load config file
 	//if(parseConfig("config.txt") == 1) return 1;
@@ -789,14 +1098,6 @@ int main(int argc, char** argv)
 	gDrawAlways = 0;
 	gFullscreen = 0;
 
-	// Init positions
-	gPosX = 0;
-	gPosY = 0;
-	gPosZ = 0;
-	gRotX = 0;
-	gRotY = 0;
-	gRotZ = 0;
-
 
 
 
@@ -804,16 +1105,47 @@ int main(int argc, char** argv)
 	// Library inits.
 	//
 
+	gStartupBegin = hrtimerNow();
 	glutInit(&argc, argv);
 
+	// Optional video config, e.g. "replay:Data/clip.y4m" to run from a recording.
+	// -latency after it measures the latency over the replay and quits at
+	// its end, best with the once option.
+	if (argc > 1) vconf = argv[1];
+	if (argc > 2 && strcmp(argv[2], "-latency") == 0) gLatencyTest = TRUE;
+
+	// Several cameras when there is a camera file, see rig.h. The video
+	// config argument replaces the first camera's.
+	if ((gRig = rigLoad(camerasFilename)) != NULL) {
+		printf("Cameras: %d (%s)\n", gRig->cameraCount, camerasFilename);
+		if (argc > 1) strncpy(gRig->cameras[0].vconf, vconf, sizeof(gRig->cameras[0].vconf) - 1);
+	} else if ((gRig = rigSingle(vconf, cparam_name)) == NULL) {
+		exit(-1);
+	}
+
+	// The model files load on worker threads while the camera and the
+	// window are set up. The compiled scene while it is up to date, the
+	// text files after anchors were saved to them.
+	if (!sceneStale(SCENE_FILE, OBJECT_DATA_FILE, MULTI_DATA_FILE)) scene = sceneOpen(SCENE_FILE, NULL);
+	if (scene == NULL) scene = sceneOpen(OBJECT_DATA_FILE, MULTI_DATA_FILE);
+	if ((objectLoad = objectLoadBegin(scene, TRUE)) == NULL) {
+		fprintf(stderr, "main(): Unable to read object data %s.\n", OBJECT_DATA_FILE);
+		exit(-1);
+	}
+	printf("Object data: %s\n", scene->compiled ? SCENE_FILE : OBJECT_DATA_FILE);
+
 	// ----------------------------------------------------------------------------
 	// Hardware setup.
 	//
 
-	if (!setupCamera(cparam_name, vconf, &gARTCparam)) {
-		fprintf(stderr, "main(): Unable to set up AR camera.\n");
-		exit(-1);
+	t = hrtimerNow();
+	for (i = 0; i < gRig->cameraCount; i++) {
+		if (!setupCamera(i)) {
+			fprintf(stderr, "main(): Unable to set up AR camera.\n");
+			exit(-1);
+		}
 	}
+	gStartupCamera = hrtimerNow() - t;
 	
 #ifdef _WIN32
 	CoInitialize(NULL);
@@ -824,6 +1156,7 @@ int main(int argc, char** argv)
 	//
 
 	// Set up GL context(s) for OpenGL to draw into.
+	t = hrtimerNow();
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
 	if (!prefWindowed) {
 		if (prefRefresh) sprintf(glutGamemode, "%ix%i:%i@%i", prefWidth, prefHeight, prefDepth, prefRefresh);
@@ -840,24 +1173,51 @@ int main(int argc, char** argv)
 		fprintf(stderr, "main(): arglSetupForCurrentContext() returned error.\n");
 		exit(-1);
 	}
+	if ((gBackground = backgroundCreate(&gARTCparam)) != NULL) gBackgroundStream = TRUE;
+	if (modelRendererAvailable(MODEL_RENDERER_SHADER)) modelSetRenderer(MODEL_RENDERER_SHADER);
+	gTextAtlas = textAtlasCreate();
+
+	// Draw only when something changed, no faster than the display shows.
+	redrawInit(&gRedraw, prefWindowed ? 0 : prefRefresh);
+	if (!redrawSetSwapInterval(1)) printf("No swap interval control, frames are limited by time only.\n");
+	gResolution = (arImageProcMode == AR_IMAGE_PROC_IN_HALF ? FRONTEND_RES_HALF : FRONTEND_RES_FULL);
 	debugReportMode();
 	arUtilTimerReset();
+	gStartupWindow = hrtimerNow() - t;
 
-	if (!setupMarkersObjects(objectDataFilename, objectDataFilenameMulti)) {
+	// Models are uploaded to GL when they are first drawn.
+	t = hrtimerNow();
+	if (!setupMarkersObjects(objectLoad)) {
 		fprintf(stderr, "main(): Unable to set up AR objects and markers.\n");
 		Quit();
 	}
-	
-	// Test render all the VRML objects.
-    fprintf(stdout, "Pre-rendering the VRML objects...");
-	fflush(stdout);
-    glEnable(GL_TEXTURE_2D);
-    for (i = 0; i < gObjectDataCount; i++) {
-		arVrmlDraw(gObjectData[i].vrml_id);
-    }
-    glDisable(GL_TEXTURE_2D);
-	fprintf(stdout, " done\n");
+	gStartupObjects = hrtimerNow() - t - gStartupLoad.waitTime;
 	fprintf(stdout, "--------------------------------------\n");
+
+	// Start capture and detection on a pipeline thread per camera.
+	t = hrtimerNow();
+	if (!arLockInit()) Quit();
+	for (i = 0; i < gRig->cameraCount; i++) {
+		if ((gPipelines[i] = pipelineCreate(gFrameSources[i], i, gCameraObjects[i], gCameraMulti[i], &gCameraCparams[i])) == NULL) {
+			fprintf(stderr, "main(): Unable to create detection pipeline.\n");
+			Quit();
+		}
+		pipelineSetPatternBank(gPipelines[i], gPatternBank);
+	}
+	if (gBackground != NULL && backgroundPersistent(gBackground)) {
+		// The detection thread copies each frame straight into the mapped
+		// pixel buffers.
+		for (i = 0; i < PIPELINE_SNAPSHOTS; i++) images[i] = backgroundImageMemory(gBackground, i);
+		pipelineSetImageMemory(gPipelines[0], images);
+	}
+	gFrontendMode = frontendBestMode();
+	updatePipelines();
+	updateSculpture();
+	printf("Thresholding and labeling: %s\n", frontendModeName(gFrontendMode));
+	for (i = 0; i < gRig->cameraCount; i++) {
+		if (!pipelineStart(gPipelines[i])) Quit();
+	}
+	gStartupPipeline = hrtimerNow() - t;
 	
 	// Register GLUT event-handling callbacks.
 	// NB: Idle() is registered by Visibility.
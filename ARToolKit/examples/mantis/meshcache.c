@@ -0,0 +1,1193 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include <AR/ar.h>
+
+#include "meshcache.h"
+#include "jpegload.h"
+#include "thread.h"
+#include "mapfile.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define MESH_CACHE_MAGIC		"MTSMESH\032"
+#define MESH_CACHE_VERSION		1
+#define MESH_CACHE_SUFFIX		".mesh"
+#define MESH_ALIGN				16
+#define MESH_FNV_BASIS			2166136261U
+#define MESH_FNV_PRIME			16777619U
+#define MESH_DECODE_THREADS		8
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+// Start of the cache file, followed by the groups, the textures, the
+// vertices and the texture pixels. Offsets are from the start of the file.
+typedef struct {
+	char		magic[8];
+	ARUint32	version;
+	ARUint32	size;			// Whole file.
+	ARUint32	sourceSize;		// Bytes of the .wrl.
+	ARUint32	sourceHash;		// FNV-1a of the .wrl and then the texture files.
+	ARUint32	vertexCount;
+	ARUint32	vertexOffset;
+	ARUint32	groupCount;
+	ARUint32	groupOffset;
+	ARUint32	textureCount;
+	ARUint32	textureOffset;
+} MeshHeader_T;
+
+struct Mesh_T {
+	double				translation[3];
+	double				rotation[4];
+	double				scale[3];
+
+	const ARUint8		*blob;
+	const MeshHeader_T	*header;
+	ARUint8				*memory;		// Compiled blob, when not mapped.
+	MapFile_T			map;
+};
+
+typedef struct {
+	float		*v;
+	int			n, cap;
+} FloatArray_T;
+
+typedef struct {
+	int			*v;
+	int			n, cap;
+} IntArray_T;
+
+typedef struct {
+	MeshGroup_T		group;			// first and count are set with the blob.
+	MeshVertex_T	*vertices;
+	int				count, cap;
+} BuildGroup_T;
+
+// Fields of a Shape node and its Appearance and IndexedFaceSet.
+typedef struct {
+	int				hasMaterial;
+	float			diffuse[3];
+	float			emissive[3];
+	float			specular[3];
+	float			ambientIntensity;
+	float			shininess;
+	float			transparency;
+	int				texture;
+	char			url[256];		// Of the ImageTexture being parsed.
+	int				repeatS, repeatT;
+
+	int				hasGeometry;
+	int				faceSet;
+	int				ccw, solid, normalPerVertex;
+	FloatArray_T	coord, normal, texCoord;
+	IntArray_T		coordIndex, normalIndex, texCoordIndex;
+} Shape_T;
+
+typedef struct {
+	const char		*file;
+	const char		*p, *end;
+	int				line;
+	char			token[256];
+	int				string;			// The token was a quoted string.
+	int				pushed;			// The token is read again by nextToken().
+	int				error;
+
+	char			dir[256];		// Of the .wrl, for the texture urls.
+	BuildGroup_T	*groups;
+	int				groupCount, groupCap;
+	MeshTexture_T	*textures;
+	int				textureCount, textureCap;
+} Build_T;
+
+// Textures decoded in parallel, taken in turn by the decoding threads.
+typedef struct {
+	const MeshTexture_T	*textures;
+	int					count;
+	volatile long		next;
+	ARUint8				**pixels;
+	int					*width, *height;
+} Decode_T;
+
+// ============================================================================
+//	Hashing and files
+// ============================================================================
+
+static ARUint32 fnv1a(const ARUint8 *data, size_t size, ARUint32 hash)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) hash = (hash ^ data[i]) * MESH_FNV_PRIME;
+	return (hash);
+}
+
+// Missing files leave the hash unchanged, the same when compiling and
+// when checking the cache.
+static ARUint32 fnv1aFile(const char *path, ARUint32 hash)
+{
+	FILE *fp;
+	ARUint8 buf[16384];
+	size_t n;
+
+	if ((fp = fopen(path, "rb")) == NULL) return (hash);
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) hash = fnv1a(buf, n, hash);
+	fclose(fp);
+	return (hash);
+}
+
+static ARUint8 *readFile(const char *path, size_t *size)
+{
+	FILE *fp;
+	ARUint8 *data;
+	long len;
+
+	if ((fp = fopen(path, "rb")) == NULL) return (NULL);
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (len < 0 || (data = (ARUint8 *)malloc(len + 1)) == NULL) {
+		fclose(fp);
+		return (NULL);
+	}
+	*size = fread(data, 1, len, fp);
+	data[*size] = '\0';
+	fclose(fp);
+	return (data);
+}
+
+// Directory part of a path including the separator, or "".
+static void pathDir(const char *path, char *dir, int size)
+{
+	const char *slash = strrchr(path, '/'), *backslash = strrchr(path, '\\');
+	int len;
+
+	if (backslash > slash) slash = backslash;
+	len = (slash == NULL ? 0 : (int)(slash - path) + 1);
+	if (len >= size) len = size - 1;
+	memcpy(dir, path, len);
+	dir[len] = '\0';
+}
+
+static void pathJoin(const char *dir, const char *name, char *path, int size)
+{
+	if (name[0] == '/' || name[0] == '\\' || (name[0] != '\0' && name[1] == ':')) dir = "";
+	sprintf(path, "%.*s", size - 1, dir);
+	strncat(path, name, size - 1 - strlen(path));
+}
+
+static char *getBuff(char *buf, int n, FILE *fp)
+{
+	char *ret;
+
+	for (;;) {
+		ret = fgets(buf, n, fp);
+		if (ret == NULL) return (NULL);
+		if (buf[0] != '\n' && buf[0] != '#') return (ret);	// Skip blank lines and comments.
+	}
+}
+
+// ============================================================================
+//	Matrices
+// ============================================================================
+//
+//	Affine transformations as the upper 3x4 of a 4x4 matrix, like the
+//	ARToolKit marker transformations.
+//
+
+static void matrixIdentity(double m[3][4])
+{
+	int i, j;
+
+	for (j = 0; j < 3; j++) for (i = 0; i < 4; i++) m[j][i] = (i == j ? 1.0 : 0.0);
+}
+
+static void matrixMul(double a[3][4], double b[3][4], double out[3][4])
+{
+	double r[3][4];
+	int i, j;
+
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < 4; i++) {
+			r[j][i] = a[j][0] * b[0][i] + a[j][1] * b[1][i] + a[j][2] * b[2][i] + (i == 3 ? a[j][3] : 0.0);
+		}
+	}
+	memcpy(out, r, sizeof(r));
+}
+
+static void matrixTranslate(double m[3][4], double x, double y, double z)
+{
+	double t[3][4];
+
+	matrixIdentity(t);
+	t[0][3] = x;
+	t[1][3] = y;
+	t[2][3] = z;
+	matrixMul(m, t, m);
+}
+
+static void matrixScale(double m[3][4], const double s[3])
+{
+	double t[3][4];
+
+	matrixIdentity(t);
+	t[0][0] = s[0];
+	t[1][1] = s[1];
+	t[2][2] = s[2];
+	matrixMul(m, t, m);
+}
+
+// VRML rotation: axis and angle in radians.
+static void matrixRotate(double m[3][4], const double r[4], double sign)
+{
+	double t[3][4], len, x, y, z, c, s, v;
+
+	len = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+	if (len == 0.0 || r[3] == 0.0) return;
+	x = r[0] / len;
+	y = r[1] / len;
+	z = r[2] / len;
+	c = cos(sign * r[3]);
+	s = sin(sign * r[3]);
+	v = 1.0 - c;
+	matrixIdentity(t);
+	t[0][0] = x * x * v + c;		t[0][1] = x * y * v - z * s;	t[0][2] = x * z * v + y * s;
+	t[1][0] = y * x * v + z * s;	t[1][1] = y * y * v + c;		t[1][2] = y * z * v - x * s;
+	t[2][0] = z * x * v - y * s;	t[2][1] = z * y * v + x * s;	t[2][2] = z * z * v + c;
+	matrixMul(m, t, m);
+}
+
+// Transposed inverse of the 3x3 part up to a positive factor, for normals.
+// Returns the determinant.
+static double matrixNormal(double m[3][4], double n[3][3])
+{
+	double det;
+	int i, j;
+
+	n[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	n[0][1] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	n[0][2] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	n[1][0] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+	n[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+	n[1][2] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+	n[2][0] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+	n[2][1] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+	n[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+	det = m[0][0] * n[0][0] + m[0][1] * n[0][1] + m[0][2] * n[0][2];
+	if (det < 0.0) {
+		for (j = 0; j < 3; j++) for (i = 0; i < 3; i++) n[j][i] = -n[j][i];
+	}
+	return (det);
+}
+
+static void normalize(float v[3])
+{
+	double len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+	if (len == 0.0) return;
+	v[0] = (float)(v[0] / len);
+	v[1] = (float)(v[1] / len);
+	v[2] = (float)(v[2] / len);
+}
+
+// ============================================================================
+//	Growing arrays
+// ============================================================================
+
+static int floatPush(FloatArray_T *a, float v)
+{
+	float *grown;
+	int cap;
+
+	if (a->n == a->cap) {
+		cap = (a->cap ? a->cap * 2 : 256);
+		if ((grown = (float *)realloc(a->v, cap * sizeof(float))) == NULL) return (FALSE);
+		a->v = grown;
+		a->cap = cap;
+	}
+	a->v[a->n++] = v;
+	return (TRUE);
+}
+
+static int intPush(IntArray_T *a, int v)
+{
+	int *grown;
+	int cap;
+
+	if (a->n == a->cap) {
+		cap = (a->cap ? a->cap * 2 : 256);
+		if ((grown = (int *)realloc(a->v, cap * sizeof(int))) == NULL) return (FALSE);
+		a->v = grown;
+		a->cap = cap;
+	}
+	a->v[a->n++] = v;
+	return (TRUE);
+}
+
+static int vertexPush(BuildGroup_T *g, const MeshVertex_T *v)
+{
+	MeshVertex_T *grown;
+	int cap;
+
+	if (g->count == g->cap) {
+		cap = (g->cap ? g->cap * 2 : 1024);
+		if ((grown = (MeshVertex_T *)realloc(g->vertices, cap * sizeof(MeshVertex_T))) == NULL) return (FALSE);
+		g->vertices = grown;
+		g->cap = cap;
+	}
+	g->vertices[g->count++] = *v;
+	return (TRUE);
+}
+
+// ============================================================================
+//	Tokens
+// ============================================================================
+
+static int parseError(Build_T *b, const char *message)
+{
+	if (!b->error) fprintf(stderr, "meshLoad(): %s line %d: %s\n", b->file, b->line, message);
+	b->error = TRUE;
+	return (FALSE);
+}
+
+// Commas are whitespace in VRML97.
+static int nextToken(Build_T *b)
+{
+	int n = 0;
+
+	if (b->pushed) {
+		b->pushed = FALSE;
+		return (TRUE);
+	}
+	for (;;) {
+		while (b->p < b->end && (isspace((unsigned char)*b->p) || *b->p == ',')) {
+			if (*b->p == '\n') b->line++;
+			b->p++;
+		}
+		if (b->p < b->end && *b->p == '#') {
+			while (b->p < b->end && *b->p != '\n') b->p++;
+			continue;
+		}
+		break;
+	}
+	b->string = FALSE;
+	b->token[0] = '\0';
+	if (b->p >= b->end) return (FALSE);
+
+	if (*b->p == '{' || *b->p == '}' || *b->p == '[' || *b->p == ']') {
+		b->token[0] = *b->p++;
+		b->token[1] = '\0';
+	} else if (*b->p == '"') {
+		b->string = TRUE;
+		for (b->p++; b->p < b->end && *b->p != '"'; b->p++) {
+			if (*b->p == '\\' && b->p + 1 < b->end) b->p++;
+			if (*b->p == '\n') b->line++;
+			if (n < (int)sizeof(b->token) - 1) b->token[n++] = *b->p;
+		}
+		if (b->p < b->end) b->p++;
+		b->token[n] = '\0';
+	} else {
+		while (b->p < b->end && !isspace((unsigned char)*b->p) && strchr(",{}[]#\"", *b->p) == NULL) {
+			if (n < (int)sizeof(b->token) - 1) b->token[n++] = *b->p;
+			b->p++;
+		}
+		b->token[n] = '\0';
+	}
+	return (TRUE);
+}
+
+static int isToken(Build_T *b, const char *s)
+{
+	return (!b->string && strcmp(b->token, s) == 0);
+}
+
+static int isNumber(Build_T *b)
+{
+	return (!b->string && b->token[0] != '\0' && strchr("0123456789+-.", b->token[0]) != NULL);
+}
+
+static int expectToken(Build_T *b, const char *s)
+{
+	char message[300];
+
+	if (nextToken(b) && isToken(b, s)) return (TRUE);
+	sprintf(message, "'%s' expected, found '%.200s'", s, b->token);
+	return (parseError(b, message));
+}
+
+// Skip to the bracket that closes an opening one just read.
+static int skipBlock(Build_T *b)
+{
+	int depth = 1;
+
+	while (depth > 0) {
+		if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+		if (isToken(b, "{") || isToken(b, "[")) depth++;
+		else if (isToken(b, "}") || isToken(b, "]")) depth--;
+	}
+	return (TRUE);
+}
+
+// Skip the value of a field that is not used.
+static int skipValue(Build_T *b)
+{
+	if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+	if (isToken(b, "[")) return (skipBlock(b));
+	if (isToken(b, "USE")) return (nextToken(b));
+	if (isToken(b, "DEF")) {
+		nextToken(b);
+		nextToken(b);
+	}
+	if (!b->string && isupper((unsigned char)b->token[0]) && !isToken(b, "TRUE") && !isToken(b, "FALSE") && !isToken(b, "NULL")) {
+		return (expectToken(b, "{") && skipBlock(b));
+	}
+	// Numbers, a string or a boolean.
+	while (nextToken(b)) {
+		if (!isNumber(b)) {
+			b->pushed = TRUE;
+			break;
+		}
+	}
+	return (TRUE);
+}
+
+static int parseFloats(Build_T *b, float *v, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!nextToken(b) || !isNumber(b)) return (parseError(b, "Number expected"));
+		v[i] = (float)strtod(b->token, NULL);
+	}
+	return (TRUE);
+}
+
+// A multiple value field, or a single value of components numbers.
+static int parseFloatArray(Build_T *b, FloatArray_T *a, int components)
+{
+	float v[4];
+	int i;
+
+	a->n = 0;
+	if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+	if (!isToken(b, "[")) {
+		b->pushed = TRUE;
+		if (!parseFloats(b, v, components)) return (FALSE);
+		for (i = 0; i < components; i++) if (!floatPush(a, v[i])) return (parseError(b, "Out of memory"));
+		return (TRUE);
+	}
+	for (;;) {
+		if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+		if (isToken(b, "]")) break;
+		if (!isNumber(b)) return (parseError(b, "Number expected"));
+		if (!floatPush(a, (float)strtod(b->token, NULL))) return (parseError(b, "Out of memory"));
+	}
+	if (a->n % components != 0) return (parseError(b, "Incomplete vector"));
+	return (TRUE);
+}
+
+static int parseIntArray(Build_T *b, IntArray_T *a)
+{
+	a->n = 0;
+	if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+	if (!isToken(b, "[")) {
+		if (!isNumber(b)) return (parseError(b, "Number expected"));
+		return (intPush(a, atoi(b->token)) ? TRUE : parseError(b, "Out of memory"));
+	}
+	for (;;) {
+		if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+		if (isToken(b, "]")) break;
+		if (!isNumber(b)) return (parseError(b, "Number expected"));
+		if (!intPush(a, atoi(b->token))) return (parseError(b, "Out of memory"));
+	}
+	return (TRUE);
+}
+
+static int parseBool(Build_T *b, int *v)
+{
+	if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+	if (isToken(b, "TRUE")) *v = TRUE;
+	else if (isToken(b, "FALSE")) *v = FALSE;
+	else return (parseError(b, "TRUE or FALSE expected"));
+	return (TRUE);
+}
+
+// The first string of an MFString field.
+static int parseUrl(Build_T *b, char *url, int size)
+{
+	url[0] = '\0';
+	if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+	if (b->string) {
+		sprintf(url, "%.*s", size - 1, b->token);
+		return (TRUE);
+	}
+	if (!isToken(b, "[")) return (parseError(b, "String expected"));
+	for (;;) {
+		if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+		if (isToken(b, "]")) break;
+		if (b->string && url[0] == '\0') sprintf(url, "%.*s", size - 1, b->token);
+	}
+	return (TRUE);
+}
+
+// ============================================================================
+//	Geometry
+// ============================================================================
+
+static int addTexture(Build_T *b, const char *url, ARUint32 flags)
+{
+	MeshTexture_T *grown;
+	char path[256];
+	int i;
+
+	pathJoin(b->dir, url, path, sizeof(path));
+	for (i = 0; i < b->textureCount; i++) {
+		if (strcmp(b->textures[i].path, path) == 0 && b->textures[i].flags == flags) return (i);
+	}
+	if (b->textureCount == b->textureCap) {
+		b->textureCap = (b->textureCap ? b->textureCap * 2 : 8);
+		if ((grown = (MeshTexture_T *)realloc(b->textures, b->textureCap * sizeof(MeshTexture_T))) == NULL) return (-1);
+		b->textures = grown;
+	}
+	memset(&b->textures[i], 0, sizeof(MeshTexture_T));
+	strcpy(b->textures[i].path, path);
+	b->textures[i].flags = flags;
+	return (b->textureCount++);
+}
+
+// The group for the appearance of a shape, VRML lighting in OpenGL terms.
+static BuildGroup_T *findGroup(Build_T *b, const Shape_T *shape)
+{
+	MeshGroup_T key;
+	BuildGroup_T *grown;
+	float alpha = 1.0f - shape->transparency;
+	int i;
+
+	memset(&key, 0, sizeof(key));
+	key.texture = shape->texture;
+	key.flags = (shape->solid ? MESH_GROUP_SOLID : 0);
+	if (shape->hasMaterial) {
+		key.flags |= MESH_GROUP_LIT;
+		for (i = 0; i < 3; i++) {
+			// An RGB texture replaces the diffuse colour.
+			key.diffuse[i] = (shape->texture >= 0 ? 1.0f : shape->diffuse[i]);
+			key.ambient[i] = key.diffuse[i] * shape->ambientIntensity;
+			key.specular[i] = shape->specular[i];
+			key.emission[i] = shape->emissive[i];
+		}
+		key.ambient[3] = key.diffuse[3] = key.specular[3] = key.emission[3] = alpha;
+		key.shininess = shape->shininess * 128.0f;
+	}
+
+	for (i = 0; i < b->groupCount; i++) {
+		if (memcmp(&b->groups[i].group, &key, sizeof(key)) == 0) return (&b->groups[i]);
+	}
+	if (b->groupCount == b->groupCap) {
+		b->groupCap = (b->groupCap ? b->groupCap * 2 : 8);
+		if ((grown = (BuildGroup_T *)realloc(b->groups, b->groupCap * sizeof(BuildGroup_T))) == NULL) return (NULL);
+		b->groups = grown;
+	}
+	memset(&b->groups[i], 0, sizeof(BuildGroup_T));
+	b->groups[i].group = key;
+	return (&b->groups[b->groupCount++]);
+}
+
+// Corner of a face. pos is the position in coordIndex.
+static int makeVertex(const Shape_T *shape, double m[3][4], const double nm[3][3], int pos, int face, MeshVertex_T *v)
+{
+	const float *p, *n;
+	int ci, ni, ti, i;
+
+	ci = shape->coordIndex.v[pos];
+	if (ci < 0 || ci * 3 + 2 >= shape->coord.n) return (FALSE);
+	p = shape->coord.v + ci * 3;
+	for (i = 0; i < 3; i++) v->position[i] = (float)(m[i][0] * p[0] + m[i][1] * p[1] + m[i][2] * p[2] + m[i][3]);
+
+	v->normal[0] = v->normal[1] = v->normal[2] = 0.0f;
+	if (shape->normal.n > 0) {
+		if (shape->normalPerVertex) ni = (shape->normalIndex.n > pos ? shape->normalIndex.v[pos] : ci);
+		else ni = (shape->normalIndex.n > face ? shape->normalIndex.v[face] : face);
+		if (ni < 0 || ni * 3 + 2 >= shape->normal.n) return (FALSE);
+		n = shape->normal.v + ni * 3;
+		for (i = 0; i < 3; i++) v->normal[i] = (float)(nm[i][0] * n[0] + nm[i][1] * n[1] + nm[i][2] * n[2]);
+		normalize(v->normal);
+	}
+
+	v->texcoord[0] = v->texcoord[1] = 0.0f;
+	if (shape->texCoord.n > 0) {
+		ti = (shape->texCoordIndex.n > pos ? shape->texCoordIndex.v[pos] : ci);
+		if (ti < 0 || ti * 2 + 1 >= shape->texCoord.n) return (FALSE);
+		v->texcoord[0] = shape->texCoord.v[ti * 2];
+		v->texcoord[1] = shape->texCoord.v[ti * 2 + 1];
+	}
+	return (TRUE);
+}
+
+// Triangulate the faces of an IndexedFaceSet as fans, counter-clockwise
+// after the transformation. Faces with bad indices are dropped.
+static int emitShape(Build_T *b, const Shape_T *shape, double m[3][4])
+{
+	BuildGroup_T *group;
+	MeshVertex_T tri[3], swap;
+	double nm[3][3];
+	float e1[3], e2[3];
+	int flip, start, face, pos, i, k;
+
+	if (shape->coord.n == 0 || shape->coordIndex.n == 0) return (TRUE);
+	if ((group = findGroup(b, shape)) == NULL) return (parseError(b, "Out of memory"));
+	flip = (!shape->ccw) != (matrixNormal(m, nm) < 0.0);
+
+	start = face = 0;
+	for (pos = 0; pos <= shape->coordIndex.n; pos++) {
+		if (pos < shape->coordIndex.n && shape->coordIndex.v[pos] >= 0) continue;
+		for (k = 1; k + 1 < pos - start; k++) {
+			if (!makeVertex(shape, m, nm, start, face, &tri[0])
+				|| !makeVertex(shape, m, nm, start + k, face, &tri[1])
+				|| !makeVertex(shape, m, nm, start + k + 1, face, &tri[2])) continue;
+			if (flip) {
+				swap = tri[1];
+				tri[1] = tri[2];
+				tri[2] = swap;
+			}
+			if (shape->normal.n == 0) {
+				for (i = 0; i < 3; i++) {
+					e1[i] = tri[1].position[i] - tri[0].position[i];
+					e2[i] = tri[2].position[i] - tri[0].position[i];
+				}
+				tri[0].normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+				tri[0].normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+				tri[0].normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+				normalize(tri[0].normal);
+				memcpy(tri[1].normal, tri[0].normal, sizeof(tri[0].normal));
+				memcpy(tri[2].normal, tri[0].normal, sizeof(tri[0].normal));
+			}
+			for (i = 0; i < 3; i++) if (!vertexPush(group, &tri[i])) return (parseError(b, "Out of memory"));
+		}
+		start = pos + 1;
+		face++;
+	}
+	return (TRUE);
+}
+
+// ============================================================================
+//	Nodes
+// ============================================================================
+
+static int parseNode(Build_T *b, double m[3][4], Shape_T *shape);
+
+static void shapeInit(Shape_T *shape)
+{
+	memset(shape, 0, sizeof(Shape_T));
+	shape->diffuse[0] = shape->diffuse[1] = shape->diffuse[2] = 0.8f;
+	shape->ambientIntensity = 0.2f;
+	shape->shininess = 0.2f;
+	shape->texture = -1;
+	shape->ccw = shape->solid = shape->normalPerVertex = TRUE;
+}
+
+static void shapeFree(Shape_T *shape)
+{
+	free(shape->coord.v);
+	free(shape->normal.v);
+	free(shape->texCoord.v);
+	free(shape->coordIndex.v);
+	free(shape->normalIndex.v);
+	free(shape->texCoordIndex.v);
+}
+
+// A single node or a list of them.
+static int parseChildren(Build_T *b, double m[3][4])
+{
+	if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+	if (!isToken(b, "[")) {
+		b->pushed = TRUE;
+		return (parseNode(b, m, NULL));
+	}
+	for (;;) {
+		if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+		if (isToken(b, "]")) return (TRUE);
+		b->pushed = TRUE;
+		if (!parseNode(b, m, NULL)) return (FALSE);
+	}
+}
+
+// Transform, Group and the grouping nodes that draw like a Group. The
+// children are parsed last, when the transformation is known.
+static int parseGroup(Build_T *b, double m[3][4], int transform)
+{
+	double world[3][4], translation[3] = { 0.0, 0.0, 0.0 }, center[3] = { 0.0, 0.0, 0.0 };
+	double rotation[4] = { 0.0, 0.0, 1.0, 0.0 }, orientation[4] = { 0.0, 0.0, 1.0, 0.0 }, scale[3] = { 1.0, 1.0, 1.0 };
+	const char *children = NULL, *end;
+	float v[4];
+	int childrenLine = 0, endLine, i;
+
+	for (;;) {
+		if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+		if (isToken(b, "}")) break;
+		if (transform && (isToken(b, "translation") || isToken(b, "center") || isToken(b, "scale"))) {
+			double *dst = (isToken(b, "translation") ? translation : (isToken(b, "center") ? center : scale));
+			if (!parseFloats(b, v, 3)) return (FALSE);
+			for (i = 0; i < 3; i++) dst[i] = v[i];
+		} else if (transform && (isToken(b, "rotation") || isToken(b, "scaleOrientation"))) {
+			double *dst = (isToken(b, "rotation") ? rotation : orientation);
+			if (!parseFloats(b, v, 4)) return (FALSE);
+			for (i = 0; i < 4; i++) dst[i] = v[i];
+		} else if (isToken(b, "children")) {
+			children = b->p;
+			childrenLine = b->line;
+			if (!skipValue(b)) return (FALSE);
+		} else if (!skipValue(b)) {
+			return (FALSE);
+		}
+	}
+	if (children == NULL) return (TRUE);
+
+	// T * C * R * SR * S * -SR * -C
+	memcpy(world, m, sizeof(world));
+	if (transform) {
+		matrixTranslate(world, translation[0] + center[0], translation[1] + center[1], translation[2] + center[2]);
+		matrixRotate(world, rotation, 1.0);
+		matrixRotate(world, orientation, 1.0);
+		matrixScale(world, scale);
+		matrixRotate(world, orientation, -1.0);
+		matrixTranslate(world, -center[0], -center[1], -center[2]);
+	}
+	end = b->p;
+	endLine = b->line;
+	b->p = children;
+	b->line = childrenLine;
+	if (!parseChildren(b, world)) return (FALSE);
+	b->p = end;
+	b->line = endLine;
+	return (TRUE);
+}
+
+static int parseShape(Build_T *b, double m[3][4])
+{
+	Shape_T shape;
+	int ok = TRUE;
+
+	shapeInit(&shape);
+	while (ok) {
+		if (!nextToken(b)) {
+			ok = parseError(b, "Unexpected end of file");
+		} else if (isToken(b, "}")) {
+			break;
+		} else if (isToken(b, "appearance")) {
+			ok = parseNode(b, m, &shape);
+		} else if (isToken(b, "geometry")) {
+			shape.hasGeometry = TRUE;
+			ok = parseNode(b, m, &shape);
+		} else {
+			ok = skipValue(b);
+		}
+	}
+	if (ok && shape.hasGeometry) {
+		ok = (shape.faceSet ? emitShape(b, &shape, m) : parseError(b, "Unsupported geometry"));
+	}
+	shapeFree(&shape);
+	return (ok);
+}
+
+// Fields of the nodes below a Shape.
+static int parseShapeField(Build_T *b, double m[3][4], Shape_T *shape, const char *type)
+{
+	if (strcmp(type, "Appearance") == 0) {
+		if (isToken(b, "material") || isToken(b, "texture")) return (parseNode(b, m, shape));
+	} else if (strcmp(type, "Material") == 0) {
+		if (isToken(b, "diffuseColor")) return (parseFloats(b, shape->diffuse, 3));
+		if (isToken(b, "emissiveColor")) return (parseFloats(b, shape->emissive, 3));
+		if (isToken(b, "specularColor")) return (parseFloats(b, shape->specular, 3));
+		if (isToken(b, "ambientIntensity")) return (parseFloats(b, &shape->ambientIntensity, 1));
+		if (isToken(b, "shininess")) return (parseFloats(b, &shape->shininess, 1));
+		if (isToken(b, "transparency")) return (parseFloats(b, &shape->transparency, 1));
+	} else if (strcmp(type, "ImageTexture") == 0) {
+		if (isToken(b, "url")) return (parseUrl(b, shape->url, sizeof(shape->url)));
+		if (isToken(b, "repeatS")) return (parseBool(b, &shape->repeatS));
+		if (isToken(b, "repeatT")) return (parseBool(b, &shape->repeatT));
+	} else if (strcmp(type, "IndexedFaceSet") == 0) {
+		shape->faceSet = TRUE;
+		if (isToken(b, "coord") || isToken(b, "normal") || isToken(b, "texCoord")) return (parseNode(b, m, shape));
+		if (isToken(b, "coordIndex")) return (parseIntArray(b, &shape->coordIndex));
+		if (isToken(b, "normalIndex")) return (parseIntArray(b, &shape->normalIndex));
+		if (isToken(b, "texCoordIndex")) return (parseIntArray(b, &shape->texCoordIndex));
+		if (isToken(b, "ccw")) return (parseBool(b, &shape->ccw));
+		if (isToken(b, "solid")) return (parseBool(b, &shape->solid));
+		if (isToken(b, "normalPerVertex")) return (parseBool(b, &shape->normalPerVertex));
+	} else if (strcmp(type, "Coordinate") == 0) {
+		if (isToken(b, "point")) return (parseFloatArray(b, &shape->coord, 3));
+	} else if (strcmp(type, "Normal") == 0) {
+		if (isToken(b, "vector")) return (parseFloatArray(b, &shape->normal, 3));
+	} else if (strcmp(type, "TextureCoordinate") == 0) {
+		if (isToken(b, "point")) return (parseFloatArray(b, &shape->texCoord, 2));
+	}
+	return (skipValue(b));
+}
+
+static int parseNode(Build_T *b, double m[3][4], Shape_T *shape)
+{
+	static const char *unsupported[] = {
+		"Box", "Cone", "Cylinder", "Sphere", "ElevationGrid", "Extrusion", "IndexedLineSet",
+		"PointSet", "Text", "Inline", "Billboard", "LOD", "Switch", NULL
+	};
+	char type[64], message[300];
+	ARUint32 flags;
+	int i;
+
+	if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+	if (isToken(b, "NULL")) return (TRUE);
+	if (isToken(b, "USE")) return (parseError(b, "USE is not supported"));
+	if (isToken(b, "DEF") && (!nextToken(b) || !nextToken(b))) return (parseError(b, "Unexpected end of file"));
+	if (isToken(b, "ROUTE") || isToken(b, "PROTO") || isToken(b, "EXTERNPROTO")) {
+		sprintf(message, "%s is not supported", b->token);
+		return (parseError(b, message));
+	}
+	for (i = 0; unsupported[i] != NULL; i++) {
+		if (isToken(b, unsupported[i])) {
+			sprintf(message, "%s nodes are not supported", b->token);
+			return (parseError(b, message));
+		}
+	}
+	sprintf(type, "%.63s", b->token);
+	if (!expectToken(b, "{")) return (FALSE);
+
+	if (strcmp(type, "Transform") == 0) return (parseGroup(b, m, TRUE));
+	if (strcmp(type, "Group") == 0 || strcmp(type, "Anchor") == 0 || strcmp(type, "Collision") == 0) return (parseGroup(b, m, FALSE));
+	if (strcmp(type, "Shape") == 0) return (parseShape(b, m));
+	if (shape == NULL) return (skipBlock(b));
+
+	if (strcmp(type, "Material") == 0) shape->hasMaterial = TRUE;
+	if (strcmp(type, "ImageTexture") == 0) {
+		shape->url[0] = '\0';
+		shape->repeatS = shape->repeatT = TRUE;
+	}
+	for (;;) {
+		if (!nextToken(b)) return (parseError(b, "Unexpected end of file"));
+		if (isToken(b, "}")) break;
+		if (!parseShapeField(b, m, shape, type)) return (FALSE);
+	}
+	if (strcmp(type, "ImageTexture") == 0 && shape->url[0] != '\0') {
+		flags = (shape->repeatS ? MESH_TEXTURE_REPEAT_S : 0) | (shape->repeatT ? MESH_TEXTURE_REPEAT_T : 0);
+		if ((shape->texture = addTexture(b, shape->url, flags)) < 0) return (parseError(b, "Out of memory"));
+	}
+	return (TRUE);
+}
+
+// ============================================================================
+//	Cache blob
+// ============================================================================
+
+static ARUint32 alignUp(ARUint32 offset, ARUint32 align)
+{
+	return ((offset + align - 1) / align * align);
+}
+
+static void decodeTextures(void *arg)
+{
+	Decode_T *decode = (Decode_T *)arg;
+	long i;
+
+	while ((i = atomicAdd(&decode->next, 1) - 1) < decode->count) {
+		decode->pixels[i] = jpegLoad(decode->textures[i].path, &decode->width[i], &decode->height[i]);
+	}
+}
+
+// Decode the textures and lay out the cache file in memory.
+static ARUint8 *buildBlob(Build_T *b, ARUint32 sourceSize, ARUint32 hash)
+{
+	MeshHeader_T header;
+	MeshGroup_T *groups;
+	MeshTexture_T *textures;
+	Decode_T decode;
+	Thread_T *threads[MESH_DECODE_THREADS];
+	ARUint8 **pixels, *blob;
+	ARUint32 size, vertexCount = 0;
+	int *width, *height, threadCount, i;
+
+	pixels = (ARUint8 **)calloc(b->textureCount + 1, sizeof(ARUint8 *));
+	width = (int *)calloc(b->textureCount + 1, sizeof(int));
+	height = (int *)calloc(b->textureCount + 1, sizeof(int));
+	if (pixels == NULL || width == NULL || height == NULL) {
+		free(pixels);
+		free(width);
+		free(height);
+		return (NULL);
+	}
+
+	// One decoding thread per texture up to the processor count, the
+	// calling thread decodes as well.
+	decode.textures = b->textures;
+	decode.count = b->textureCount;
+	decode.next = 0;
+	decode.pixels = pixels;
+	decode.width = width;
+	decode.height = height;
+	threadCount = b->textureCount - 1;
+	if (threadCount > threadCpuCount() - 1) threadCount = threadCpuCount() - 1;
+	if (threadCount > MESH_DECODE_THREADS) threadCount = MESH_DECODE_THREADS;
+	for (i = 0; i < threadCount; i++) threads[i] = threadCreate(decodeTextures, &decode);
+	decodeTextures(&decode);
+	for (i = 0; i < threadCount; i++) if (threads[i] != NULL) threadJoin(threads[i]);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MESH_CACHE_VERSION;
+	header.sourceSize = sourceSize;
+	header.groupCount = b->groupCount;
+	header.groupOffset = alignUp(sizeof(MeshHeader_T), MESH_ALIGN);
+	header.textureCount = b->textureCount;
+	header.textureOffset = alignUp(header.groupOffset + b->groupCount * sizeof(MeshGroup_T), MESH_ALIGN);
+	for (i = 0; i < b->groupCount; i++) vertexCount += b->groups[i].count;
+	header.vertexCount = vertexCount;
+	header.vertexOffset = alignUp(header.textureOffset + b->textureCount * sizeof(MeshTexture_T), MESH_ALIGN);
+	size = alignUp(header.vertexOffset + vertexCount * sizeof(MeshVertex_T), MESH_ALIGN);
+
+	// Textures that fail to decode stay in the table with no pixels and
+	// are drawn untextured.
+	for (i = 0; i < b->textureCount; i++) {
+		hash = fnv1aFile(b->textures[i].path, hash);
+		if (pixels[i] == NULL) continue;
+		b->textures[i].width = width[i];
+		b->textures[i].height = height[i];
+		b->textures[i].offset = size;
+		size = alignUp(size + width[i] * height[i] * 3, MESH_ALIGN);
+	}
+	header.sourceHash = hash;
+	header.size = size;
+
+	if ((blob = (ARUint8 *)calloc(1, size)) != NULL) {
+		memcpy(blob, &header, sizeof(header));
+		groups = (MeshGroup_T *)(blob + header.groupOffset);
+		vertexCount = 0;
+		for (i = 0; i < b->groupCount; i++) {
+			groups[i] = b->groups[i].group;
+			groups[i].first = vertexCount;
+			groups[i].count = b->groups[i].count;
+			memcpy(blob + header.vertexOffset + vertexCount * sizeof(MeshVertex_T), b->groups[i].vertices, b->groups[i].count * sizeof(MeshVertex_T));
+			vertexCount += b->groups[i].count;
+		}
+		textures = (MeshTexture_T *)(blob + header.textureOffset);
+		for (i = 0; i < b->textureCount; i++) {
+			textures[i] = b->textures[i];
+			if (pixels[i] != NULL) memcpy(blob + textures[i].offset, pixels[i], textures[i].width * textures[i].height * 3);
+		}
+	}
+	for (i = 0; i < b->textureCount; i++) free(pixels[i]);
+	free(pixels);
+	free(width);
+	free(height);
+	return (blob);
+}
+
+static ARUint8 *compile(const char *wrlFile, const ARUint8 *source, size_t size, ARUint32 hash)
+{
+	Build_T b;
+	double m[3][4];
+	ARUint8 *blob = NULL;
+	int i;
+
+	memset(&b, 0, sizeof(b));
+	b.file = wrlFile;
+	b.p = (const char *)source;
+	b.end = b.p + size;
+	b.line = 1;
+	pathDir(wrlFile, b.dir, sizeof(b.dir));
+	matrixIdentity(m);
+
+	if (strncmp(b.p, "#VRML V2.0", 10) != 0) {
+		parseError(&b, "Not a VRML97 file");
+	} else {
+		while (nextToken(&b)) {
+			b.pushed = TRUE;
+			if (!parseNode(&b, m, NULL)) break;
+		}
+	}
+	if (!b.error) blob = buildBlob(&b, (ARUint32)size, hash);
+
+	for (i = 0; i < b.groupCount; i++) free(b.groups[i].vertices);
+	free(b.groups);
+	free(b.textures);
+	return (blob);
+}
+
+// Check a mapped cache file against the source and itself.
+static int blobValid(const ARUint8 *blob, size_t size, ARUint32 sourceSize, ARUint32 hash)
+{
+	const MeshHeader_T *header = (const MeshHeader_T *)blob;
+	const MeshGroup_T *groups;
+	const MeshTexture_T *textures;
+	ARUint32 i;
+
+	if (size < sizeof(MeshHeader_T) || memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(header->magic)) != 0) return (FALSE);
+	if (header->version != MESH_CACHE_VERSION || header->size != size || header->sourceSize != sourceSize) return (FALSE);
+	if (header->groupOffset + (double)header->groupCount * sizeof(MeshGroup_T) > size
+		|| header->textureOffset + (double)header->textureCount * sizeof(MeshTexture_T) > size
+		|| header->vertexOffset + (double)header->vertexCount * sizeof(MeshVertex_T) > size) return (FALSE);
+
+	groups = (const MeshGroup_T *)(blob + header->groupOffset);
+	for (i = 0; i < header->groupCount; i++) {
+		if ((double)groups[i].first + groups[i].count > header->vertexCount) return (FALSE);
+		if (groups[i].texture >= (ARInt32)header->textureCount) return (FALSE);
+	}
+	textures = (const MeshTexture_T *)(blob + header->textureOffset);
+	for (i = 0; i < header->textureCount; i++) {
+		if (textures[i].offset + (double)textures[i].width * textures[i].height * 3 > size) return (FALSE);
+		hash = fnv1aFile(textures[i].path, hash);
+	}
+	return (header->sourceHash == hash);
+}
+
+// Replaced in one step like a compiled scene, another instance never maps
+// half a file.
+static void writeCache(const char *path, const ARUint8 *blob)
+{
+	FILE *fp;
+	ARUint32 size = ((const MeshHeader_T *)blob)->size;
+	char *tmpPath;
+	int ok = TRUE;
+
+	if ((tmpPath = (char *)malloc(strlen(path) + 5)) == NULL) {
+		fprintf(stderr, "meshLoad(): Out of memory.\n");
+		return;
+	}
+	sprintf(tmpPath, "%s.tmp", path);
+	if ((fp = fopen(tmpPath, "wb")) == NULL) {
+		fprintf(stderr, "meshLoad(): Unable to write %s, the model is compiled on every start.\n", tmpPath);
+	} else {
+		if (fwrite(blob, 1, size, fp) != size) ok = FALSE;
+		if (fclose(fp) != 0) ok = FALSE;
+		remove(path);
+		if (!ok || rename(tmpPath, path) != 0) {
+			fprintf(stderr, "meshLoad(): Unable to write %s.\n", path);
+			remove(tmpPath);
+		}
+	}
+	free(tmpPath);
+}
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+Mesh_T *meshLoad(const char *datFile, int *cached)
+{
+	FILE *fp;
+	Mesh_T *mesh;
+	ARUint8 *source;
+	char buf[256], name[256], dir[256], wrlFile[256], cacheFile[256 + sizeof(MESH_CACHE_SUFFIX)];
+	size_t size;
+	ARUint32 hash;
+
+	*cached = FALSE;
+	if ((mesh = (Mesh_T *)calloc(1, sizeof(Mesh_T))) == NULL) return (NULL);
+
+	// Same format as arVrmlLoadFile().
+	if ((fp = fopen(datFile, "r")) == NULL) {
+		fprintf(stderr, "meshLoad(): Unable to open %s.\n", datFile);
+		free(mesh);
+		return (NULL);
+	}
+	if (getBuff(buf, sizeof(buf), fp) == NULL || sscanf(buf, "%255s", name) != 1
+		|| getBuff(buf, sizeof(buf), fp) == NULL || sscanf(buf, "%lf %lf %lf", &mesh->translation[0], &mesh->translation[1], &mesh->translation[2]) != 3
+		|| getBuff(buf, sizeof(buf), fp) == NULL || sscanf(buf, "%lf %lf %lf %lf", &mesh->rotation[0], &mesh->rotation[1], &mesh->rotation[2], &mesh->rotation[3]) != 4
+		|| getBuff(buf, sizeof(buf), fp) == NULL || sscanf(buf, "%lf %lf %lf", &mesh->scale[0], &mesh->scale[1], &mesh->scale[2]) != 3) {
+		fprintf(stderr, "meshLoad(): Bad model file %s.\n", datFile);
+		fclose(fp);
+		free(mesh);
+		return (NULL);
+	}
+	fclose(fp);
+
+	pathDir(datFile, dir, sizeof(dir));
+	pathJoin(dir, name, wrlFile, sizeof(wrlFile));
+	sprintf(cacheFile, "%s%s", wrlFile, MESH_CACHE_SUFFIX);
+	if ((source = readFile(wrlFile, &size)) == NULL) {
+		fprintf(stderr, "meshLoad(): Unable to read %s.\n", wrlFile);
+		free(mesh);
+		return (NULL);
+	}
+	hash = fnv1a(source, size, MESH_FNV_BASIS);
+
+	if (mapFileOpen(&mesh->map, cacheFile)) {
+		if (blobValid(mesh->map.data, mesh->map.size, (ARUint32)size, hash)) {
+			free(source);
+			mesh->blob = mesh->map.data;
+			mesh->header = (const MeshHeader_T *)mesh->blob;
+			*cached = TRUE;
+			return (mesh);
+		}
+		mapFileClose(&mesh->map);
+	}
+
+	mesh->memory = compile(wrlFile, source, size, hash);
+	free(source);
+	if (mesh->memory == NULL) {
+		free(mesh);
+		return (NULL);
+	}
+	writeCache(cacheFile, mesh->memory);
+	mesh->blob = mesh->memory;
+	mesh->header = (const MeshHeader_T *)mesh->blob;
+	return (mesh);
+}
+
+void meshFree(Mesh_T *mesh)
+{
+	if (mesh == NULL) return;
+	mapFileClose(&mesh->map);
+	free(mesh->memory);
+	free(mesh);
+}
+
+void meshPlacement(Mesh_T *mesh, double translation[3], double rotation[4], double scale[3])
+{
+	memcpy(translation, mesh->translation, sizeof(mesh->translation));
+	memcpy(rotation, mesh->rotation, sizeof(mesh->rotation));
+	memcpy(scale, mesh->scale, sizeof(mesh->scale));
+}
+
+int meshVertexCount(Mesh_T *mesh)
+{
+	return (mesh->header->vertexCount);
+}
+
+const MeshVertex_T *meshVertices(Mesh_T *mesh)
+{
+	return ((const MeshVertex_T *)(mesh->blob + mesh->header->vertexOffset));
+}
+
+int meshGroupCount(Mesh_T *mesh)
+{
+	return (mesh->header->groupCount);
+}
+
+const MeshGroup_T *meshGroups(Mesh_T *mesh)
+{
+	return ((const MeshGroup_T *)(mesh->blob + mesh->header->groupOffset));
+}
+
+int meshTextureCount(Mesh_T *mesh)
+{
+	return (mesh->header->textureCount);
+}
+
+const MeshTexture_T *meshTextures(Mesh_T *mesh)
+{
+	return ((const MeshTexture_T *)(mesh->blob + mesh->header->textureOffset));
+}
+
+const ARUint8 *meshTexturePixels(Mesh_T *mesh, int texture)
+{
+	const MeshTexture_T *t = meshTextures(mesh) + texture;
+
+	return (t->width == 0 ? NULL : mesh->blob + t->offset);
+}
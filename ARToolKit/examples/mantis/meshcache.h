@@ -0,0 +1,89 @@
+#ifndef __meshcache_h__
+#define __meshcache_h__
+
+// ============================================================================
+//	Compiled VRML mesh cache
+// ============================================================================
+//
+//	Compiles the models of arVrmlLoadFile() .dat files to flat triangle
+//	lists. Every IndexedFaceSet is de-indexed into interleaved position,
+//	normal and texture coordinate vertices, with the Transform nodes baked
+//	in, and the triangles are grouped by texture and material so a model
+//	draws with one call per group. The textures are decoded as well, in
+//	parallel.
+//
+//	The result is written next to the .wrl file as <name>.wrl.mesh and
+//	mapped into memory on the next start, as long as the hash of the .wrl
+//	and its textures still matches. Otherwise the .wrl is parsed again.
+//
+//	Only the subset of VRML97 that the 3D Studio MAX exporter writes for
+//	static meshes is understood: Transform, Group, Shape, Appearance,
+//	Material, ImageTexture and IndexedFaceSet. Other nodes are skipped,
+//	other geometry, USE and PROTO make meshLoad() fail, so the caller can
+//	fall back to arVrmlLoadFile().
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MESH_GROUP_SOLID		0x01	// Back faces may be culled.
+#define MESH_GROUP_LIT			0x02	// Has a Material, otherwise unlit white.
+#define MESH_TEXTURE_REPEAT_S	0x01
+#define MESH_TEXTURE_REPEAT_T	0x02
+
+// Counter-clockwise triangles, 32 bytes.
+typedef struct {
+	float		position[3];
+	float		normal[3];
+	float		texcoord[2];
+} MeshVertex_T;
+
+typedef struct {
+	ARUint32	first;			// First vertex.
+	ARUint32	count;			// Vertex count, three per triangle.
+	ARInt32		texture;		// Index into the textures, -1 for none.
+	ARUint32	flags;			// MESH_GROUP_*.
+	float		ambient[4];		// Material, in glMaterialfv() terms.
+	float		diffuse[4];
+	float		specular[4];
+	float		emission[4];
+	float		shininess;		// 0..128.
+} MeshGroup_T;
+
+typedef struct {
+	char		path[256];		// Source image, part of the cache key.
+	ARUint32	width;
+	ARUint32	height;
+	ARUint32	offset;			// RGB pixels, bottom row first.
+	ARUint32	flags;			// MESH_TEXTURE_*.
+} MeshTexture_T;
+
+typedef struct Mesh_T Mesh_T;
+
+// Load the model of an arVrmlLoadFile() .dat file. cached is set to TRUE
+// when the compiled mesh came from the cache file. Returns NULL when the
+// files cannot be read or the .wrl uses unsupported features.
+// Safe to call from any thread.
+Mesh_T *meshLoad(const char *datFile, int *cached);
+void meshFree(Mesh_T *mesh);
+
+// The transformation of the .dat file: translation, rotation as an angle in
+// degrees and an axis, scale.
+void meshPlacement(Mesh_T *mesh, double translation[3], double rotation[4], double scale[3]);
+
+int meshVertexCount(Mesh_T *mesh);
+const MeshVertex_T *meshVertices(Mesh_T *mesh);
+int meshGroupCount(Mesh_T *mesh);
+const MeshGroup_T *meshGroups(Mesh_T *mesh);
+int meshTextureCount(Mesh_T *mesh);
+const MeshTexture_T *meshTextures(Mesh_T *mesh);
+const ARUint8 *meshTexturePixels(Mesh_T *mesh, int texture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __meshcache_h__
@@ -0,0 +1,725 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  define GL_GLEXT_PROTOTYPES
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/arvrml.h>
+
+#include "meshcache.h"
+#include "hrtimer.h"
+#include "shader.h"
+#include "model.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+// OpenGL 1.5, opengl32.lib only exports 1.1. GL_ARRAY_BUFFER and
+// GL_STATIC_DRAW come with shader.h.
+#ifndef GL_GENERATE_MIPMAP
+#  define GL_GENERATE_MIPMAP	0x8191
+#endif
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+// Materials of a model in the uniform block of the shader renderer, the
+// groups of a model with more are drawn by the fixed function renderer.
+#define MODEL_MATERIALS_MAX		64
+
+#define MODEL_DEG2RAD			(3.14159265358979323846 / 180.0)
+
+#define MODEL_BINDING_TRANSFORM	0		// Uniform block binding points.
+#define MODEL_BINDING_MATERIALS	1
+
+#define MODEL_STRING(x)			#x
+#define MODEL_NUMBER(x)			MODEL_STRING(x)
+
+// ============================================================================
+//	Shaders
+// ============================================================================
+
+// Per vertex lighting by the equations of fixed function GL_LIGHT0 with a
+// non-local viewer, GL_NORMALIZE and GL_MODULATE texturing.
+static const char *gVertexSource =
+	"#version 140\n"
+	"layout(std140) uniform Transform {\n"
+	"	mat4 projection;\n"
+	"	mat4 modelview;\n"
+	"	mat4 normalMatrix;\n"
+	"	vec4 lightPosition;\n"
+	"	vec4 lightDirection;\n"
+	"	vec4 lightHalf;\n"
+	"	vec4 ambient;\n"
+	"	vec4 lightDiffuse;\n"
+	"	vec4 lightSpecular;\n"
+	"};\n"
+	"struct Material {\n"
+	"	vec4 ambient;\n"
+	"	vec4 diffuse;\n"
+	"	vec4 specular;\n"
+	"	vec4 emission;\n"
+	"	vec4 params;\n"					// Shininess, lit.
+	"};\n"
+	"layout(std140) uniform Materials {\n"
+	"	Material materials[" MODEL_NUMBER(MODEL_MATERIALS_MAX) "];\n"
+	"};\n"
+	"in vec3 position;\n"
+	"in vec3 normal;\n"
+	"in vec2 texcoord;\n"
+	"in float material;\n"
+	"out vec4 color;\n"
+	"out vec2 uv;\n"
+	"void main() {\n"
+	"	vec4 eye = modelview * vec4(position, 1.0);\n"
+	"	int i = int(material + 0.5);\n"
+	"	vec3 n = normalize(mat3(normalMatrix) * normal);\n"
+	"	vec3 vp = lightDirection.xyz;\n"
+	"	vec3 h = lightHalf.xyz;\n"
+	"	if (lightPosition.w != 0.0) {\n"
+	"		vp = lightPosition.xyz / lightPosition.w - eye.xyz / eye.w;\n"
+	"		float d = length(vp);\n"
+	"		vp = (d > 0.0 ? vp / d : vp);\n"
+	"		h = normalize(vp + vec3(0.0, 0.0, 1.0));\n"
+	"	}\n"
+	"	float diffuse = max(dot(n, vp), 0.0);\n"
+	"	float specular = (diffuse > 0.0 ? pow(max(dot(n, h), 1e-30), materials[i].params.x) : 0.0);\n"
+	"	vec4 c = materials[i].emission + materials[i].ambient * ambient + diffuse * materials[i].diffuse * lightDiffuse + specular * materials[i].specular * lightSpecular;\n"
+	"	color = mix(vec4(1.0), vec4(clamp(c.rgb, 0.0, 1.0), clamp(materials[i].diffuse.a, 0.0, 1.0)), materials[i].params.y);\n"
+	"	uv = texcoord;\n"
+	"	gl_Position = projection * eye;\n"
+	"}\n";
+
+static const char *gFragmentSource =
+	"#version 140\n"
+	"uniform sampler2D image;\n"
+	"uniform int textured;\n"
+	"in vec4 color;\n"
+	"in vec2 uv;\n"
+	"out vec4 fragColor;\n"
+	"void main() {\n"
+	"	fragColor = (textured != 0 ? color * texture(image, uv) : color);\n"
+	"}\n";
+
+static const char *gAttributes[] = { "position", "normal", "texcoord", "material" };
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef void (APIENTRY *GenBuffers_T)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffers_T)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBuffer_T)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferData_T)(GLenum target, ptrdiff_t size, const GLvoid *data, GLenum usage);
+
+// Uniform blocks of the shader renderer, std140 layout.
+typedef struct {
+	GLfloat			projection[16];
+	GLfloat			modelview[16];
+	GLfloat			normal[16];		// Inverse transpose of the modelview, upper 3x3.
+	GLfloat			lightPosition[4];
+	GLfloat			lightDirection[4];	// Unit vector to a directional light, per vertex for the others.
+	GLfloat			lightHalf[4];		// Its half vector with the viewer at infinity.
+	GLfloat			ambient[4];			// Scene and light ambient together.
+	GLfloat			lightDiffuse[4];
+	GLfloat			lightSpecular[4];
+} ModelTransform_T;
+
+typedef struct {
+	GLfloat			ambient[4];
+	GLfloat			diffuse[4];
+	GLfloat			specular[4];
+	GLfloat			emission[4];
+	GLfloat			params[4];		// Shininess, lit.
+} ModelMaterial_T;
+
+// A mesh vertex with the index of its group's material.
+typedef struct {
+	MeshVertex_T	vertex;
+	GLfloat			material;
+} ModelVertex_T;
+
+// Triangles of one texture and culling mode.
+typedef struct {
+	GLint			first;
+	GLsizei			count;
+	ARInt32			texture;		// -1 for none.
+	int				solid;
+} ModelBatch_T;
+
+struct Model_T {
+	char			datFile[256];
+	Mesh_T			*mesh;			// NULL when drawn by OpenVRML.
+	int				vrmlId;			// -1 until loaded, -2 when OpenVRML failed.
+
+	int				uploaded;
+	GLuint			buffer;			// 0 draws from the mesh in memory.
+	GLuint			*textures;
+
+	int				shaderUploaded;
+	GLuint			shaderBuffer;	// ModelVertex_T in batch order, 0 when the shader renderer cannot draw it.
+	GLuint			materialBuffer;
+	int				batchCount;
+	ModelBatch_T	*batches;
+	double			placement[16];	// The placement of the .dat file.
+};
+
+// ============================================================================
+//	Globals
+// ============================================================================
+
+static int				gBuffersChecked = FALSE;
+static GenBuffers_T		gGenBuffers = NULL;
+static DeleteBuffers_T	gDeleteBuffers = NULL;
+static BindBuffer_T		gBindBuffer = NULL;
+static BufferData_T		gBufferData = NULL;
+
+static int				gMipmapsChecked = FALSE;
+static int				gHardwareMipmaps = FALSE;
+
+static ModelRenderer_T	gRenderer = MODEL_RENDERER_FIXED;
+
+static int				gProgramChecked = FALSE;
+static GLuint			gProgram = 0;
+static GLint			gTexturedLocation = -1;
+static GLuint			gTransformBuffer = 0;
+static ModelTransform_T	gTransform;
+
+static const char		*gRendererNames[MODEL_RENDERER_COUNT] = {
+	"shader",
+	"fixed function",
+	"OpenVRML"
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+// Vertex buffer objects where the driver has them, plain vertex arrays
+// otherwise.
+static int modelBuffersAvailable(void)
+{
+	if (!gBuffersChecked) {
+		gBuffersChecked = TRUE;
+#ifdef _WIN32
+		gGenBuffers = (GenBuffers_T)wglGetProcAddress("glGenBuffers");
+		gDeleteBuffers = (DeleteBuffers_T)wglGetProcAddress("glDeleteBuffers");
+		gBindBuffer = (BindBuffer_T)wglGetProcAddress("glBindBuffer");
+		gBufferData = (BufferData_T)wglGetProcAddress("glBufferData");
+		if (gGenBuffers == NULL) {
+			gGenBuffers = (GenBuffers_T)wglGetProcAddress("glGenBuffersARB");
+			gDeleteBuffers = (DeleteBuffers_T)wglGetProcAddress("glDeleteBuffersARB");
+			gBindBuffer = (BindBuffer_T)wglGetProcAddress("glBindBufferARB");
+			gBufferData = (BufferData_T)wglGetProcAddress("glBufferDataARB");
+		}
+#else
+		gGenBuffers = (GenBuffers_T)glGenBuffers;
+		gDeleteBuffers = (DeleteBuffers_T)glDeleteBuffers;
+		gBindBuffer = (BindBuffer_T)glBindBuffer;
+		gBufferData = (BufferData_T)glBufferData;
+#endif
+		if (gGenBuffers == NULL || gDeleteBuffers == NULL || gBindBuffer == NULL || gBufferData == NULL) {
+			fprintf(stderr, "modelDraw(): No vertex buffer objects, drawing from client memory.\n");
+			gGenBuffers = NULL;
+		}
+	}
+	return (gGenBuffers != NULL);
+}
+
+Model_T *modelLoad(const char *datFile)
+{
+	Model_T *model;
+	double begin = hrtimerNow();
+	int cached;
+
+	if ((model = (Model_T *)calloc(1, sizeof(Model_T))) == NULL) return (NULL);
+	strncpy(model->datFile, datFile, sizeof(model->datFile) - 1);
+	model->vrmlId = -1;
+
+	if ((model->mesh = meshLoad(datFile, &cached)) == NULL) {
+		free(model);
+		return (NULL);
+	}
+	printf("Mesh %s: %d triangles, %d draw groups (%s, %.0f ms).\n", datFile,
+		meshVertexCount(model->mesh) / 3, meshGroupCount(model->mesh), (cached ? "cache" : "compiled"),
+		(hrtimerNow() - begin) * 1000.0);
+	return (model);
+}
+
+Model_T *modelLoadVrml(const char *datFile)
+{
+	Model_T *model;
+
+	if ((model = (Model_T *)calloc(1, sizeof(Model_T))) == NULL) return (NULL);
+	strncpy(model->datFile, datFile, sizeof(model->datFile) - 1);
+	if ((model->vrmlId = arVrmlLoadFile(datFile)) < 0) {
+		free(model);
+		return (NULL);
+	}
+	return (model);
+}
+
+void modelFree(Model_T *model)
+{
+	if (model == NULL) return;
+	if (model->uploaded) {
+		if (model->buffer != 0) gDeleteBuffers(1, &model->buffer);
+		glDeleteTextures(meshTextureCount(model->mesh), model->textures);
+	}
+	if (model->shaderUploaded) {
+		shaderBufferDelete(model->shaderBuffer);
+		shaderBufferDelete(model->materialBuffer);
+	}
+	free(model->batches);
+	free(model->textures);
+	meshFree(model->mesh);
+	free(model);
+}
+
+// OpenGL 1.4 builds the mipmaps of power of two textures on the card,
+// gluBuild2DMipmaps() takes long enough to show as a hitch.
+static int modelMipmaps(int width, int height)
+{
+	const char *version;
+	int major = 1, minor = 0;
+
+	if (!gMipmapsChecked) {
+		gMipmapsChecked = TRUE;
+		if ((version = (const char *)glGetString(GL_VERSION)) != NULL) sscanf(version, "%d.%d", &major, &minor);
+		gHardwareMipmaps = (major > 1 || minor >= 4);
+	}
+	return (gHardwareMipmaps && (width & (width - 1)) == 0 && (height & (height - 1)) == 0);
+}
+
+static void modelUpload(Model_T *model)
+{
+	const MeshTexture_T *textures = meshTextures(model->mesh);
+	const ARUint8 *pixels;
+	int count = meshTextureCount(model->mesh), i;
+
+	model->uploaded = TRUE;
+	if (modelBuffersAvailable() && meshVertexCount(model->mesh) > 0) {
+		gGenBuffers(1, &model->buffer);
+		gBindBuffer(GL_ARRAY_BUFFER, model->buffer);
+		gBufferData(GL_ARRAY_BUFFER, meshVertexCount(model->mesh) * sizeof(MeshVertex_T), meshVertices(model->mesh), GL_STATIC_DRAW);
+		gBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	if (count == 0) return;
+	if ((model->textures = (GLuint *)calloc(count, sizeof(GLuint))) == NULL) return;
+	glGenTextures(count, model->textures);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (i = 0; i < count; i++) {
+		if ((pixels = meshTexturePixels(model->mesh, i)) == NULL) continue;
+		glBindTexture(GL_TEXTURE_2D, model->textures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (textures[i].flags & MESH_TEXTURE_REPEAT_S ? GL_REPEAT : GL_CLAMP));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (textures[i].flags & MESH_TEXTURE_REPEAT_T ? GL_REPEAT : GL_CLAMP));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		if (modelMipmaps(textures[i].width, textures[i].height)) {
+			glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textures[i].width, textures[i].height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		} else {
+			gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGB, textures[i].width, textures[i].height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+static void modelDrawMesh(Model_T *model)
+{
+	const MeshGroup_T *groups = meshGroups(model->mesh);
+	const ARUint8 *base;
+	double translation[3], rotation[4], scale[3];
+	int i;
+
+	if (!model->uploaded) modelUpload(model);
+	meshPlacement(model->mesh, translation, rotation, scale);
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_POLYGON_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+	// The placement of arVrmlDraw(), VRML's y axis up is the marker's z axis.
+	glTranslated(translation[0], translation[1], translation[2]);
+	if (rotation[0] != 0.0) glRotated(rotation[0], rotation[1], rotation[2], rotation[3]);
+	glScaled(scale[0], scale[1], scale[2]);
+	glRotated(90.0, 1.0, 0.0, 0.0);
+
+	glEnable(GL_NORMALIZE);
+	glFrontFace(GL_CCW);
+	glCullFace(GL_BACK);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+	if (model->buffer != 0) {
+		gBindBuffer(GL_ARRAY_BUFFER, model->buffer);
+		base = NULL;
+	} else {
+		base = (const ARUint8 *)meshVertices(model->mesh);
+	}
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex_T), base + offsetof(MeshVertex_T, position));
+	glNormalPointer(GL_FLOAT, sizeof(MeshVertex_T), base + offsetof(MeshVertex_T, normal));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(MeshVertex_T), base + offsetof(MeshVertex_T, texcoord));
+
+	for (i = 0; i < meshGroupCount(model->mesh); i++) {
+		if (groups[i].texture >= 0 && model->textures != NULL && meshTexturePixels(model->mesh, groups[i].texture) != NULL) {
+			glEnable(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, model->textures[groups[i].texture]);
+		} else {
+			glDisable(GL_TEXTURE_2D);
+		}
+		if (groups[i].flags & MESH_GROUP_LIT) {
+			glEnable(GL_LIGHTING);
+			glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, groups[i].ambient);
+			glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, groups[i].diffuse);
+			glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, groups[i].specular);
+			glMaterialfv(GL_FRONT_AND_BACK, GL_EMISSION, groups[i].emission);
+			glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, groups[i].shininess);
+		} else {
+			glDisable(GL_LIGHTING);
+			glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		}
+		if (groups[i].flags & MESH_GROUP_SOLID) glEnable(GL_CULL_FACE);
+		else glDisable(GL_CULL_FACE);
+		glDrawArrays(GL_TRIANGLES, groups[i].first, groups[i].count);
+	}
+
+	if (model->buffer != 0) gBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopClientAttrib();
+	glPopAttrib();
+	glPopMatrix();
+}
+
+// ============================================================================
+//	Shader renderer
+// ============================================================================
+
+// Column major 4x4 matrices, r may be a or b.
+static void modelMatrixMul(const double a[16], const double b[16], double r[16])
+{
+	double t[16];
+	int i, j;
+
+	for (j = 0; j < 4; j++) {
+		for (i = 0; i < 4; i++) {
+			t[j * 4 + i] = a[i] * b[j * 4] + a[4 + i] * b[j * 4 + 1] + a[8 + i] * b[j * 4 + 2] + a[12 + i] * b[j * 4 + 3];
+		}
+	}
+	memcpy(r, t, sizeof(t));
+}
+
+// Rotation by angle degrees around the axis, like glRotated().
+static void modelMatrixRotation(double angle, double x, double y, double z, double m[16])
+{
+	double len = sqrt(x * x + y * y + z * z), c, s, t;
+
+	memset(m, 0, 16 * sizeof(double));
+	m[15] = 1.0;
+	if (len == 0.0) {
+		m[0] = m[5] = m[10] = 1.0;
+		return;
+	}
+	x /= len;
+	y /= len;
+	z /= len;
+	c = cos(angle * MODEL_DEG2RAD);
+	s = sin(angle * MODEL_DEG2RAD);
+	t = 1.0 - c;
+	m[0] = x * x * t + c;		m[4] = x * y * t - z * s;	m[8] = x * z * t + y * s;
+	m[1] = y * x * t + z * s;	m[5] = y * y * t + c;		m[9] = y * z * t - x * s;
+	m[2] = z * x * t - y * s;	m[6] = z * y * t + x * s;	m[10] = z * z * t + c;
+}
+
+// The transformations modelDrawMesh() applies with glTranslated() and
+// friends.
+static void modelPlacement(Model_T *model)
+{
+	double translation[3], rotation[4], scale[3], m[16];
+
+	meshPlacement(model->mesh, translation, rotation, scale);
+	memset(model->placement, 0, sizeof(model->placement));
+	model->placement[0] = model->placement[5] = model->placement[10] = model->placement[15] = 1.0;
+	model->placement[12] = translation[0];
+	model->placement[13] = translation[1];
+	model->placement[14] = translation[2];
+	if (rotation[0] != 0.0) {
+		modelMatrixRotation(rotation[0], rotation[1], rotation[2], rotation[3], m);
+		modelMatrixMul(model->placement, m, model->placement);
+	}
+	memset(m, 0, sizeof(m));
+	m[0] = scale[0];
+	m[5] = scale[1];
+	m[10] = scale[2];
+	m[15] = 1.0;
+	modelMatrixMul(model->placement, m, model->placement);
+	modelMatrixRotation(90.0, 1.0, 0.0, 0.0, m);
+	modelMatrixMul(model->placement, m, model->placement);
+}
+
+static GLuint modelProgram(void)
+{
+	if (!gProgramChecked) {
+		gProgramChecked = TRUE;
+		if (!shaderAvailable()) return (0);
+		if ((gProgram = shaderProgram("model", gVertexSource, gFragmentSource, gAttributes, 4)) == 0) return (0);
+		if (!shaderBindBlock(gProgram, "Transform", MODEL_BINDING_TRANSFORM)
+			|| !shaderBindBlock(gProgram, "Materials", MODEL_BINDING_MATERIALS)) {
+			shaderDeleteProgram(gProgram);
+			gProgram = 0;
+			return (0);
+		}
+		shaderUseProgram(gProgram);
+		shaderSetInt(shaderUniform(gProgram, "image"), 0);
+		shaderUseProgram(0);
+		gTexturedLocation = shaderUniform(gProgram, "textured");
+		gTransformBuffer = shaderBufferCreate(GL_UNIFORM_BUFFER, sizeof(ModelTransform_T), NULL, GL_STREAM_DRAW);
+	}
+	return (gProgram);
+}
+
+// Sort the groups by texture and culling, copy their vertices in that
+// order with the index of their material, and merge neighbours into
+// batches.
+static void modelShaderUpload(Model_T *model)
+{
+	const MeshGroup_T *groups = meshGroups(model->mesh);
+	const MeshVertex_T *vertices = meshVertices(model->mesh);
+	int count = meshGroupCount(model->mesh);
+	ModelMaterial_T materials[MODEL_MATERIALS_MAX];
+	ModelVertex_T *data;
+	ModelBatch_T *batch;
+	int order[MODEL_MATERIALS_MAX], texture[MODEL_MATERIALS_MAX];
+	int i, j, k, n, g, solid;
+
+	model->shaderUploaded = TRUE;
+	if (!model->uploaded) modelUpload(model);
+	modelPlacement(model);
+	if (count > MODEL_MATERIALS_MAX) {
+		fprintf(stderr, "modelDraw(): %s has more than %d materials, drawing it with the fixed function renderer.\n", model->datFile, MODEL_MATERIALS_MAX);
+		return;
+	}
+	if (meshVertexCount(model->mesh) == 0) return;
+
+	for (i = 0; i < count; i++) {
+		texture[i] = groups[i].texture;
+		if (texture[i] < 0 || model->textures == NULL || meshTexturePixels(model->mesh, texture[i]) == NULL) texture[i] = -1;
+		for (j = i; j > 0; j--) {
+			k = order[j - 1];
+			if (texture[k] < texture[i] || (texture[k] == texture[i] && (groups[k].flags & MESH_GROUP_SOLID) <= (groups[i].flags & MESH_GROUP_SOLID))) break;
+			order[j] = k;
+		}
+		order[j] = i;
+	}
+
+	if ((data = (ModelVertex_T *)malloc(meshVertexCount(model->mesh) * sizeof(ModelVertex_T))) == NULL) return;
+	if ((model->batches = (ModelBatch_T *)calloc(count, sizeof(ModelBatch_T))) == NULL) {
+		free(data);
+		return;
+	}
+	memset(materials, 0, sizeof(materials));
+	for (i = 0, n = 0; i < count; i++) {
+		g = order[i];
+		solid = ((groups[g].flags & MESH_GROUP_SOLID) != 0);
+		batch = (model->batchCount > 0 ? &model->batches[model->batchCount - 1] : NULL);
+		if (batch == NULL || batch->texture != texture[g] || batch->solid != solid) {
+			batch = &model->batches[model->batchCount++];
+			batch->first = n;
+			batch->texture = texture[g];
+			batch->solid = solid;
+		}
+		for (j = 0; j < (int)groups[g].count; j++) {
+			data[n + j].vertex = vertices[groups[g].first + j];
+			data[n + j].material = (GLfloat)g;
+		}
+		n += groups[g].count;
+		batch->count = n - batch->first;
+
+		memcpy(materials[g].ambient, groups[g].ambient, sizeof(materials[g].ambient));
+		memcpy(materials[g].diffuse, groups[g].diffuse, sizeof(materials[g].diffuse));
+		memcpy(materials[g].specular, groups[g].specular, sizeof(materials[g].specular));
+		memcpy(materials[g].emission, groups[g].emission, sizeof(materials[g].emission));
+		materials[g].params[0] = groups[g].shininess;
+		materials[g].params[1] = (groups[g].flags & MESH_GROUP_LIT ? 1.0f : 0.0f);
+	}
+
+	model->shaderBuffer = shaderBufferCreate(GL_ARRAY_BUFFER, n * sizeof(ModelVertex_T), data, GL_STATIC_DRAW);
+	model->materialBuffer = shaderBufferCreate(GL_UNIFORM_BUFFER, sizeof(materials), materials, GL_STATIC_DRAW);
+	free(data);
+}
+
+// FALSE when the model has to be drawn by the fixed function renderer.
+static int modelDrawShader(Model_T *model, const double view[16], const double *local)
+{
+	double m[16], c[16], det;
+	int i, j;
+
+	if (modelProgram() == 0) return (FALSE);
+	if (!model->shaderUploaded) modelShaderUpload(model);
+	if (model->shaderBuffer == 0) return (FALSE);
+
+	if (local != NULL) modelMatrixMul(view, local, m);
+	else memcpy(m, view, sizeof(m));
+	modelMatrixMul(m, model->placement, m);
+
+	// The cofactors are the inverse transpose up to the determinant, the
+	// shader normalizes, only the sign has to be kept.
+	memset(c, 0, sizeof(c));
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < 3; i++) {
+			c[j * 4 + i] = m[((j + 1) % 3) * 4 + (i + 1) % 3] * m[((j + 2) % 3) * 4 + (i + 2) % 3]
+						 - m[((j + 1) % 3) * 4 + (i + 2) % 3] * m[((j + 2) % 3) * 4 + (i + 1) % 3];
+		}
+	}
+	det = m[0] * c[0] + m[1] * c[1] + m[2] * c[2];
+	for (i = 0; i < 16; i++) {
+		gTransform.modelview[i] = (GLfloat)m[i];
+		gTransform.normal[i] = (GLfloat)(det < 0.0 ? -c[i] : c[i]);
+	}
+	shaderBufferUpdate(GL_UNIFORM_BUFFER, gTransformBuffer, sizeof(ModelTransform_T), &gTransform);
+
+	shaderUseProgram(gProgram);
+	shaderBufferBindBlock(MODEL_BINDING_TRANSFORM, gTransformBuffer);
+	shaderBufferBindBlock(MODEL_BINDING_MATERIALS, model->materialBuffer);
+	glPushAttrib(GL_ENABLE_BIT | GL_POLYGON_BIT | GL_TEXTURE_BIT);
+	glFrontFace(GL_CCW);
+	glCullFace(GL_BACK);
+
+	shaderBufferBind(GL_ARRAY_BUFFER, model->shaderBuffer);
+	shaderAttrib(0, 3, sizeof(ModelVertex_T), offsetof(ModelVertex_T, vertex) + offsetof(MeshVertex_T, position));
+	shaderAttrib(1, 3, sizeof(ModelVertex_T), offsetof(ModelVertex_T, vertex) + offsetof(MeshVertex_T, normal));
+	shaderAttrib(2, 2, sizeof(ModelVertex_T), offsetof(ModelVertex_T, vertex) + offsetof(MeshVertex_T, texcoord));
+	shaderAttrib(3, 1, sizeof(ModelVertex_T), offsetof(ModelVertex_T, material));
+
+	for (i = 0; i < model->batchCount; i++) {
+		if (model->batches[i].texture >= 0) glBindTexture(GL_TEXTURE_2D, model->textures[model->batches[i].texture]);
+		shaderSetInt(gTexturedLocation, model->batches[i].texture >= 0);
+		if (model->batches[i].solid) glEnable(GL_CULL_FACE);
+		else glDisable(GL_CULL_FACE);
+		glDrawArrays(GL_TRIANGLES, model->batches[i].first, model->batches[i].count);
+	}
+
+	shaderAttribsOff(4);
+	shaderBufferBind(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+	shaderUseProgram(0);
+	return (TRUE);
+}
+
+// ============================================================================
+//	Drawing
+// ============================================================================
+
+void modelBegin(const double projection[16], const ModelLight_T *light)
+{
+	static const GLfloat viewer[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+	float length;
+	int i;
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixd(projection);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	// Models the shader renderer cannot draw fall back to the fixed
+	// function, both get the light.
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glLightfv(GL_LIGHT0, GL_POSITION, light->position);
+	glLightfv(GL_LIGHT0, GL_AMBIENT, light->ambient);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, light->diffuse);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, light->specular);
+	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, light->sceneAmbient);
+
+	for (i = 0; i < 16; i++) gTransform.projection[i] = (GLfloat)projection[i];
+	memcpy(gTransform.lightPosition, light->position, sizeof(gTransform.lightPosition));
+	memcpy(gTransform.lightDiffuse, light->diffuse, sizeof(gTransform.lightDiffuse));
+	memcpy(gTransform.lightSpecular, light->specular, sizeof(gTransform.lightSpecular));
+	for (i = 0; i < 4; i++) gTransform.ambient[i] = light->sceneAmbient[i] + light->ambient[i];
+
+	// The terms that do not change over the vertices of a directional
+	// light, a zero direction lights nothing like in the fixed function.
+	memset(gTransform.lightDirection, 0, sizeof(gTransform.lightDirection));
+	memcpy(gTransform.lightHalf, viewer, sizeof(gTransform.lightHalf));
+	if (light->position[3] == 0.0f) {
+		length = (float)sqrt(light->position[0] * light->position[0] + light->position[1] * light->position[1] + light->position[2] * light->position[2]);
+		if (length > 0.0f) {
+			for (i = 0; i < 3; i++) gTransform.lightDirection[i] = light->position[i] / length;
+			for (i = 0; i < 3; i++) gTransform.lightHalf[i] = gTransform.lightDirection[i] + viewer[i];
+			length = (float)sqrt(gTransform.lightHalf[0] * gTransform.lightHalf[0] + gTransform.lightHalf[1] * gTransform.lightHalf[1] + gTransform.lightHalf[2] * gTransform.lightHalf[2]);
+			if (length > 0.0f) {
+				for (i = 0; i < 3; i++) gTransform.lightHalf[i] /= length;
+			}
+		}
+	}
+}
+
+void modelEnd(void)
+{
+	glDisable(GL_LIGHT0);
+	glDisable(GL_LIGHTING);
+}
+
+void modelDraw(Model_T *model, const double view[16], const double *local)
+{
+	if (model == NULL) return;
+	if (model->mesh != NULL && gRenderer == MODEL_RENDERER_SHADER && modelDrawShader(model, view, local)) return;
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixd(view);
+	if (local != NULL) glMultMatrixd(local);
+	if (model->mesh != NULL && gRenderer != MODEL_RENDERER_VRML) {
+		modelDrawMesh(model);
+		return;
+	}
+	if (model->vrmlId == -1 && (model->vrmlId = arVrmlLoadFile(model->datFile)) < 0) {
+		fprintf(stderr, "modelDraw(): Unable to load %s with OpenVRML.\n", model->datFile);
+		model->vrmlId = -2;
+	}
+	if (model->vrmlId >= 0) arVrmlDraw(model->vrmlId);
+}
+
+const char *modelRendererName(ModelRenderer_T renderer)
+{
+	if (renderer < 0 || renderer >= MODEL_RENDERER_COUNT) return ("");
+	return (gRendererNames[renderer]);
+}
+
+int modelRendererAvailable(ModelRenderer_T renderer)
+{
+	if (renderer == MODEL_RENDERER_SHADER) return (modelProgram() != 0);
+	return (renderer >= 0 && renderer < MODEL_RENDERER_COUNT);
+}
+
+void modelSetRenderer(ModelRenderer_T renderer)
+{
+	if (modelRendererAvailable(renderer)) gRenderer = renderer;
+}
+
+ModelRenderer_T modelRenderer(void)
+{
+	return (gRenderer);
+}
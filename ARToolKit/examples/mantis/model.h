@@ -0,0 +1,80 @@
+#ifndef __model_h__
+#define __model_h__
+
+// ============================================================================
+//	Models drawn from the compiled mesh cache
+// ============================================================================
+//
+//	Loads the models of arVrmlLoadFile() .dat files through meshcache.h and
+//	draws them from vertex buffer objects, one glDrawArrays() per texture
+//	group. The buffers and textures are created on the first draw, which
+//	needs the GL context. Models the mesh cache cannot compile are loaded
+//	with modelLoadVrml() and drawn by OpenVRML as before.
+//
+//	The placement of the .dat file is applied like arVrmlDraw() does.
+//
+//	Three renderers can be switched at run time to compare them. The shader
+//	renderer draws the mesh with a GLSL program (see shader.h): the camera,
+//	model and light go into one uniform block per draw, the materials of a
+//	model into another, and the triangles are sorted by texture so a model
+//	draws with one call per texture. It lights the vertices with the fixed
+//	function equations, so it looks like the fixed function renderer that
+//	draws the same buffers through glMaterial() and the matrix stack. The
+//	third is OpenVRML.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	MODEL_RENDERER_SHADER = 0,		// Mesh cache, GLSL.
+	MODEL_RENDERER_FIXED,			// Mesh cache, fixed function.
+	MODEL_RENDERER_VRML,			// OpenVRML.
+	MODEL_RENDERER_COUNT
+} ModelRenderer_T;
+
+// GL_LIGHT0 and the light model ambient, in glLightfv() terms. The position
+// is in eye coordinates.
+typedef struct {
+	float		position[4];
+	float		ambient[4];
+	float		diffuse[4];
+	float		specular[4];
+	float		sceneAmbient[4];
+} ModelLight_T;
+
+typedef struct Model_T Model_T;
+
+// Load through the mesh cache. Returns NULL when the file cannot be read or
+// compiled. Safe to call from any thread.
+Model_T *modelLoad(const char *datFile);
+
+// Load with arVrmlLoadFile(). Must be called from the GL thread.
+Model_T *modelLoadVrml(const char *datFile);
+void modelFree(Model_T *model);
+
+// Set the projection and the light for the models drawn until modelEnd().
+// Must be called from the GL thread, like the functions below.
+void modelBegin(const double projection[16], const ModelLight_T *light);
+void modelEnd(void);
+
+// Draw at the camera view of a marker, with local placing the model on the
+// marker, NULL for none. Matrices are OpenGL's column major.
+void modelDraw(Model_T *model, const double view[16], const double *local);
+
+const char *modelRendererName(ModelRenderer_T renderer);
+
+// The shader renderer needs OpenGL 3.1.
+int modelRendererAvailable(ModelRenderer_T renderer);
+
+// Draw every model with renderer. Models the mesh cache could not load are
+// always drawn by OpenVRML, loaded on first use.
+void modelSetRenderer(ModelRenderer_T renderer);
+ModelRenderer_T modelRenderer(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __model_h__
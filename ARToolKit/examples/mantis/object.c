@@ -7,84 +7,294 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <AR/ar.h>
-#include <AR/arvrml.h>
 #include "object.h"
+#include "arena.h"
+#include "scene.h"
+#include "model.h"
+#include "thread.h"
+#include "hrtimer.h"
 
-static char *get_buff(char *buf, int n, FILE *fp)
+#define   OBJECT_LOAD_THREADS   4
+#define   OBJECT_DEG2RAD        (3.14159265358979323846 / 180.0)
+
+struct ObjectLoad_T {
+    ObjectSet_T    *objects;
+    int            *modelIndex;         // Per object into models, -1 without a model.
+
+    const char    **models;             // Model files without duplicates.
+    Model_T       **loaded;
+    double         *loadedTime;
+    int             modelCount;
+    volatile long   next;               // Next model for a worker.
+    Thread_T       *threads[OBJECT_LOAD_THREADS];
+    int             threadCount;
+    double          begin;
+};
+
+static void load_models(void *arg)
 {
-    char *ret;
-	
-    for(;;) {
-        ret = fgets(buf, n, fp);
-        if (ret == NULL) return(NULL);
-        if (buf[0] != '\n' && buf[0] != '#') return(ret); // Skip blank lines and comments.
+    ObjectLoad_T  *load = (ObjectLoad_T *)arg;
+    long           i;
+
+    while ((i = atomicAdd(&load->next, 1) - 1) < load->modelCount) {
+        load->loaded[i] = modelLoad(load->models[i]);
+        load->loadedTime[i] = hrtimerNow();
     }
 }
 
-ObjectData_T *read_VRMLdata( char *name, int *objectnum )
+static void free_load( ObjectLoad_T *load )
 {
-    FILE          *fp;
-    ObjectData_T  *object;
-    char           buf[256], buf1[256];
     int            i;
 
-	printf("Opening model file %s\n", name);
+    for (i = 0; i < load->threadCount; i++) threadJoin(load->threads[i]);
+    objectFree(load->objects);
+    free(load->modelIndex);
+    free(load->models);
+    free(load->loaded);
+    free(load->loadedTime);
+    free(load);
+}
 
-    if ((fp=fopen(name, "r")) == NULL) return(0);
+// Set of n objects in one arena, the arrays on their own cache lines.
+static ObjectSet_T *new_set( int n, ObjectConfig_T *config )
+{
+    Arena_T       *arena;
+    ObjectSet_T   *objects;
 
-    get_buff(buf, 256, fp);
-    if (sscanf(buf, "%d", objectnum) != 1) {
-		fclose(fp); return(0);
-	}
+    if ((arena = arenaCreate(sizeof(ObjectSet_T) + n * sizeof(ObjectTrack_T) + (config == NULL ? n * sizeof(ObjectConfig_T) : 0)
+                             + 3 * ARENA_CACHE_LINE)) == NULL) return(0);
+    if ((objects = (ObjectSet_T *)arenaAlloc(arena, sizeof(ObjectSet_T), ARENA_CACHE_LINE)) == NULL
+        || (objects->track = (ObjectTrack_T *)arenaAlloc(arena, n * sizeof(ObjectTrack_T), ARENA_CACHE_LINE)) == NULL
+        || (config == NULL && (config = (ObjectConfig_T *)arenaAlloc(arena, n * sizeof(ObjectConfig_T), ARENA_CACHE_LINE)) == NULL)) {
+        arenaDestroy(arena);
+        return(0);
+    }
+    objects->count = n;
+    objects->config = config;
+    objects->arena = arena;
+    objects->scene = NULL;
+    return( objects );
+}
 
-	printf("About to load %d models.\n", *objectnum);
+ObjectLoad_T *objectLoadBegin( Scene_T *scene, int loadModels )
+{
+    ObjectLoad_T  *load;
+    ObjectConfig_T *object;
+    SceneObject_T *source;
+    int            i, j, n;
 
-    if ((object = (ObjectData_T *)malloc(sizeof(ObjectData_T) * (*objectnum))) == NULL) exit (-1);
+    if (scene == NULL) return(0);
+    if ((load = (ObjectLoad_T *)calloc(1, sizeof(ObjectLoad_T))) == NULL) exit (-1);
+    load->begin = hrtimerNow();
 
-    for (i = 0; i < *objectnum; i++) {
-		
-        get_buff(buf, 256, fp);
-        if (sscanf(buf, "%s %s", buf1, object[i].name) != 2) {
-            fclose(fp); free(object); return(0);
-        }
+    n = scene->objectCount;
+	printf("About to load %d models.\n", n);
+
+    load->objects = new_set(n, NULL);
+    load->modelIndex = (int *)malloc(n * sizeof(int));
+    load->models = (const char **)malloc(n * sizeof(*load->models));
+    load->loaded = (Model_T **)calloc(n, sizeof(Model_T *));
+    load->loadedTime = (double *)calloc(n, sizeof(double));
+    if (load->objects == NULL || load->modelIndex == NULL || load->models == NULL
+        || load->loaded == NULL || load->loadedTime == NULL) exit (-1);
+    load->objects->scene = scene;
+    object = load->objects->config;
+
+    for (i = 0; i < n; i++) {
+        source = &scene->objects[i];
+        object[i].name = source->name;
+        object[i].type = source->type;
+        object[i].patt_name = scene->patterns[source->pattern].path;
+        object[i].marker_width = source->markerWidth;
+        object[i].marker_center[0] = source->markerCenter[0];
+        object[i].marker_center[1] = source->markerCenter[1];
+        memcpy(object[i].anchor, source->anchor, sizeof(object[i].anchor));
 		
-		printf("Model %d: %20s\n", i + 1, &(object[i].name[0]));
+		printf("Model %d: %20s\n", i + 1, object[i].name);
 		
-        if (strcmp(buf1, "VRML") == 0) {
-            object[i].vrml_id = arVrmlLoadFile(object[i].name);
-			printf("VRML id - %d \n", object[i].vrml_id);
-            if (object[i].vrml_id < 0) {
-                fclose(fp); free(object); return(0);
+        // Each model file is loaded once.
+        load->modelIndex[i] = -1;
+        if (loadModels && strcmp(object[i].type, "VRML") == 0) {
+            for (j = 0; j < load->modelCount; j++) {
+                if (strcmp(load->models[j], object[i].name) == 0) break;
             }
-        } else {
-			object[i].vrml_id = -1;
-		}
-		object[i].vrml_id_orig = object[i].vrml_id;
-		object[i].visible = 0;
-
-        get_buff(buf, 256, fp);
-        if (sscanf(buf, "%s", buf1) != 1) {
-			fclose(fp); free(object); return(0);
-		}
-        
-        if ((object[i].id = arLoadPatt(buf1)) < 0) {
-			fclose(fp); free(object); return(0);
-		}
-
-        get_buff(buf, 256, fp);
-        if (sscanf(buf, "%lf", &object[i].marker_width) != 1) {
-			fclose(fp); free(object); return(0);
-		}
-
-        get_buff(buf, 256, fp);
-        if (sscanf(buf, "%lf %lf", &object[i].marker_center[0], &object[i].marker_center[1]) != 2) {
-            fclose(fp); free(object); return(0);
+            if (j == load->modelCount) load->models[load->modelCount++] = object[i].name;
+            load->modelIndex[i] = j;
+        }
+
+        objectAnchorUpdate(&object[i]);
+        load->objects->track[i].id = -1;
+
+    }
+
+    // The workers only read files and build meshes, the caller keeps going.
+    n = load->modelCount;
+    if (n > threadCpuCount()) n = threadCpuCount();
+    if (n > OBJECT_LOAD_THREADS) n = OBJECT_LOAD_THREADS;
+    for (i = 0; i < n; i++) {
+        if ((load->threads[load->threadCount] = threadCreate(load_models, load)) != NULL) load->threadCount++;
+    }
+    if (load->threadCount == 0) load_models(load);
+
+    return( load );
+}
+
+ObjectSet_T *objectLoadEnd( ObjectLoad_T *load, ObjectLoadStats_T *stats )
+{
+    ObjectSet_T   *objects;
+    double         t, last;
+    int            i, ok = 1;
+
+    if (load == NULL) return(0);
+
+    // arLoadPatt() fills ARToolKit's pattern table, so it stays on this
+    // thread, while the workers are still busy.
+    t = hrtimerNow();
+    objects = load->objects;
+    for (i = 0; i < objects->count; i++) {
+        if ((objects->track[i].id = arLoadPatt(objects->config[i].patt_name)) < 0) {
+            fprintf(stderr, "objectLoadEnd(): Unable to load pattern %s.\n", objects->config[i].patt_name);
+            ok = 0;
+            break;
+        }
+    }
+    if (stats != NULL) stats->patternTime = hrtimerNow() - t;
+
+    t = hrtimerNow();
+    for (i = 0; i < load->threadCount; i++) threadJoin(load->threads[i]);
+    load->threadCount = 0;
+    if (stats != NULL) stats->waitTime = hrtimerNow() - t;
+
+    // OpenVRML for the models the mesh cache could not compile.
+    for (i = 0; i < load->modelCount && ok; i++) {
+        if (load->loaded[i] != NULL) continue;
+        if ((load->loaded[i] = modelLoadVrml(load->models[i])) == NULL) ok = 0;
+        load->loadedTime[i] = hrtimerNow();
+    }
+    if (!ok) {
+        for (i = 0; i < load->modelCount; i++) modelFree(load->loaded[i]);
+        free_load(load);
+        return(0);
+    }
+
+    last = load->begin;
+    for (i = 0; i < load->modelCount; i++) {
+        if (load->loadedTime[i] > last) last = load->loadedTime[i];
+    }
+    for (i = 0; i < objects->count; i++) {
+        objects->config[i].model = (load->modelIndex[i] >= 0 ? load->loaded[load->modelIndex[i]] : NULL);
+    }
+    if (stats != NULL) {
+        stats->models = load->modelCount;
+        stats->shared = 0;
+        for (i = 0; i < objects->count; i++) if (load->modelIndex[i] >= 0) stats->shared++;
+        stats->shared -= load->modelCount;
+        stats->modelTime = last - load->begin;
+    }
+
+    load->objects = NULL;
+    free_load(load);
+    return( objects );
+}
+
+ObjectSet_T *read_VRMLdata( char *name )
+{
+    return( objectLoadEnd(objectLoadBegin(sceneOpen(name, NULL), 1), NULL) );
+}
+
+ObjectSet_T *read_PATTdata( char *name )
+{
+    return( objectLoadEnd(objectLoadBegin(sceneOpen(name, NULL), 0), NULL) );
+}
+
+ObjectSet_T *objectCloneTrack( ObjectSet_T *objects )
+{
+    ObjectSet_T   *clone;
+
+    if ((clone = new_set(objects->count, objects->config)) == NULL) {
+        fprintf(stderr, "objectCloneTrack(): Out of memory.\n");
+        return(0);
+    }
+    memcpy(clone->track, objects->track, objects->count * sizeof(ObjectTrack_T));
+    return( clone );
+}
+
+void objectFree( ObjectSet_T *objects )
+{
+    if (objects == NULL) return;
+    sceneClose(objects->scene);
+    arenaDestroy(objects->arena);
+}
+
+// Column major 4x4 product r = a * b, r may be a or b.
+static void mat_mul( double a[16], double b[16], double r[16] )
+{
+    double         t[16];
+    int            i, j;
+
+    for (j = 0; j < 4; j++) {
+        for (i = 0; i < 4; i++) {
+            t[j*4 + i] = a[i] * b[j*4] + a[4 + i] * b[j*4 + 1] + a[8 + i] * b[j*4 + 2] + a[12 + i] * b[j*4 + 3];
         }
-        
     }
+    memcpy(r, t, sizeof(t));
+}
 
-    fclose(fp);
+// Same as glRotated(angle, axis == 0, axis == 1, axis == 2).
+static void mat_rotate( double m[16], int axis, double angle )
+{
+    double         r[16];
+    double         c, s;
+    int            a, b;
+
+    memset(r, 0, sizeof(r));
+    r[0] = r[5] = r[10] = r[15] = 1.0;
+    c = cos(angle * OBJECT_DEG2RAD);
+    s = sin(angle * OBJECT_DEG2RAD);
+    a = (axis + 1) % 3;
+    b = (axis + 2) % 3;
+    r[a*4 + a] = c;
+    r[a*4 + b] = s;
+    r[b*4 + a] = -s;
+    r[b*4 + b] = c;
+    mat_mul(m, r, m);
+}
 
-    return( object );
+void objectAnchorUpdate( ObjectConfig_T *config )
+{
+    double        *m = config->anchor_matrix;
+
+    memset(m, 0, 16 * sizeof(double));
+    m[0] = m[5] = m[10] = m[15] = 1.0;
+    m[12] = config->anchor[0];
+    m[13] = config->anchor[1];
+    m[14] = config->anchor[2];
+    mat_rotate(m, 0, config->anchor[3]);
+    mat_rotate(m, 1, config->anchor[4]);
+    mat_rotate(m, 2, config->anchor[5]);
+}
+
+int objectSave( char *name, ObjectSet_T *objects )
+{
+    FILE          *fp;
+    ObjectConfig_T *object = objects->config;
+    int            i, ok;
+
+    if ((fp = fopen(name, "w")) == NULL) {
+        fprintf(stderr, "objectSave(): Unable to open %s.\n", name);
+        return(0);
+    }
+    fprintf(fp, "#the number of patterns to be recognized, top is the most important\n%d\n", objects->count);
+    for (i = 0; i < objects->count; i++) {
+        fprintf(fp, "\n#pattern\n%s\t%s\n%s\n%.1f\n%.1f %.1f\n", object[i].type, object[i].name, object[i].patt_name,
+                object[i].marker_width, object[i].marker_center[0], object[i].marker_center[1]);
+        fprintf(fp, "ANCHOR\t%.1f %.1f %.1f\t%.1f %.1f %.1f\n", object[i].anchor[0], object[i].anchor[1], object[i].anchor[2],
+                object[i].anchor[3], object[i].anchor[4], object[i].anchor[5]);
+    }
+    ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "objectSave(): Unable to write %s.\n", name);
+    return(ok);
 }
@@ -8,19 +8,81 @@
 extern "C" {
 #endif	
 
+// Per-frame tracking state of an object. The matching and pose loops run
+// over the track array at camera rate on every camera, so it holds only
+// what they touch and the whole array stays within a few cache lines.
 typedef struct {
-    char       name[256];
-    int        id;
+    int        id;                  // Pattern id from arLoadPatt().
     int        visible;
-    double     marker_coord[4][2];
     double     trans[3][4];
-	int        vrml_id;
-	int        vrml_id_orig;
+} ObjectTrack_T;
+
+// Object file contents, used when loading, drawing and tuning.
+typedef struct {
+    const char *name;               // Model file. Strings are the scene's, see scene.h.
+    const char *type;               // Model type, VRML.
+    const char *patt_name;
+	struct Model_T *model;		// See model.h, NULL when not loaded.
     double     marker_width;
     double     marker_center[2];
-} ObjectData_T;
+    double     anchor[6];           // Model placement on the marker: translation X Y Z, then rotation around X Y Z in degrees.
+    double     anchor_matrix[16];   // anchor as an OpenGL matrix, for glMultMatrixd().
+} ObjectConfig_T;
+
+// All objects of an object file, track[i] and config[i] belong to the
+// same object. Everything is allocated from the set's arena.
+typedef struct {
+    int              count;
+    ObjectTrack_T   *track;
+    ObjectConfig_T  *config;
+    struct Arena_T  *arena;         // See arena.h.
+    struct Scene_T  *scene;         // Object file the set was loaded from, NULL for clones.
+} ObjectSet_T;
+
+// Models shared by several objects are loaded once, the objects point to
+// the same Model_T. name is an object file or a compiled scene.
+ObjectSet_T   *read_VRMLdata (char *name);
+
+// Same as read_VRMLdata() but loads only the patterns, models are left
+// unloaded (model NULL). For headless tools without a GL context.
+ObjectSet_T   *read_PATTdata (char *name);
+
+// Tracking state of its own for another camera, sharing the config with
+// objects, which must outlive it.
+ObjectSet_T   *objectCloneTrack (ObjectSet_T *objects);
+
+// Releases the set, its arena and its scene. Models stay loaded, they may
+// be shared.
+void           objectFree (ObjectSet_T *objects);
+
+// The object file may place the model relative to each pattern with a line
+//     ANCHOR  tx ty tz  rx ry rz
+// after the marker center, translation in model units, the rotations are
+// applied after it around X, Y and Z in degrees. Without it the model sits
+// on the marker. objectAnchorUpdate() recomputes anchor_matrix after anchor
+// changes, objectSave() writes the objects back with their anchors.
+void           objectAnchorUpdate (ObjectConfig_T *config);
+int            objectSave (char *name, ObjectSet_T *objects);
+
+// Loading in two steps, so the model files load on worker threads while
+// the caller sets up the camera and the window. objectLoadBegin() takes
+// the scene from sceneOpen(), closed with the set, and starts the
+// workers. objectLoadEnd() loads the patterns on the calling thread, waits
+// for the models and releases the ObjectLoad_T. Models the mesh cache
+// cannot compile are loaded with OpenVRML at that point, so with models
+// it must be the GL thread.
+typedef struct ObjectLoad_T ObjectLoad_T;
+
+typedef struct {
+    int        models;          // Model files, each loaded once.
+    int        shared;          // Objects using the model of an earlier object.
+    double     patternTime;     // Seconds in arLoadPatt().
+    double     modelTime;       // Seconds from objectLoadBegin() to the last model.
+    double     waitTime;        // Seconds objectLoadEnd() waited for the models.
+} ObjectLoadStats_T;
 
-ObjectData_T  *read_VRMLdata (char *name, int *objectnum);
+ObjectLoad_T  *objectLoadBegin (struct Scene_T *scene, int loadModels);
+ObjectSet_T   *objectLoadEnd (ObjectLoad_T *load, ObjectLoadStats_T *stats);
 
 #ifdef __cplusplus
 }
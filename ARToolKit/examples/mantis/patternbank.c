@@ -0,0 +1,432 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "patternbank.h"
+#include "frontend.h"
+#include "arena.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#  define PATTERNBANK_HAVE_SSE2
+#  include <emmintrin.h>
+#  if (defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#    define PATTERNBANK_HAVE_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+// GCC and clang only emit AVX2 code in functions marked for it.
+#if defined(PATTERNBANK_HAVE_AVX2) && defined(__GNUC__)
+#  define TARGET_AVX2		__attribute__((target("avx2")))
+#else
+#  define TARGET_AVX2
+#endif
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define PATTERNBANK_PIXELS		(AR_PATT_SIZE_Y * AR_PATT_SIZE_X)
+#define PATTERNBANK_ROWS_MAX	(4 * PATTERNBANK_PATTERNS_MAX)
+#define PATTERNBANK_BLOCKS		4			// Rows are scored a block at a time, with a bound after each.
+#define PATTERNBANK_ALIGN		32
+#define PATTERNBANK_SLACK		1e-9		// Rounding allowance of the bound.
+#define PATTERNBANK_EVEC		10			// Main components of the PCA mode, EVEC_MAX of ARToolKit.
+#define PATTERNBANK_EVEC_LOOPS	100			// Power iterations per component.
+#define PATTERNBANK_PCA_CHECK	4			// Nearest rows scored in full in the PCA mode.
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef int (*Dot_T)(const ARInt16 *a, const ARInt16 *b, int n);
+
+// The color or the gray templates.
+typedef struct {
+	int			length;			// Values per row, 3 or 1 per pixel.
+	int			block;			// Values per block.
+	ARInt16		*values;		// [block][row][value], a block of all rows in one piece.
+	double		*pow;			// [row] norm as arLoadPatt() computes it.
+	double		*rest;			// [block][row] norm of the row after the block.
+	int			evecCount;		// Main components, 0 when the bank is too small for PCA.
+	double		*evec;			// [evec][value]
+	double		*proj;			// [row][evec] the normalized row in the components.
+} PatternSet_T;
+
+struct PatternBank_T {
+	Arena_T		*arena;
+	int			count;
+	int			rows;			// Pattern * 4 + direction.
+	int			*ids;			// Rising, the order arGetCode() tries the patterns in.
+	PatternSet_T color;
+	PatternSet_T bw;
+	Dot_T		dot;
+};
+
+// ============================================================================
+//	Dot products of 16 bit values, n a multiple of 16
+// ============================================================================
+
+static int dotScalar(const ARInt16 *a, const ARInt16 *b, int n)
+{
+	int i, sum = 0;
+
+	for (i = 0; i < n; i++) sum += a[i] * b[i];
+	return (sum);
+}
+
+#ifdef PATTERNBANK_HAVE_SSE2
+static int dotSSE2(const ARInt16 *a, const ARInt16 *b, int n)
+{
+	__m128i sum0 = _mm_setzero_si128(), sum1 = _mm_setzero_si128();
+	int i, s[4];
+
+	for (i = 0; i < n; i += 16) {
+		sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_load_si128((const __m128i *)(a + i)), _mm_load_si128((const __m128i *)(b + i))));
+		sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_load_si128((const __m128i *)(a + i + 8)), _mm_load_si128((const __m128i *)(b + i + 8))));
+	}
+	_mm_storeu_si128((__m128i *)s, _mm_add_epi32(sum0, sum1));
+	return (s[0] + s[1] + s[2] + s[3]);
+}
+#endif
+
+#ifdef PATTERNBANK_HAVE_AVX2
+TARGET_AVX2 static int dotAVX2(const ARInt16 *a, const ARInt16 *b, int n)
+{
+	__m256i sum = _mm256_setzero_si256();
+	__m128i half;
+	int i, s[4];
+
+	for (i = 0; i < n; i += 16) {
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_load_si256((const __m256i *)(a + i)), _mm256_load_si256((const __m256i *)(b + i))));
+	}
+	half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	_mm_storeu_si128((__m128i *)s, half);
+	return (s[0] + s[1] + s[2] + s[3]);
+}
+#endif
+
+// ============================================================================
+//	Building
+// ============================================================================
+
+static int setInit(PatternBank_T *bank, PatternSet_T *set, int length)
+{
+	set->length = length;
+	set->block = length / PATTERNBANK_BLOCKS;
+	set->values = (ARInt16 *)arenaAlloc(bank->arena, bank->rows * length * sizeof(ARInt16), PATTERNBANK_ALIGN);
+	set->pow = (double *)arenaAlloc(bank->arena, bank->rows * sizeof(double), PATTERNBANK_ALIGN);
+	set->rest = (double *)arenaAlloc(bank->arena, PATTERNBANK_BLOCKS * bank->rows * sizeof(double), PATTERNBANK_ALIGN);
+	return (set->values != NULL && set->pow != NULL && set->rest != NULL);
+}
+
+// A row from its template values, arLoadPatt() computes pat and patBW the
+// same way.
+static void setRow(PatternBank_T *bank, PatternSet_T *set, int row, const int *t)
+{
+	double m;
+	int b, i;
+
+	for (i = 0; i < set->length; i++) {
+		set->values[(i / set->block * bank->rows + row) * set->block + i % set->block] = (ARInt16)t[i];
+	}
+	m = 0.0;
+	for (b = PATTERNBANK_BLOCKS - 1; b >= 0; b--) {
+		set->rest[b * bank->rows + row] = sqrt(m);
+		for (i = b * set->block; i < (b + 1) * set->block; i++) m += (double)(t[i] * t[i]);
+	}
+	set->pow[row] = sqrt(m);
+	if (set->pow[row] == 0.0) set->pow[row] = 0.0000001;
+}
+
+static void addPattern(PatternBank_T *bank, int pattern, const ARUint8 *data)
+{
+	int color[PATTERNBANK_PIXELS * 3], gray[PATTERNBANK_PIXELS];
+	int h, c, i, l;
+
+	// The file holds 4 rotations of 3 color planes of rows.
+	for (h = 0; h < 4; h++) {
+		l = 0;
+		for (c = 0; c < 3; c++) {
+			for (i = 0; i < PATTERNBANK_PIXELS; i++) {
+				color[i * 3 + c] = 255 - data[(h * 3 + c) * PATTERNBANK_PIXELS + i];
+				l += color[i * 3 + c];
+			}
+		}
+		l /= PATTERNBANK_PIXELS * 3;
+		for (i = 0; i < PATTERNBANK_PIXELS; i++) {
+			gray[i] = (color[i * 3] + color[i * 3 + 1] + color[i * 3 + 2]) / 3 - l;
+		}
+		for (i = 0; i < PATTERNBANK_PIXELS * 3; i++) color[i] -= l;
+		setRow(bank, &bank->color, pattern * 4 + h, color);
+		setRow(bank, &bank->bw, pattern * 4 + h, gray);
+	}
+}
+
+// Value i of a row as a double divided by its norm.
+static double unitValue(const PatternBank_T *bank, const PatternSet_T *set, int row, int i)
+{
+	return (set->values[(i / set->block * bank->rows + row) * set->block + i % set->block] / set->pow[row]);
+}
+
+// Main components of the normalized rows, from the eigenvectors of their
+// Gram matrix by power iteration.
+static int setPca(PatternBank_T *bank, PatternSet_T *set)
+{
+	int rows = bank->rows, length = set->length;
+	double *unit, *gram, *u, *w, norm, lambda, v;
+	int i, j, k, r, loop;
+
+	set->evecCount = 0;
+	if (rows <= PATTERNBANK_EVEC) return (TRUE);		// Scoring every row is as cheap.
+	set->evec = (double *)arenaAlloc(bank->arena, PATTERNBANK_EVEC * length * sizeof(double), PATTERNBANK_ALIGN);
+	set->proj = (double *)arenaAlloc(bank->arena, rows * PATTERNBANK_EVEC * sizeof(double), PATTERNBANK_ALIGN);
+	unit = (double *)malloc(rows * length * sizeof(double));
+	gram = (double *)malloc(rows * rows * sizeof(double));
+	u = (double *)malloc(PATTERNBANK_EVEC * rows * sizeof(double));
+	w = (double *)malloc(rows * sizeof(double));
+	if (set->evec == NULL || set->proj == NULL || unit == NULL || gram == NULL || u == NULL || w == NULL) {
+		free(unit);
+		free(gram);
+		free(u);
+		free(w);
+		return (FALSE);
+	}
+
+	for (r = 0; r < rows; r++) {
+		for (i = 0; i < length; i++) unit[r * length + i] = unitValue(bank, set, r, i);
+	}
+	for (r = 0; r < rows; r++) {
+		for (j = 0; j <= r; j++) {
+			v = 0.0;
+			for (i = 0; i < length; i++) v += unit[r * length + i] * unit[j * length + i];
+			gram[r * rows + j] = gram[j * rows + r] = v;
+		}
+	}
+
+	for (k = 0; k < PATTERNBANK_EVEC; k++) {
+		for (r = 0; r < rows; r++) u[k * rows + r] = 1.0 + (double)((r * 7 + k) % 11) / 11.0;
+		lambda = 0.0;
+		for (loop = 0; loop < PATTERNBANK_EVEC_LOOPS; loop++) {
+			for (r = 0; r < rows; r++) {
+				v = 0.0;
+				for (j = 0; j < rows; j++) v += gram[r * rows + j] * u[k * rows + j];
+				w[r] = v;
+			}
+			// Orthogonal to the components found so far.
+			for (j = 0; j < k; j++) {
+				v = 0.0;
+				for (r = 0; r < rows; r++) v += w[r] * u[j * rows + r];
+				for (r = 0; r < rows; r++) w[r] -= v * u[j * rows + r];
+			}
+			norm = 0.0;
+			for (r = 0; r < rows; r++) norm += w[r] * w[r];
+			norm = sqrt(norm);
+			if (norm < 1e-12) break;
+			for (r = 0; r < rows; r++) u[k * rows + r] = w[r] / norm;
+			lambda = norm;
+		}
+		if (lambda < 1e-12) break;		// The rows span fewer dimensions.
+
+		for (i = 0; i < length; i++) {
+			v = 0.0;
+			for (r = 0; r < rows; r++) v += u[k * rows + r] * unit[r * length + i];
+			set->evec[k * length + i] = v / sqrt(lambda);
+		}
+		for (r = 0; r < rows; r++) {
+			v = 0.0;
+			for (i = 0; i < length; i++) v += set->evec[k * length + i] * unit[r * length + i];
+			set->proj[r * PATTERNBANK_EVEC + k] = v;
+		}
+		set->evecCount = k + 1;
+	}
+
+	free(unit);
+	free(gram);
+	free(u);
+	free(w);
+	return (TRUE);
+}
+
+PatternBank_T *patternBankCreate(int count, const int *ids, const ARUint8 * const *data)
+{
+	PatternBank_T *bank;
+	Arena_T *arena;
+	int order[PATTERNBANK_PATTERNS_MAX], i, j, n, t;
+
+	// By rising id without duplicates.
+	for (i = n = 0; i < count; i++) {
+		for (j = 0; j < n && ids[order[j]] != ids[i]; j++);
+		if (j < n) continue;
+		if (n == PATTERNBANK_PATTERNS_MAX || data[i] == NULL) {
+			fprintf(stderr, "patternBankCreate(): %s.\n", (data[i] == NULL ? "Pattern values missing" : "Too many patterns"));
+			return (NULL);
+		}
+		for (j = n++; j > 0 && ids[order[j - 1]] > ids[i]; j--) order[j] = order[j - 1];
+		order[j] = i;
+	}
+	if (n == 0) return (NULL);
+
+	if ((arena = arenaCreate(0)) == NULL) return (NULL);
+	if ((bank = (PatternBank_T *)arenaAlloc(arena, sizeof(PatternBank_T), PATTERNBANK_ALIGN)) == NULL) {
+		arenaDestroy(arena);
+		return (NULL);
+	}
+	bank->arena = arena;
+	bank->count = n;
+	bank->rows = 4 * n;
+	bank->ids = (int *)arenaAlloc(arena, n * sizeof(int), PATTERNBANK_ALIGN);
+	if (bank->ids == NULL || !setInit(bank, &bank->color, PATTERNBANK_PIXELS * 3) || !setInit(bank, &bank->bw, PATTERNBANK_PIXELS)) {
+		fprintf(stderr, "patternBankCreate(): Out of memory.\n");
+		patternBankDestroy(bank);
+		return (NULL);
+	}
+	for (t = 0; t < n; t++) {
+		bank->ids[t] = ids[order[t]];
+		addPattern(bank, t, data[order[t]]);
+	}
+	if (!setPca(bank, &bank->color) || !setPca(bank, &bank->bw)) {
+		fprintf(stderr, "patternBankCreate(): Out of memory.\n");
+		patternBankDestroy(bank);
+		return (NULL);
+	}
+
+	bank->dot = dotScalar;
+#ifdef PATTERNBANK_HAVE_SSE2
+	if (frontendModeAvailable(FRONTEND_SSE2)) bank->dot = dotSSE2;
+#endif
+#ifdef PATTERNBANK_HAVE_AVX2
+	if (frontendModeAvailable(FRONTEND_AVX2)) bank->dot = dotAVX2;
+#endif
+	return (bank);
+}
+
+void patternBankDestroy(PatternBank_T *bank)
+{
+	if (bank != NULL) arenaDestroy(bank->arena);
+}
+
+int patternBankCount(const PatternBank_T *bank)
+{
+	return (bank != NULL ? bank->count : 0);
+}
+
+// ============================================================================
+//	Matching
+// ============================================================================
+
+// Score of a row, NULL rest for the whole row. With rest the first block
+// is in sum already and the row is left as soon as it cannot beat best,
+// returning -2.
+static double scoreRow(const PatternBank_T *bank, const PatternSet_T *set, int row, const ARInt16 *input, double datapow,
+					   const double *rest, int sum, double best)
+{
+	int b;
+
+	for (b = (rest != NULL ? 1 : 0); b < PATTERNBANK_BLOCKS; b++) {
+		if (rest != NULL && (sum + rest[b - 1] * set->rest[(b - 1) * bank->rows + row]) / set->pow[row] / datapow < best - PATTERNBANK_SLACK) return (-2.0);
+		sum += bank->dot(set->values + (b * bank->rows + row) * set->block, input + b * set->block, set->block);
+	}
+	return (sum / set->pow[row] / datapow);
+}
+
+// arGetCode() keeps the first row with the highest score.
+static void keepBest(double score, int row, double *best, int *bestRow)
+{
+	if (score > *best || (score == *best && row < *bestRow)) {
+		*best = score;
+		*bestRow = row;
+	}
+}
+
+void patternBankMatch(const PatternBank_T *bank, ARUint8 pattern[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3], int *id, int *dir, double *cf)
+{
+	const ARUint8 *data = &pattern[0][0][0];
+	const PatternSet_T *set = (arTemplateMatchingMode == AR_TEMPLATE_MATCHING_COLOR ? &bank->color : &bank->bw);
+	ARInt16 input[PATTERNBANK_PIXELS * 3 + PATTERNBANK_ALIGN / sizeof(ARInt16)], *in;
+	int partial[PATTERNBANK_ROWS_MAX], nearest[PATTERNBANK_PCA_CHECK];
+	double rest[PATTERNBANK_BLOCKS], invec[PATTERNBANK_EVEC], dist[PATTERNBANK_PCA_CHECK];
+	double datapow, best = 0.0, bound, first, d, v;
+	int ave = 0, sum = 0, bestRow = -1, firstRow = 0, i, b, k, r, n;
+
+	in = (ARInt16 *)(((size_t)input + PATTERNBANK_ALIGN - 1) & ~(size_t)(PATTERNBANK_ALIGN - 1));
+
+	// The input as pattern_match() of ARToolKit prepares it.
+	for (i = 0; i < PATTERNBANK_PIXELS * 3; i++) ave += 255 - data[i];
+	ave /= PATTERNBANK_PIXELS * 3;
+	if (set == &bank->color) {
+		for (i = 0; i < PATTERNBANK_PIXELS * 3; i++) in[i] = (ARInt16)((255 - data[i]) - ave);
+	} else {
+		for (i = 0; i < PATTERNBANK_PIXELS; i++) in[i] = (ARInt16)(((255 - data[i * 3]) + (255 - data[i * 3 + 1]) + (255 - data[i * 3 + 2])) / 3 - ave);
+	}
+	for (b = PATTERNBANK_BLOCKS - 1; b >= 0; b--) {
+		rest[b] = sqrt((double)sum);
+		for (i = b * set->block; i < (b + 1) * set->block; i++) sum += in[i] * in[i];
+	}
+	datapow = sqrt((double)sum);
+	if (datapow == 0.0) {
+		*id = 0;
+		*dir = 0;
+		*cf = -1.0;
+		return;
+	}
+
+	if (arMatchingPCAMode == AR_MATCHING_WITH_PCA && set->evecCount > 0) {
+		// The nearest rows in the main components, scored in full.
+		for (k = 0; k < set->evecCount; k++) {
+			v = 0.0;
+			for (i = 0; i < set->length; i++) v += set->evec[k * set->length + i] * in[i];
+			invec[k] = v / datapow;
+		}
+		for (r = n = 0; r < bank->rows; r++) {
+			d = 0.0;
+			for (k = 0; k < set->evecCount; k++) {
+				v = invec[k] - set->proj[r * PATTERNBANK_EVEC + k];
+				d += v * v;
+			}
+			if (n == PATTERNBANK_PCA_CHECK && d >= dist[n - 1]) continue;
+			if (n < PATTERNBANK_PCA_CHECK) n++;
+			for (i = n - 1; i > 0 && dist[i - 1] > d; i--) {
+				dist[i] = dist[i - 1];
+				nearest[i] = nearest[i - 1];
+			}
+			dist[i] = d;
+			nearest[i] = r;
+		}
+		for (i = 0; i < n; i++) keepBest(scoreRow(bank, set, nearest[i], in, datapow, NULL, 0, 0.0), nearest[i], &best, &bestRow);
+	} else {
+		// The first block of all rows in one pass. The row with the best
+		// bound is scored first, so most rows stop after a block or two.
+		first = -2.0;
+		for (r = 0; r < bank->rows; r++) {
+			partial[r] = bank->dot(set->values + r * set->block, in, set->block);
+			bound = (partial[r] + rest[0] * set->rest[r]) / set->pow[r];
+			if (bound > first) {
+				first = bound;
+				firstRow = r;
+			}
+		}
+		keepBest(scoreRow(bank, set, firstRow, in, datapow, rest, partial[firstRow], -1.0), firstRow, &best, &bestRow);
+		for (r = 0; r < bank->rows; r++) {
+			if (r != firstRow) keepBest(scoreRow(bank, set, r, in, datapow, rest, partial[r], best), r, &best, &bestRow);
+		}
+	}
+
+	if (bestRow < 0) {
+		*id = -1;
+		*dir = -1;
+		*cf = 0.0;
+		return;
+	}
+	*id = bank->ids[bestRow / 4];
+	*dir = bestRow % 4;
+	*cf = best;
+}
@@ -0,0 +1,56 @@
+#ifndef __patternbank_h__
+#define __patternbank_h__
+
+// ============================================================================
+//	Matching a square against all pattern templates at once
+// ============================================================================
+//
+//	Replaces the template matching of arGetMarkerInfo(). The templates of
+//	all patterns in all four rotations are packed into one aligned matrix
+//	of zero mean 16 bit values, a row per rotation, with the norm of every
+//	row precomputed. A square is scored against the whole bank with SSE2
+//	or AVX2 multiply-adds, a block of the rows at a time, and a row is
+//	dropped as soon as the rest of it can no longer beat the best score so
+//	far. The sums are the integers arGetCode() computes, so the id, the
+//	direction and the confidence are the ones ARToolKit finds.
+//
+//	arTemplateMatchingMode selects the color or the gray templates. With
+//	arMatchingPCAMode the square is compared with the rows in the space of
+//	the main components of the bank and only the nearest rows are scored in
+//	full; like ARToolKit's PCA matching it may pick another pattern for poor
+//	matches.
+//
+//	A bank does not change after it is created, the pipelines of several
+//	cameras share one.
+//
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Patterns per bank, more than the AR_PATT_NUM_MAX of a stock ARToolKit.
+#define PATTERNBANK_PATTERNS_MAX	256
+
+typedef struct PatternBank_T PatternBank_T;
+
+// Bank of count patterns, ids[i] is the id arLoadPatt() returned for a
+// pattern and data[i] the values of its file, see SCENE_PATTERN_SIZE in
+// scene.h. A pattern whose id is in the bank already is skipped.
+PatternBank_T *patternBankCreate(int count, const int *ids, const ARUint8 * const *data);
+void patternBankDestroy(PatternBank_T *bank);
+
+int patternBankCount(const PatternBank_T *bank);
+
+// What arGetCode() returns for the pattern arGetPatt() extracted from a
+// square: id -1 when no template correlates positively, cf -1 for a
+// square of one color.
+void patternBankMatch(const PatternBank_T *bank, ARUint8 pattern[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3], int *id, int *dir, double *cf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __patternbank_h__
@@ -0,0 +1,399 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/param.h>
+#include <AR/arMulti.h>
+
+#include "pipeline.h"
+#include "tracker.h"
+#include "profile.h"
+#include "thread.h"
+#include "arlock.h"
+#include "hrtimer.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define SLOT_COUNT		PIPELINE_SNAPSHOTS
+#define SLOT_MASK		0x3
+#define SLOT_FRESH		0x4		// Middle slot holds a snapshot not yet seen by the reader.
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+struct Pipeline_T {
+	Capture_T			*capture;
+	int					camera;				// For the trace.
+	ObjectSet_T			*objects;
+	ARMultiMarkerInfoT	*multiConfig;
+	ARMultiMarkerInfoT	*sculpture;
+	ARMultiMarkerInfoT	*sculpturePending;	// Handed over by pipelineSetSculpture().
+	volatile long		sculptureChanged;
+	Mutex_T				*mutex;				// Guards sculpturePending.
+	ARParam				cparam;
+	int					imageSize;
+	int					imageMemory;	// Snapshot images belong to the caller.
+	Frame_T				*frames[SLOT_COUNT];	// Held by the snapshots.
+
+	// Triple buffer. The writer owns back, the reader owns front and
+	// middle is exchanged atomically between them.
+	PoseSnapshot_T		slots[SLOT_COUNT];
+	int					back;
+	int					front;
+	volatile long		middle;
+
+	RoiTracker_T		*roi;
+	volatile long		roiTracking;
+	Pyramid_T			*pyramid;			// NULL in pixel formats it does not support.
+	volatile long		pyramidEnabled;
+	Frontend_T			*frontend;
+	volatile long		frontendMode;
+	volatile long		resolution;
+	BatchPose_T			*batch;
+	volatile long		batchPose;
+	AutoThresh_T		*autoThresh;
+	volatile long		thresholdMode;
+	volatile long		thresholdBias;
+	volatile long		threshold;
+	volatile long		frameCount;
+	volatile long		quit;
+	Thread_T			*thread;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static int snapshotInit(PoseSnapshot_T *snap, int objectCount, int imageSize)
+{
+	memset(snap, 0, sizeof(PoseSnapshot_T));
+	snap->debugImage = (ARUint8 *)malloc(imageSize);
+	snap->visible = (int *)calloc(objectCount > 0 ? objectCount : 1, sizeof(int));
+	snap->trans = (double (*)[3][4])calloc(objectCount > 0 ? objectCount : 1, sizeof(double[3][4]));
+	return (snap->debugImage && snap->visible && snap->trans);
+}
+
+static void snapshotFinal(PoseSnapshot_T *snap)
+{
+	free(snap->debugImage);
+	free(snap->visible);
+	free(snap->trans);
+}
+
+Pipeline_T *pipelineCreate(FrameSource_T *source, int camera, ObjectSet_T *objects, ARMultiMarkerInfoT *multiConfig, const ARParam *cparam)
+{
+	Pipeline_T *pipeline;
+	int i;
+
+	if ((pipeline = (Pipeline_T *)calloc(1, sizeof(Pipeline_T))) == NULL) return (NULL);
+	pipeline->camera = camera;
+	pipeline->objects = objects;
+	pipeline->multiConfig = multiConfig;
+	pipeline->cparam = *cparam;
+	pipeline->imageSize = cparam->xsize * cparam->ysize * AR_PIX_SIZE_DEFAULT;
+	pipeline->threshold = 100;
+	pipeline->batchPose = TRUE;
+
+	if ((pipeline->capture = captureCreate(source, camera, cparam->xsize, cparam->ysize, SLOT_COUNT)) == NULL ||
+		(pipeline->roi = roiTrackerCreate(cparam)) == NULL || (pipeline->frontend = frontendCreate(cparam->xsize, cparam->ysize)) == NULL ||
+		(pipeline->autoThresh = autoThreshCreate(cparam->xsize, cparam->ysize)) == NULL || (pipeline->mutex = mutexCreate()) == NULL ||
+		(pipeline->batch = batchPoseCreate(objects->count, cparam)) == NULL) {
+		fprintf(stderr, "pipelineCreate(): Out of memory.\n");
+		pipelineDestroy(pipeline);
+		return (NULL);
+	}
+	roiTrackerSetFrontend(pipeline->roi, pipeline->frontend);
+	pipeline->pyramid = pyramidCreate(cparam->xsize, cparam->ysize, ROI_PYRAMID_LEVEL);
+	pipeline->frontendMode = frontendMode(pipeline->frontend);
+	pipeline->resolution = frontendResolution(pipeline->frontend);
+	pipeline->thresholdMode = autoThreshMode(pipeline->autoThresh);
+
+	for (i = 0; i < SLOT_COUNT; i++) {
+		if (!snapshotInit(&pipeline->slots[i], objects->count, pipeline->imageSize)) {
+			fprintf(stderr, "pipelineCreate(): Out of memory.\n");
+			pipelineDestroy(pipeline);
+			return (NULL);
+		}
+	}
+	pipeline->back = 0;
+	pipeline->middle = 1;
+	pipeline->front = 2;
+
+	return (pipeline);
+}
+
+void pipelineDestroy(Pipeline_T *pipeline)
+{
+	int i;
+
+	if (pipeline == NULL) return;
+	pipelineStop(pipeline);
+	for (i = 0; i < SLOT_COUNT; i++) {
+		snapshotFinal(&pipeline->slots[i]);
+		frameRelease(pipeline->frames[i]);
+	}
+	captureDestroy(pipeline->capture);
+	roiTrackerDestroy(pipeline->roi);
+	pyramidDestroy(pipeline->pyramid);
+	frontendDestroy(pipeline->frontend);
+	autoThreshDestroy(pipeline->autoThresh);
+	batchPoseDestroy(pipeline->batch);
+	if (pipeline->sculpture != NULL) arMultiFreeConfig(pipeline->sculpture);
+	if (pipeline->sculpturePending != NULL) arMultiFreeConfig(pipeline->sculpturePending);
+	mutexDestroy(pipeline->mutex);
+	free(pipeline);
+}
+
+void pipelineSetImageMemory(Pipeline_T *pipeline, ARUint8 *images[PIPELINE_SNAPSHOTS])
+{
+	int i;
+
+	if (pipeline->thread != NULL) {
+		fprintf(stderr, "pipelineSetImageMemory(): Pipeline is running.\n");
+		return;
+	}
+	for (i = 0; i < SLOT_COUNT; i++) pipeline->slots[i].image = images[i];
+	pipeline->imageMemory = TRUE;
+}
+
+void pipelineSetThreshold(Pipeline_T *pipeline, int threshold)
+{
+	atomicStore(&pipeline->threshold, threshold);
+}
+
+void pipelineSetThresholdBias(Pipeline_T *pipeline, int bias)
+{
+	atomicStore(&pipeline->thresholdBias, bias);
+}
+
+void pipelineSetThresholdMode(Pipeline_T *pipeline, AutoThreshMode_T mode)
+{
+	atomicStore(&pipeline->thresholdMode, mode);
+}
+
+void pipelineSetRoiTracking(Pipeline_T *pipeline, int enabled)
+{
+	atomicStore(&pipeline->roiTracking, enabled);
+}
+
+void pipelineSetPyramid(Pipeline_T *pipeline, int enabled)
+{
+	atomicStore(&pipeline->pyramidEnabled, enabled);
+}
+
+void pipelineSetFrontendMode(Pipeline_T *pipeline, FrontendMode_T mode)
+{
+	atomicStore(&pipeline->frontendMode, mode);
+}
+
+void pipelineSetResolution(Pipeline_T *pipeline, FrontendResolution_T resolution)
+{
+	atomicStore(&pipeline->resolution, resolution);
+}
+
+void pipelineSetPatternBank(Pipeline_T *pipeline, const PatternBank_T *bank)
+{
+	if (pipeline->thread != NULL) {
+		fprintf(stderr, "pipelineSetPatternBank(): Pipeline is running.\n");
+		return;
+	}
+	frontendSetPatternBank(pipeline->frontend, bank);
+}
+
+void pipelineSetBatchPose(Pipeline_T *pipeline, int enabled)
+{
+	atomicStore(&pipeline->batchPose, enabled);
+}
+
+void pipelineSetSculpture(Pipeline_T *pipeline, ARMultiMarkerInfoT *config)
+{
+	ARMultiMarkerInfoT *old;
+
+	mutexLock(pipeline->mutex);
+	old = pipeline->sculpturePending;
+	pipeline->sculpturePending = config;
+	atomicStore(&pipeline->sculptureChanged, 1);
+	mutexUnlock(pipeline->mutex);
+	if (old != NULL) arMultiFreeConfig(old);
+}
+
+long pipelineTakeFrameCount(Pipeline_T *pipeline)
+{
+	return (atomicExchange(&pipeline->frameCount, 0));
+}
+
+void pipelineTakeCaptureStats(Pipeline_T *pipeline, CaptureStats_T *stats)
+{
+	captureTakeStats(pipeline->capture, stats);
+}
+
+// Hand the back slot over to the reader and take the previous middle slot.
+static void pipelinePublish(Pipeline_T *pipeline)
+{
+	long prev = atomicExchange(&pipeline->middle, pipeline->back | SLOT_FRESH);
+	pipeline->back = (int)(prev & SLOT_MASK);
+}
+
+int pipelineFresh(Pipeline_T *pipeline)
+{
+	return ((atomicLoad(&pipeline->middle) & SLOT_FRESH) != 0);
+}
+
+PoseSnapshot_T *pipelineAcquire(Pipeline_T *pipeline)
+{
+	long prev;
+
+	if (pipelineFresh(pipeline)) {
+		prev = atomicExchange(&pipeline->middle, pipeline->front);
+		pipeline->front = (int)(prev & SLOT_MASK);
+	}
+	return (&pipeline->slots[pipeline->front]);
+}
+
+// Detect markers in one camera frame and fill the snapshot.
+static void pipelineProcess(Pipeline_T *pipeline, ARUint8 *image, PoseSnapshot_T *snap)
+{
+	ARMarkerInfo    *marker_info;					// Pointer to array holding the details of detected markers.
+	int             marker_num;						// Count of number of markers detected.
+	const ThresholdMap_T *map;
+	ARMultiMarkerInfoT *sculpture;
+	ARUint8         *debugImage;
+	int             thresh;
+	int             i;
+	double          t;
+
+	if (roiTrackerEnabled(pipeline->roi) != (atomicLoad(&pipeline->roiTracking) != 0)) {
+		roiTrackerSetEnabled(pipeline->roi, atomicLoad(&pipeline->roiTracking) != 0);
+	}
+	if (frontendMode(pipeline->frontend) != (FrontendMode_T)atomicLoad(&pipeline->frontendMode)) {
+		frontendSetMode(pipeline->frontend, (FrontendMode_T)atomicLoad(&pipeline->frontendMode));
+	}
+	frontendSetResolution(pipeline->frontend, (FrontendResolution_T)atomicLoad(&pipeline->resolution));
+	if (atomicLoad(&pipeline->sculptureChanged)) {
+		mutexLock(pipeline->mutex);
+		sculpture = pipeline->sculpture;
+		pipeline->sculpture = pipeline->sculpturePending;
+		pipeline->sculpturePending = NULL;
+		atomicStore(&pipeline->sculptureChanged, 0);
+		mutexUnlock(pipeline->mutex);
+		if (sculpture != NULL) arMultiFreeConfig(sculpture);
+	}
+
+	// Pick the thresholds for this frame.
+	t = profileBegin();
+	if (autoThreshMode(pipeline->autoThresh) != (AutoThreshMode_T)atomicLoad(&pipeline->thresholdMode)) {
+		autoThreshSetMode(pipeline->autoThresh, (AutoThreshMode_T)atomicLoad(&pipeline->thresholdMode));
+	}
+	autoThreshSetManual(pipeline->autoThresh, (int)atomicLoad(&pipeline->threshold));
+	autoThreshSetBias(pipeline->autoThresh, (int)atomicLoad(&pipeline->thresholdBias));
+	thresh = autoThreshUpdate(pipeline->autoThresh, image, &map);
+	frontendSetThresholdMap(pipeline->frontend, map);
+	profileEnd(PROFILE_THRESHOLD, t);
+
+	// One pyramid per frame, for the full scan candidates.
+	if (pipeline->pyramid != NULL && atomicLoad(&pipeline->pyramidEnabled)) {
+		t = profileBegin();
+		pyramidBuild(pipeline->pyramid, image, pipeline->cparam.xsize, pipeline->cparam.ysize);
+		profileEnd(PROFILE_PYRAMID, t);
+		roiTrackerSetPyramid(pipeline->roi, pipeline->pyramid);
+	} else {
+		roiTrackerSetPyramid(pipeline->roi, NULL);
+	}
+
+	// Detect the markers in the video frame. ARToolKit is shared with the
+	// other cameras' pipelines.
+	arLock(&pipeline->cparam);
+	if (trackerDetect(pipeline->roi, pipeline->frontend, image, thresh, &marker_info, &marker_num) < 0) {
+		fprintf(stderr, "pipelineProcess(): arDetectMarker returned error.\n");
+		exit(-1);
+	}
+
+	snap->pattFound = (trackerUpdateObjects(atomicLoad(&pipeline->batchPose) ? pipeline->batch : NULL, pipeline->objects, marker_info, marker_num) > 0);
+	for (i = 0; i < pipeline->objects->count; i++) {
+		snap->visible[i] = pipeline->objects->track[i].visible;
+		memcpy(snap->trans[i], pipeline->objects->track[i].trans, sizeof(double[3][4]));
+	}
+
+	snap->multiErr = trackerUpdateMulti(pipeline->multiConfig, marker_info, marker_num);
+	snap->pattFoundMulti = (snap->multiErr >= 0);
+	if (snap->pattFoundMulti) memcpy(snap->multiTrans, pipeline->multiConfig->trans, sizeof(double[3][4]));
+
+	snap->sculptureErr = (pipeline->sculpture != NULL ? trackerUpdateSculpture(pipeline->sculpture, marker_info, marker_num) : -1.0);
+	snap->sculptureFound = (snap->sculptureErr >= 0);
+	if (snap->sculptureFound) memcpy(snap->sculptureTrans, pipeline->sculpture->trans, sizeof(double[3][4]));
+
+	// Keep the threshold image while arImage still belongs to this frame.
+	if ((debugImage = frontendDebugImage(pipeline->frontend)) == NULL) debugImage = arImage;
+	snap->debug = (arDebug && debugImage != NULL);
+	if (snap->debug) memcpy(snap->debugImage, debugImage, pipeline->imageSize);
+	arUnlock();
+
+	autoThreshFeedback(pipeline->autoThresh, snap->pattFound || snap->pattFoundMulti || snap->sculptureFound);
+	snap->thresholdMode = autoThreshMode(pipeline->autoThresh);
+	autoThreshStats(pipeline->autoThresh, &snap->threshold, &snap->thresholdMin, &snap->thresholdMax, &snap->thresholdFallback);
+
+	// The snapshot holds the frame, mapped pixel buffers need a copy.
+	if (pipeline->imageMemory) memcpy(snap->image, image, pipeline->imageSize);
+	else snap->image = image;
+	snap->valid = TRUE;
+}
+
+static void pipelineWorker(void *arg)
+{
+	Pipeline_T *pipeline = (Pipeline_T *)arg;
+	Frame_T *frame;
+	PoseSnapshot_T *snap;
+
+	profileSetCamera(pipeline->camera);
+	while (!atomicLoad(&pipeline->quit)) {
+		// Latest camera frame, the ones before it are dropped.
+		if ((frame = captureTake(pipeline->capture)) == NULL) {
+			arUtilSleep(1);
+			continue;
+		}
+
+		// The back slot's previous frame is not drawn any more.
+		snap = &pipeline->slots[pipeline->back];
+		frameRelease(pipeline->frames[pipeline->back]);
+		pipeline->frames[pipeline->back] = frame;
+
+		pipelineProcess(pipeline, frame->image, snap);
+		snap->frame = frame->sequence;
+		snap->time = frame->time;
+		snap->published = hrtimerNow();
+
+		atomicAdd(&pipeline->frameCount, 1); // Increment ARToolKit FPS counter.
+		pipelinePublish(pipeline);
+	}
+}
+
+int pipelineStart(Pipeline_T *pipeline)
+{
+	if (pipeline->thread != NULL) return (TRUE);
+	atomicStore(&pipeline->quit, 0);
+	if (!captureStart(pipeline->capture)) return (FALSE);
+	if ((pipeline->thread = threadCreate(pipelineWorker, pipeline)) == NULL) {
+		fprintf(stderr, "pipelineStart(): Unable to start detection thread.\n");
+		captureStop(pipeline->capture);
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+void pipelineStop(Pipeline_T *pipeline)
+{
+	if (pipeline->thread == NULL) return;
+	atomicStore(&pipeline->quit, 1);
+	threadJoin(pipeline->thread);
+	pipeline->thread = NULL;
+	captureStop(pipeline->capture);
+}
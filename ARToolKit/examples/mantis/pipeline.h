@@ -0,0 +1,129 @@
+#ifndef __pipeline_h__
+#define __pipeline_h__
+
+// ============================================================================
+//	Capture -> detection -> pose pipeline running on its own thread
+// ============================================================================
+//
+//	The worker thread grabs camera frames, detects markers and computes all
+//	transformations. Each result is published as a PoseSnapshot_T through a
+//	lock-free triple buffer, so the render thread always sees the latest
+//	complete frame and never waits for detection.
+//
+//	The camera frames come from a capture thread, see capture.h. A snapshot
+//	holds a reference to its frame instead of a copy, the frame returns to
+//	the pool when the worker reuses the snapshot.
+//
+
+#include <AR/ar.h>
+#include <AR/param.h>
+#include <AR/arMulti.h>
+
+#include "object.h"
+#include "framesource.h"
+#include "capture.h"
+#include "frontend.h"
+#include "autothresh.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	int			valid;				// Snapshot holds a processed frame.
+	long		frame;				// Sequence number of the camera frame, gaps are dropped frames.
+	double		time;				// hrtimerNow() when the frame was grabbed.
+	double		published;			// hrtimerNow() when the poses were done.
+	ARUint8		*image;				// Camera frame the poses belong to.
+	ARUint8		*debugImage;		// Copy of the threshold image, valid if debug is set.
+	int			debug;
+	AutoThreshMode_T thresholdMode;
+	int			threshold;			// Global threshold.
+	int			thresholdMin;		// Range of the tile thresholds.
+	int			thresholdMax;
+	int			thresholdFallback;	// Adaptive mode fell back to the global threshold.
+	int			pattFound;			// At least one marker.
+	int			pattFoundMulti;		// At least one multi marker.
+	double		multiTrans[3][4];
+	double		multiErr;
+	int			sculptureFound;		// Sculpture pose from all visible markers.
+	double		sculptureTrans[3][4];
+	double		sculptureErr;
+	int			*visible;			// Per object, indexed like the object data.
+	double		(*trans)[3][4];
+} PoseSnapshot_T;
+
+#define PIPELINE_SNAPSHOTS	3	// Triple buffer.
+
+typedef struct Pipeline_T Pipeline_T;
+
+// The capture thread grabs from source, which must be capturing already.
+// The pipeline uses the objects' track array and the multi marker config as
+// its tracking state; after pipelineStart() only the worker thread may
+// touch them. cparam is the camera parameter set with arInitCparam().
+// camera numbers the pipeline's threads in the trace, see profileSetCamera().
+Pipeline_T *pipelineCreate(FrameSource_T *source, int camera, ObjectSet_T *objects, ARMultiMarkerInfoT *multiConfig, const ARParam *cparam);
+void pipelineDestroy(Pipeline_T *pipeline);
+
+// Copy the camera frames of the snapshots into caller owned memory, one
+// xsize * ysize * AR_PIX_SIZE_DEFAULT image per snapshot, e.g. mapped pixel
+// buffers (see background.h). Must be called before pipelineStart(), the
+// memory must stay valid until pipelineDestroy().
+void pipelineSetImageMemory(Pipeline_T *pipeline, ARUint8 *images[PIPELINE_SNAPSHOTS]);
+
+// Sculpture config from trackerSculptureConfig(), NULL for none. May be
+// called while running, e.g. after the anchors change; the worker switches
+// at the next frame. The pipeline frees the config.
+void pipelineSetSculpture(Pipeline_T *pipeline, ARMultiMarkerInfoT *config);
+
+int  pipelineStart(Pipeline_T *pipeline);
+void pipelineStop(Pipeline_T *pipeline);
+
+// Manual threshold, and the bias added to the automatic thresholds.
+void pipelineSetThreshold(Pipeline_T *pipeline, int threshold);
+void pipelineSetThresholdBias(Pipeline_T *pipeline, int bias);
+
+// Threshold selection, see autothresh.h. Defaults to adaptive.
+void pipelineSetThresholdMode(Pipeline_T *pipeline, AutoThreshMode_T mode);
+
+// Detect only around the tracked markers, see roitrack.h. Off by default.
+void pipelineSetRoiTracking(Pipeline_T *pipeline, int enabled);
+
+// Build a pyramid of every frame and find the full scan candidates in it,
+// see pyramid.h and roitrack.h. Off by default.
+void pipelineSetPyramid(Pipeline_T *pipeline, int enabled);
+
+// Thresholding and labeling front end, see frontend.h. Defaults to the
+// fastest mode the CPU supports.
+void pipelineSetFrontendMode(Pipeline_T *pipeline, FrontendMode_T mode);
+
+// Resolution the squares are found at, see frontend.h. Defaults to the
+// arImageProcMode at pipelineCreate().
+void pipelineSetResolution(Pipeline_T *pipeline, FrontendResolution_T resolution);
+
+// Identify the markers with a pattern bank shared by the pipelines, NULL
+// for ARToolKit's pattern matching. Must be called before pipelineStart(),
+// the bank must stay valid until pipelineDestroy().
+void pipelineSetPatternBank(Pipeline_T *pipeline, const PatternBank_T *bank);
+
+// Refine the tracked marker poses in one batch, see batchpose.h. On by
+// default.
+void pipelineSetBatchPose(Pipeline_T *pipeline, int enabled);
+
+// Number of frames processed since the last call.
+long pipelineTakeFrameCount(Pipeline_T *pipeline);
+
+// Frames captured, dropped and overrun since the last call, see capture.h.
+void pipelineTakeCaptureStats(Pipeline_T *pipeline, CaptureStats_T *stats);
+
+// Render side. pipelineFresh() tells whether a newer snapshot is waiting,
+// pipelineAcquire() makes it current. The returned snapshot stays valid
+// until the next pipelineAcquire() call.
+int pipelineFresh(Pipeline_T *pipeline);
+PoseSnapshot_T *pipelineAcquire(Pipeline_T *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __pipeline_h__
@@ -0,0 +1,245 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <AR/config.h>
+
+#include "posefilter.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+// Benedict-Bordner gains, beta = alpha^2 / (2 - alpha). Lower alpha smooths
+// more and lags more.
+#define POSEFILTER_ALPHA			0.5
+#define POSEFILTER_BETA				(POSEFILTER_ALPHA * POSEFILTER_ALPHA / (2.0 - POSEFILTER_ALPHA))
+
+#define POSEFILTER_JUMP_POS			250.0	// mm off the prediction that restart the filter.
+#define POSEFILTER_JUMP_ROT			0.6		// rad off the prediction that restart the filter.
+#define POSEFILTER_DT_MIN			0.0001	// Detections closer in time are the same frame.
+
+// ============================================================================
+//	Quaternions, x y z w
+// ============================================================================
+
+static void quatMul(const double a[4], const double b[4], double r[4])
+{
+	double t[4];
+
+	t[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+	t[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+	t[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+	t[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+	memcpy(r, t, sizeof(t));
+}
+
+static void quatNormalize(double q[4])
+{
+	double len = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	int i;
+
+	for (i = 0; i < 4; i++) q[i] /= len;
+}
+
+// Rotation by the vector v, its length is the angle.
+static void quatExp(const double v[3], double q[4])
+{
+	double angle = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	double s;
+
+	s = (angle < 1e-9 ? 0.5 : sin(0.5 * angle) / angle);
+	q[0] = s * v[0];
+	q[1] = s * v[1];
+	q[2] = s * v[2];
+	q[3] = cos(0.5 * angle);
+}
+
+// Rotation vector of q, the shorter way around.
+static void quatLog(const double q[4], double v[3])
+{
+	double sign = (q[3] < 0.0 ? -1.0 : 1.0);
+	double len = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+	double s;
+
+	s = (len < 1e-9 ? 2.0 : 2.0 * atan2(len, sign * q[3]) / len);
+	v[0] = sign * s * q[0];
+	v[1] = sign * s * q[1];
+	v[2] = sign * s * q[2];
+}
+
+// Shepperd's method, stable for any rotation.
+static void matToQuat(double m[3][4], double q[4])
+{
+	double trace = m[0][0] + m[1][1] + m[2][2];
+	double s;
+
+	if (trace > 0.0) {
+		s = 2.0 * sqrt(trace + 1.0);
+		q[0] = (m[2][1] - m[1][2]) / s;
+		q[1] = (m[0][2] - m[2][0]) / s;
+		q[2] = (m[1][0] - m[0][1]) / s;
+		q[3] = 0.25 * s;
+	} else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+		s = 2.0 * sqrt(1.0 + m[0][0] - m[1][1] - m[2][2]);
+		q[0] = 0.25 * s;
+		q[1] = (m[0][1] + m[1][0]) / s;
+		q[2] = (m[0][2] + m[2][0]) / s;
+		q[3] = (m[2][1] - m[1][2]) / s;
+	} else if (m[1][1] > m[2][2]) {
+		s = 2.0 * sqrt(1.0 + m[1][1] - m[0][0] - m[2][2]);
+		q[0] = (m[0][1] + m[1][0]) / s;
+		q[1] = 0.25 * s;
+		q[2] = (m[1][2] + m[2][1]) / s;
+		q[3] = (m[0][2] - m[2][0]) / s;
+	} else {
+		s = 2.0 * sqrt(1.0 + m[2][2] - m[0][0] - m[1][1]);
+		q[0] = (m[0][2] + m[2][0]) / s;
+		q[1] = (m[1][2] + m[2][1]) / s;
+		q[2] = 0.25 * s;
+		q[3] = (m[1][0] - m[0][1]) / s;
+	}
+	quatNormalize(q);
+}
+
+static void quatToMat(const double q[4], const double p[3], double m[3][4])
+{
+	double x = q[0], y = q[1], z = q[2], w = q[3];
+
+	m[0][0] = 1.0 - 2.0 * (y * y + z * z);
+	m[0][1] = 2.0 * (x * y - z * w);
+	m[0][2] = 2.0 * (x * z + y * w);
+	m[1][0] = 2.0 * (x * y + z * w);
+	m[1][1] = 1.0 - 2.0 * (x * x + z * z);
+	m[1][2] = 2.0 * (y * z - x * w);
+	m[2][0] = 2.0 * (x * z - y * w);
+	m[2][1] = 2.0 * (y * z + x * w);
+	m[2][2] = 1.0 - 2.0 * (x * x + y * y);
+	m[0][3] = p[0];
+	m[1][3] = p[1];
+	m[2][3] = p[2];
+}
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+const char *poseFilterModeName(PoseFilterMode_T mode)
+{
+	switch (mode) {
+		case POSEFILTER_OFF:		return ("off");
+		case POSEFILTER_SMOOTH:		return ("smooth");
+		case POSEFILTER_PREDICT:	return ("predict");
+		default:					return ("unknown");
+	}
+}
+
+void poseFilterReset(PoseFilter_T *filter)
+{
+	memset(filter, 0, sizeof(PoseFilter_T));
+}
+
+// State moved ahead by dt at constant velocity.
+static void poseFilterPredict(PoseFilter_T *filter, double dt, double pos[3], double rot[4])
+{
+	double v[3], dq[4];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		pos[i] = filter->pos[i] + filter->vel[i] * dt;
+		v[i] = filter->angVel[i] * dt;
+	}
+	quatExp(v, dq);
+	quatMul(dq, filter->rot, rot);
+	quatNormalize(rot);
+}
+
+static void poseFilterRestart(PoseFilter_T *filter, double time, const double pos[3], const double rot[4])
+{
+	poseFilterReset(filter);
+	filter->valid = TRUE;
+	filter->updates = 1;
+	filter->time = time;
+	memcpy(filter->pos, pos, sizeof(filter->pos));
+	memcpy(filter->rot, rot, sizeof(filter->rot));
+}
+
+void poseFilterUpdate(PoseFilter_T *filter, double time, double trans[3][4])
+{
+	double pos[3], rot[4], predPos[3], predRot[4], conj[4], dq[4];
+	double resPos[3], resRot[3], v[3];
+	double dt, dist, angle;
+	int i;
+
+	pos[0] = trans[0][3];
+	pos[1] = trans[1][3];
+	pos[2] = trans[2][3];
+	matToQuat(trans, rot);
+
+	dt = time - filter->time;
+	if (!filter->valid || dt > POSEFILTER_DROPOUT || dt < -POSEFILTER_DROPOUT) {
+		poseFilterRestart(filter, time, pos, rot);
+		return;
+	}
+	if (dt < POSEFILTER_DT_MIN) return;
+
+	// Residual against the prediction, the rotation one in camera axes.
+	poseFilterPredict(filter, dt, predPos, predRot);
+	conj[0] = -predRot[0];
+	conj[1] = -predRot[1];
+	conj[2] = -predRot[2];
+	conj[3] = predRot[3];
+	quatMul(rot, conj, dq);
+	quatLog(dq, resRot);
+	for (i = 0; i < 3; i++) resPos[i] = pos[i] - predPos[i];
+	dist = sqrt(resPos[0] * resPos[0] + resPos[1] * resPos[1] + resPos[2] * resPos[2]);
+	angle = sqrt(resRot[0] * resRot[0] + resRot[1] * resRot[1] + resRot[2] * resRot[2]);
+	if (dist > POSEFILTER_JUMP_POS || angle > POSEFILTER_JUMP_ROT) {
+		poseFilterRestart(filter, time, pos, rot);
+		return;
+	}
+
+	if (filter->updates == 1) {
+		// Second detection, the velocity is the whole difference.
+		for (i = 0; i < 3; i++) {
+			filter->vel[i] = resPos[i] / dt;
+			filter->angVel[i] = resRot[i] / dt;
+		}
+		memcpy(filter->pos, pos, sizeof(filter->pos));
+		memcpy(filter->rot, rot, sizeof(filter->rot));
+	} else {
+		for (i = 0; i < 3; i++) {
+			filter->pos[i] = predPos[i] + POSEFILTER_ALPHA * resPos[i];
+			filter->vel[i] += POSEFILTER_BETA / dt * resPos[i];
+			filter->angVel[i] += POSEFILTER_BETA / dt * resRot[i];
+			v[i] = POSEFILTER_ALPHA * resRot[i];
+		}
+		quatExp(v, dq);
+		quatMul(dq, predRot, filter->rot);
+		quatNormalize(filter->rot);
+	}
+	filter->updates++;
+	filter->time = time;
+}
+
+int poseFilterPose(PoseFilter_T *filter, double time, double trans[3][4])
+{
+	double pos[3], rot[4], dt;
+
+	if (!poseFilterActive(filter, time)) return (FALSE);
+	dt = time - filter->time;
+	if (dt < 0.0) dt = 0.0;
+	if (dt > POSEFILTER_EXTRAPOLATE_MAX) dt = POSEFILTER_EXTRAPOLATE_MAX;
+	poseFilterPredict(filter, dt, pos, rot);
+	quatToMat(rot, pos, trans);
+	return (TRUE);
+}
+
+int poseFilterActive(PoseFilter_T *filter, double time)
+{
+	return (filter->valid && time - filter->time <= POSEFILTER_DROPOUT);
+}
@@ -0,0 +1,65 @@
+#ifndef __posefilter_h__
+#define __posefilter_h__
+
+// ============================================================================
+//	Pose filtering and prediction
+// ============================================================================
+//
+//	One filter per tracked object models constant linear and angular
+//	velocity of the marker pose. Every detection corrects the state with
+//	fixed alpha-beta gains, the steady state of a constant velocity Kalman
+//	filter. The pose can then be read at any time: at the camera frame time
+//	it is a smoothed detection matching the video, later it is extrapolated,
+//	e.g. to the time the rendered frame reaches the display.
+//
+//	When the marker drops out for a few frames the pose keeps moving for a
+//	short while and then holds; after POSEFILTER_DROPOUT the object is
+//	reported invisible. A detection far from the prediction restarts the
+//	filter, so switching between markers or a bad detection does not drag.
+//
+//	Times are in seconds, see hrtimer.h, translations in mm.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POSEFILTER_DROPOUT			0.3		// Seconds an unseen object stays visible.
+#define POSEFILTER_EXTRAPOLATE_MAX	0.1		// Seconds the pose moves past the last detection.
+
+typedef enum {
+	POSEFILTER_OFF = 0,			// Raw detections.
+	POSEFILTER_SMOOTH,			// Filtered at the camera frame time.
+	POSEFILTER_PREDICT,			// Filtered and extrapolated to the display time.
+	POSEFILTER_MODE_COUNT
+} PoseFilterMode_T;
+
+typedef struct {
+	int			valid;
+	int			updates;			// Detections since the last restart.
+	double		time;				// Time of the state, the last detection.
+	double		pos[3];
+	double		vel[3];				// mm/s.
+	double		rot[4];				// Unit quaternion x y z w.
+	double		angVel[3];			// rad/s around the camera axes.
+} PoseFilter_T;
+
+const char *poseFilterModeName(PoseFilterMode_T mode);
+
+void poseFilterReset(PoseFilter_T *filter);
+
+// Correct the filter with a detected pose, trans as from arGetTransMat().
+void poseFilterUpdate(PoseFilter_T *filter, double time, double trans[3][4]);
+
+// Pose at time. Returns FALSE and leaves trans alone when the object has
+// not been seen for POSEFILTER_DROPOUT.
+int poseFilterPose(PoseFilter_T *filter, double time, double trans[3][4]);
+
+// The object is still reported visible at time.
+int poseFilterActive(PoseFilter_T *filter, double time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __posefilter_h__
@@ -0,0 +1,180 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "hrtimer.h"
+#include "thread.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define PROFILE_SAMPLES		128			// Rolling window per stage.
+#define PROFILE_EVENTS		65536		// Trace ring, power of two.
+
+#ifndef TRUE
+#  define TRUE 1
+#endif
+#ifndef FALSE
+#  define FALSE 0
+#endif
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	double			samples[PROFILE_SAMPLES];
+	volatile long	count;
+} ProfileRing_T;
+
+typedef struct {
+	double	begin;
+	double	duration;
+	int		stage;
+	int		camera;
+} ProfileEvent_T;
+
+// ============================================================================
+//	Global variables
+// ============================================================================
+
+static const struct {
+	const char	*name;
+	int			tid;			// Trace thread lane, see profileLane().
+} gStageInfo[PROFILE_STAGE_COUNT] = {
+	{ "video grab", 3 },
+	{ "threshold", 2 },
+	{ "pyramid", 2 },
+	{ "arDetectMarker", 2 },
+	{ "object matching", 2 },
+	{ "arGetTransMat[Cont]", 2 },
+	{ "arMultiGetTransMat", 2 },
+	{ "sculpture pose", 2 },
+	{ "arglDispImage", 1 },
+	{ "modelDraw", 1 },
+	{ "glutSwapBuffers", 1 }
+};
+
+static ProfileRing_T	gRings[PROFILE_STAGE_COUNT];
+static ProfileEvent_T	gEvents[PROFILE_EVENTS];
+static volatile long	gEventCount = 0;
+static THREAD_LOCAL int	gCamera = 0;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+void profileSetCamera(int camera)
+{
+	gCamera = camera;
+}
+
+// Render thread 1, then detection and capture of the first camera 2 and 3,
+// of the second 4 and 5 and so on.
+static int profileLane(const ProfileEvent_T *event)
+{
+	int tid = gStageInfo[event->stage].tid;
+
+	return (tid == 1 ? tid : tid + 2 * event->camera);
+}
+
+double profileBegin(void)
+{
+	return (hrtimerNow());
+}
+
+void profileEnd(ProfileStage_T stage, double begin)
+{
+	ProfileRing_T *ring = &gRings[stage];
+	ProfileEvent_T *event;
+	double duration = hrtimerNow() - begin;
+	long slot;
+
+	slot = atomicAdd(&ring->count, 1) - 1;
+	ring->samples[slot % PROFILE_SAMPLES] = duration;
+
+	slot = (atomicAdd(&gEventCount, 1) - 1) & (PROFILE_EVENTS - 1);
+	event = &gEvents[slot];
+	event->begin = begin;
+	event->duration = duration;
+	event->stage = stage;
+	event->camera = gCamera;
+}
+
+const char *profileStageName(ProfileStage_T stage)
+{
+	return (gStageInfo[stage].name);
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+	double da = *(const double *)a, db = *(const double *)b;
+	return ((da > db) - (da < db));
+}
+
+int profileStats(ProfileStage_T stage, double *min, double *avg, double *p99)
+{
+	ProfileRing_T *ring = &gRings[stage];
+	double sorted[PROFILE_SAMPLES], sum = 0.0;
+	long count = atomicLoad(&ring->count);
+	int n, i;
+
+	n = (count < PROFILE_SAMPLES ? (int)count : PROFILE_SAMPLES);
+	if (n == 0) return (FALSE);
+
+	memcpy(sorted, ring->samples, n * sizeof(double));
+	qsort(sorted, n, sizeof(double), compareDouble);
+	for (i = 0; i < n; i++) sum += sorted[i];
+
+	*min = sorted[0] * 1000.0;
+	*avg = sum / n * 1000.0;
+	*p99 = sorted[(int)(0.99 * (n - 1) + 0.5)] * 1000.0;
+	return (TRUE);
+}
+
+int profileWriteTrace(const char *filename)
+{
+	FILE *fp;
+	long count, first, i;
+	ProfileEvent_T *event;
+	double origin;
+	int cameras = 1, c;
+
+	if ((fp = fopen(filename, "w")) == NULL) {
+		fprintf(stderr, "profileWriteTrace(): Unable to open %s.\n", filename);
+		return (FALSE);
+	}
+
+	// Oldest events are overwritten once the ring is full.
+	count = atomicLoad(&gEventCount);
+	first = (count > PROFILE_EVENTS ? count - PROFILE_EVENTS : 0);
+	origin = gEvents[first & (PROFILE_EVENTS - 1)].begin;
+	for (i = first; i < count; i++) {
+		if (gEvents[i & (PROFILE_EVENTS - 1)].begin < origin) origin = gEvents[i & (PROFILE_EVENTS - 1)].begin;
+		if (gEvents[i & (PROFILE_EVENTS - 1)].camera >= cameras) cameras = gEvents[i & (PROFILE_EVENTS - 1)].camera + 1;
+	}
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"render\"}}");
+	for (c = 0; c < cameras; c++) {
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"detection %d\"}}", 2 + 2 * c, c + 1);
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"capture %d\"}}", 3 + 2 * c, c + 1);
+	}
+	for (i = first; i < count; i++) {
+		event = &gEvents[i & (PROFILE_EVENTS - 1)];
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			gStageInfo[event->stage].name, profileLane(event),
+			(event->begin - origin) * 1e6, event->duration * 1e6);
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	printf("Wrote %ld trace events to %s\n", count - first, filename);
+	return (TRUE);
+}
@@ -0,0 +1,59 @@
+#ifndef __profile_h__
+#define __profile_h__
+
+// ============================================================================
+//	Per-stage frame time instrumentation
+// ============================================================================
+//
+//	Each stage of a frame records its duration into a small ring of recent
+//	samples (for the rolling statistics shown in the debug text) and into a
+//	global event ring that is written out as a Chrome trace on exit
+//	(load the file in chrome://tracing).
+//
+//	A stage may be recorded from several threads at once, the detection and
+//	capture threads of every camera record the same stages; samples and
+//	events take their slots atomically. The statistics are over all cameras,
+//	the trace shows the threads of each camera on lanes of their own, see
+//	profileSetCamera().
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	PROFILE_GRAB,			// Capture thread.
+	PROFILE_THRESHOLD,		// Detection thread.
+	PROFILE_PYRAMID,
+	PROFILE_DETECT,
+	PROFILE_MATCH,
+	PROFILE_TRANS,
+	PROFILE_MULTI,
+	PROFILE_SCULPTURE,
+	PROFILE_DISP_IMAGE,		// Render thread.
+	PROFILE_MODEL_DRAW,
+	PROFILE_SWAP,
+	PROFILE_STAGE_COUNT
+} ProfileStage_T;
+
+// Camera of the calling thread's events in the trace, 0 until set.
+void profileSetCamera(int camera);
+
+// Timestamp to pass to profileEnd().
+double profileBegin(void);
+void profileEnd(ProfileStage_T stage, double begin);
+
+const char *profileStageName(ProfileStage_T stage);
+
+// Rolling statistics over the recent samples of a stage, in milliseconds.
+// Returns FALSE if the stage has no samples yet.
+int profileStats(ProfileStage_T stage, double *min, double *avg, double *p99);
+
+// Write the recorded events as Chrome trace event JSON.
+int profileWriteTrace(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __profile_h__
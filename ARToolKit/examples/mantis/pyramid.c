@@ -0,0 +1,268 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "pyramid.h"
+#include "frontend.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#  define PYRAMID_HAVE_SSE2
+#  include <emmintrin.h>
+#endif
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	int			xsize;
+	int			ysize;
+	ARUint8		*mean;
+	ARUint8		*darkest;
+} PyramidLevel_T;
+
+struct Pyramid_T {
+	int				levels;
+	int				built;
+	int				simd;
+	PyramidLevel_T	level[PYRAMID_LEVELS_MAX + 1];	// 0 is unused, the frame.
+	ARUint8			*check;							// Scalar levels for pyramidVerify().
+};
+
+// ============================================================================
+//	Scalar code
+// ============================================================================
+
+#define PYRAMID_GRAY(p)		((int)(p)[0] + (int)(p)[1] + (int)(p)[2])
+
+// Level 1 from the camera frame, columns from x0 on. The darkest sum is
+// rounded up, so darkest <= thresh exactly when arLabeling() sees a dark
+// pixel among the four.
+static void pyramidFirstScalar(const ARUint8 *image, int xsize, PyramidLevel_T *dst, int x0)
+{
+	const int row = xsize * AR_PIX_SIZE_DEFAULT;
+	const ARUint8 *p;
+	int x, y, s00, s01, s10, s11, m;
+
+	for (y = 0; y < dst->ysize; y++) {
+		p = image + 2 * y * row + 2 * x0 * AR_PIX_SIZE_DEFAULT + FRONTEND_CHANNEL;
+		for (x = x0; x < dst->xsize; x++, p += 2 * AR_PIX_SIZE_DEFAULT) {
+			s00 = PYRAMID_GRAY(p);
+			s01 = PYRAMID_GRAY(p + AR_PIX_SIZE_DEFAULT);
+			s10 = PYRAMID_GRAY(p + row);
+			s11 = PYRAMID_GRAY(p + row + AR_PIX_SIZE_DEFAULT);
+			m = (s00 < s01 ? s00 : s01);
+			if (s10 < m) m = s10;
+			if (s11 < m) m = s11;
+			dst->mean[y * dst->xsize + x] = (ARUint8)((s00 + s01 + s10 + s11 + 6) / 12);
+			dst->darkest[y * dst->xsize + x] = (ARUint8)((m + 2) / 3);
+		}
+	}
+}
+
+static void pyramidNextScalar(const PyramidLevel_T *src, PyramidLevel_T *dst, int x0, int y)
+{
+	const ARUint8 *m0 = src->mean + 2 * y * src->xsize, *m1 = m0 + src->xsize;
+	const ARUint8 *d0 = src->darkest + 2 * y * src->xsize, *d1 = d0 + src->xsize;
+	int x, a, b;
+
+	for (x = x0; x < dst->xsize; x++) {
+		dst->mean[y * dst->xsize + x] = (ARUint8)((m0[2 * x] + m0[2 * x + 1] + m1[2 * x] + m1[2 * x + 1] + 2) >> 2);
+		a = (d0[2 * x] < d0[2 * x + 1] ? d0[2 * x] : d0[2 * x + 1]);
+		b = (d1[2 * x] < d1[2 * x + 1] ? d1[2 * x] : d1[2 * x + 1]);
+		dst->darkest[y * dst->xsize + x] = (ARUint8)(a < b ? a : b);
+	}
+}
+
+// ============================================================================
+//	SSE2 code
+// ============================================================================
+//
+//	The same integer arithmetic, eight level pixels per step. Divisions by
+//	12 and 3 are multiplications by 5462 / 65536 and 21846 / 65536, exact
+//	for the sums that occur.
+//
+
+#ifdef PYRAMID_HAVE_SSE2
+// Colour sums of eight pixels as 16 bit lanes, in order.
+static __m128i pyramidSumsSSE2(const ARUint8 *p)
+{
+	const __m128i weights = (FRONTEND_CHANNEL == 0 ? _mm_set_epi16(0, 1, 1, 1, 0, 1, 1, 1) : _mm_set_epi16(1, 1, 1, 0, 1, 1, 1, 0));
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = _mm_loadu_si128((const __m128i *)p);
+	__m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+	__m128i sa = _mm_madd_epi16(_mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(a, zero), weights), _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), weights)), ones);
+	__m128i sb = _mm_madd_epi16(_mm_packs_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(b, zero), weights), _mm_madd_epi16(_mm_unpackhi_epi8(b, zero), weights)), ones);
+
+	return (_mm_packs_epi32(sa, sb));
+}
+
+// Smaller of each pair of 16 bit lanes, in the low half of 32 bit lanes.
+static __m128i pyramidPairMinSSE2(__m128i v)
+{
+	v = _mm_min_epi16(v, _mm_srli_epi32(v, 16));
+	return (_mm_and_si128(v, _mm_set1_epi32(0xFFFF)));
+}
+
+static int pyramidFirstSSE2(const ARUint8 *image, int xsize, PyramidLevel_T *dst)
+{
+	const int row = xsize * AR_PIX_SIZE_DEFAULT;
+	const __m128i ones = _mm_set1_epi16(1);
+	const ARUint8 *p;
+	__m128i a0, a1, b0, b1, mean, dark;
+	int x = 0, y;
+
+	for (y = 0; y < dst->ysize; y++) {
+		p = image + 2 * y * row;
+		for (x = 0; x + 8 <= dst->xsize; x += 8, p += 16 * AR_PIX_SIZE_DEFAULT) {
+			a0 = pyramidSumsSSE2(p);
+			a1 = pyramidSumsSSE2(p + 8 * AR_PIX_SIZE_DEFAULT);
+			b0 = pyramidSumsSSE2(p + row);
+			b1 = pyramidSumsSSE2(p + row + 8 * AR_PIX_SIZE_DEFAULT);
+
+			mean = _mm_packs_epi32(_mm_madd_epi16(_mm_add_epi16(a0, b0), ones), _mm_madd_epi16(_mm_add_epi16(a1, b1), ones));
+			mean = _mm_mulhi_epu16(_mm_add_epi16(mean, _mm_set1_epi16(6)), _mm_set1_epi16(5462));
+			_mm_storel_epi64((__m128i *)(dst->mean + y * dst->xsize + x), _mm_packus_epi16(mean, mean));
+
+			dark = _mm_packs_epi32(pyramidPairMinSSE2(_mm_min_epi16(a0, b0)), pyramidPairMinSSE2(_mm_min_epi16(a1, b1)));
+			dark = _mm_mulhi_epu16(_mm_add_epi16(dark, _mm_set1_epi16(2)), _mm_set1_epi16(21846));
+			_mm_storel_epi64((__m128i *)(dst->darkest + y * dst->xsize + x), _mm_packus_epi16(dark, dark));
+		}
+	}
+	return (x);
+}
+
+static int pyramidNextSSE2(const PyramidLevel_T *src, PyramidLevel_T *dst, int y)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	const ARUint8 *m0 = src->mean + 2 * y * src->xsize, *m1 = m0 + src->xsize;
+	const ARUint8 *d0 = src->darkest + 2 * y * src->xsize, *d1 = d0 + src->xsize;
+	__m128i a, b, lo, hi, v;
+	int x;
+
+	for (x = 0; x + 8 <= dst->xsize; x += 8) {
+		a = _mm_loadu_si128((const __m128i *)(m0 + 2 * x));
+		b = _mm_loadu_si128((const __m128i *)(m1 + 2 * x));
+		lo = _mm_madd_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)), ones);
+		hi = _mm_madd_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)), ones);
+		v = _mm_srli_epi16(_mm_add_epi16(_mm_packs_epi32(lo, hi), _mm_set1_epi16(2)), 2);
+		_mm_storel_epi64((__m128i *)(dst->mean + y * dst->xsize + x), _mm_packus_epi16(v, v));
+
+		a = _mm_loadu_si128((const __m128i *)(d0 + 2 * x));
+		b = _mm_loadu_si128((const __m128i *)(d1 + 2 * x));
+		v = _mm_min_epu8(a, b);
+		v = _mm_and_si128(_mm_min_epu8(v, _mm_srli_epi16(v, 8)), _mm_set1_epi16(0x00FF));
+		_mm_storel_epi64((__m128i *)(dst->darkest + y * dst->xsize + x), _mm_packus_epi16(v, v));
+	}
+	return (x);
+}
+#endif
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+Pyramid_T *pyramidCreate(int xsize, int ysize, int levels)
+{
+	Pyramid_T *pyramid;
+	int i, size = 0;
+
+	if (!FRONTEND_FORMAT_OK) return (NULL);
+	if (levels < 1) levels = 1;
+	if (levels > PYRAMID_LEVELS_MAX) levels = PYRAMID_LEVELS_MAX;
+	if ((pyramid = (Pyramid_T *)calloc(1, sizeof(Pyramid_T))) == NULL) return (NULL);
+	pyramid->levels = levels;
+	pyramid->simd = frontendModeAvailable(FRONTEND_SSE2);
+
+	// One block, mean and darkest of every level and the same for checks.
+	for (i = 1; i <= levels; i++) size += 2 * (xsize >> i) * (ysize >> i);
+	if ((pyramid->level[1].mean = (ARUint8 *)malloc(2 * size + 1)) == NULL) {
+		free(pyramid);
+		return (NULL);
+	}
+	pyramid->check = pyramid->level[1].mean + size;
+	for (i = 1; i <= levels; i++) {
+		pyramid->level[i].xsize = xsize >> i;
+		pyramid->level[i].ysize = ysize >> i;
+		if (i > 1) pyramid->level[i].mean = pyramid->level[i - 1].darkest + pyramid->level[i - 1].xsize * pyramid->level[i - 1].ysize;
+		pyramid->level[i].darkest = pyramid->level[i].mean + pyramid->level[i].xsize * pyramid->level[i].ysize;
+	}
+	return (pyramid);
+}
+
+void pyramidDestroy(Pyramid_T *pyramid)
+{
+	if (pyramid == NULL) return;
+	free(pyramid->level[1].mean);
+	free(pyramid);
+}
+
+int pyramidLevels(Pyramid_T *pyramid)
+{
+	return (pyramid->levels);
+}
+
+static void pyramidBuildWith(Pyramid_T *pyramid, int simd, const ARUint8 *image, int xsize, int ysize)
+{
+	int i, x, y;
+
+	for (i = 1; i <= pyramid->levels; i++) {
+		pyramid->level[i].xsize = xsize >> i;
+		pyramid->level[i].ysize = ysize >> i;
+	}
+
+	x = 0;
+#ifdef PYRAMID_HAVE_SSE2
+	if (simd) x = pyramidFirstSSE2(image, xsize, &pyramid->level[1]);
+#endif
+	pyramidFirstScalar(image, xsize, &pyramid->level[1], x);
+
+	for (i = 2; i <= pyramid->levels; i++) {
+		for (y = 0; y < pyramid->level[i].ysize; y++) {
+			x = 0;
+#ifdef PYRAMID_HAVE_SSE2
+			if (simd) x = pyramidNextSSE2(&pyramid->level[i - 1], &pyramid->level[i], y);
+#endif
+			pyramidNextScalar(&pyramid->level[i - 1], &pyramid->level[i], x, y);
+		}
+	}
+}
+
+void pyramidBuild(Pyramid_T *pyramid, const ARUint8 *image, int xsize, int ysize)
+{
+	pyramidBuildWith(pyramid, pyramid->simd, image, xsize, ysize);
+	pyramid->built = TRUE;
+}
+
+const ARUint8 *pyramidLevel(Pyramid_T *pyramid, int level, PyramidKind_T kind, int *xsize, int *ysize)
+{
+	if (pyramid == NULL || !pyramid->built || level < 1 || level > pyramid->levels) return (NULL);
+	*xsize = pyramid->level[level].xsize;
+	*ysize = pyramid->level[level].ysize;
+	return (kind == PYRAMID_DARKEST ? pyramid->level[level].darkest : pyramid->level[level].mean);
+}
+
+int pyramidVerify(Pyramid_T *pyramid, const ARUint8 *image, int xsize, int ysize)
+{
+	ARUint8 *levels = pyramid->level[1].mean;
+	int i, size, mismatch = 0;
+
+	size = (int)(pyramid->check - levels);
+	pyramidBuild(pyramid, image, xsize, ysize);
+	memcpy(pyramid->check, levels, size);
+	pyramidBuildWith(pyramid, FALSE, image, xsize, ysize);
+	for (i = 0; i < size; i++) {
+		if (levels[i] != pyramid->check[i]) mismatch++;
+	}
+	memcpy(levels, pyramid->check, size);
+	return (mismatch);
+}
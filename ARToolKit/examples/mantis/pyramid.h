@@ -0,0 +1,58 @@
+#ifndef __pyramid_h__
+#define __pyramid_h__
+
+// ============================================================================
+//	Gray image pyramid of a camera frame
+// ============================================================================
+//
+//	Level 0 is the camera frame itself, every further level halves the size
+//	of the one before. Each level is kept twice, as the mean of the 2x2
+//	pixels below it and as their darkest one, in the brightness arLabeling()
+//	thresholds: the colour sum divided by three. The darkest levels keep a
+//	one pixel wide dark line at any level, so a marker border that averages
+//	away in the mean levels is still seen there.
+//
+//	Built once per frame with SSE2 when the CPU has it, the levels are then
+//	read by any stage that wants a smaller image, see roitrack.h for the
+//	coarse to fine marker search. 32 bit pixel formats only.
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PYRAMID_LEVELS_MAX	4
+
+typedef enum {
+	PYRAMID_MEAN,
+	PYRAMID_DARKEST
+} PyramidKind_T;
+
+typedef struct Pyramid_T Pyramid_T;
+
+// Levels 1 to levels for frames of up to xsize * ysize. NULL in other
+// pixel formats or when out of memory.
+Pyramid_T *pyramidCreate(int xsize, int ysize, int levels);
+void pyramidDestroy(Pyramid_T *pyramid);
+
+// Build all levels from a camera frame of xsize * ysize pixels.
+void pyramidBuild(Pyramid_T *pyramid, const ARUint8 *image, int xsize, int ysize);
+
+// Number of levels above the frame.
+int pyramidLevels(Pyramid_T *pyramid);
+
+// Level 1 to pyramidLevels() of the last build, rows of *xsize bytes, NULL
+// for other levels or before the first build.
+const ARUint8 *pyramidLevel(Pyramid_T *pyramid, int level, PyramidKind_T kind, int *xsize, int *ysize);
+
+// Build with the scalar code and compare, returns the number of differing
+// pixels over all levels. For checking the SSE2 code.
+int pyramidVerify(Pyramid_T *pyramid, const ARUint8 *image, int xsize, int ysize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __pyramid_h__
@@ -0,0 +1,161 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#ifdef __APPLE__
+#  include <OpenGL/OpenGL.h>
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#  ifndef _WIN32
+#    include <GL/glx.h>
+#  endif
+#endif
+
+#include <AR/config.h>
+
+#include "redraw.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define REDRAW_REFRESH_DEFAULT	60		// Hz when the display does not tell.
+#define REDRAW_SLACK			0.9		// Part of a refresh that has to pass between frames.
+
+// WGL_EXT_swap_control, GLX_SGI_swap_control and GLX_MESA_swap_control.
+#ifdef _WIN32
+typedef BOOL (WINAPI *SwapInterval_T)(int interval);
+#elif !defined(__APPLE__)
+typedef int (*SwapInterval_T)(unsigned int interval);
+#endif
+
+static const char *gRedrawReasonNames[REDRAW_REASON_COUNT] = {
+	"frame",
+	"pose",
+	"ui"
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+void redrawInit(Redraw_T *redraw, int refreshRate)
+{
+#ifdef _WIN32
+	DEVMODE mode;
+
+	if (refreshRate <= 1) {
+		memset(&mode, 0, sizeof(mode));
+		mode.dmSize = sizeof(mode);
+		if (EnumDisplaySettings(NULL, ENUM_CURRENT_SETTINGS, &mode)) refreshRate = (int)mode.dmDisplayFrequency;
+	}
+#endif
+	// 0 and 1 stand for the hardware default.
+	if (refreshRate <= 1) refreshRate = REDRAW_REFRESH_DEFAULT;
+
+	memset(redraw, 0, sizeof(Redraw_T));
+	redraw->refresh = 1.0 / refreshRate;
+	redraw->pending = REDRAW_FRAME | REDRAW_UI;
+}
+
+void redrawRequest(Redraw_T *redraw, unsigned reasons)
+{
+	redraw->pending |= reasons;
+}
+
+void redrawCheckPose(Redraw_T *redraw, int visible, double trans[3][4])
+{
+	int i, j;
+
+	if (!visible != !redraw->drawnVisible) {
+		redraw->pending |= REDRAW_POSE;
+		return;
+	}
+	if (!visible) return;
+	for (j = 0; j < 3; j++) {
+		if (fabs(trans[j][3] - redraw->drawnTrans[j][3]) > REDRAW_EPSILON_POS) break;
+		for (i = 0; i < 3; i++) {
+			if (fabs(trans[j][i] - redraw->drawnTrans[j][i]) > REDRAW_EPSILON_ROT) break;
+		}
+		if (i < 3) break;
+	}
+	if (j < 3) redraw->pending |= REDRAW_POSE;
+}
+
+int redrawDue(Redraw_T *redraw, double now)
+{
+	if (redraw->pending == 0) {
+		redraw->idle++;
+		return (FALSE);
+	}
+	return (now - redraw->last >= REDRAW_SLACK * redraw->refresh);
+}
+
+unsigned redrawBegin(Redraw_T *redraw, double now)
+{
+	unsigned reasons = redraw->pending;
+	int i;
+
+	redraw->pending = 0;
+	redraw->last = now;
+	redraw->frames++;
+	for (i = 0; i < REDRAW_REASON_COUNT; i++) {
+		if (reasons & (1u << i)) redraw->reasons[i]++;
+	}
+	return (reasons);
+}
+
+void redrawDrawn(Redraw_T *redraw, int visible, double trans[3][4])
+{
+	redraw->drawnVisible = visible;
+	if (visible) memcpy(redraw->drawnTrans, trans, sizeof(redraw->drawnTrans));
+}
+
+const char *redrawReasonName(int reason)
+{
+	if (reason < 0 || reason >= REDRAW_REASON_COUNT) return ("");
+	return (gRedrawReasonNames[reason]);
+}
+
+long redrawTakeCounts(Redraw_T *redraw, long reasons[REDRAW_REASON_COUNT], long *idle)
+{
+	long frames = redraw->frames;
+
+	memcpy(reasons, redraw->reasons, sizeof(redraw->reasons));
+	*idle = redraw->idle;
+	memset(redraw->reasons, 0, sizeof(redraw->reasons));
+	redraw->frames = 0;
+	redraw->idle = 0;
+	return (frames);
+}
+
+int redrawSetSwapInterval(int interval)
+{
+#ifdef _WIN32
+	SwapInterval_T swapInterval = (SwapInterval_T)wglGetProcAddress("wglSwapIntervalEXT");
+
+	return (swapInterval != NULL && swapInterval(interval));
+#elif defined(__APPLE__)
+	GLint value = interval;
+
+	return (CGLSetParameter(CGLGetCurrentContext(), kCGLCPSwapInterval, &value) == kCGLNoError);
+#else
+	SwapInterval_T swapInterval;
+
+	// GLX_SGI_swap_control cannot switch the sync off.
+	if (interval > 0 && (swapInterval = (SwapInterval_T)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalSGI")) != NULL) {
+		return (swapInterval((unsigned int)interval) == 0);
+	}
+	if ((swapInterval = (SwapInterval_T)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalMESA")) != NULL) {
+		return (swapInterval((unsigned int)interval) == 0);
+	}
+	return (FALSE);
+#endif
+}
@@ -0,0 +1,80 @@
+#ifndef __redraw_h__
+#define __redraw_h__
+
+// ============================================================================
+//	Drawing frames only when something changed
+// ============================================================================
+//
+//	Collects the reasons for a new frame: a camera frame published by a
+//	pipeline, a drawn pose that moved more than the epsilons (predicted
+//	poses move between camera frames), a changed mode or window. The idle
+//	callback asks for a redisplay only while a reason is pending, and not
+//	sooner than one display refresh after the last frame. The reasons also
+//	tell the display callback whether the camera frame has to be uploaded
+//	again or the texture of the last one can be drawn.
+//
+//	With the swap interval set to 1 the buffer swap waits for the vertical
+//	blank as well, so the GPU never draws frames the display does not show.
+//
+//	Must only be used from the GL thread.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REDRAW_EPSILON_POS		0.5		// mm a drawn pose has to move.
+#define REDRAW_EPSILON_ROT		0.001	// Change of a rotation matrix element, about 0.06 degrees.
+
+typedef enum {
+	REDRAW_FRAME	= 0x01,		// New camera frame.
+	REDRAW_POSE		= 0x02,		// Drawn pose moved.
+	REDRAW_UI		= 0x04,		// Mode, window or debug output changed.
+	REDRAW_REASON_COUNT = 3
+} RedrawReason_T;
+
+typedef struct {
+	unsigned	pending;			// RedrawReason_T bits.
+	double		refresh;			// Seconds per display refresh.
+	double		last;				// Time the last frame was drawn.
+	int			drawnVisible;		// Pose of the model in the last frame.
+	double		drawnTrans[3][4];
+	long		frames;				// Frames drawn since redrawTakeCounts().
+	long		reasons[REDRAW_REASON_COUNT];	// Frames drawn for each reason.
+	long		idle;				// Idle calls with nothing to draw.
+} Redraw_T;
+
+// Refresh rate in Hz of the display the window is on, 0 for the default
+// of the desktop.
+void redrawInit(Redraw_T *redraw, int refreshRate);
+
+void redrawRequest(Redraw_T *redraw, unsigned reasons);
+
+// Request REDRAW_POSE if the model pose differs from the one last drawn.
+void redrawCheckPose(Redraw_T *redraw, int visible, double trans[3][4]);
+
+// From the idle callback: TRUE when a frame should be drawn now. Counts
+// the calls that found nothing to draw.
+int redrawDue(Redraw_T *redraw, double now);
+
+// From the display callback: the pending reasons, which are then cleared.
+// A redisplay the window system asked for has none.
+unsigned redrawBegin(Redraw_T *redraw, double now);
+
+// The model pose the frame was drawn with.
+void redrawDrawn(Redraw_T *redraw, int visible, double trans[3][4]);
+
+const char *redrawReasonName(int reason);
+
+// Frames drawn and idle calls since the last call, per reason as well.
+long redrawTakeCounts(Redraw_T *redraw, long reasons[REDRAW_REASON_COUNT], long *idle);
+
+// Sync the buffer swap of the current context with the vertical blank,
+// interval refreshes per swap, 0 off. FALSE when the driver cannot.
+int redrawSetSwapInterval(int interval);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __redraw_h__
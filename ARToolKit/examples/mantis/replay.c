@@ -0,0 +1,327 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "replay.h"
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef enum {
+	REPLAY_Y4M,
+	REPLAY_PGM,
+	REPLAY_RAW
+} ReplayFormat_T;
+
+struct Replay_T {
+	char			path[256];
+	ReplayFormat_T	format;
+	int				sequence;		// Path is a printf pattern of numbered files.
+	int				first;			// Number of the first file in a sequence.
+	int				loop;
+
+	FILE			*fp;
+	long			dataStart;		// Offset of the first frame in a single file.
+	int				next;			// Number of the next file in a sequence.
+	long			index;
+
+	int				xsize, ysize;
+	int				chromaSize;		// Y4M chroma bytes per frame.
+	double			fps;
+
+	ARUint8			*grey;
+	ARUint8			*image;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static int hasSuffix(const char *path, const char *suffix)
+{
+	size_t lp = strlen(path), ls = strlen(suffix);
+	return (lp >= ls && strcmp(path + lp - ls, suffix) == 0);
+}
+
+// Read one whitespace separated PGM header token, skipping comments.
+static int pgmToken(FILE *fp, int *value)
+{
+	int c;
+
+	for (;;) {
+		c = fgetc(fp);
+		if (c == EOF) return (FALSE);
+		if (c == '#') {
+			while (c != '\n' && c != EOF) c = fgetc(fp);
+		} else if (!isspace(c)) {
+			break;
+		}
+	}
+	*value = 0;
+	while (c != EOF && isdigit(c)) {
+		*value = *value * 10 + (c - '0');
+		c = fgetc(fp);
+	}
+	return (TRUE);	// The single whitespace after the token is consumed.
+}
+
+static int pgmHeader(FILE *fp, int *xsize, int *ysize, int *maxval)
+{
+	if (fgetc(fp) != 'P' || fgetc(fp) != '5') return (FALSE);
+	if (!pgmToken(fp, xsize) || !pgmToken(fp, ysize) || !pgmToken(fp, maxval)) return (FALSE);
+	return (*xsize > 0 && *ysize > 0 && *maxval > 0 && *maxval < 65536);
+}
+
+static int y4mHeader(Replay_T *replay)
+{
+	char line[256], *tok;
+	int num, den;
+
+	if (fgets(line, sizeof(line), replay->fp) == NULL) return (FALSE);
+	if (strncmp(line, "YUV4MPEG2", 9) != 0) return (FALSE);
+
+	replay->chromaSize = -1;	// 4:2:0 unless stated otherwise.
+	for (tok = strtok(line + 9, " \n"); tok != NULL; tok = strtok(NULL, " \n")) {
+		switch (tok[0]) {
+			case 'W': replay->xsize = atoi(tok + 1); break;
+			case 'H': replay->ysize = atoi(tok + 1); break;
+			case 'F':
+				if (sscanf(tok + 1, "%d:%d", &num, &den) == 2 && den > 0) replay->fps = (double)num / den;
+				break;
+			case 'C':
+				if (strncmp(tok + 1, "444", 3) == 0) replay->chromaSize = -3;
+				else if (strncmp(tok + 1, "422", 3) == 0) replay->chromaSize = -2;
+				else if (strncmp(tok + 1, "mono", 4) == 0) replay->chromaSize = 0;
+				break;
+			default:
+				break;
+		}
+	}
+	if (replay->xsize <= 0 || replay->ysize <= 0) return (FALSE);
+
+	switch (replay->chromaSize) {
+		case -3: replay->chromaSize = 2 * replay->xsize * replay->ysize; break;
+		case -2: replay->chromaSize = 2 * ((replay->xsize + 1) / 2) * replay->ysize; break;
+		case -1: replay->chromaSize = 2 * ((replay->xsize + 1) / 2) * ((replay->ysize + 1) / 2); break;
+		default: break;
+	}
+	replay->dataStart = ftell(replay->fp);
+	return (TRUE);
+}
+
+static FILE *replayOpenFile(Replay_T *replay, int number)
+{
+	char name[512];
+
+	if (!replay->sequence) return (fopen(replay->path, "rb"));
+	sprintf(name, replay->path, number);
+	return (fopen(name, "rb"));
+}
+
+// Expand a grey frame to the ARToolKit pixel format.
+static void replayExpand(Replay_T *replay)
+{
+	ARUint8 *src = replay->grey;
+	ARUint8 *dst = replay->image;
+	int n = replay->xsize * replay->ysize;
+	int i;
+
+	for (i = 0; i < n; i++, src++) {
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
+		*dst++ = 128; *dst++ = *src;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
+		*dst++ = *src; *dst++ = 128;
+#else
+		int k;
+		for (k = 0; k < AR_PIX_SIZE_DEFAULT; k++) *dst++ = *src;
+#endif
+	}
+}
+
+// Read one PGM image into the grey buffer.
+static int replayReadPgm(Replay_T *replay)
+{
+	int xsize, ysize, maxval, i, hi, lo;
+	int n = replay->xsize * replay->ysize;
+
+	if (!pgmHeader(replay->fp, &xsize, &ysize, &maxval)) return (FALSE);
+	if (xsize != replay->xsize || ysize != replay->ysize) {
+		fprintf(stderr, "replayReadPgm(): Frame size changed to %dx%d.\n", xsize, ysize);
+		return (FALSE);
+	}
+	if (maxval < 256) {
+		if (fread(replay->grey, 1, n, replay->fp) != (size_t)n) return (FALSE);
+		if (maxval != 255) {
+			for (i = 0; i < n; i++) replay->grey[i] = (ARUint8)(replay->grey[i] * 255 / maxval);
+		}
+	} else {
+		for (i = 0; i < n; i++) {
+			hi = fgetc(replay->fp); lo = fgetc(replay->fp);
+			if (lo == EOF) return (FALSE);
+			replay->grey[i] = (ARUint8)(((hi << 8) | lo) * 255 / maxval);
+		}
+	}
+	return (TRUE);
+}
+
+static int replayReadFrame(Replay_T *replay)
+{
+	char line[256];
+	int n = replay->xsize * replay->ysize;
+
+	switch (replay->format) {
+		case REPLAY_Y4M:
+			if (fgets(line, sizeof(line), replay->fp) == NULL || strncmp(line, "FRAME", 5) != 0) return (FALSE);
+			if (fread(replay->grey, 1, n, replay->fp) != (size_t)n) return (FALSE);
+			if (fseek(replay->fp, replay->chromaSize, SEEK_CUR) != 0) return (FALSE);
+			replayExpand(replay);
+			return (TRUE);
+		case REPLAY_PGM:
+			if (!replayReadPgm(replay)) return (FALSE);
+			replayExpand(replay);
+			return (TRUE);
+		case REPLAY_RAW:
+			n *= AR_PIX_SIZE_DEFAULT;
+			return (fread(replay->image, 1, n, replay->fp) == (size_t)n);
+	}
+	return (FALSE);
+}
+
+// Position the input at its first frame.
+static int replayRewind(Replay_T *replay)
+{
+	if (replay->sequence) {
+		if (replay->fp) fclose(replay->fp);
+		replay->next = replay->first;
+		replay->fp = replayOpenFile(replay, replay->next++);
+		return (replay->fp != NULL);
+	}
+	return (fseek(replay->fp, replay->dataStart, SEEK_SET) == 0);
+}
+
+Replay_T *replayOpen(const char *path, int xsize, int ysize, int loop)
+{
+	Replay_T *replay;
+	int maxval;
+
+	if (strlen(path) >= sizeof(replay->path)) return (NULL);
+	if ((replay = (Replay_T *)calloc(1, sizeof(Replay_T))) == NULL) return (NULL);
+	strcpy(replay->path, path);
+	replay->loop = loop;
+	replay->index = -1;
+	replay->sequence = (strchr(path, '%') != NULL);
+
+	if (hasSuffix(path, ".y4m")) replay->format = REPLAY_Y4M;
+	else if (hasSuffix(path, ".raw")) replay->format = REPLAY_RAW;
+	else replay->format = REPLAY_PGM;
+
+	if (replay->format == REPLAY_Y4M && replay->sequence) {
+		fprintf(stderr, "replayOpen(): Y4M input must be a single file.\n");
+		free(replay);
+		return (NULL);
+	}
+
+	// Sequences may be numbered from 0 or from 1.
+	replay->first = 0;
+	if ((replay->fp = replayOpenFile(replay, 0)) == NULL && replay->sequence) {
+		replay->first = 1;
+		replay->fp = replayOpenFile(replay, 1);
+	}
+	if (replay->fp == NULL) {
+		fprintf(stderr, "replayOpen(): Unable to open %s.\n", path);
+		free(replay);
+		return (NULL);
+	}
+	replay->next = replay->first + 1;
+
+	switch (replay->format) {
+		case REPLAY_Y4M:
+			if (!y4mHeader(replay)) {
+				fprintf(stderr, "replayOpen(): %s is not a YUV4MPEG2 stream.\n", path);
+				replayClose(replay);
+				return (NULL);
+			}
+			break;
+		case REPLAY_PGM:
+			if (!pgmHeader(replay->fp, &replay->xsize, &replay->ysize, &maxval)) {
+				fprintf(stderr, "replayOpen(): %s is not a binary PGM image.\n", path);
+				replayClose(replay);
+				return (NULL);
+			}
+			rewind(replay->fp);
+			break;
+		case REPLAY_RAW:
+			if (xsize <= 0 || ysize <= 0) {
+				fprintf(stderr, "replayOpen(): Frame size required for raw input %s.\n", path);
+				replayClose(replay);
+				return (NULL);
+			}
+			replay->xsize = xsize;
+			replay->ysize = ysize;
+			break;
+	}
+
+	replay->grey = (ARUint8 *)malloc(replay->xsize * replay->ysize);
+	replay->image = (ARUint8 *)malloc(replay->xsize * replay->ysize * AR_PIX_SIZE_DEFAULT);
+	if (replay->grey == NULL || replay->image == NULL) {
+		replayClose(replay);
+		return (NULL);
+	}
+	return (replay);
+}
+
+void replayClose(Replay_T *replay)
+{
+	if (replay == NULL) return;
+	if (replay->fp) fclose(replay->fp);
+	free(replay->grey);
+	free(replay->image);
+	free(replay);
+}
+
+void replayInqSize(Replay_T *replay, int *xsize, int *ysize)
+{
+	*xsize = replay->xsize;
+	*ysize = replay->ysize;
+}
+
+double replayFrameRate(Replay_T *replay)
+{
+	return (replay->fps);
+}
+
+long replayFrameIndex(Replay_T *replay)
+{
+	return (replay->index);
+}
+
+ARUint8 *replayNextFrame(Replay_T *replay)
+{
+	int restarted = FALSE;
+
+	for (;;) {
+		if (replay->fp != NULL && replayReadFrame(replay)) break;
+
+		// End of the current file: go on with the next file of a sequence,
+		// or start over when looping.
+		if (replay->sequence && replay->fp != NULL) {
+			fclose(replay->fp);
+			replay->fp = replayOpenFile(replay, replay->next++);
+			if (replay->fp != NULL) continue;
+		}
+		if (!replay->loop || restarted || !replayRewind(replay)) return (NULL);
+		restarted = TRUE;
+	}
+
+	replay->index++;
+	return (replay->image);
+}
@@ -0,0 +1,48 @@
+#ifndef __replay_h__
+#define __replay_h__
+
+// ============================================================================
+//	Offline replay of recorded camera frames
+// ============================================================================
+//
+//	Supported inputs:
+//	  clip.y4m           YUV4MPEG2 stream, the luma plane is used
+//	  clip.pgm           one or more concatenated binary PGM (P5) images
+//	  clip.raw           concatenated frames in the ARToolKit pixel format,
+//	                     the frame size must be given
+//	  frames/%04d.pgm    numbered sequence of PGM or raw files, from 0 or 1
+//
+//	Grey frames are expanded to AR_DEFAULT_PIXEL_FORMAT, so the result can be
+//	passed to arDetectMarker() like a camera image.
+//
+
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Replay_T Replay_T;
+
+// xsize and ysize are required for raw input and ignored otherwise.
+// With loop set the sequence restarts at its end instead of ending.
+Replay_T *replayOpen(const char *path, int xsize, int ysize, int loop);
+void replayClose(Replay_T *replay);
+
+void replayInqSize(Replay_T *replay, int *xsize, int *ysize);
+
+// Frame rate stored in the input (Y4M only), 0 if unknown.
+double replayFrameRate(Replay_T *replay);
+
+// Decode the next frame. Returns NULL at the end of the input or on error.
+// The buffer stays valid until the next call.
+ARUint8 *replayNextFrame(Replay_T *replay);
+
+// Index of the last returned frame, counted from 0 across loops.
+long replayFrameIndex(Replay_T *replay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __replay_h__
@@ -0,0 +1,211 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "rig.h"
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+// Poses in the first camera's coordinates, summed for averaging.
+typedef struct {
+	int			count;
+	double		weight;
+	double		q[4];
+	double		p[3];
+	double		first[3][4];		// The pose itself when there is only one.
+} PoseSum_T;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static char *rigLine(char *buf, int n, FILE *fp)
+{
+	char *ret;
+
+	for (;;) {
+		if ((ret = fgets(buf, n, fp)) == NULL) return (NULL);
+		if (buf[0] != '\n' && buf[0] != '\r' && buf[0] != '#') break;	// Skip blank lines and comments.
+	}
+	buf[strcspn(buf, "\r\n")] = '\0';
+	return (ret);
+}
+
+static void rigIdentity(double m[3][4])
+{
+	int i, j;
+
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < 4; i++) m[j][i] = (i == j ? 1.0 : 0.0);
+	}
+}
+
+static int rigReadCamera(FILE *fp, RigCamera_T *camera)
+{
+	char buf[256];
+	int j;
+
+	if (rigLine(buf, sizeof(buf), fp) == NULL) return (FALSE);
+	strncpy(camera->vconf, (strcmp(buf, "-") == 0 ? "" : buf), sizeof(camera->vconf) - 1);
+	if (rigLine(buf, sizeof(buf), fp) == NULL || sscanf(buf, "%255s", camera->cparamName) != 1) return (FALSE);
+	for (j = 0; j < 3; j++) {
+		if (rigLine(buf, sizeof(buf), fp) == NULL ||
+			sscanf(buf, "%lf %lf %lf %lf", &camera->extrinsic[j][0], &camera->extrinsic[j][1], &camera->extrinsic[j][2], &camera->extrinsic[j][3]) != 4) {
+			return (FALSE);
+		}
+	}
+	return (TRUE);
+}
+
+Rig_T *rigLoad(const char *filename)
+{
+	FILE *fp;
+	Rig_T *rig;
+	char buf[256];
+	int i, n;
+
+	if ((fp = fopen(filename, "r")) == NULL) return (NULL);
+	if (rigLine(buf, sizeof(buf), fp) == NULL || sscanf(buf, "%d", &n) != 1 || n <= 0 || n > RIG_CAMERAS_MAX) {
+		fprintf(stderr, "rigLoad(): %s: Expected 1 to %d cameras.\n", filename, RIG_CAMERAS_MAX);
+		fclose(fp);
+		return (NULL);
+	}
+	if ((rig = (Rig_T *)calloc(1, sizeof(Rig_T))) == NULL) {
+		fclose(fp);
+		return (NULL);
+	}
+	for (i = 0; i < n; i++) {
+		if (!rigReadCamera(fp, &rig->cameras[i])) {
+			fprintf(stderr, "rigLoad(): %s: Camera %d is incomplete.\n", filename, i + 1);
+			fclose(fp);
+			free(rig);
+			return (NULL);
+		}
+	}
+	rig->cameraCount = n;
+	fclose(fp);
+	return (rig);
+}
+
+Rig_T *rigSingle(const char *vconf, const char *cparamName)
+{
+	Rig_T *rig;
+
+	if ((rig = (Rig_T *)calloc(1, sizeof(Rig_T))) == NULL) return (NULL);
+	rig->cameraCount = 1;
+	strncpy(rig->cameras[0].vconf, vconf, sizeof(rig->cameras[0].vconf) - 1);
+	strncpy(rig->cameras[0].cparamName, cparamName, sizeof(rig->cameras[0].cparamName) - 1);
+	rigIdentity(rig->cameras[0].extrinsic);
+	return (rig);
+}
+
+void rigFree(Rig_T *rig)
+{
+	free(rig);
+}
+
+// Rotations are averaged as quaternions in the hemisphere of the first one,
+// close enough for the small differences between calibrated cameras.
+static void poseAdd(PoseSum_T *sum, double extrinsic[3][4], double trans[3][4], double weight)
+{
+	double ref[3][4], q[4], p[3], sign;
+	int i;
+
+	arUtilMatMul(extrinsic, trans, ref);
+	if (sum->count == 0) memcpy(sum->first, ref, sizeof(sum->first));
+	arUtilMat2QuatPos(ref, q, p);
+	sign = (sum->count > 0 && q[0] * sum->q[0] + q[1] * sum->q[1] + q[2] * sum->q[2] + q[3] * sum->q[3] < 0.0 ? -1.0 : 1.0);
+	for (i = 0; i < 4; i++) sum->q[i] += sign * weight * q[i];
+	for (i = 0; i < 3; i++) sum->p[i] += weight * p[i];
+	sum->weight += weight;
+	sum->count++;
+}
+
+static void poseResult(PoseSum_T *sum, double trans[3][4])
+{
+	double len;
+	int i;
+
+	if (sum->count == 1) {
+		memcpy(trans, sum->first, sizeof(double[3][4]));
+		return;
+	}
+	len = sqrt(sum->q[0] * sum->q[0] + sum->q[1] * sum->q[1] + sum->q[2] * sum->q[2] + sum->q[3] * sum->q[3]);
+	for (i = 0; i < 4; i++) sum->q[i] /= len;
+	for (i = 0; i < 3; i++) sum->p[i] /= sum->weight;
+	arUtilQuatPos2Mat(sum->q, sum->p, trans);
+}
+
+// Multi marker or sculpture poses weighted by their fitting error. Returns
+// FALSE when no camera found it.
+static int fuseFitted(Rig_T *rig, PoseSnapshot_T **snaps, int *use, int sculpture, double trans[3][4], double *err)
+{
+	PoseSum_T sum;
+	double weight, errSum = 0.0, e;
+	int k;
+
+	memset(&sum, 0, sizeof(sum));
+	for (k = 0; k < rig->cameraCount; k++) {
+		if (!use[k] || !(sculpture ? snaps[k]->sculptureFound : snaps[k]->pattFoundMulti)) continue;
+		e = (sculpture ? snaps[k]->sculptureErr : snaps[k]->multiErr);
+		weight = 1.0 / (1.0 + e);
+		poseAdd(&sum, rig->cameras[k].extrinsic, (sculpture ? snaps[k]->sculptureTrans : snaps[k]->multiTrans), weight);
+		errSum += weight * e;
+	}
+	if (sum.count == 0) {
+		*err = -1.0;
+		return (FALSE);
+	}
+	poseResult(&sum, trans);
+	*err = errSum / sum.weight;
+	return (TRUE);
+}
+
+void rigFuse(Rig_T *rig, PoseSnapshot_T **snaps, int objectCount, PoseSnapshot_T *fused)
+{
+	int *visible = fused->visible;
+	double (*trans)[3][4] = fused->trans;
+	int use[RIG_CAMERAS_MAX];
+	double newest = 0.0;
+	PoseSum_T sum;
+	int i, k;
+
+	// Cameras that stopped delivering, e.g. unplugged, are left out.
+	for (k = 0; k < rig->cameraCount; k++) {
+		if (snaps[k] != NULL && snaps[k]->valid && snaps[k]->time > newest) newest = snaps[k]->time;
+	}
+	for (k = 0; k < rig->cameraCount; k++) {
+		use[k] = (snaps[k] != NULL && snaps[k]->valid && newest - snaps[k]->time <= RIG_MAX_AGE);
+	}
+
+	// The times stay the first camera's, they belong to the frame shown.
+	*fused = *snaps[0];
+	fused->visible = visible;
+	fused->trans = trans;
+
+	fused->pattFound = FALSE;
+	for (i = 0; i < objectCount; i++) {
+		memset(&sum, 0, sizeof(sum));
+		for (k = 0; k < rig->cameraCount; k++) {
+			if (use[k] && snaps[k]->visible[i]) poseAdd(&sum, rig->cameras[k].extrinsic, snaps[k]->trans[i], 1.0);
+		}
+		visible[i] = (sum.count > 0);
+		if (visible[i]) {
+			poseResult(&sum, trans[i]);
+			fused->pattFound = TRUE;
+		}
+	}
+
+	fused->pattFoundMulti = fuseFitted(rig, snaps, use, FALSE, fused->multiTrans, &fused->multiErr);
+	fused->sculptureFound = fuseFitted(rig, snaps, use, TRUE, fused->sculptureTrans, &fused->sculptureErr);
+}
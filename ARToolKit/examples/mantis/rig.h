@@ -0,0 +1,71 @@
+#ifndef __rig_h__
+#define __rig_h__
+
+// ============================================================================
+//	Several cameras looking at the sculpture
+// ============================================================================
+//
+//	Every camera has its own video config, camera parameters and its
+//	transformation into the coordinates of the first camera, whose image is
+//	shown. The file lists them like this:
+//
+//	    #the number of cameras, the first one is shown
+//	    2
+//
+//	    #camera: video config (- for the default), camera parameters and
+//	    #the transformation into the first camera's coordinates in mm
+//	    -
+//	    Data/camera_para.dat
+//	    1.0 0.0 0.0 0.0
+//	    0.0 1.0 0.0 0.0
+//	    0.0 0.0 1.0 0.0
+//
+//	Each camera runs its own pipeline (see pipeline.h). rigFuse() combines
+//	their latest snapshots into the first camera's view on the render
+//	thread, so a marker hidden from the first camera is still tracked when
+//	another one sees it.
+//
+
+#include <AR/ar.h>
+
+#include "pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RIG_CAMERAS_MAX		8
+#define RIG_MAX_AGE			0.1		// Seconds a snapshot may lag the newest one and still count.
+
+typedef struct {
+	char		vconf[256];
+	char		cparamName[256];
+	double		extrinsic[3][4];	// Camera to first camera coordinates.
+} RigCamera_T;
+
+typedef struct {
+	int			cameraCount;
+	RigCamera_T	cameras[RIG_CAMERAS_MAX];
+} Rig_T;
+
+// Read a camera file. Returns NULL when it cannot be read.
+Rig_T *rigLoad(const char *filename);
+
+// A single camera with an identity transformation.
+Rig_T *rigSingle(const char *vconf, const char *cparamName);
+void rigFree(Rig_T *rig);
+
+// Combine the snapshots of all cameras, NULL or invalid ones are skipped.
+// The frame, the images, the thresholds and both times are the first
+// camera's, so the pose filter and the latency histogram measure against
+// the frame on the screen. An object is visible when any camera sees it;
+// its pose, and the multi marker and sculpture poses weighted by the
+// fitting error, is the average of the cameras seeing it. fused must have
+// visible and trans arrays for objectCount objects.
+void rigFuse(Rig_T *rig, PoseSnapshot_T **snaps, int objectCount, PoseSnapshot_T *fused);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __rig_h__
@@ -0,0 +1,364 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <AR/config.h>
+#include <AR/param.h>
+#include <AR/ar.h>
+
+#include "roitrack.h"
+#include "markertable.h"
+#include "arlock.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define ROI_FULL_SCAN_INTERVAL		15		// Frames between forced full frame scans.
+#define ROI_MARGIN_FACTOR			0.5		// Window margin as a fraction of the marker size.
+#define ROI_MARGIN_MIN				16		// Minimal window margin in pixels.
+#define ROI_MAX_COVERAGE			0.5		// Above this fraction of the frame a full scan is cheaper.
+#define ROI_ALIGN					4		// Window alignment, keeps half image processing exact.
+#define ROI_BLOB_AREA_MIN			6		// Pyramid level pixels of a candidate, a marker border of 12 frame pixels.
+#define ROI_FINE_SIZE				96		// Frame pixels below which candidates are detected in the full image.
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	int			active;
+	double		vertex[4][2];		// Ideal screen coordinates of the last detection.
+	double		pos[2];
+	double		vel[2];				// Motion of pos over the last frame.
+} RoiTrack_T;
+
+typedef struct {
+	int			x0, y0, x1, y1;		// Observed image coordinates, x1 and y1 exclusive.
+	int			fine;				// Detect in the full image.
+} RoiWindow_T;
+
+struct RoiTracker_T {
+	ARParam			cparam;
+	Frontend_T		*frontend;
+	Pyramid_T		*pyramid;
+	int				enabled;
+	int				forceFull;
+	int				sinceFull;
+	int				wasFull;
+
+	RoiTrack_T		tracks[AR_PATT_NUM_MAX];	// Indexed by pattern id.
+	RoiWindow_T		windows[AR_PATT_NUM_MAX];
+	int				windowNum;
+
+	ARUint8			*crop;
+	ARMarkerInfo	*markers;
+	int				markerCap;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+RoiTracker_T *roiTrackerCreate(const ARParam *cparam)
+{
+	RoiTracker_T *roi;
+
+	if ((roi = (RoiTracker_T *)calloc(1, sizeof(RoiTracker_T))) == NULL) return (NULL);
+	roi->cparam = *cparam;
+	roi->forceFull = TRUE;
+	roi->crop = (ARUint8 *)malloc(cparam->xsize * cparam->ysize * AR_PIX_SIZE_DEFAULT);
+	if (roi->crop == NULL) {
+		free(roi);
+		return (NULL);
+	}
+	return (roi);
+}
+
+void roiTrackerDestroy(RoiTracker_T *roi)
+{
+	if (roi == NULL) return;
+	free(roi->crop);
+	free(roi->markers);
+	free(roi);
+}
+
+void roiTrackerSetEnabled(RoiTracker_T *roi, int enabled)
+{
+	roi->enabled = enabled;
+	roi->forceFull = TRUE;
+}
+
+int roiTrackerEnabled(RoiTracker_T *roi)
+{
+	return (roi->enabled);
+}
+
+void roiTrackerSetFrontend(RoiTracker_T *roi, Frontend_T *frontend)
+{
+	roi->frontend = frontend;
+}
+
+void roiTrackerSetPyramid(RoiTracker_T *roi, Pyramid_T *pyramid)
+{
+	roi->pyramid = pyramid;
+}
+
+int roiTrackerWasFullScan(RoiTracker_T *roi)
+{
+	return (roi->wasFull);
+}
+
+static int roiReserve(RoiTracker_T *roi, int count)
+{
+	ARMarkerInfo *markers;
+
+	if (count <= roi->markerCap) return (TRUE);
+	if ((markers = (ARMarkerInfo *)realloc(roi->markers, count * sizeof(ARMarkerInfo))) == NULL) return (FALSE);
+	roi->markers = markers;
+	roi->markerCap = count;
+	return (TRUE);
+}
+
+// Remember the best detection of every pattern for the next prediction.
+// Returns FALSE if a tracked pattern was not found again.
+static int roiUpdateTracks(RoiTracker_T *roi, ARMarkerInfo *marker_info, int marker_num)
+{
+	MarkerTable_T table;
+	RoiTrack_T *track;
+	int id, k, kept = TRUE;
+
+	markerTableBuild(&table, marker_info, marker_num);
+	for (id = 0; id < AR_PATT_NUM_MAX; id++) {
+		track = &roi->tracks[id];
+		if ((k = table.best[id]) == -1) {
+			if (track->active) kept = FALSE;
+			track->active = FALSE;
+			continue;
+		}
+		if (track->active) {
+			track->vel[0] = marker_info[k].pos[0] - track->pos[0];
+			track->vel[1] = marker_info[k].pos[1] - track->pos[1];
+		} else {
+			track->vel[0] = track->vel[1] = 0.0;
+		}
+		memcpy(track->vertex, marker_info[k].vertex, sizeof(track->vertex));
+		track->pos[0] = marker_info[k].pos[0];
+		track->pos[1] = marker_info[k].pos[1];
+		track->active = TRUE;
+	}
+	return (kept);
+}
+
+static int roiOverlap(const RoiWindow_T *a, const RoiWindow_T *b)
+{
+	return (a->x0 < b->x1 && b->x0 < a->x1 && a->y0 < b->y1 && b->y0 < a->y1);
+}
+
+// Add the window around a box of the observed image, aligned and clipped
+// to the frame. Boxes out of the frame are dropped.
+static void roiAddWindow(RoiTracker_T *roi, double minX, double minY, double maxX, double maxY, double margin, int fine)
+{
+	RoiWindow_T *w = &roi->windows[roi->windowNum];
+
+	w->x0 = (int)floor(minX - margin);
+	w->y0 = (int)floor(minY - margin);
+	w->x1 = (int)ceil(maxX + margin);
+	w->y1 = (int)ceil(maxY + margin);
+	w->x0 = (w->x0 < 0 ? 0 : w->x0 / ROI_ALIGN * ROI_ALIGN);
+	w->y0 = (w->y0 < 0 ? 0 : w->y0 / ROI_ALIGN * ROI_ALIGN);
+	w->x1 = (w->x1 > roi->cparam.xsize ? roi->cparam.xsize : (w->x1 + ROI_ALIGN - 1) / ROI_ALIGN * ROI_ALIGN);
+	w->y1 = (w->y1 > roi->cparam.ysize ? roi->cparam.ysize : (w->y1 + ROI_ALIGN - 1) / ROI_ALIGN * ROI_ALIGN);
+	w->fine = fine;
+	if (w->x1 - w->x0 >= 2 * ROI_ALIGN && w->y1 - w->y0 >= 2 * ROI_ALIGN) roi->windowNum++;
+}
+
+// Merge overlapping windows so no marker is detected twice. Returns the
+// covered area in pixels.
+static int roiMergeWindows(RoiTracker_T *roi)
+{
+	RoiWindow_T *w;
+	int i, j, area, merged;
+
+	do {
+		merged = FALSE;
+		for (i = 0; i < roi->windowNum; i++) {
+			for (j = i + 1; j < roi->windowNum; j++) {
+				if (!roiOverlap(&roi->windows[i], &roi->windows[j])) continue;
+				w = &roi->windows[i];
+				if (roi->windows[j].x0 < w->x0) w->x0 = roi->windows[j].x0;
+				if (roi->windows[j].y0 < w->y0) w->y0 = roi->windows[j].y0;
+				if (roi->windows[j].x1 > w->x1) w->x1 = roi->windows[j].x1;
+				if (roi->windows[j].y1 > w->y1) w->y1 = roi->windows[j].y1;
+				w->fine |= roi->windows[j].fine;
+				roi->windows[j] = roi->windows[--roi->windowNum];
+				merged = TRUE;
+				j--;
+			}
+		}
+	} while (merged);
+
+	for (i = 0, area = 0; i < roi->windowNum; i++) {
+		area += (roi->windows[i].x1 - roi->windows[i].x0) * (roi->windows[i].y1 - roi->windows[i].y0);
+	}
+	return (area);
+}
+
+// Predict a search window for every tracked pattern. Returns the covered
+// area in pixels.
+static int roiPredictWindows(RoiTracker_T *roi)
+{
+	RoiTrack_T *track;
+	double ox, oy, minX, minY, maxX, maxY, margin;
+	int id, i;
+
+	roi->windowNum = 0;
+	for (id = 0; id < AR_PATT_NUM_MAX; id++) {
+		track = &roi->tracks[id];
+		if (!track->active) continue;
+
+		// Bounding box of the last vertices in the observed image, moved
+		// by the last frame's motion.
+		minX = minY = 1e9;
+		maxX = maxY = -1e9;
+		for (i = 0; i < 4; i++) {
+			arParamIdeal2Observ(roi->cparam.dist_factor, track->vertex[i][0], track->vertex[i][1], &ox, &oy);
+			if (ox < minX) minX = ox;
+			if (ox > maxX) maxX = ox;
+			if (oy < minY) minY = oy;
+			if (oy > maxY) maxY = oy;
+		}
+		margin = ROI_MARGIN_FACTOR * ((maxX - minX) > (maxY - minY) ? (maxX - minX) : (maxY - minY));
+		if (margin < ROI_MARGIN_MIN) margin = ROI_MARGIN_MIN;
+		margin += sqrt(track->vel[0] * track->vel[0] + track->vel[1] * track->vel[1]);
+		roiAddWindow(roi, minX + track->vel[0], minY + track->vel[1], maxX + track->vel[0], maxY + track->vel[1], margin, FALSE);
+	}
+	return (roiMergeWindows(roi));
+}
+
+// Windows around the dark blobs of the pyramid for a full scan. Returns
+// FALSE when the frame has to be scanned as a whole, TRUE with no windows
+// when there is no candidate at all.
+static int roiCandidateWindows(RoiTracker_T *roi, int thresh)
+{
+	FrontendBlob_T blobs[AR_PATT_NUM_MAX];
+	const ARUint8 *level;
+	const int scale = 1 << ROI_PYRAMID_LEVEL;
+	int lxsize, lysize, num, i, area;
+
+	if (roi->pyramid == NULL || roi->frontend == NULL || arDebug) return (FALSE);
+	level = pyramidLevel(roi->pyramid, ROI_PYRAMID_LEVEL, PYRAMID_DARKEST, &lxsize, &lysize);
+	if (level == NULL || lxsize != roi->cparam.xsize / scale || lysize != roi->cparam.ysize / scale) return (FALSE);
+	// No upper area limit: on the darkest level a marker merges with the
+	// dark things around it into a blob larger than any marker. Large
+	// blobs end in the coverage limit and a full scan.
+	num = frontendBlobs(roi->frontend, level, lxsize, lysize, scale, thresh, ROI_BLOB_AREA_MIN, lxsize * lysize, blobs, AR_PATT_NUM_MAX);
+	if (num < 0 || num > AR_PATT_NUM_MAX) return (FALSE);
+
+	// The darkest level widens the blobs already, the margin is for the
+	// pixels arLabeling() leaves out at window borders.
+	roi->windowNum = 0;
+	for (i = 0; i < num; i++) {
+		roiAddWindow(roi, blobs[i].x0, blobs[i].y0, blobs[i].x1, blobs[i].y1, ROI_MARGIN_MIN,
+					 (blobs[i].x1 - blobs[i].x0 < ROI_FINE_SIZE || blobs[i].y1 - blobs[i].y0 < ROI_FINE_SIZE));
+	}
+	area = roiMergeWindows(roi);
+	return (area <= ROI_MAX_COVERAGE * roi->cparam.xsize * roi->cparam.ysize);
+}
+
+// Detect markers in one window. The window is copied into a compact image
+// and detected with a camera parameter whose principal point and distortion
+// centre are moved by the window offset, so the results only need to be
+// shifted back into full frame coordinates.
+static int roiDetectWindow(RoiTracker_T *roi, ARUint8 *image, int thresh, const RoiWindow_T *w, int *count)
+{
+	ARParam wparam;
+	ARMarkerInfo *info, *m;
+	int num, width, height, rowBytes, y, i, j;
+	double x0 = w->x0, y0 = w->y0;
+
+	width = w->x1 - w->x0;
+	height = w->y1 - w->y0;
+	rowBytes = width * AR_PIX_SIZE_DEFAULT;
+	for (y = 0; y < height; y++) {
+		memcpy(roi->crop + y * rowBytes, image + ((w->y0 + y) * roi->cparam.xsize + w->x0) * AR_PIX_SIZE_DEFAULT, rowBytes);
+	}
+
+	wparam = roi->cparam;
+	wparam.xsize = width;
+	wparam.ysize = height;
+	for (j = 0; j < 4; j++) {
+		wparam.mat[0][j] -= x0 * wparam.mat[2][j];
+		wparam.mat[1][j] -= y0 * wparam.mat[2][j];
+	}
+	wparam.dist_factor[0] -= x0;
+	wparam.dist_factor[1] -= y0;
+	arLockInstall(&wparam);
+	if (roi->frontend != NULL) frontendSetOrigin(roi->frontend, w->x0, w->y0);
+
+	if (frontendDetectLite(roi->frontend, roi->crop, thresh, &info, &num) < 0) return (FALSE);
+	if (!roiReserve(roi, *count + num)) return (FALSE);
+
+	for (i = 0; i < num; i++) {
+		m = &roi->markers[(*count)++];
+		*m = info[i];
+		m->pos[0] += x0;
+		m->pos[1] += y0;
+		for (j = 0; j < 4; j++) {
+			m->vertex[j][0] += x0;
+			m->vertex[j][1] += y0;
+			m->line[j][2] -= m->line[j][0] * x0 + m->line[j][1] * y0;
+		}
+	}
+	return (TRUE);
+}
+
+int roiTrackerDetect(RoiTracker_T *roi, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num)
+{
+	FrontendResolution_T resolution;
+	int i, count, ok, area, kept;
+
+	roi->wasFull = (!roi->enabled || roi->forceFull || arDebug || ++roi->sinceFull >= ROI_FULL_SCAN_INTERVAL);
+	if (!roi->wasFull) {
+		area = roiPredictWindows(roi);
+		if (roi->windowNum == 0 || area > ROI_MAX_COVERAGE * roi->cparam.xsize * roi->cparam.ysize) roi->wasFull = TRUE;
+	}
+
+	if (roi->wasFull && !roiCandidateWindows(roi, thresh)) {
+		if (frontendDetect(roi->frontend, image, thresh, marker_info, marker_num) < 0) return (-1);
+		if (roi->enabled) roiUpdateTracks(roi, *marker_info, *marker_num);
+		roi->forceFull = FALSE;
+		roi->sinceFull = 0;
+		return (0);
+	}
+
+	resolution = (roi->frontend != NULL ? frontendResolution(roi->frontend) : FRONTEND_RES_FULL);
+	for (i = 0, count = 0, ok = TRUE; i < roi->windowNum && ok; i++) {
+		if (roi->frontend != NULL) frontendSetResolution(roi->frontend, (roi->windows[i].fine ? FRONTEND_RES_FULL : resolution));
+		ok = roiDetectWindow(roi, image, thresh, &roi->windows[i], &count);
+	}
+	arLockInstall(&roi->cparam);	// Back to the full frame for pose estimation.
+	if (roi->frontend != NULL) {
+		frontendSetResolution(roi->frontend, resolution);
+		frontendSetOrigin(roi->frontend, 0, 0);
+	}
+	if (!ok) return (-1);
+
+	// Losing a tracked marker means it may now be anywhere in the frame.
+	kept = (!roi->enabled || roiUpdateTracks(roi, roi->markers, count));
+	if (roi->wasFull) {
+		roi->forceFull = FALSE;
+		roi->sinceFull = 0;
+	} else if (!kept) {
+		roi->forceFull = TRUE;
+	}
+
+	*marker_info = roi->markers;
+	*marker_num = count;
+	return (0);
+}
@@ -0,0 +1,65 @@
+#ifndef __roitrack_h__
+#define __roitrack_h__
+
+// ============================================================================
+//	Region of interest tracking
+// ============================================================================
+//
+//	While markers are locked, detection only runs in windows around the
+//	positions predicted from the previous frame instead of on the whole
+//	camera image. A full frame scan is still done every few frames, when a
+//	tracked marker is lost, when nothing is tracked and in threshold debug
+//	mode.
+//
+//	With a pyramid of the frame the full frame scan is also done in windows:
+//	the dark blobs of a coarse darkest level are the candidates, and only
+//	their surroundings are detected in the frame. Small candidates, far
+//	away markers, are detected in the full image whatever the front end
+//	resolution. Too many candidates or too much of the frame covered make
+//	it a plain full scan again.
+//
+//	Detections from the windows are returned in full frame coordinates, so
+//	arGetTransMat(), arGetTransMatCont() and arMultiGetTransMat() use them
+//	unchanged.
+//
+
+#include <AR/ar.h>
+#include <AR/param.h>
+
+#include "frontend.h"
+#include "pyramid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ROI_PYRAMID_LEVEL	2	// Pyramid level the candidates are found in.
+
+typedef struct RoiTracker_T RoiTracker_T;
+
+// cparam is the full frame camera parameter set with arInitCparam().
+RoiTracker_T *roiTrackerCreate(const ARParam *cparam);
+void roiTrackerDestroy(RoiTracker_T *roi);
+
+void roiTrackerSetEnabled(RoiTracker_T *roi, int enabled);
+int roiTrackerEnabled(RoiTracker_T *roi);
+
+// Detect through a front end instead of ARToolKit directly, NULL to stop.
+void roiTrackerSetFrontend(RoiTracker_T *roi, Frontend_T *frontend);
+
+// Find the full scan candidates in pyramid, NULL for plain full scans. The
+// pyramid must be built from the image of every roiTrackerDetect() call,
+// with ROI_PYRAMID_LEVEL levels at least. Needs a front end.
+void roiTrackerSetPyramid(RoiTracker_T *roi, Pyramid_T *pyramid);
+
+// Drop-in replacement for arDetectMarker(). Returns -1 on error.
+int roiTrackerDetect(RoiTracker_T *roi, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num);
+
+// Whether the last roiTrackerDetect() call scanned the full frame.
+int roiTrackerWasFullScan(RoiTracker_T *roi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __roitrack_h__
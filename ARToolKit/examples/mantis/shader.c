@@ -0,0 +1,372 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  define GL_GLEXT_PROTOTYPES
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#include <AR/config.h>
+
+#include "shader.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#ifndef GL_FRAGMENT_SHADER
+#  define GL_FRAGMENT_SHADER		0x8B30
+#  define GL_VERTEX_SHADER			0x8B31
+#  define GL_COMPILE_STATUS			0x8B81
+#  define GL_LINK_STATUS			0x8B82
+#  define GL_INFO_LOG_LENGTH		0x8B84
+#endif
+#ifndef GL_FRAMEBUFFER
+#  define GL_FRAMEBUFFER			0x8D40
+#  define GL_COLOR_ATTACHMENT0		0x8CE0
+#  define GL_FRAMEBUFFER_COMPLETE	0x8CD5
+#endif
+#ifndef GL_INVALID_INDEX
+#  define GL_INVALID_INDEX			0xFFFFFFFFu
+#endif
+#ifndef APIENTRY
+#  define APIENTRY
+#endif
+
+// Entry points from wglGetProcAddress() on Windows, the library elsewhere.
+#ifdef _WIN32
+#  define SHADER_PROC(type, name)	((type)wglGetProcAddress(#name))
+#else
+#  define SHADER_PROC(type, name)	((type)name)
+#endif
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef GLuint (APIENTRY *CreateShader_T)(GLenum type);
+typedef void (APIENTRY *ShaderSource_T)(GLuint shader, GLsizei count, const char * const *string, const GLint *length);
+typedef void (APIENTRY *CompileShader_T)(GLuint shader);
+typedef void (APIENTRY *GetShaderiv_T)(GLuint shader, GLenum pname, GLint *params);
+typedef void (APIENTRY *GetShaderInfoLog_T)(GLuint shader, GLsizei bufSize, GLsizei *length, char *infoLog);
+typedef void (APIENTRY *DeleteShader_T)(GLuint shader);
+typedef GLuint (APIENTRY *CreateProgram_T)(void);
+typedef void (APIENTRY *AttachShader_T)(GLuint program, GLuint shader);
+typedef void (APIENTRY *BindAttribLocation_T)(GLuint program, GLuint index, const char *name);
+typedef void (APIENTRY *LinkProgram_T)(GLuint program);
+typedef void (APIENTRY *GetProgramiv_T)(GLuint program, GLenum pname, GLint *params);
+typedef void (APIENTRY *GetProgramInfoLog_T)(GLuint program, GLsizei bufSize, GLsizei *length, char *infoLog);
+typedef void (APIENTRY *DeleteProgram_T)(GLuint program);
+typedef void (APIENTRY *UseProgram_T)(GLuint program);
+typedef GLint (APIENTRY *GetUniformLocation_T)(GLuint program, const char *name);
+typedef void (APIENTRY *Uniform1i_T)(GLint location, GLint v0);
+typedef void (APIENTRY *Uniform2f_T)(GLint location, GLfloat v0, GLfloat v1);
+typedef GLuint (APIENTRY *GetUniformBlockIndex_T)(GLuint program, const char *name);
+typedef void (APIENTRY *UniformBlockBinding_T)(GLuint program, GLuint index, GLuint binding);
+typedef void (APIENTRY *GenBuffers_T)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffers_T)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBuffer_T)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferData_T)(GLenum target, ptrdiff_t size, const GLvoid *data, GLenum usage);
+typedef void (APIENTRY *BufferSubData_T)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const GLvoid *data);
+typedef void (APIENTRY *BindBufferBase_T)(GLenum target, GLuint index, GLuint buffer);
+typedef void (APIENTRY *VertexAttribPointer_T)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer);
+typedef void (APIENTRY *EnableVertexAttribArray_T)(GLuint index);
+typedef void (APIENTRY *DisableVertexAttribArray_T)(GLuint index);
+typedef void (APIENTRY *GenFramebuffers_T)(GLsizei n, GLuint *framebuffers);
+typedef void (APIENTRY *BindFramebuffer_T)(GLenum target, GLuint framebuffer);
+typedef void (APIENTRY *FramebufferTexture2D_T)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRY *CheckFramebufferStatus_T)(GLenum target);
+typedef void (APIENTRY *DeleteFramebuffers_T)(GLsizei n, const GLuint *framebuffers);
+
+// ============================================================================
+//	Globals
+// ============================================================================
+
+static int							gChecked = FALSE;
+static int							gAvailable = FALSE;
+
+static CreateShader_T				gCreateShader;
+static ShaderSource_T				gShaderSource;
+static CompileShader_T				gCompileShader;
+static GetShaderiv_T				gGetShaderiv;
+static GetShaderInfoLog_T			gGetShaderInfoLog;
+static DeleteShader_T				gDeleteShader;
+static CreateProgram_T				gCreateProgram;
+static AttachShader_T				gAttachShader;
+static BindAttribLocation_T			gBindAttribLocation;
+static LinkProgram_T				gLinkProgram;
+static GetProgramiv_T				gGetProgramiv;
+static GetProgramInfoLog_T			gGetProgramInfoLog;
+static DeleteProgram_T				gDeleteProgram;
+static UseProgram_T					gUseProgram;
+static GetUniformLocation_T			gGetUniformLocation;
+static Uniform1i_T					gUniform1i;
+static Uniform2f_T					gUniform2f;
+static GetUniformBlockIndex_T		gGetUniformBlockIndex;
+static UniformBlockBinding_T		gUniformBlockBinding;
+static GenBuffers_T					gGenBuffers;
+static DeleteBuffers_T				gDeleteBuffers;
+static BindBuffer_T					gBindBuffer;
+static BufferData_T					gBufferData;
+static BufferSubData_T				gBufferSubData;
+static BindBufferBase_T				gBindBufferBase;
+static VertexAttribPointer_T		gVertexAttribPointer;
+static EnableVertexAttribArray_T	gEnableVertexAttribArray;
+static DisableVertexAttribArray_T	gDisableVertexAttribArray;
+static GenFramebuffers_T			gGenFramebuffers;
+static BindFramebuffer_T			gBindFramebuffer;
+static FramebufferTexture2D_T		gFramebufferTexture2D;
+static CheckFramebufferStatus_T		gCheckFramebufferStatus;
+static DeleteFramebuffers_T			gDeleteFramebuffers;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static int shaderLoad(void)
+{
+#ifdef __APPLE__
+	// The legacy context GLUT creates stops at OpenGL 2.1.
+	return (FALSE);
+#else
+	const char *version;
+	int major = 1, minor = 0;
+
+	if ((version = (const char *)glGetString(GL_VERSION)) != NULL) sscanf(version, "%d.%d", &major, &minor);
+	if (major < 3 || (major == 3 && minor < 1)) return (FALSE);
+
+	gCreateShader = SHADER_PROC(CreateShader_T, glCreateShader);
+	gShaderSource = SHADER_PROC(ShaderSource_T, glShaderSource);
+	gCompileShader = SHADER_PROC(CompileShader_T, glCompileShader);
+	gGetShaderiv = SHADER_PROC(GetShaderiv_T, glGetShaderiv);
+	gGetShaderInfoLog = SHADER_PROC(GetShaderInfoLog_T, glGetShaderInfoLog);
+	gDeleteShader = SHADER_PROC(DeleteShader_T, glDeleteShader);
+	gCreateProgram = SHADER_PROC(CreateProgram_T, glCreateProgram);
+	gAttachShader = SHADER_PROC(AttachShader_T, glAttachShader);
+	gBindAttribLocation = SHADER_PROC(BindAttribLocation_T, glBindAttribLocation);
+	gLinkProgram = SHADER_PROC(LinkProgram_T, glLinkProgram);
+	gGetProgramiv = SHADER_PROC(GetProgramiv_T, glGetProgramiv);
+	gGetProgramInfoLog = SHADER_PROC(GetProgramInfoLog_T, glGetProgramInfoLog);
+	gDeleteProgram = SHADER_PROC(DeleteProgram_T, glDeleteProgram);
+	gUseProgram = SHADER_PROC(UseProgram_T, glUseProgram);
+	gGetUniformLocation = SHADER_PROC(GetUniformLocation_T, glGetUniformLocation);
+	gUniform1i = SHADER_PROC(Uniform1i_T, glUniform1i);
+	gUniform2f = SHADER_PROC(Uniform2f_T, glUniform2f);
+	gGetUniformBlockIndex = SHADER_PROC(GetUniformBlockIndex_T, glGetUniformBlockIndex);
+	gUniformBlockBinding = SHADER_PROC(UniformBlockBinding_T, glUniformBlockBinding);
+	gGenBuffers = SHADER_PROC(GenBuffers_T, glGenBuffers);
+	gDeleteBuffers = SHADER_PROC(DeleteBuffers_T, glDeleteBuffers);
+	gBindBuffer = SHADER_PROC(BindBuffer_T, glBindBuffer);
+	gBufferData = SHADER_PROC(BufferData_T, glBufferData);
+	gBufferSubData = SHADER_PROC(BufferSubData_T, glBufferSubData);
+	gBindBufferBase = SHADER_PROC(BindBufferBase_T, glBindBufferBase);
+	gVertexAttribPointer = SHADER_PROC(VertexAttribPointer_T, glVertexAttribPointer);
+	gEnableVertexAttribArray = SHADER_PROC(EnableVertexAttribArray_T, glEnableVertexAttribArray);
+	gDisableVertexAttribArray = SHADER_PROC(DisableVertexAttribArray_T, glDisableVertexAttribArray);
+	gGenFramebuffers = SHADER_PROC(GenFramebuffers_T, glGenFramebuffers);
+	gBindFramebuffer = SHADER_PROC(BindFramebuffer_T, glBindFramebuffer);
+	gFramebufferTexture2D = SHADER_PROC(FramebufferTexture2D_T, glFramebufferTexture2D);
+	gCheckFramebufferStatus = SHADER_PROC(CheckFramebufferStatus_T, glCheckFramebufferStatus);
+	gDeleteFramebuffers = SHADER_PROC(DeleteFramebuffers_T, glDeleteFramebuffers);
+
+	return (gCreateShader != NULL && gShaderSource != NULL && gCompileShader != NULL && gGetShaderiv != NULL
+		&& gGetShaderInfoLog != NULL && gDeleteShader != NULL && gCreateProgram != NULL && gAttachShader != NULL
+		&& gBindAttribLocation != NULL && gLinkProgram != NULL && gGetProgramiv != NULL && gGetProgramInfoLog != NULL
+		&& gDeleteProgram != NULL && gUseProgram != NULL && gGetUniformLocation != NULL && gUniform1i != NULL
+		&& gUniform2f != NULL && gGetUniformBlockIndex != NULL && gUniformBlockBinding != NULL && gGenBuffers != NULL
+		&& gDeleteBuffers != NULL && gBindBuffer != NULL && gBufferData != NULL && gBufferSubData != NULL
+		&& gBindBufferBase != NULL && gVertexAttribPointer != NULL && gEnableVertexAttribArray != NULL
+		&& gDisableVertexAttribArray != NULL && gGenFramebuffers != NULL && gBindFramebuffer != NULL
+		&& gFramebufferTexture2D != NULL && gCheckFramebufferStatus != NULL && gDeleteFramebuffers != NULL);
+#endif
+}
+
+int shaderAvailable(void)
+{
+	if (!gChecked) {
+		gChecked = TRUE;
+		gAvailable = shaderLoad();
+		if (!gAvailable) fprintf(stderr, "shaderAvailable(): No OpenGL 3.1, the shader renderer is off.\n");
+	}
+	return (gAvailable);
+}
+
+static GLuint shaderCompile(const char *name, GLenum type, const char *source)
+{
+	GLuint shader;
+	GLint status, length;
+	char *log;
+
+	shader = gCreateShader(type);
+	gShaderSource(shader, 1, &source, NULL);
+	gCompileShader(shader);
+	gGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status) return (shader);
+
+	gGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+	if (length > 0 && (log = (char *)malloc(length)) != NULL) {
+		gGetShaderInfoLog(shader, length, NULL, log);
+		fprintf(stderr, "shaderProgram(): %s %s shader:\n%s\n", name, (type == GL_VERTEX_SHADER ? "vertex" : "fragment"), log);
+		free(log);
+	}
+	gDeleteShader(shader);
+	return (0);
+}
+
+GLuint shaderProgram(const char *name, const char *vertexSource, const char *fragmentSource, const char * const *attributes, int attributeCount)
+{
+	GLuint program, vertex, fragment;
+	GLint status, length;
+	char *log;
+	int i;
+
+	if (!shaderAvailable()) return (0);
+	if ((vertex = shaderCompile(name, GL_VERTEX_SHADER, vertexSource)) == 0) return (0);
+	if ((fragment = shaderCompile(name, GL_FRAGMENT_SHADER, fragmentSource)) == 0) {
+		gDeleteShader(vertex);
+		return (0);
+	}
+
+	program = gCreateProgram();
+	gAttachShader(program, vertex);
+	gAttachShader(program, fragment);
+	for (i = 0; i < attributeCount; i++) gBindAttribLocation(program, i, attributes[i]);
+	gLinkProgram(program);
+	gDeleteShader(vertex);
+	gDeleteShader(fragment);
+	gGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status) return (program);
+
+	gGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+	if (length > 0 && (log = (char *)malloc(length)) != NULL) {
+		gGetProgramInfoLog(program, length, NULL, log);
+		fprintf(stderr, "shaderProgram(): %s:\n%s\n", name, log);
+		free(log);
+	}
+	gDeleteProgram(program);
+	return (0);
+}
+
+void shaderDeleteProgram(GLuint program)
+{
+	if (program != 0) gDeleteProgram(program);
+}
+
+void shaderUseProgram(GLuint program)
+{
+	gUseProgram(program);
+}
+
+GLint shaderUniform(GLuint program, const char *name)
+{
+	return (gGetUniformLocation(program, name));
+}
+
+void shaderSetInt(GLint location, int value)
+{
+	gUniform1i(location, value);
+}
+
+void shaderSetVec2(GLint location, float x, float y)
+{
+	gUniform2f(location, x, y);
+}
+
+int shaderBindBlock(GLuint program, const char *name, GLuint binding)
+{
+	GLuint index = gGetUniformBlockIndex(program, name);
+
+	if (index == GL_INVALID_INDEX) {
+		fprintf(stderr, "shaderBindBlock(): No uniform block %s.\n", name);
+		return (FALSE);
+	}
+	gUniformBlockBinding(program, index, binding);
+	return (TRUE);
+}
+
+GLuint shaderBufferCreate(GLenum target, size_t size, const GLvoid *data, GLenum usage)
+{
+	GLuint buffer = 0;
+
+	gGenBuffers(1, &buffer);
+	gBindBuffer(target, buffer);
+	gBufferData(target, (ptrdiff_t)size, data, usage);
+	gBindBuffer(target, 0);
+	return (buffer);
+}
+
+// The whole buffer is replaced, so the driver may hand out new storage
+// instead of waiting for draws still reading the old one.
+void shaderBufferUpdate(GLenum target, GLuint buffer, size_t size, const GLvoid *data)
+{
+	gBindBuffer(target, buffer);
+	gBufferData(target, (ptrdiff_t)size, NULL, GL_STREAM_DRAW);
+	gBufferSubData(target, 0, (ptrdiff_t)size, data);
+	gBindBuffer(target, 0);
+}
+
+void shaderBufferDelete(GLuint buffer)
+{
+	if (buffer != 0) gDeleteBuffers(1, &buffer);
+}
+
+void shaderBufferBind(GLenum target, GLuint buffer)
+{
+	gBindBuffer(target, buffer);
+}
+
+void shaderBufferBindBlock(GLuint binding, GLuint buffer)
+{
+	gBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+void shaderAttrib(GLuint index, int size, size_t stride, size_t offset)
+{
+	gVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, (GLsizei)stride, (const GLvoid *)offset);
+	gEnableVertexAttribArray(index);
+}
+
+void shaderAttribsOff(int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) gDisableVertexAttribArray(i);
+}
+
+GLuint shaderTarget(GLuint texture)
+{
+	GLuint framebuffer = 0;
+
+	gGenFramebuffers(1, &framebuffer);
+	gBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	gFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	if (gCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "shaderTarget(): Framebuffer incomplete.\n");
+		gBindFramebuffer(GL_FRAMEBUFFER, 0);
+		gDeleteFramebuffers(1, &framebuffer);
+		return (0);
+	}
+	gBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return (framebuffer);
+}
+
+void shaderTargetBind(GLuint framebuffer)
+{
+	gBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void shaderTargetDelete(GLuint framebuffer)
+{
+	if (framebuffer != 0) gDeleteFramebuffers(1, &framebuffer);
+}
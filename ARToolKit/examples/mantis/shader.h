@@ -0,0 +1,92 @@
+#ifndef __shader_h__
+#define __shader_h__
+
+// ============================================================================
+//	GLSL programs, uniform blocks and vertex attributes
+// ============================================================================
+//
+//	The parts of OpenGL 3.1 the shader renderer of model.h and the text of
+//	textatlas.h use, on top of the 1.1 that opengl32.lib exports. They are
+//	used next to the fixed function drawing of the rest of the frame, in
+//	the compatibility context GLUT creates.
+//
+//	Must be called from the GL thread.
+//
+
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+#include <stddef.h>
+#ifdef __APPLE__
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// TRUE when the context has OpenGL 3.1 and the entry points are loaded.
+int shaderAvailable(void);
+
+// Compile and link a GLSL 1.40 program. attributes[i] is bound to vertex
+// attribute i. Returns 0 and prints the info log on errors.
+GLuint shaderProgram(const char *name, const char *vertexSource, const char *fragmentSource, const char * const *attributes, int attributeCount);
+void shaderDeleteProgram(GLuint program);
+void shaderUseProgram(GLuint program);
+
+GLint shaderUniform(GLuint program, const char *name);
+void shaderSetInt(GLint location, int value);
+void shaderSetVec2(GLint location, float x, float y);
+
+// Bind the uniform block name of program to a binding point, FALSE when
+// the program has no such block.
+int shaderBindBlock(GLuint program, const char *name, GLuint binding);
+
+// Buffer objects, target GL_ARRAY_BUFFER or GL_UNIFORM_BUFFER.
+GLuint shaderBufferCreate(GLenum target, size_t size, const GLvoid *data, GLenum usage);
+void shaderBufferUpdate(GLenum target, GLuint buffer, size_t size, const GLvoid *data);
+void shaderBufferDelete(GLuint buffer);
+void shaderBufferBind(GLenum target, GLuint buffer);
+void shaderBufferBindBlock(GLuint binding, GLuint buffer);
+
+// Float vertex attribute index read from the bound GL_ARRAY_BUFFER.
+void shaderAttrib(GLuint index, int size, size_t stride, size_t offset);
+void shaderAttribsOff(int count);
+
+// Framebuffer object rendering into the level 0 of texture, 0 on failure.
+GLuint shaderTarget(GLuint texture);
+void shaderTargetBind(GLuint framebuffer);
+void shaderTargetDelete(GLuint framebuffer);
+
+#ifndef GL_ARRAY_BUFFER
+#  define GL_ARRAY_BUFFER		0x8892
+#endif
+#ifndef GL_UNIFORM_BUFFER
+#  define GL_UNIFORM_BUFFER		0x8A11
+#endif
+#ifndef GL_STATIC_DRAW
+#  define GL_STATIC_DRAW		0x88E4
+#endif
+#ifndef GL_STREAM_DRAW
+#  define GL_STREAM_DRAW		0x88E0
+#endif
+#ifndef GL_DYNAMIC_DRAW
+#  define GL_DYNAMIC_DRAW		0x88E8
+#endif
+#ifndef GL_R8
+#  define GL_R8					0x8229
+#endif
+#ifndef GL_RED
+#  define GL_RED				0x1903
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#  define GL_CLAMP_TO_EDGE		0x812F
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __shader_h__
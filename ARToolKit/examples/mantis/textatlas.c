@@ -0,0 +1,276 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include <AR/config.h>
+
+#include "shader.h"
+#include "textatlas.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define TEXTATLAS_FONT			GLUT_BITMAP_8_BY_13
+#define TEXTATLAS_FIRST			32		// Glyphs of the printable ASCII characters.
+#define TEXTATLAS_LAST			126
+#define TEXTATLAS_CELL_X		8		// Cell of a glyph, the font is 8 pixels wide.
+#define TEXTATLAS_CELL_Y		16
+#define TEXTATLAS_DESCENT		3		// Pixels below the baseline in a cell.
+#define TEXTATLAS_COLUMNS		16
+#define TEXTATLAS_SIZE			128		// Texture, 16 x 8 cells.
+#define TEXTATLAS_SOLID			(TEXTATLAS_COLUMNS * 8 - 1)	// Filled cell for the rectangles.
+#define TEXTATLAS_QUADS			512		// Initial capacity.
+
+// ============================================================================
+//	Shaders
+// ============================================================================
+
+// Quads anchored in normalized device coordinates with offsets in pixels,
+// the anchor is moved to the pixel corner below it.
+static const char *gVertexSource =
+	"#version 140\n"
+	"uniform vec2 viewport;\n"
+	"in vec2 anchor;\n"
+	"in vec2 offset;\n"
+	"in vec2 texcoord;\n"
+	"in vec4 color;\n"
+	"out vec2 uv;\n"
+	"out vec4 tint;\n"
+	"void main() {\n"
+	"	vec2 p = floor((anchor * 0.5 + 0.5) * viewport + 0.0001) + offset;\n"
+	"	uv = texcoord;\n"
+	"	tint = color;\n"
+	"	gl_Position = vec4(p / viewport * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+static const char *gFragmentSource =
+	"#version 140\n"
+	"uniform sampler2D glyphs;\n"
+	"in vec2 uv;\n"
+	"in vec4 tint;\n"
+	"out vec4 fragColor;\n"
+	"void main() {\n"
+	"	if (texture(glyphs, uv).r < 0.5) discard;\n"
+	"	fragColor = tint;\n"
+	"}\n";
+
+static const char *gAttributes[] = { "anchor", "offset", "texcoord", "color" };
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+typedef struct {
+	GLfloat		anchor[2];
+	GLfloat		offset[2];
+	GLfloat		texcoord[2];
+	GLfloat		color[4];
+} TextVertex_T;
+
+struct TextAtlas_T {
+	GLuint			program;
+	GLint			viewportLocation;
+	GLuint			texture;
+	GLuint			buffer;
+	int				advance[TEXTATLAS_LAST + 1];
+
+	TextVertex_T	*vertices;		// Six per quad.
+	int				quadCount;
+	int				quadCap;
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+// Render the glyphs into the atlas texture with glutBitmapCharacter(), the
+// raster color only writes the red channel.
+static int textAtlasRender(TextAtlas_T *atlas)
+{
+	GLuint framebuffer;
+	int c, cell;
+
+	glGenTextures(1, &atlas->texture);
+	glBindTexture(GL_TEXTURE_2D, atlas->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, TEXTATLAS_SIZE, TEXTATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	if ((framebuffer = shaderTarget(atlas->texture)) == 0) return (FALSE);
+
+	shaderTargetBind(framebuffer);
+	glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT | GL_TRANSFORM_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_BLEND);
+	glViewport(0, 0, TEXTATLAS_SIZE, TEXTATLAS_SIZE);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, TEXTATLAS_SIZE, 0.0, TEXTATLAS_SIZE, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+	for (c = TEXTATLAS_FIRST; c <= TEXTATLAS_LAST; c++) {
+		cell = c - TEXTATLAS_FIRST;
+		glRasterPos2i((cell % TEXTATLAS_COLUMNS) * TEXTATLAS_CELL_X, (cell / TEXTATLAS_COLUMNS) * TEXTATLAS_CELL_Y + TEXTATLAS_DESCENT);
+		glutBitmapCharacter(TEXTATLAS_FONT, c);
+		atlas->advance[c] = glutBitmapWidth(TEXTATLAS_FONT, c);
+	}
+	cell = TEXTATLAS_SOLID;
+	glRecti((cell % TEXTATLAS_COLUMNS) * TEXTATLAS_CELL_X, (cell / TEXTATLAS_COLUMNS) * TEXTATLAS_CELL_Y,
+			(cell % TEXTATLAS_COLUMNS + 1) * TEXTATLAS_CELL_X, (cell / TEXTATLAS_COLUMNS + 1) * TEXTATLAS_CELL_Y);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopAttrib();
+	shaderTargetBind(0);
+	shaderTargetDelete(framebuffer);
+	return (TRUE);
+}
+
+TextAtlas_T *textAtlasCreate(void)
+{
+	TextAtlas_T *atlas;
+
+	if (!shaderAvailable()) return (NULL);
+	if ((atlas = (TextAtlas_T *)calloc(1, sizeof(TextAtlas_T))) == NULL) return (NULL);
+	if ((atlas->program = shaderProgram("text", gVertexSource, gFragmentSource, gAttributes, 4)) == 0
+		|| !textAtlasRender(atlas)) {
+		textAtlasDestroy(atlas);
+		return (NULL);
+	}
+	shaderUseProgram(atlas->program);
+	shaderSetInt(shaderUniform(atlas->program, "glyphs"), 0);
+	shaderUseProgram(0);
+	atlas->viewportLocation = shaderUniform(atlas->program, "viewport");
+	atlas->buffer = shaderBufferCreate(GL_ARRAY_BUFFER, TEXTATLAS_QUADS * 6 * sizeof(TextVertex_T), NULL, GL_STREAM_DRAW);
+	return (atlas);
+}
+
+void textAtlasDestroy(TextAtlas_T *atlas)
+{
+	if (atlas == NULL) return;
+	shaderBufferDelete(atlas->buffer);
+	if (atlas->texture != 0) glDeleteTextures(1, &atlas->texture);
+	shaderDeleteProgram(atlas->program);
+	free(atlas->vertices);
+	free(atlas);
+}
+
+// Quad from the pixel offsets x0 y0 to x1 y1 of the anchor corners,
+// textured with the atlas between st0 and st1.
+static void textAtlasQuad(TextAtlas_T *atlas, const float anchor[4], int x0, int y0, int x1, int y1, const float st0[2], const float st1[2], const float color[4])
+{
+	static const int corners[6][2] = { {0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1} };
+	TextVertex_T *grown, *v;
+	int i;
+
+	if (atlas->quadCount == atlas->quadCap) {
+		atlas->quadCap = (atlas->quadCap ? atlas->quadCap * 2 : TEXTATLAS_QUADS);
+		if ((grown = (TextVertex_T *)realloc(atlas->vertices, atlas->quadCap * 6 * sizeof(TextVertex_T))) == NULL) {
+			atlas->quadCap = atlas->quadCount;
+			return;
+		}
+		atlas->vertices = grown;
+	}
+	v = &atlas->vertices[atlas->quadCount++ * 6];
+	for (i = 0; i < 6; i++) {
+		v[i].anchor[0] = anchor[(corners[i][0] ? 2 : 0)];
+		v[i].anchor[1] = anchor[(corners[i][1] ? 3 : 1)];
+		v[i].offset[0] = (GLfloat)(corners[i][0] ? x1 : x0);
+		v[i].offset[1] = (GLfloat)(corners[i][1] ? y1 : y0);
+		v[i].texcoord[0] = (corners[i][0] ? st1[0] : st0[0]);
+		v[i].texcoord[1] = (corners[i][1] ? st1[1] : st0[1]);
+		memcpy(v[i].color, color, sizeof(v[i].color));
+	}
+}
+
+void textAtlasRect(TextAtlas_T *atlas, float x0, float y0, float x1, float y1, const float color[4])
+{
+	float anchor[4], st[2];
+
+	if (atlas == NULL) return;
+	anchor[0] = x0;
+	anchor[1] = y0;
+	anchor[2] = x1;
+	anchor[3] = y1;
+
+	// The middle of the filled cell.
+	st[0] = ((TEXTATLAS_SOLID % TEXTATLAS_COLUMNS) + 0.5f) * TEXTATLAS_CELL_X / TEXTATLAS_SIZE;
+	st[1] = ((TEXTATLAS_SOLID / TEXTATLAS_COLUMNS) + 0.5f) * TEXTATLAS_CELL_Y / TEXTATLAS_SIZE;
+	textAtlasQuad(atlas, anchor, 0, 0, 0, 0, st, st, color);
+}
+
+void textAtlasString(TextAtlas_T *atlas, float x, float y, const char *string, const float color[4])
+{
+	float anchor[4], st0[2], st1[2];
+	int pen = 0, c, cell;
+
+	if (atlas == NULL) return;
+	anchor[0] = anchor[2] = x;
+	anchor[1] = anchor[3] = y;
+	for (; *string != '\0'; string++) {
+		c = (unsigned char)*string;
+		if (c == '\n') {
+			pen = 0;
+			continue;
+		}
+		if (c < TEXTATLAS_FIRST || c > TEXTATLAS_LAST) continue;
+		if (c != ' ') {
+			cell = c - TEXTATLAS_FIRST;
+			st0[0] = (float)((cell % TEXTATLAS_COLUMNS) * TEXTATLAS_CELL_X) / TEXTATLAS_SIZE;
+			st0[1] = (float)((cell / TEXTATLAS_COLUMNS) * TEXTATLAS_CELL_Y) / TEXTATLAS_SIZE;
+			st1[0] = st0[0] + (float)TEXTATLAS_CELL_X / TEXTATLAS_SIZE;
+			st1[1] = st0[1] + (float)TEXTATLAS_CELL_Y / TEXTATLAS_SIZE;
+			textAtlasQuad(atlas, anchor, pen, -TEXTATLAS_DESCENT, pen + TEXTATLAS_CELL_X, TEXTATLAS_CELL_Y - TEXTATLAS_DESCENT, st0, st1, color);
+		}
+		pen += atlas->advance[c];
+	}
+}
+
+void textAtlasDraw(TextAtlas_T *atlas)
+{
+	GLint viewport[4];
+
+	if (atlas == NULL || atlas->quadCount == 0) return;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	shaderUseProgram(atlas->program);
+	shaderSetVec2(atlas->viewportLocation, (float)viewport[2], (float)viewport[3]);
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_BLEND);
+	glBindTexture(GL_TEXTURE_2D, atlas->texture);
+
+	shaderBufferUpdate(GL_ARRAY_BUFFER, atlas->buffer, atlas->quadCount * 6 * sizeof(TextVertex_T), atlas->vertices);
+	shaderBufferBind(GL_ARRAY_BUFFER, atlas->buffer);
+	shaderAttrib(0, 2, sizeof(TextVertex_T), offsetof(TextVertex_T, anchor));
+	shaderAttrib(1, 2, sizeof(TextVertex_T), offsetof(TextVertex_T, offset));
+	shaderAttrib(2, 2, sizeof(TextVertex_T), offsetof(TextVertex_T, texcoord));
+	shaderAttrib(3, 4, sizeof(TextVertex_T), offsetof(TextVertex_T, color));
+	glDrawArrays(GL_TRIANGLES, 0, atlas->quadCount * 6);
+
+	shaderAttribsOff(4);
+	shaderBufferBind(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+	shaderUseProgram(0);
+	atlas->quadCount = 0;
+}
@@ -0,0 +1,42 @@
+#ifndef __textatlas_h__
+#define __textatlas_h__
+
+// ============================================================================
+//	Debug text drawn from a glyph atlas
+// ============================================================================
+//
+//	The glyphs of GLUT_BITMAP_8_BY_13 are rendered once into a texture.
+//	Rectangles and strings are then queued as quads over the frame and
+//	drawn together with one draw call of a GLSL program (see shader.h),
+//	instead of a glutBitmapCharacter() per character. Positions are in
+//	normalized device coordinates like printString() uses them, glyphs
+//	are placed on whole pixels, so the text looks like the bitmap text.
+//
+//	Must be called from the GL thread.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TextAtlas_T TextAtlas_T;
+
+// NULL without OpenGL 3.1.
+TextAtlas_T *textAtlasCreate(void);
+void textAtlasDestroy(TextAtlas_T *atlas);
+
+// Queue a filled rectangle between the corners x0 y0 and x1 y1.
+void textAtlasRect(TextAtlas_T *atlas, float x0, float y0, float x1, float y1, const float color[4]);
+
+// Queue a string with its first glyph where glRasterPos2f(x, y) would put
+// it. A newline starts again at x y, like printString() did.
+void textAtlasString(TextAtlas_T *atlas, float x, float y, const char *string, const float color[4]);
+
+// Draw everything queued since the last call.
+void textAtlasDraw(TextAtlas_T *atlas);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __textatlas_h__
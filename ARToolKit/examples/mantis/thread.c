@@ -0,0 +1,180 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <process.h>
+#else
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+#include <stdlib.h>
+
+#include "thread.h"
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+struct Thread_T {
+#ifdef _WIN32
+	HANDLE			handle;
+#else
+	pthread_t		handle;
+#endif
+	ThreadFunc_T	func;
+	void			*arg;
+};
+
+struct Mutex_T {
+#ifdef _WIN32
+	CRITICAL_SECTION	section;
+#else
+	pthread_mutex_t		mutex;
+#endif
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+#ifdef _WIN32
+static unsigned __stdcall threadEntry(void *arg)
+#else
+static void *threadEntry(void *arg)
+#endif
+{
+	Thread_T *thread = (Thread_T *)arg;
+
+	thread->func(thread->arg);
+	return (0);
+}
+
+Thread_T *threadCreate(ThreadFunc_T func, void *arg)
+{
+	Thread_T *thread;
+
+	if ((thread = (Thread_T *)malloc(sizeof(Thread_T))) == NULL) return (NULL);
+	thread->func = func;
+	thread->arg = arg;
+
+#ifdef _WIN32
+	thread->handle = (HANDLE)_beginthreadex(NULL, 0, threadEntry, thread, 0, NULL);
+	if (thread->handle == 0) {
+		free(thread);
+		return (NULL);
+	}
+#else
+	if (pthread_create(&thread->handle, NULL, threadEntry, thread) != 0) {
+		free(thread);
+		return (NULL);
+	}
+#endif
+	return (thread);
+}
+
+void threadJoin(Thread_T *thread)
+{
+	if (thread == NULL) return;
+#ifdef _WIN32
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+	free(thread);
+}
+
+int threadCpuCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1);
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (count > 0 ? (int)count : 1);
+#endif
+}
+
+Mutex_T *mutexCreate(void)
+{
+	Mutex_T *mutex;
+
+	if ((mutex = (Mutex_T *)malloc(sizeof(Mutex_T))) == NULL) return (NULL);
+#ifdef _WIN32
+	InitializeCriticalSection(&mutex->section);
+#else
+	if (pthread_mutex_init(&mutex->mutex, NULL) != 0) {
+		free(mutex);
+		return (NULL);
+	}
+#endif
+	return (mutex);
+}
+
+void mutexDestroy(Mutex_T *mutex)
+{
+	if (mutex == NULL) return;
+#ifdef _WIN32
+	DeleteCriticalSection(&mutex->section);
+#else
+	pthread_mutex_destroy(&mutex->mutex);
+#endif
+	free(mutex);
+}
+
+void mutexLock(Mutex_T *mutex)
+{
+#ifdef _WIN32
+	EnterCriticalSection(&mutex->section);
+#else
+	pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+void mutexUnlock(Mutex_T *mutex)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(&mutex->section);
+#else
+	pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
+
+long atomicExchange(volatile long *target, long value)
+{
+#ifdef _WIN32
+	return (InterlockedExchange(target, value));
+#else
+	long prev = __sync_lock_test_and_set(target, value);
+	__sync_synchronize();
+	return (prev);
+#endif
+}
+
+long atomicAdd(volatile long *target, long value)
+{
+#ifdef _WIN32
+	return (InterlockedExchangeAdd(target, value) + value);
+#else
+	return (__sync_add_and_fetch(target, value));
+#endif
+}
+
+long atomicLoad(volatile long *target)
+{
+#ifdef _WIN32
+	return (InterlockedCompareExchange(target, 0, 0));
+#else
+	return (__sync_add_and_fetch(target, 0));
+#endif
+}
+
+void atomicStore(volatile long *target, long value)
+{
+	atomicExchange(target, value);
+}
@@ -0,0 +1,48 @@
+#ifndef __thread_h__
+#define __thread_h__
+
+// ============================================================================
+//	Minimal portable threads and atomics (Win32 threads or pthreads)
+// ============================================================================
+
+// Storage class of a variable with an instance per thread.
+#ifdef _MSC_VER
+#  define THREAD_LOCAL	__declspec(thread)
+#else
+#  define THREAD_LOCAL	__thread
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Thread_T Thread_T;
+typedef struct Mutex_T Mutex_T;
+typedef void (*ThreadFunc_T)(void *arg);
+
+// Start a new thread running func(arg). Returns NULL on failure.
+Thread_T *threadCreate(ThreadFunc_T func, void *arg);
+
+// Wait for the thread to finish and release it.
+void threadJoin(Thread_T *thread);
+
+// Number of logical processors, at least 1.
+int threadCpuCount(void);
+
+// Non-recursive mutual exclusion. mutexCreate() returns NULL on failure.
+Mutex_T *mutexCreate(void);
+void mutexDestroy(Mutex_T *mutex);
+void mutexLock(Mutex_T *mutex);
+void mutexUnlock(Mutex_T *mutex);
+
+// Atomic operations with full memory barrier semantics.
+long atomicExchange(volatile long *target, long value);
+long atomicAdd(volatile long *target, long value);	// Returns the new value.
+long atomicLoad(volatile long *target);
+void atomicStore(volatile long *target, long value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __thread_h__
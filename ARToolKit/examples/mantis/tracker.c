@@ -0,0 +1,221 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/ar.h>
+#include <AR/arMulti.h>
+
+#include "tracker.h"
+#include "markertable.h"
+#include "scene.h"
+#include "profile.h"
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+int trackerDetect(RoiTracker_T *roi, Frontend_T *frontend, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num)
+{
+	double t = profileBegin();
+	int ret;
+
+	if (roi != NULL) ret = roiTrackerDetect(roi, image, thresh, marker_info, marker_num);
+	else ret = frontendDetect(frontend, image, thresh, marker_info, marker_num);
+
+	profileEnd(PROFILE_DETECT, t);
+	return (ret);
+}
+
+// Pose of every matched object on its own.
+static void trackerTransEach(ObjectSet_T *objects, ARMarkerInfo *marker_info, MarkerTable_T *table)
+{
+	ObjectTrack_T *track = objects->track;
+	ObjectConfig_T *config = objects->config;
+	int i, k;
+
+	for (i = 0; i < objects->count; i++) {
+		if ((k = markerTableBest(table, track[i].id)) == -1) continue;
+		// Get the transformation between the marker and the real camera.
+		if (track[i].visible == 0) {
+			arGetTransMat(&marker_info[k], config[i].marker_center, config[i].marker_width, track[i].trans);
+		} else {
+			arGetTransMatCont(&marker_info[k], track[i].trans, config[i].marker_center, config[i].marker_width, track[i].trans);
+		}
+	}
+}
+
+// Poses of the tracked objects refined in one batch, the new ones and the
+// ones the batch fits badly from scratch like arGetTransMatCont() does.
+static void trackerTransBatch(BatchPose_T *batch, ObjectSet_T *objects, ARMarkerInfo *marker_info, MarkerTable_T *table)
+{
+	ObjectTrack_T *track = objects->track;
+	ObjectConfig_T *config = objects->config;
+	double trans[3][4], err;
+	int i, k, slot, added = 0;
+
+	batchPoseClear(batch);
+	for (i = 0; i < objects->count; i++) {
+		if ((k = markerTableBest(table, track[i].id)) == -1) continue;
+		if (track[i].visible == 0) {
+			arGetTransMat(&marker_info[k], config[i].marker_center, config[i].marker_width, track[i].trans);
+		} else if (batchPoseAdd(batch, &marker_info[k], config[i].marker_center, config[i].marker_width, track[i].trans) != -1) {
+			added++;
+		} else {
+			arGetTransMatCont(&marker_info[k], track[i].trans, config[i].marker_center, config[i].marker_width, track[i].trans);
+		}
+	}
+	batchPoseRefine(batch);
+
+	// Slots were handed out in object order until the batch was full.
+	slot = 0;
+	for (i = 0; i < objects->count && slot < added; i++) {
+		if (track[i].visible == 0 || (k = markerTableBest(table, track[i].id)) == -1) continue;
+		err = batchPoseResult(batch, slot++, track[i].trans);
+		if (err > BATCHPOSE_MAX_FIT_ERROR) {
+			if (arGetTransMat(&marker_info[k], config[i].marker_center, config[i].marker_width, trans) < err) {
+				memcpy(track[i].trans, trans, sizeof(trans));
+			}
+		}
+	}
+}
+
+int trackerUpdateObjects(BatchPose_T *batch, ObjectSet_T *objects, ARMarkerInfo *marker_info, int marker_num)
+{
+	ObjectTrack_T *track = objects->track;
+	MarkerTable_T table;
+	int i;
+	int found = 0;
+	double t;
+
+	// Highest confidence visible marker for every pattern.
+	t = profileBegin();
+	markerTableBuild(&table, marker_info, marker_num);
+	profileEnd(PROFILE_MATCH, t);
+
+	// The batch fits the ideal corners, other fitting modes stay with
+	// ARToolKit.
+	t = profileBegin();
+	if (batch != NULL && arFittingMode == AR_FITTING_TO_IDEAL) trackerTransBatch(batch, objects, marker_info, &table);
+	else trackerTransEach(objects, marker_info, &table);
+
+	// Check for object visibility.
+	for (i = 0; i < objects->count; i++) {
+		track[i].visible = (markerTableBest(&table, track[i].id) != -1);
+		if (track[i].visible) found++;
+	}
+	profileEnd(PROFILE_TRANS, t);
+	return (found);
+}
+
+double trackerUpdateMulti(ARMultiMarkerInfoT *config, ARMarkerInfo *marker_info, int marker_num)
+{
+	double err;
+	double t = profileBegin();
+
+	// Compute camera position in function of the multi-marker patterns (based on detected markers)
+	err = arMultiGetTransMat(marker_info, marker_num, config);
+	profileEnd(PROFILE_MULTI, t);
+	if (err < 0 || config->marker_num <= 0) return (-1.0);
+	return (err);
+}
+
+ARMultiMarkerInfoT *trackerCopyMulti(ARMultiMarkerInfoT *config)
+{
+	ARMultiMarkerInfoT *copy;
+
+	if ((copy = (ARMultiMarkerInfoT *)malloc(sizeof(ARMultiMarkerInfoT))) == NULL) return (NULL);
+	*copy = *config;
+	if ((copy->marker = (ARMultiEachMarkerInfoT *)malloc(config->marker_num * sizeof(ARMultiEachMarkerInfoT))) == NULL) {
+		free(copy);
+		return (NULL);
+	}
+	memcpy(copy->marker, config->marker, config->marker_num * sizeof(ARMultiEachMarkerInfoT));
+	return (copy);
+}
+
+ARMultiMarkerInfoT *trackerSculptureConfig(ObjectSet_T *objects, double scale)
+{
+	int objectCount = objects->count;
+	ARMultiMarkerInfoT *config;
+	ARMultiEachMarkerInfoT *marker;
+	double *a, corner[4][2], hw;
+	int i, j, k;
+
+	if ((config = (ARMultiMarkerInfoT *)calloc(1, sizeof(ARMultiMarkerInfoT))) == NULL) return (NULL);
+	if ((config->marker = (ARMultiEachMarkerInfoT *)calloc(objectCount > 0 ? objectCount : 1, sizeof(ARMultiEachMarkerInfoT))) == NULL) {
+		free(config);
+		return (NULL);
+	}
+	config->marker_num = objectCount;
+
+	for (i = 0; i < objectCount; i++) {
+		marker = &config->marker[i];
+		marker->patt_id = objects->track[i].id;
+		marker->width = objects->config[i].marker_width;
+		marker->center[0] = objects->config[i].marker_center[0];
+		marker->center[1] = objects->config[i].marker_center[1];
+
+		// The anchor is the sculpture in marker coordinates, in model units
+		// and column major. itrans keeps it in mm, trans is its inverse.
+		a = objects->config[i].anchor_matrix;
+		for (j = 0; j < 3; j++) {
+			for (k = 0; k < 3; k++) {
+				marker->itrans[j][k] = a[k * 4 + j];
+				marker->trans[j][k] = a[j * 4 + k];
+			}
+			marker->itrans[j][3] = a[12 + j] / scale;
+		}
+		for (j = 0; j < 3; j++) {
+			marker->trans[j][3] = -(marker->trans[j][0] * marker->itrans[0][3] + marker->trans[j][1] * marker->itrans[1][3] + marker->trans[j][2] * marker->itrans[2][3]);
+		}
+
+		// Corners in the order of arMultiReadConfigFile().
+		hw = marker->width * 0.5;
+		corner[0][0] = marker->center[0] - hw;	corner[0][1] = marker->center[1] + hw;
+		corner[1][0] = marker->center[0] + hw;	corner[1][1] = marker->center[1] + hw;
+		corner[2][0] = marker->center[0] + hw;	corner[2][1] = marker->center[1] - hw;
+		corner[3][0] = marker->center[0] - hw;	corner[3][1] = marker->center[1] - hw;
+		for (j = 0; j < 4; j++) {
+			for (k = 0; k < 3; k++) {
+				marker->pos3d[j][k] = marker->trans[k][0] * corner[j][0] + marker->trans[k][1] * corner[j][1] + marker->trans[k][3];
+			}
+		}
+	}
+	return (config);
+}
+
+double trackerUpdateSculpture(ARMultiMarkerInfoT *config, ARMarkerInfo *marker_info, int marker_num)
+{
+	double err;
+	double t = profileBegin();
+
+	err = arMultiGetTransMat(marker_info, marker_num, config);
+	profileEnd(PROFILE_SCULPTURE, t);
+	if (err < 0 || config->marker_num <= 0) return (-1.0);
+	return (err);
+}
+
+PatternBank_T *trackerPatternBank(ObjectSet_T *objects, ARMultiMarkerInfoT *multiConfig)
+{
+	Scene_T *scene = objects->scene;
+	const ARUint8 *data[2 * AR_PATT_NUM_MAX];
+	int ids[2 * AR_PATT_NUM_MAX], n = 0, i;
+
+	// The pattern values are in a compiled scene, a text one reads them.
+	if (scene == NULL || !sceneReadPatterns(scene)) return (NULL);
+	for (i = 0; i < objects->count && n < AR_PATT_NUM_MAX; i++) {
+		ids[n] = objects->track[i].id;
+		data[n++] = scene->patterns[scene->objects[i].pattern].data;
+	}
+	if (multiConfig != NULL && multiConfig->marker_num == scene->markerCount) {
+		for (i = 0; i < multiConfig->marker_num && i < AR_PATT_NUM_MAX; i++) {
+			ids[n] = multiConfig->marker[i].patt_id;
+			data[n++] = scene->patterns[scene->markers[i].pattern].data;
+		}
+	}
+	return (patternBankCreate(n, ids, data));
+}
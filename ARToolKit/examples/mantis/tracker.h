@@ -0,0 +1,62 @@
+#ifndef __tracker_h__
+#define __tracker_h__
+
+// ============================================================================
+//	Marker detection and pose estimation stages
+// ============================================================================
+//
+//	The per-frame hot path shared by the pipeline thread and the headless
+//	benchmark, split into stages so each one can be timed on its own.
+//
+
+#include <AR/ar.h>
+#include <AR/arMulti.h>
+
+#include "object.h"
+#include "roitrack.h"
+#include "frontend.h"
+#include "batchpose.h"
+#include "patternbank.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Detect the markers in a camera frame, in the tracked regions only when
+// roi is not NULL and enabled. Without roi the frame goes through frontend,
+// which may be NULL for arDetectMarker(). Returns -1 on error.
+int trackerDetect(RoiTracker_T *roi, Frontend_T *frontend, ARUint8 *image, int thresh, ARMarkerInfo **marker_info, int *marker_num);
+
+// Match the detections to the objects and update their tracking state.
+// With batch the poses of the objects tracked from the previous frame are
+// refined together (see batchpose.h), NULL for one arGetTransMatCont() per
+// object. Returns the number of visible objects.
+int trackerUpdateObjects(BatchPose_T *batch, ObjectSet_T *objects, ARMarkerInfo *marker_info, int marker_num);
+
+// Update the multi marker transformation. Returns the fitting error, or a
+// negative value when the multi marker was not found.
+double trackerUpdateMulti(ARMultiMarkerInfoT *config, ARMarkerInfo *marker_info, int marker_num);
+
+// Copy of a multi marker config with the same pattern ids, as tracking
+// state for another camera. Free with arMultiFreeConfig().
+ARMultiMarkerInfoT *trackerCopyMulti(ARMultiMarkerInfoT *config);
+
+// Multi marker config of the whole sculpture: every object's marker placed
+// by the inverse of its anchor (see object.h), so arMultiGetTransMat() fits
+// the model pose to the corners of all visible markers at once. scale is
+// model units per mm. Free with arMultiFreeConfig().
+ARMultiMarkerInfoT *trackerSculptureConfig(ObjectSet_T *objects, double scale);
+
+// Sculpture pose from the detections, same as trackerUpdateMulti().
+double trackerUpdateSculpture(ARMultiMarkerInfoT *config, ARMarkerInfo *marker_info, int marker_num);
+
+// Pattern bank of the objects and the multi marker config, both loaded
+// from the objects' scene (see sceneMultiConfig()), with the pattern ids
+// they got from arLoadPatt(). NULL on error.
+PatternBank_T *trackerPatternBank(ObjectSet_T *objects, ARMultiMarkerInfoT *multiConfig);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __tracker_h__
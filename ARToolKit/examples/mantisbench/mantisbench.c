@@ -0,0 +1,470 @@
+// ============================================================================
+//	Headless detection benchmark for the Mantis pipeline
+// ============================================================================
+//
+//	Runs the mantis detection stages over a recorded sequence without a
+//	camera or a window and reports per-stage latency percentiles and the
+//	achieved frame rate. Run it from the bin directory like the apps:
+//
+//	    MantisBench.exe [options] Data/clip.y4m
+//
+
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/param.h>
+#include <AR/ar.h>
+#include <AR/arMulti.h>
+
+#include "object.h"
+#include "scene.h"
+#include "replay.h"
+#include "tracker.h"
+#include "batchpose.h"
+#include "roitrack.h"
+#include "pyramid.h"
+#include "frontend.h"
+#include "autothresh.h"
+#include "hrtimer.h"
+#include "arlock.h"
+#include "thread.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define MODEL_SCALE		4.0		// Model units per mm of the anchors, VIEW_SCALEFACTOR_4 of mantis.
+
+enum {
+	STAGE_GRAB,
+	STAGE_THRESHOLD,
+	STAGE_PYRAMID,
+	STAGE_DETECT,
+	STAGE_OBJECTS,
+	STAGE_MULTI,
+	STAGE_SCULPTURE,
+	STAGE_TOTAL,
+	STAGE_COUNT
+};
+
+static const char *stageNames[STAGE_COUNT] = {
+	"grab", "threshold", "pyramid", "arDetectMarker", "marker poses", "arMultiGetTransMat", "sculpture pose", "total"
+};
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+// Second camera for the -D check. A second front end detects the frame on
+// a thread while the benchmark detects it, and compares its markers with
+// the ones it found alone.
+typedef struct {
+	Frontend_T		*frontend;
+	const ARParam	*cparam;
+	ARUint8			*image;
+	int				thresh;
+	ARMarkerInfo	reference[AR_SQUARE_MAX];
+	int				referenceNum;
+
+	volatile long	run;			// The benchmark is detecting image.
+	volatile long	active;			// The thread may be reading image.
+	volatile long	quit;
+	volatile long	runs;
+	volatile long	mismatches;
+	Thread_T		*thread;
+} Check_T;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options] <sequence>\n", name);
+	printf("   -o file     object data or a compiled scene (default Data/object_data_mantis)\n");
+	printf("   -m file     multi marker config, not used with a compiled scene (default Data/multi/marker_mantis.dat)\n");
+	printf("   -c file     camera parameters (default Data/camera_para.dat)\n");
+	printf("   -a mode     threshold selection: manual, adaptive, otsu (default adaptive)\n");
+	printf("   -t n        manual threshold (default 100)\n");
+	printf("   -b n        bias of the automatic thresholds (default 0)\n");
+	printf("   -r          region of interest tracking\n");
+	printf("   -P          full scans only around the dark blobs of an image pyramid\n");
+	printf("   -p n        batch pose refinement on up to n threads, 0 for one marker at a time (default 1)\n");
+	printf("   -f mode     thresholding and labeling: artoolkit, scalar, sse2, avx2 (default fastest)\n");
+	printf("   -R res      detection resolution: full, half, hybrid (default full)\n");
+	printf("   -M mode     template matching: color, bw, color-pca, bw-pca (default color)\n");
+	printf("   -k          ARToolKit's pattern matching instead of the pattern bank\n");
+	printf("   -V          compare the front end and the pyramid with the scalar code every frame\n");
+	printf("   -D res      detect every frame also on a second thread with a front end at res, as a second camera,\n");
+	printf("               and compare with detecting alone\n");
+	printf("   -s WxH      frame size of raw input\n");
+	printf("   -n n        stop after n frames\n");
+	printf("   -w n        warm-up frames left out of the statistics (default 5)\n");
+	printf("The sequence is a .y4m, .pgm or .raw file or a numbered pattern like frames/%%04d.pgm.\n");
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+	double da = *(const double *)a, db = *(const double *)b;
+	return ((da > db) - (da < db));
+}
+
+static double percentile(const double *sorted, int n, double p)
+{
+	int i = (int)(p * (n - 1) + 0.5);
+	return (sorted[i]);
+}
+
+static int sameMarkers(const ARMarkerInfo *a, const ARMarkerInfo *b, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (a[i].area != b[i].area || a[i].id != b[i].id || a[i].dir != b[i].dir ||
+			memcmp(a[i].pos, b[i].pos, sizeof(a[i].pos)) != 0 || memcmp(a[i].vertex, b[i].vertex, sizeof(a[i].vertex)) != 0) return (FALSE);
+	}
+	return (TRUE);
+}
+
+// Markers of the check's front end, detected with the lock held.
+static int checkDetect(Check_T *check, ARMarkerInfo **marker_info, int *marker_num)
+{
+	int ret;
+
+	arLock(check->cparam);
+	ret = frontendDetectLite(check->frontend, check->image, check->thresh, marker_info, marker_num);
+	arUnlock();
+	return (ret);
+}
+
+static void checkWorker(void *arg)
+{
+	Check_T *check = (Check_T *)arg;
+	ARMarkerInfo *marker_info;
+	int marker_num;
+
+	for (;;) {
+		atomicStore(&check->active, TRUE);
+		if (atomicLoad(&check->quit)) break;
+		if (!atomicLoad(&check->run)) {
+			atomicStore(&check->active, FALSE);
+			arUtilSleep(0);
+			continue;
+		}
+		atomicAdd(&check->runs, 1);
+		if (checkDetect(check, &marker_info, &marker_num) < 0 || marker_num != check->referenceNum ||
+			!sameMarkers(marker_info, check->reference, marker_num)) atomicAdd(&check->mismatches, 1);
+	}
+	atomicStore(&check->active, FALSE);
+}
+
+// The reference markers of a frame, while the thread waits.
+static int checkPrepare(Check_T *check, ARUint8 *image, int thresh)
+{
+	ARMarkerInfo *marker_info;
+	int marker_num;
+
+	check->image = image;
+	check->thresh = thresh;
+	if (checkDetect(check, &marker_info, &marker_num) < 0) return (FALSE);
+	if (marker_num > AR_SQUARE_MAX) marker_num = AR_SQUARE_MAX;
+	memcpy(check->reference, marker_info, marker_num * sizeof(ARMarkerInfo));
+	check->referenceNum = marker_num;
+	return (TRUE);
+}
+
+// Stop detecting and wait until the thread lets go of the image.
+static void checkFinish(Check_T *check)
+{
+	atomicStore(&check->run, FALSE);
+	while (atomicLoad(&check->active)) arUtilSleep(0);
+}
+
+static void report(double *samples[STAGE_COUNT], int n)
+{
+	int s, i;
+	double sum;
+
+	printf("%-22s %9s %9s %9s %9s %9s %9s\n", "stage [ms]", "min", "mean", "p50", "p90", "p99", "max");
+	for (s = 0; s < STAGE_COUNT; s++) {
+		qsort(samples[s], n, sizeof(double), compareDouble);
+		for (i = 0, sum = 0.0; i < n; i++) sum += samples[s][i];
+		printf("%-22s %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", stageNames[s],
+			samples[s][0] * 1000.0, sum / n * 1000.0,
+			percentile(samples[s], n, 0.50) * 1000.0, percentile(samples[s], n, 0.90) * 1000.0,
+			percentile(samples[s], n, 0.99) * 1000.0, samples[s][n - 1] * 1000.0);
+		if (s == STAGE_TOTAL) printf("\nThroughput: %.1f frames/s over %d frames\n", n / sum, n);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	char			*objectDataFilename = "Data/object_data_mantis";
+	char			*multiDataFilename = "Data/multi/marker_mantis.dat";
+	char			*cparamName = "Data/camera_para.dat";
+	char			*sequence = NULL;
+	int				thresh = 100, xsize = 0, ysize = 0, maxFrames = -1, warmup = 5, roiTracking = FALSE, verify = FALSE, bias = 0, batchThreads = 1;
+	int				usePatternBank = TRUE, usePyramid = FALSE;
+	const char		*matchingModes[4] = {"color", "bw", "color-pca", "bw-pca"};
+
+	Replay_T		*replay;
+	ARParam			wparam, cparam;
+	ObjectSet_T		*objects;
+	ARMultiMarkerInfoT *multiConfig;
+	ARMultiMarkerInfoT *sculpture;
+	RoiTracker_T	*roi = NULL;
+	Pyramid_T		*pyramid = NULL;
+	int				pyramidMismatches = 0, pyramidFrames = 0;
+	BatchPose_T		*batch = NULL;
+	PatternBank_T	*bank = NULL;
+	int				fullScans = 0;
+	Frontend_T		*frontend;
+	FrontendMode_T	mode = frontendBestMode();
+	FrontendResolution_T resolution = FRONTEND_RES_FULL;
+	int				mismatches = 0, mismatchFrames = 0, m;
+	AutoThresh_T	*autoThresh;
+	AutoThreshMode_T thresholdMode = AUTOTHRESH_ADAPTIVE;
+	const ThresholdMap_T *map;
+	int				frameThresh, found, foundFrames = 0;
+	Check_T			check;
+	int				checkResolution = -1;
+
+	ARUint8			*image;
+	ARMarkerInfo	*marker_info;
+	int				marker_num;
+	double			*samples[STAGE_COUNT];
+	double			t[STAGE_COUNT + 1];
+	int				capacity = 1024, n = 0, frame, i, s;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) objectDataFilename = argv[++i];
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) multiDataFilename = argv[++i];
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) cparamName = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) thresh = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-r") == 0) roiTracking = TRUE;
+		else if (strcmp(argv[i], "-P") == 0) usePyramid = TRUE;
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) batchThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-V") == 0) verify = TRUE;
+		else if (strcmp(argv[i], "-k") == 0) usePatternBank = FALSE;
+		else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+			for (m = 0; m < 4 && strcmp(argv[i + 1], matchingModes[m]) != 0; m++);
+			if (m == 4) {
+				usage(argv[0]);
+				return (1);
+			}
+			arTemplateMatchingMode = (m % 2 == 0 ? AR_TEMPLATE_MATCHING_COLOR : AR_TEMPLATE_MATCHING_BW);
+			arMatchingPCAMode = (m >= 2 ? AR_MATCHING_WITH_PCA : AR_MATCHING_WITHOUT_PCA);
+			i++;
+		}
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) bias = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			for (m = 0; m < AUTOTHRESH_MODE_COUNT && strcmp(argv[i + 1], autoThreshModeName((AutoThreshMode_T)m)) != 0; m++);
+			if (m == AUTOTHRESH_MODE_COUNT) {
+				usage(argv[0]);
+				return (1);
+			}
+			thresholdMode = (AutoThreshMode_T)m;
+			i++;
+		}
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			for (m = 0; m < FRONTEND_MODE_COUNT && strcmp(argv[i + 1], frontendModeName((FrontendMode_T)m)) != 0; m++);
+			if (m == FRONTEND_MODE_COUNT || !frontendModeAvailable((FrontendMode_T)m)) {
+				fprintf(stderr, "main(): Front end %s is not available.\n", argv[i + 1]);
+				return (1);
+			}
+			mode = (FrontendMode_T)m;
+			i++;
+		}
+		else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+			for (m = 0; m < FRONTEND_RES_COUNT && strcmp(argv[i + 1], frontendResolutionName((FrontendResolution_T)m)) != 0; m++);
+			if (m == FRONTEND_RES_COUNT) {
+				usage(argv[0]);
+				return (1);
+			}
+			resolution = (FrontendResolution_T)m;
+			i++;
+		}
+		else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+			for (m = 0; m < FRONTEND_RES_COUNT && strcmp(argv[i + 1], frontendResolutionName((FrontendResolution_T)m)) != 0; m++);
+			if (m == FRONTEND_RES_COUNT) {
+				usage(argv[0]);
+				return (1);
+			}
+			checkResolution = m;
+			i++;
+		}
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &xsize, &ysize);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) maxFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+		else if (argv[i][0] != '-' && sequence == NULL) sequence = argv[i];
+		else {
+			usage(argv[0]);
+			return (1);
+		}
+	}
+	if (sequence == NULL) {
+		usage(argv[0]);
+		return (1);
+	}
+
+	if ((replay = replayOpen(sequence, xsize, ysize, FALSE)) == NULL) return (1);
+	replayInqSize(replay, &xsize, &ysize);
+	printf("Sequence %s, frame size (x,y) = (%d,%d)\n", sequence, xsize, ysize);
+
+	if (arParamLoad(cparamName, 1, &wparam) < 0) {
+		fprintf(stderr, "main(): Error loading parameter file %s for camera.\n", cparamName);
+		return (1);
+	}
+	arParamChangeSize(&wparam, xsize, ysize, &cparam);
+	arLockInstall(&cparam);
+
+	if ((objects = objectLoadEnd(objectLoadBegin(sceneOpen(objectDataFilename, multiDataFilename), FALSE), NULL)) == NULL) {
+		fprintf(stderr, "main(): Unable to read object data %s.\n", objectDataFilename);
+		return (1);
+	}
+	if ((multiConfig = sceneMultiConfig(objects->scene)) == NULL) {
+		fprintf(stderr, "main(): sceneMultiConfig returned error !!\n");
+		return (1);
+	}
+	if ((sculpture = trackerSculptureConfig(objects, MODEL_SCALE)) == NULL) return (1);
+
+	if ((frontend = frontendCreate(xsize, ysize)) == NULL) return (1);
+	frontendSetMode(frontend, mode);
+	frontendSetResolution(frontend, resolution);
+	printf("Thresholding and labeling: %s, %s resolution\n", frontendModeName(mode), frontendResolutionName(resolution));
+	if (usePatternBank) {
+		if ((bank = trackerPatternBank(objects, multiConfig)) == NULL) return (1);
+		frontendSetPatternBank(frontend, bank);
+	}
+	printf("Template matching: %s%s, %s\n", (arTemplateMatchingMode == AR_TEMPLATE_MATCHING_COLOR ? "color" : "BW"),
+		   (arMatchingPCAMode == AR_MATCHING_WITH_PCA ? " with PCA" : ""), (bank != NULL ? "pattern bank" : "ARToolKit"));
+	if ((autoThresh = autoThreshCreate(xsize, ysize)) == NULL) return (1);
+	autoThreshSetMode(autoThresh, thresholdMode);
+	autoThreshSetManual(autoThresh, thresh);
+	autoThreshSetBias(autoThresh, bias);
+	printf("Threshold selection: %s\n", autoThreshModeName(thresholdMode));
+	if (roiTracking || usePyramid) {
+		if ((roi = roiTrackerCreate(&cparam)) == NULL) return (1);
+		roiTrackerSetEnabled(roi, roiTracking);
+		roiTrackerSetFrontend(roi, frontend);
+	}
+	if (usePyramid) {
+		if ((pyramid = pyramidCreate(xsize, ysize, ROI_PYRAMID_LEVEL)) == NULL) {
+			fprintf(stderr, "main(): No pyramid for this pixel format.\n");
+			return (1);
+		}
+		roiTrackerSetPyramid(roi, pyramid);
+		printf("Pyramid candidate search: level %d\n", ROI_PYRAMID_LEVEL);
+	}
+
+	memset(&check, 0, sizeof(check));
+	if (checkResolution >= 0) {
+		if (!arLockInit() || (check.frontend = frontendCreate(xsize, ysize)) == NULL) return (1);
+		frontendSetMode(check.frontend, mode);
+		frontendSetResolution(check.frontend, (FrontendResolution_T)checkResolution);
+		frontendSetPatternBank(check.frontend, bank);
+		check.cparam = &cparam;
+		if ((check.thread = threadCreate(checkWorker, &check)) == NULL) {
+			fprintf(stderr, "main(): Unable to start the check thread.\n");
+			return (1);
+		}
+		printf("Second camera check: %s resolution\n", frontendResolutionName((FrontendResolution_T)checkResolution));
+	}
+
+	if (batchThreads > 0) {
+		if ((batch = batchPoseCreate(objects->count, &cparam)) == NULL) return (1);
+		batchPoseSetThreads(batch, batchThreads);
+		printf("Batch pose refinement: up to %d threads\n", batchThreads);
+	}
+
+	for (s = 0; s < STAGE_COUNT; s++) {
+		if ((samples[s] = (double *)malloc(capacity * sizeof(double))) == NULL) return (1);
+	}
+
+	for (frame = 0; maxFrames < 0 || frame < maxFrames; frame++) {
+		t[0] = hrtimerNow();
+		if ((image = replayNextFrame(replay)) == NULL) break;
+		t[1] = hrtimerNow();
+		frameThresh = autoThreshUpdate(autoThresh, image, &map);
+		frontendSetThresholdMap(frontend, map);
+		t[2] = hrtimerNow();
+		if (pyramid != NULL) pyramidBuild(pyramid, image, xsize, ysize);
+		if (check.thread != NULL) {
+			if (!checkPrepare(&check, image, frameThresh)) return (1);
+			atomicStore(&check.run, TRUE);
+		}
+		t[3] = hrtimerNow();
+		arLock(&cparam);
+		if (trackerDetect(roi, frontend, image, frameThresh, &marker_info, &marker_num) < 0) {
+			fprintf(stderr, "main(): arDetectMarker returned error.\n");
+			return (1);
+		}
+		arUnlock();
+		t[4] = hrtimerNow();
+		if (check.thread != NULL) checkFinish(&check);
+		if (roiTracking && frame >= warmup && roiTrackerWasFullScan(roi)) fullScans++;
+		found = (trackerUpdateObjects(batch, objects, marker_info, marker_num) > 0);
+		t[5] = hrtimerNow();
+		if (trackerUpdateMulti(multiConfig, marker_info, marker_num) >= 0) found = TRUE;
+		t[6] = hrtimerNow();
+		if (trackerUpdateSculpture(sculpture, marker_info, marker_num) >= 0) found = TRUE;
+		t[7] = hrtimerNow();
+		autoThreshFeedback(autoThresh, found);
+		if (found && frame >= warmup) foundFrames++;
+
+		// Outside the measured stages.
+		if (verify && (m = frontendVerify(frontend, image, frameThresh)) > 0) {
+			mismatches += m;
+			mismatchFrames++;
+		}
+		if (verify && pyramid != NULL && (m = pyramidVerify(pyramid, image, xsize, ysize)) > 0) {
+			pyramidMismatches += m;
+			pyramidFrames++;
+		}
+
+		if (frame < warmup) continue;
+		if (n == capacity) {
+			capacity *= 2;
+			for (s = 0; s < STAGE_COUNT; s++) {
+				if ((samples[s] = (double *)realloc(samples[s], capacity * sizeof(double))) == NULL) return (1);
+			}
+		}
+		for (s = 0; s < STAGE_TOTAL; s++) samples[s][n] = t[s + 1] - t[s];
+		samples[STAGE_TOTAL][n] = t[STAGE_TOTAL] - t[0];
+		n++;
+	}
+
+	if (n == 0) {
+		fprintf(stderr, "main(): No frames measured (%d read, %d warm-up).\n", frame, warmup);
+		return (1);
+	}
+	report(samples, n);
+	printf("Frames with a marker: %d of %d\n", foundFrames, n);
+	if (roiTracking) printf("ROI tracking: %d of %d frames scanned in full\n", fullScans, n);
+	if (verify) printf("Front end check: %d mismatches in %d of %d frames\n", mismatches, mismatchFrames, frame);
+	if (verify && pyramid != NULL) printf("Pyramid check: %d differing pixels in %d of %d frames\n", pyramidMismatches, pyramidFrames, frame);
+	if (check.thread != NULL) {
+		atomicStore(&check.quit, TRUE);
+		threadJoin(check.thread);
+		printf("Second camera check: %ld mismatches in %ld detections\n", check.mismatches, check.runs);
+		frontendDestroy(check.frontend);
+		arLockFinal();
+	}
+
+	for (s = 0; s < STAGE_COUNT; s++) free(samples[s]);
+	roiTrackerDestroy(roi);
+	pyramidDestroy(pyramid);
+	batchPoseDestroy(batch);
+	frontendDestroy(frontend);
+	patternBankDestroy(bank);
+	autoThreshDestroy(autoThresh);
+	replayClose(replay);
+	objectFree(objects);
+	return (0);
+}
@@ -0,0 +1,721 @@
+// ============================================================================
+//	Detection regression suite for the Mantis pipeline
+// ============================================================================
+//
+//	Renders the markers of an object file and the multi marker at known
+//	poses (see synth.h), runs the mantis detection and pose stages over the
+//	frames and compares the poses with the truth, for every combination of
+//	threshold selection, detection resolution and template matching. The
+//	frames come from a fixed seed, every run sees the same pixels, so the
+//	results only change when the detection does. Run it from the bin
+//	directory like the apps:
+//
+//	    MantisRegress.exe -G Data/regress.txt     record the results
+//	    MantisRegress.exe -g Data/regress.txt     check against them
+//
+//	The check fails when a configuration finds fewer markers, more false
+//	ones or poses further from the truth than recorded. The frame rates are
+//	printed only, they depend on the machine.
+//
+
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <AR/config.h>
+#include <AR/param.h>
+#include <AR/ar.h>
+#include <AR/arMulti.h>
+
+#include "object.h"
+#include "scene.h"
+#include "tracker.h"
+#include "batchpose.h"
+#include "roitrack.h"
+#include "pyramid.h"
+#include "frontend.h"
+#include "autothresh.h"
+#include "hrtimer.h"
+#include "arlock.h"
+#include "synth.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#define LAYOUT_MAX			(OBJECT_MAX + 1)	// Every object and the multi marker.
+#define MARKER_PIXELS_MIN	32.0				// Frame width of a marker's black square.
+#define MARKER_PIXELS_MAX	200.0
+#define TILT_MAX			55.0				// Degrees away from facing the camera.
+#define GAIN_MIN			0.6
+#define GAIN_MAX			1.1
+#define FRAME_MARGIN		8.0					// Pixels between the paper and the frame edge.
+#define POSE_TRIES			100
+#define CACHE_MAX			(256 * 1024 * 1024)	// Bytes of frames rendered once for all configurations.
+#define MATCHING_COUNT		4
+#define REGRESS_DEG2RAD		(3.14159265358979323846 / 180.0)
+
+static const char *matchingNames[MATCHING_COUNT] = {"color", "bw", "color-pca", "bw-pca"};
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+// Markers shown together, their trans is the marker in layout coordinates.
+typedef struct {
+	const char		*name;
+	int				object;			// Into the objects, -1 for the multi marker.
+	int				count;
+	SynthMarker_T	*markers;
+	double			width;			// Of the first marker, sets the distance.
+	double			radius;			// Of all paper around the layout origin.
+} Layout_T;
+
+typedef struct {
+	double			x, y;			// Frame position of the layout origin.
+	double			size;			// Frame width of the first marker.
+	double			axis, tilt, spin;	// Tilt around an axis in the image plane, then spin on the marker, degrees.
+	double			gain;
+} PoseParams_T;
+
+typedef struct {
+	int				layout;
+	double			pose[3][4];		// Layout to camera, the truth.
+	double			gain;
+} Frame_T;
+
+typedef struct {
+	char			name[64];
+	int				targets;		// Frames.
+	int				found;			// Frames the layout was found in.
+	int				falsePositives;	// Objects found that were not in the frame.
+	double			*transErr;		// mm, per found frame.
+	double			*rotErr;		// Degrees.
+	double			time;			// Seconds of detection and poses.
+} Result_T;
+
+typedef struct {
+	int				found, falsePositives;
+	double			transMean, transP90, transMax, rotMean, rotP90, rotMax;
+} Summary_T;
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options]\n", name);
+	printf("   -o file     object data or a compiled scene (default Data/object_data_mantis)\n");
+	printf("   -m file     multi marker config, not used with a compiled scene (default Data/multi/marker_mantis.dat)\n");
+	printf("   -c file     camera parameters (default Data/camera_para.dat)\n");
+	printf("   -s WxH      frame size (default that of the camera parameters)\n");
+	printf("   -n n        rounds over all objects and the multi marker (default 2)\n");
+	printf("   -l n        frames per object in a round (default 10)\n");
+	printf("   -S n        seed of the poses and the noise (default 1)\n");
+	printf("   -N sigma    pixel noise (default 3)\n");
+	printf("   -B n        3x3 blur passes (default 1)\n");
+	printf("   -a mode     only this threshold selection: manual, adaptive, otsu\n");
+	printf("   -R res      only this detection resolution: full, half, hybrid\n");
+	printf("   -M mode     only this template matching: color, bw, color-pca, bw-pca\n");
+	printf("   -t n        manual threshold (default 100)\n");
+	printf("   -r          region of interest tracking\n");
+	printf("   -P          full scans only around the dark blobs of an image pyramid\n");
+	printf("   -p n        batch pose refinement on up to n threads, 0 for one marker at a time (default 1)\n");
+	printf("   -f mode     thresholding and labeling: artoolkit, scalar, sse2, avx2 (default fastest)\n");
+	printf("   -k          ARToolKit's pattern matching instead of the pattern bank\n");
+	printf("   -d file     write the frames as a raw sequence for MantisBench.exe and replay:\n");
+	printf("   -G file     write the results as the golden ones\n");
+	printf("   -g file     compare the results with golden ones, exit code 2 on a regression\n");
+	printf("   -T frac     tolerance of the pose errors against the golden ones (default 0.05)\n");
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+	double da = *(const double *)a, db = *(const double *)b;
+	return ((da > db) - (da < db));
+}
+
+static void matMul3(double a[3][3], double b[3][3], double d[3][3])
+{
+	int i, j;
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) d[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+	}
+}
+
+// Layout to camera for the parameters. The rotation faces the marker to
+// the camera (its Z towards it, Y up in the frame), spins it and tilts it.
+static void poseFromParams(const ARParam *cparam, const Layout_T *layout, const PoseParams_T *p, double pose[3][4])
+{
+	double facing[3][3], tilt[3][3], r[3][3];
+	double a, c, s, ax, ay, ix, iy, z;
+	int i, j;
+
+	a = p->spin * REGRESS_DEG2RAD;
+	c = cos(a); s = sin(a);
+	facing[0][0] = c;  facing[0][1] = -s; facing[0][2] = 0.0;
+	facing[1][0] = -s; facing[1][1] = -c; facing[1][2] = 0.0;
+	facing[2][0] = 0.0; facing[2][1] = 0.0; facing[2][2] = -1.0;
+
+	ax = cos(p->axis * REGRESS_DEG2RAD);
+	ay = sin(p->axis * REGRESS_DEG2RAD);
+	a = p->tilt * REGRESS_DEG2RAD;
+	c = cos(a); s = sin(a);
+	tilt[0][0] = c + ax * ax * (1.0 - c); tilt[0][1] = ax * ay * (1.0 - c);    tilt[0][2] = ay * s;
+	tilt[1][0] = ax * ay * (1.0 - c);    tilt[1][1] = c + ay * ay * (1.0 - c); tilt[1][2] = -ax * s;
+	tilt[2][0] = -ay * s;                tilt[2][1] = ax * s;                  tilt[2][2] = c;
+	matMul3(tilt, facing, r);
+
+	z = cparam->mat[0][0] * layout->width / p->size;
+	arParamObserv2Ideal(cparam->dist_factor, p->x, p->y, &ix, &iy);
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) pose[i][j] = r[i][j];
+	}
+	pose[2][3] = z;
+	pose[1][3] = (iy - cparam->mat[1][2]) * z / cparam->mat[1][1];
+	pose[0][3] = (ix - cparam->mat[0][2] - cparam->mat[0][1] * pose[1][3] / z) * z / cparam->mat[0][0];
+}
+
+static void drawParams(const ARParam *cparam, const Layout_T *layout, unsigned long *state, PoseParams_T *p)
+{
+	double f = cparam->mat[0][0], reach, sizeMax;
+
+	// Largest size that keeps the paper in the frame even when tilted
+	// towards the camera, see the margin of the position below.
+	reach = (cparam->xsize < cparam->ysize ? cparam->xsize : cparam->ysize) / 2.0 - FRAME_MARGIN;
+	sizeMax = f * layout->width / (layout->radius * (1.0 + f / reach));
+	if (sizeMax > MARKER_PIXELS_MAX) sizeMax = MARKER_PIXELS_MAX;
+	if (sizeMax < MARKER_PIXELS_MIN) sizeMax = MARKER_PIXELS_MIN;
+
+	p->size = MARKER_PIXELS_MIN + (sizeMax - MARKER_PIXELS_MIN) * synthRandom(state);
+	reach = f * layout->radius * p->size / (f * layout->width - layout->radius * p->size) + FRAME_MARGIN;
+	p->x = reach + (cparam->xsize - 2.0 * reach) * synthRandom(state);
+	p->y = reach + (cparam->ysize - 2.0 * reach) * synthRandom(state);
+	p->axis = 360.0 * synthRandom(state);
+	p->tilt = TILT_MAX * synthRandom(state);
+	p->spin = 360.0 * synthRandom(state);
+	p->gain = GAIN_MIN + (GAIN_MAX - GAIN_MIN) * synthRandom(state);
+}
+
+// Markers of the layout placed by pose.
+static void placeLayout(Layout_T *layout, double pose[3][4], SynthMarker_T *markers)
+{
+	int k;
+
+	for (k = 0; k < layout->count; k++) {
+		markers[k] = layout->markers[k];
+		arUtilMatMul(pose, layout->markers[k].trans, markers[k].trans);
+	}
+}
+
+// Whether all paper of the markers is in the frame.
+static int layoutInFrame(const Synth_T *synth, const ARParam *cparam, const SynthMarker_T *markers, int count)
+{
+	double u, v, p[3], x, y;
+	int k, i, c;
+
+	for (k = 0; k < count; k++) {
+		for (i = 0; i < 4; i++) {
+			u = markers[k].center[0] + ((i & 1) ? 0.5 : -0.5) * SYNTH_PAPER * markers[k].width;
+			v = markers[k].center[1] + ((i & 2) ? 0.5 : -0.5) * SYNTH_PAPER * markers[k].width;
+			for (c = 0; c < 3; c++) p[c] = markers[k].trans[c][0] * u + markers[k].trans[c][1] * v + markers[k].trans[c][3];
+			if (!synthProject(synth, p, &x, &y)) return (FALSE);
+			if (x < FRAME_MARGIN || y < FRAME_MARGIN || x > cparam->xsize - FRAME_MARGIN || y > cparam->ysize - FRAME_MARGIN) return (FALSE);
+		}
+	}
+	return (TRUE);
+}
+
+// Truth of every frame. Each round shows every layout for framesPer
+// frames, moving between two random poses.
+static void makeFrames(const Synth_T *synth, const ARParam *cparam, Layout_T *layouts, int layoutCount, int rounds, int framesPer,
+					   unsigned long seed, SynthMarker_T *markers, Frame_T *frames)
+{
+	PoseParams_T from, to, p;
+	unsigned long state;
+	double t;
+	int segment, l, j, attempt, ok;
+
+	for (segment = 0; segment < rounds * layoutCount; segment++) {
+		l = segment % layoutCount;
+		state = synthSeed(seed, segment);
+		for (attempt = 0, ok = FALSE; attempt < POSE_TRIES && !ok; attempt++) {
+			drawParams(cparam, &layouts[l], &state, &from);
+			drawParams(cparam, &layouts[l], &state, &to);
+			for (j = 0, ok = TRUE; j < framesPer && ok; j++) {
+				t = (framesPer > 1 ? (double)j / (framesPer - 1) : 0.0);
+				p.x = from.x + (to.x - from.x) * t;
+				p.y = from.y + (to.y - from.y) * t;
+				p.size = from.size + (to.size - from.size) * t;
+				p.axis = from.axis + (to.axis - from.axis) * t;
+				p.tilt = from.tilt + (to.tilt - from.tilt) * t;
+				p.spin = from.spin + (to.spin - from.spin) * t;
+				p.gain = from.gain + (to.gain - from.gain) * t;
+				frames[segment * framesPer + j].layout = l;
+				frames[segment * framesPer + j].gain = p.gain;
+				poseFromParams(cparam, &layouts[l], &p, frames[segment * framesPer + j].pose);
+				placeLayout(&layouts[l], frames[segment * framesPer + j].pose, markers);
+				ok = layoutInFrame(synth, cparam, markers, layouts[l].count);
+			}
+		}
+		if (!ok) fprintf(stderr, "makeFrames(): %s does not fit in the frame, rendered partly.\n", layouts[l].name);
+	}
+}
+
+static void renderFrame(Synth_T *synth, Layout_T *layouts, Frame_T *frame, unsigned long seed, int index, double noise, int blur,
+						SynthMarker_T *markers, ARUint8 *image)
+{
+	SynthLook_T look;
+
+	look.gain = frame->gain;
+	look.noise = noise;
+	look.blur = blur;
+	look.seed = synthSeed(seed, 0x10000UL + index);
+	placeLayout(&layouts[frame->layout], frame->pose, markers);
+	synthRender(synth, markers, layouts[frame->layout].count, &look, image);
+}
+
+static double transError(double est[3][4], double truth[3][4])
+{
+	double d, sum = 0.0;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		d = est[i][3] - truth[i][3];
+		sum += d * d;
+	}
+	return (sqrt(sum));
+}
+
+// Angle of the rotation between the two, from the trace of est^T truth.
+static double rotError(double est[3][4], double truth[3][4])
+{
+	double trace = 0.0, c;
+	int i, j;
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) trace += est[i][j] * truth[i][j];
+	}
+	c = (trace - 1.0) / 2.0;
+	if (c > 1.0) c = 1.0;
+	if (c < -1.0) c = -1.0;
+	return (acos(c) / REGRESS_DEG2RAD);
+}
+
+static void summarize(Result_T *result, Summary_T *s)
+{
+	int n = result->found, i;
+
+	memset(s, 0, sizeof(Summary_T));
+	s->found = result->found;
+	s->falsePositives = result->falsePositives;
+	if (n == 0) return;
+	qsort(result->transErr, n, sizeof(double), compareDouble);
+	qsort(result->rotErr, n, sizeof(double), compareDouble);
+	for (i = 0; i < n; i++) {
+		s->transMean += result->transErr[i];
+		s->rotMean += result->rotErr[i];
+	}
+	s->transMean /= n;
+	s->rotMean /= n;
+	s->transP90 = result->transErr[(int)(0.9 * (n - 1) + 0.5)];
+	s->rotP90 = result->rotErr[(int)(0.9 * (n - 1) + 0.5)];
+	s->transMax = result->transErr[n - 1];
+	s->rotMax = result->rotErr[n - 1];
+}
+
+// Compare with the golden line of the configuration, TRUE when no worse.
+static int checkGolden(FILE *fp, const char *settings, const char *name, const Summary_T *s, double tolerance)
+{
+	char line[1024], gname[64];
+	Summary_T g;
+	int ok = TRUE, sameSettings = FALSE;
+
+	rewind(fp);
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '#' || line[0] == '\0') continue;
+		if (strncmp(line, "settings ", 9) == 0) {
+			sameSettings = (strcmp(line + 9, settings) == 0);
+			continue;
+		}
+		if (sscanf(line, "%63s %d %d %lf %lf %lf %lf", gname, &g.found, &g.falsePositives, &g.transMean, &g.transP90, &g.rotMean, &g.rotP90) != 7) continue;
+		if (strcmp(gname, name) != 0) continue;
+
+		if (!sameSettings) {
+			printf("   %s: golden results were made with other settings\n", name);
+			return (FALSE);
+		}
+		if (s->found < g.found) {
+			printf("   %s: found in %d frames, golden %d\n", name, s->found, g.found);
+			ok = FALSE;
+		}
+		if (s->falsePositives > g.falsePositives) {
+			printf("   %s: %d false markers, golden %d\n", name, s->falsePositives, g.falsePositives);
+			ok = FALSE;
+		}
+		if (s->transMean > g.transMean * (1.0 + tolerance) + 0.01 || s->transP90 > g.transP90 * (1.0 + tolerance) + 0.01) {
+			printf("   %s: position error %.2f/%.2f mm mean/p90, golden %.2f/%.2f\n", name, s->transMean, s->transP90, g.transMean, g.transP90);
+			ok = FALSE;
+		}
+		if (s->rotMean > g.rotMean * (1.0 + tolerance) + 0.01 || s->rotP90 > g.rotP90 * (1.0 + tolerance) + 0.01) {
+			printf("   %s: rotation error %.2f/%.2f deg mean/p90, golden %.2f/%.2f\n", name, s->rotMean, s->rotP90, g.rotMean, g.rotP90);
+			ok = FALSE;
+		}
+		return (ok);
+	}
+	printf("   %s: not in the golden results\n", name);
+	return (TRUE);
+}
+
+int main(int argc, char **argv)
+{
+	char			*objectDataFilename = "Data/object_data_mantis";
+	char			*multiDataFilename = "Data/multi/marker_mantis.dat";
+	char			*cparamName = "Data/camera_para.dat";
+	char			*dumpName = NULL, *goldenName = NULL, *recordName = NULL;
+	int				thresh = 100, xsize = 0, ysize = 0, rounds = 2, framesPer = 10, blur = 1, batchThreads = 1;
+	int				roiTracking = FALSE, usePatternBank = TRUE, usePyramid = FALSE;
+	int				onlyThresh = -1, onlyResolution = -1, onlyMatching = -1;
+	unsigned long	seed = 1;
+	double			noise = 3.0, tolerance = 0.05;
+	FrontendMode_T	mode = frontendBestMode();
+
+	ARParam			wparam, cparam;
+	ObjectSet_T		*objects;
+	Scene_T			*scene;
+	ARMultiMarkerInfoT *multiConfig = NULL;
+	PatternBank_T	*bank = NULL;
+	BatchPose_T		*batch = NULL;
+	Synth_T			*synth;
+	Layout_T		layouts[LAYOUT_MAX];
+	SynthMarker_T	*markers;
+	Frame_T			*frames;
+	ARUint8			*image, *cache = NULL;
+	int				layoutCount = 0, frameCount, imageSize, markersMax = 1;
+	FILE			*dump = NULL, *golden = NULL, *record = NULL;
+	char			settings[512], name[64];
+
+	Frontend_T		*frontend;
+	AutoThresh_T	*autoThresh;
+	RoiTracker_T	*roi;
+	Pyramid_T		*pyramid;
+	const ThresholdMap_T *map;
+	ARMarkerInfo	*marker_info;
+	int				marker_num, frameThresh, found, visible;
+	Result_T		result;
+	Summary_T		summary;
+	int				a, r, m, f, i, k, regressions = 0;
+	double			t, d, *o;
+	double			(*est)[4];
+	ARUint8			*frameImage;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) objectDataFilename = argv[++i];
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) multiDataFilename = argv[++i];
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) cparamName = argv[++i];
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &xsize, &ysize);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) rounds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) framesPer = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) seed = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc) noise = atof(argv[++i]);
+		else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) blur = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) thresh = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-r") == 0) roiTracking = TRUE;
+		else if (strcmp(argv[i], "-P") == 0) usePyramid = TRUE;
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) batchThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-k") == 0) usePatternBank = FALSE;
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) dumpName = argv[++i];
+		else if (strcmp(argv[i], "-G") == 0 && i + 1 < argc) recordName = argv[++i];
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) goldenName = argv[++i];
+		else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			for (m = 0; m < AUTOTHRESH_MODE_COUNT && strcmp(argv[i + 1], autoThreshModeName((AutoThreshMode_T)m)) != 0; m++);
+			if (m == AUTOTHRESH_MODE_COUNT) {
+				usage(argv[0]);
+				return (1);
+			}
+			onlyThresh = m;
+			i++;
+		}
+		else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+			for (m = 0; m < FRONTEND_RES_COUNT && strcmp(argv[i + 1], frontendResolutionName((FrontendResolution_T)m)) != 0; m++);
+			if (m == FRONTEND_RES_COUNT) {
+				usage(argv[0]);
+				return (1);
+			}
+			onlyResolution = m;
+			i++;
+		}
+		else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+			for (m = 0; m < MATCHING_COUNT && strcmp(argv[i + 1], matchingNames[m]) != 0; m++);
+			if (m == MATCHING_COUNT) {
+				usage(argv[0]);
+				return (1);
+			}
+			onlyMatching = m;
+			i++;
+		}
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			for (m = 0; m < FRONTEND_MODE_COUNT && strcmp(argv[i + 1], frontendModeName((FrontendMode_T)m)) != 0; m++);
+			if (m == FRONTEND_MODE_COUNT || !frontendModeAvailable((FrontendMode_T)m)) {
+				fprintf(stderr, "main(): Front end %s is not available.\n", argv[i + 1]);
+				return (1);
+			}
+			mode = (FrontendMode_T)m;
+			i++;
+		}
+		else {
+			usage(argv[0]);
+			return (1);
+		}
+	}
+	if (rounds < 1 || framesPer < 1 || blur < 0) {
+		usage(argv[0]);
+		return (1);
+	}
+
+	if (arParamLoad(cparamName, 1, &wparam) < 0) {
+		fprintf(stderr, "main(): Error loading parameter file %s for camera.\n", cparamName);
+		return (1);
+	}
+	if (xsize <= 0 || ysize <= 0) {
+		xsize = wparam.xsize;
+		ysize = wparam.ysize;
+	}
+	arParamChangeSize(&wparam, xsize, ysize, &cparam);
+	arLockInstall(&cparam);
+	imageSize = xsize * ysize * AR_PIX_SIZE_DEFAULT;
+
+	if ((objects = objectLoadEnd(objectLoadBegin(sceneOpen(objectDataFilename, multiDataFilename), FALSE), NULL)) == NULL) {
+		fprintf(stderr, "main(): Unable to read object data %s.\n", objectDataFilename);
+		return (1);
+	}
+	scene = objects->scene;
+	if (!sceneReadPatterns(scene)) return (1);
+	if (scene->markerCount > 0 && (multiConfig = sceneMultiConfig(scene)) == NULL) {
+		fprintf(stderr, "main(): sceneMultiConfig returned error !!\n");
+		return (1);
+	}
+
+	// A layout per object, its marker at the layout origin, and the multi
+	// marker at the origin of its config.
+	for (i = 0; i < objects->count && layoutCount < LAYOUT_MAX; i++, layoutCount++) {
+		layouts[layoutCount].name = objects->config[i].patt_name;
+		layouts[layoutCount].object = i;
+		layouts[layoutCount].count = 1;
+		if ((layouts[layoutCount].markers = (SynthMarker_T *)calloc(1, sizeof(SynthMarker_T))) == NULL) return (1);
+		layouts[layoutCount].markers[0].pattern = scene->patterns[scene->objects[i].pattern].data;
+		layouts[layoutCount].markers[0].width = objects->config[i].marker_width;
+		layouts[layoutCount].markers[0].center[0] = objects->config[i].marker_center[0];
+		layouts[layoutCount].markers[0].center[1] = objects->config[i].marker_center[1];
+		layouts[layoutCount].markers[0].trans[0][0] = layouts[layoutCount].markers[0].trans[1][1] = layouts[layoutCount].markers[0].trans[2][2] = 1.0;
+	}
+	if (multiConfig != NULL && layoutCount < LAYOUT_MAX) {
+		layouts[layoutCount].name = multiDataFilename;
+		layouts[layoutCount].object = -1;
+		layouts[layoutCount].count = scene->markerCount;
+		if ((layouts[layoutCount].markers = (SynthMarker_T *)calloc(scene->markerCount, sizeof(SynthMarker_T))) == NULL) return (1);
+		for (k = 0; k < scene->markerCount; k++) {
+			layouts[layoutCount].markers[k].pattern = scene->patterns[scene->markers[k].pattern].data;
+			layouts[layoutCount].markers[k].width = scene->markers[k].width;
+			layouts[layoutCount].markers[k].center[0] = scene->markers[k].center[0];
+			layouts[layoutCount].markers[k].center[1] = scene->markers[k].center[1];
+			memcpy(layouts[layoutCount].markers[k].trans, scene->markers[k].trans, sizeof(double) * 12);
+		}
+		if (scene->markerCount > markersMax) markersMax = scene->markerCount;
+		layoutCount++;
+	}
+	if (layoutCount == 0) {
+		fprintf(stderr, "main(): No markers in %s.\n", objectDataFilename);
+		return (1);
+	}
+	for (i = 0; i < layoutCount; i++) {
+		layouts[i].width = layouts[i].markers[0].width;
+		layouts[i].radius = 0.0;
+		for (k = 0; k < layouts[i].count; k++) {
+			o = &layouts[i].markers[k].trans[0][0];
+			d = sqrt(o[3] * o[3] + o[7] * o[7] + o[11] * o[11])
+					 + sqrt(layouts[i].markers[k].center[0] * layouts[i].markers[k].center[0] + layouts[i].markers[k].center[1] * layouts[i].markers[k].center[1])
+					 + layouts[i].markers[k].width * SYNTH_PAPER * 0.7072;
+			if (d > layouts[i].radius) layouts[i].radius = d;
+		}
+	}
+
+	if ((synth = synthCreate(&cparam)) == NULL) return (1);
+	frameCount = rounds * layoutCount * framesPer;
+	markers = (SynthMarker_T *)malloc(markersMax * sizeof(SynthMarker_T));
+	frames = (Frame_T *)malloc(frameCount * sizeof(Frame_T));
+	image = (ARUint8 *)malloc(imageSize);
+	if (markers == NULL || frames == NULL || image == NULL) {
+		fprintf(stderr, "main(): Out of memory.\n");
+		return (1);
+	}
+	makeFrames(synth, &cparam, layouts, layoutCount, rounds, framesPer, seed, markers, frames);
+
+	// Render every frame once when they fit, the configurations share them.
+	if ((double)frameCount * imageSize <= CACHE_MAX) cache = (ARUint8 *)malloc(frameCount * imageSize);
+	if (dumpName != NULL && (dump = fopen(dumpName, "wb")) == NULL) {
+		fprintf(stderr, "main(): Unable to write %s.\n", dumpName);
+		return (1);
+	}
+	if (cache != NULL || dump != NULL) {
+		for (f = 0; f < frameCount; f++) {
+			renderFrame(synth, layouts, &frames[f], seed, f, noise, blur, markers, (cache != NULL ? cache + f * imageSize : image));
+			if (dump != NULL) fwrite((cache != NULL ? cache + f * imageSize : image), 1, imageSize, dump);
+		}
+	}
+	if (dump != NULL) {
+		fclose(dump);
+		printf("Frames written to %s, replay with \"replay:%s;size=%dx%d\"\n", dumpName, dumpName, xsize, ysize);
+	}
+
+	sprintf(settings, "%dx%d %s %s %s layouts %d rounds %d frames %d seed %lu noise %.2f blur %d thresh %d",
+			xsize, ysize, cparamName, objectDataFilename, (multiConfig != NULL ? multiDataFilename : "-"), layoutCount, rounds, framesPer, seed, noise, blur, thresh);
+	printf("Synthetic frames: %d layouts, %d frames of %dx%d, noise %.1f, blur %d, seed %lu\n", layoutCount, frameCount, xsize, ysize, noise, blur, seed);
+	printf("Thresholding and labeling: %s%s%s\n", frontendModeName(mode), (roiTracking ? ", ROI tracking" : ""), (usePyramid ? ", pyramid" : ""));
+
+	if (usePatternBank && (bank = trackerPatternBank(objects, multiConfig)) == NULL) return (1);
+	if (batchThreads > 0) {
+		if ((batch = batchPoseCreate(objects->count, &cparam)) == NULL) return (1);
+		batchPoseSetThreads(batch, batchThreads);
+	}
+	if (goldenName != NULL && (golden = fopen(goldenName, "r")) == NULL) {
+		fprintf(stderr, "main(): Unable to read golden results %s.\n", goldenName);
+		return (1);
+	}
+	if (recordName != NULL) {
+		if ((record = fopen(recordName, "w")) == NULL) {
+			fprintf(stderr, "main(): Unable to write %s.\n", recordName);
+			return (1);
+		}
+		fprintf(record, "# MantisRegress golden results\nsettings %s\n", settings);
+	}
+	if ((result.transErr = (double *)malloc(frameCount * sizeof(double))) == NULL || (result.rotErr = (double *)malloc(frameCount * sizeof(double))) == NULL) return (1);
+
+	printf("\n%-26s %11s %5s %23s %23s %9s\n", "", "", "", "position error [mm]", "rotation error [deg]", "");
+	printf("%-26s %11s %5s %7s %7s %7s %7s %7s %7s %9s\n", "configuration", "found", "false", "mean", "p90", "max", "mean", "p90", "max", "frames/s");
+	for (a = 0; a < AUTOTHRESH_MODE_COUNT; a++) {
+		if (onlyThresh >= 0 && a != onlyThresh) continue;
+		for (r = 0; r < FRONTEND_RES_COUNT; r++) {
+			if (onlyResolution >= 0 && r != onlyResolution) continue;
+			for (m = 0; m < MATCHING_COUNT; m++) {
+				if (onlyMatching >= 0 && m != onlyMatching) continue;
+
+				// Every configuration starts from nothing tracked.
+				arTemplateMatchingMode = (m % 2 == 0 ? AR_TEMPLATE_MATCHING_COLOR : AR_TEMPLATE_MATCHING_BW);
+				arMatchingPCAMode = (m >= 2 ? AR_MATCHING_WITH_PCA : AR_MATCHING_WITHOUT_PCA);
+				for (i = 0; i < objects->count; i++) objects->track[i].visible = 0;
+				if (multiConfig != NULL) multiConfig->prevF = 0;
+				if ((frontend = frontendCreate(xsize, ysize)) == NULL || (autoThresh = autoThreshCreate(xsize, ysize)) == NULL) return (1);
+				frontendSetMode(frontend, mode);
+				frontendSetResolution(frontend, (FrontendResolution_T)r);
+				frontendSetPatternBank(frontend, bank);
+				autoThreshSetMode(autoThresh, (AutoThreshMode_T)a);
+				autoThreshSetManual(autoThresh, thresh);
+				roi = NULL;
+				pyramid = NULL;
+				if (roiTracking || usePyramid) {
+					if ((roi = roiTrackerCreate(&cparam)) == NULL) return (1);
+					roiTrackerSetEnabled(roi, roiTracking);
+					roiTrackerSetFrontend(roi, frontend);
+				}
+				if (usePyramid) {
+					if ((pyramid = pyramidCreate(xsize, ysize, ROI_PYRAMID_LEVEL)) == NULL) {
+						fprintf(stderr, "main(): No pyramid for this pixel format.\n");
+						return (1);
+					}
+					roiTrackerSetPyramid(roi, pyramid);
+				}
+
+				sprintf(name, "%s/%s/%s", autoThreshModeName((AutoThreshMode_T)a), frontendResolutionName((FrontendResolution_T)r), matchingNames[m]);
+				strcpy(result.name, name);
+				result.targets = result.found = result.falsePositives = 0;
+				result.time = 0.0;
+				for (f = 0; f < frameCount; f++) {
+					frameImage = image;
+					if (cache != NULL) frameImage = cache + f * imageSize;
+					else renderFrame(synth, layouts, &frames[f], seed, f, noise, blur, markers, image);
+
+					// The stages of the pipeline thread, timed together.
+					t = hrtimerNow();
+					frameThresh = autoThreshUpdate(autoThresh, frameImage, &map);
+					frontendSetThresholdMap(frontend, map);
+					if (pyramid != NULL) pyramidBuild(pyramid, frameImage, xsize, ysize);
+					if (trackerDetect(roi, frontend, frameImage, frameThresh, &marker_info, &marker_num) < 0) {
+						fprintf(stderr, "main(): arDetectMarker returned error.\n");
+						return (1);
+					}
+					found = (trackerUpdateObjects(batch, objects, marker_info, marker_num) > 0);
+					visible = (multiConfig != NULL && trackerUpdateMulti(multiConfig, marker_info, marker_num) >= 0);
+					autoThreshFeedback(autoThresh, found || visible);
+					result.time += hrtimerNow() - t;
+
+					// Against the truth. An object is false when its pattern is not in the frame.
+					result.targets++;
+					k = layouts[frames[f].layout].object;
+					if (k >= 0) visible = objects->track[k].visible;
+					if (visible) {
+						est = (k >= 0 ? objects->track[k].trans : multiConfig->trans);
+						result.transErr[result.found] = transError(est, frames[f].pose);
+						result.rotErr[result.found] = rotError(est, frames[f].pose);
+						result.found++;
+					}
+					for (i = 0; i < objects->count; i++) {
+						if (!objects->track[i].visible) continue;
+						for (k = 0; k < layouts[frames[f].layout].count; k++) {
+							if (layouts[frames[f].layout].markers[k].pattern == scene->patterns[scene->objects[i].pattern].data) break;
+						}
+						if (k == layouts[frames[f].layout].count) result.falsePositives++;
+					}
+				}
+
+				summarize(&result, &summary);
+				printf("%-26s %5d/%-5d %5d %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %9.1f\n", name, summary.found, result.targets, summary.falsePositives,
+					   summary.transMean, summary.transP90, summary.transMax, summary.rotMean, summary.rotP90, summary.rotMax,
+					   (result.time > 0.0 ? result.targets / result.time : 0.0));
+				if (record != NULL) {
+					fprintf(record, "%s %d %d %.3f %.3f %.3f %.3f\n", name, summary.found, summary.falsePositives,
+							summary.transMean, summary.transP90, summary.rotMean, summary.rotP90);
+				}
+				if (golden != NULL && !checkGolden(golden, settings, name, &summary, tolerance)) regressions++;
+
+				roiTrackerDestroy(roi);
+				pyramidDestroy(pyramid);
+				frontendDestroy(frontend);
+				autoThreshDestroy(autoThresh);
+			}
+		}
+	}
+
+	if (record != NULL) {
+		fclose(record);
+		printf("\nGolden results written to %s\n", recordName);
+	}
+	if (golden != NULL) {
+		fclose(golden);
+		if (regressions > 0) printf("\n%d configurations regressed against %s\n", regressions, goldenName);
+		else printf("\nNo regressions against %s\n", goldenName);
+	}
+
+	free(result.transErr);
+	free(result.rotErr);
+	for (i = 0; i < layoutCount; i++) free(layouts[i].markers);
+	free(markers);
+	free(frames);
+	free(image);
+	free(cache);
+	synthDestroy(synth);
+	batchPoseDestroy(batch);
+	patternBankDestroy(bank);
+	if (multiConfig != NULL) arMultiFreeConfig(multiConfig);
+	objectFree(objects);
+	return (regressions > 0 ? 2 : 0);
+}
@@ -0,0 +1,307 @@
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "synth.h"
+
+// ============================================================================
+//	Constants
+// ============================================================================
+
+#ifndef TRUE
+#  define TRUE 1
+#endif
+#ifndef FALSE
+#  define FALSE 0
+#endif
+
+#define SYNTH_SAMPLES		4			// Per pixel and axis.
+
+// Gray levels at gain 1.0: printed black, paper and the background from
+// the left to the right edge of the frame.
+#define SYNTH_BLACK			25.0
+#define SYNTH_WHITE			235.0
+#define SYNTH_BACK_LEFT		140.0
+#define SYNTH_BACK_RIGHT	190.0
+
+// ============================================================================
+//	Types
+// ============================================================================
+
+struct Synth_T {
+	ARParam			cparam;
+	int				xsize, ysize;
+	float			*ideal;			// [y][x][2] ideal screen position of every pixel.
+	float			*color;			// [y][x][3] frame being rendered, B G R like the pattern files.
+	float			*temp;			// For the blur.
+};
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+double synthRandom(unsigned long *state)
+{
+	*state = (*state * 1103515245UL + 12345UL) & 0xffffffffUL;
+	return ((double)(*state >> 8) / 16777216.0);
+}
+
+unsigned long synthSeed(unsigned long seed, unsigned long n)
+{
+	unsigned long h = (seed * 2654435761UL + n) & 0xffffffffUL;
+
+	h = ((h ^ (h >> 16)) * 0x45d9f3bUL) & 0xffffffffUL;
+	h = ((h ^ (h >> 16)) * 0x45d9f3bUL) & 0xffffffffUL;
+	return (h ^ (h >> 16));
+}
+
+Synth_T *synthCreate(const ARParam *cparam)
+{
+	Synth_T *synth;
+	double ix, iy;
+	int n, x, y;
+
+	if ((synth = (Synth_T *)calloc(1, sizeof(Synth_T))) == NULL) return (NULL);
+	synth->cparam = *cparam;
+	synth->xsize = cparam->xsize;
+	synth->ysize = cparam->ysize;
+	n = synth->xsize * synth->ysize;
+	synth->ideal = (float *)malloc(n * 2 * sizeof(float));
+	synth->color = (float *)malloc(n * 3 * sizeof(float));
+	synth->temp = (float *)malloc(n * 3 * sizeof(float));
+	if (synth->ideal == NULL || synth->color == NULL || synth->temp == NULL) {
+		fprintf(stderr, "synthCreate(): Out of memory.\n");
+		synthDestroy(synth);
+		return (NULL);
+	}
+
+	for (y = 0; y < synth->ysize; y++) {
+		for (x = 0; x < synth->xsize; x++) {
+			arParamObserv2Ideal(cparam->dist_factor, x, y, &ix, &iy);
+			synth->ideal[(y * synth->xsize + x) * 2] = (float)ix;
+			synth->ideal[(y * synth->xsize + x) * 2 + 1] = (float)iy;
+		}
+	}
+	return (synth);
+}
+
+void synthDestroy(Synth_T *synth)
+{
+	if (synth == NULL) return;
+	free(synth->ideal);
+	free(synth->color);
+	free(synth->temp);
+	free(synth);
+}
+
+int synthProject(const Synth_T *synth, const double p[3], double *x, double *y)
+{
+	double h[3];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		h[i] = synth->cparam.mat[i][0] * p[0] + synth->cparam.mat[i][1] * p[1] + synth->cparam.mat[i][2] * p[2] + synth->cparam.mat[i][3];
+	}
+	if (p[2] <= 0.0 || h[2] <= 0.0) return (FALSE);
+	arParamIdeal2Observ(synth->cparam.dist_factor, h[0] / h[2], h[1] / h[2], x, y);
+	return (TRUE);
+}
+
+// Homography from the ideal screen to the marker plane, the inverse of the
+// camera matrix times the marker's X, Y and translation columns.
+static int synthHomography(const Synth_T *synth, const double trans[3][4], double inv[3][3])
+{
+	double h[3][3], det;
+	int i, j;
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			h[i][j] = synth->cparam.mat[i][0] * trans[0][j == 2 ? 3 : j] + synth->cparam.mat[i][1] * trans[1][j == 2 ? 3 : j]
+					+ synth->cparam.mat[i][2] * trans[2][j == 2 ? 3 : j];
+		}
+		h[i][2] += synth->cparam.mat[i][3];
+	}
+	det = h[0][0] * (h[1][1] * h[2][2] - h[1][2] * h[2][1]) - h[0][1] * (h[1][0] * h[2][2] - h[1][2] * h[2][0])
+		+ h[0][2] * (h[1][0] * h[2][1] - h[1][1] * h[2][0]);
+	if (fabs(det) < 1e-12) return (FALSE);
+	inv[0][0] = (h[1][1] * h[2][2] - h[1][2] * h[2][1]) / det;
+	inv[0][1] = (h[0][2] * h[2][1] - h[0][1] * h[2][2]) / det;
+	inv[0][2] = (h[0][1] * h[1][2] - h[0][2] * h[1][1]) / det;
+	inv[1][0] = (h[1][2] * h[2][0] - h[1][0] * h[2][2]) / det;
+	inv[1][1] = (h[0][0] * h[2][2] - h[0][2] * h[2][0]) / det;
+	inv[1][2] = (h[0][2] * h[1][0] - h[0][0] * h[1][2]) / det;
+	inv[2][0] = (h[1][0] * h[2][1] - h[1][1] * h[2][0]) / det;
+	inv[2][1] = (h[0][1] * h[2][0] - h[0][0] * h[2][1]) / det;
+	inv[2][2] = (h[0][0] * h[1][1] - h[0][1] * h[1][0]) / det;
+	return (TRUE);
+}
+
+// Printed B G R at (x, y) from the marker center in marker widths, FALSE
+// off the paper. Rows of the pattern run down from the +Y edge, columns
+// from the -X edge, as arGetPatt() samples them from vertex[0].
+static int synthSample(const SynthMarker_T *marker, double x, double y, double value[3])
+{
+	int row, col, c;
+
+	if (fabs(x) > SYNTH_PAPER / 2.0 || fabs(y) > SYNTH_PAPER / 2.0) return (FALSE);
+	if (fabs(x) >= 0.5 || fabs(y) >= 0.5) {
+		value[0] = value[1] = value[2] = SYNTH_WHITE;
+	} else if (fabs(x) >= 0.25 || fabs(y) >= 0.25) {
+		value[0] = value[1] = value[2] = SYNTH_BLACK;
+	} else {
+		col = (int)((x + 0.25) * 2.0 * AR_PATT_SIZE_X);
+		row = (int)((0.25 - y) * 2.0 * AR_PATT_SIZE_Y);
+		if (col > AR_PATT_SIZE_X - 1) col = AR_PATT_SIZE_X - 1;
+		if (row > AR_PATT_SIZE_Y - 1) row = AR_PATT_SIZE_Y - 1;
+		for (c = 0; c < 3; c++) {
+			value[c] = SYNTH_BLACK + marker->pattern[(c * AR_PATT_SIZE_Y + row) * AR_PATT_SIZE_X + col] * (SYNTH_WHITE - SYNTH_BLACK) / 255.0;
+		}
+	}
+	return (TRUE);
+}
+
+static void synthMarker(Synth_T *synth, const SynthMarker_T *marker, double gain)
+{
+	double inv[3][3], corner[3], value[3], sum[3];
+	double ox, oy, x0, y0, x1, y1, u, v, hx, hy, hw, dx, dy;
+	const float *ideal, *right, *down;
+	float *color;
+	int x, y, sx, sy, hits, i, c, left, top, width, height;
+
+	if (!synthHomography(synth, marker->trans, inv)) return;
+
+	// Pixels the paper may cover.
+	x0 = synth->xsize; y0 = synth->ysize;
+	x1 = y1 = 0.0;
+	for (i = 0; i < 4; i++) {
+		u = marker->center[0] + ((i & 1) ? 0.5 : -0.5) * SYNTH_PAPER * marker->width;
+		v = marker->center[1] + ((i & 2) ? 0.5 : -0.5) * SYNTH_PAPER * marker->width;
+		for (c = 0; c < 3; c++) corner[c] = marker->trans[c][0] * u + marker->trans[c][1] * v + marker->trans[c][3];
+		if (!synthProject(synth, corner, &ox, &oy)) return;
+		if (ox < x0) x0 = ox;
+		if (ox > x1) x1 = ox;
+		if (oy < y0) y0 = oy;
+		if (oy > y1) y1 = oy;
+	}
+	left = (x0 < 2.0 ? 0 : (int)x0 - 2);
+	top = (y0 < 2.0 ? 0 : (int)y0 - 2);
+	width = (x1 + 3.0 > synth->xsize ? synth->xsize : (int)x1 + 3) - left;
+	height = (y1 + 3.0 > synth->ysize ? synth->ysize : (int)y1 + 3) - top;
+
+	for (y = top; y < top + height; y++) {
+		for (x = left; x < left + width; x++) {
+			ideal = synth->ideal + (y * synth->xsize + x) * 2;
+			right = (x + 1 < synth->xsize ? ideal + 2 : ideal);
+			down = (y + 1 < synth->ysize ? ideal + synth->xsize * 2 : ideal);
+			sum[0] = sum[1] = sum[2] = 0.0;
+			hits = 0;
+			for (sy = 0; sy < SYNTH_SAMPLES; sy++) {
+				dy = (sy + 0.5) / SYNTH_SAMPLES - 0.5;
+				for (sx = 0; sx < SYNTH_SAMPLES; sx++) {
+					dx = (sx + 0.5) / SYNTH_SAMPLES - 0.5;
+
+					// The ideal position of a sample from the pixel's neighbours.
+					u = ideal[0] + dx * (right[0] - ideal[0]) + dy * (down[0] - ideal[0]);
+					v = ideal[1] + dx * (right[1] - ideal[1]) + dy * (down[1] - ideal[1]);
+					hx = inv[0][0] * u + inv[0][1] * v + inv[0][2];
+					hy = inv[1][0] * u + inv[1][1] * v + inv[1][2];
+					hw = inv[2][0] * u + inv[2][1] * v + inv[2][2];
+					if (hw == 0.0) continue;
+					if (!synthSample(marker, (hx / hw - marker->center[0]) / marker->width, (hy / hw - marker->center[1]) / marker->width, value)) continue;
+					for (c = 0; c < 3; c++) sum[c] += value[c];
+					hits++;
+				}
+			}
+			if (hits == 0) continue;
+			color = synth->color + (y * synth->xsize + x) * 3;
+			for (c = 0; c < 3; c++) {
+				color[c] = (float)((gain * sum[c] + (SYNTH_SAMPLES * SYNTH_SAMPLES - hits) * color[c]) / (SYNTH_SAMPLES * SYNTH_SAMPLES));
+			}
+		}
+	}
+}
+
+// 3x3 box filter, the edge pixels repeated.
+static void synthBlur(Synth_T *synth)
+{
+	int xsize = synth->xsize, ysize = synth->ysize;
+	float *src = synth->color, *dst = synth->temp;
+	int x, y, c, l, r;
+
+	for (y = 0; y < ysize; y++) {
+		for (x = 0; x < xsize; x++) {
+			l = (x > 0 ? x - 1 : x);
+			r = (x + 1 < xsize ? x + 1 : x);
+			for (c = 0; c < 3; c++) {
+				dst[(y * xsize + x) * 3 + c] = (src[(y * xsize + l) * 3 + c] + src[(y * xsize + x) * 3 + c] + src[(y * xsize + r) * 3 + c]) / 3.0f;
+			}
+		}
+	}
+	for (y = 0; y < ysize; y++) {
+		l = (y > 0 ? y - 1 : y);
+		r = (y + 1 < ysize ? y + 1 : y);
+		for (x = 0; x < xsize * 3; x++) {
+			src[y * xsize * 3 + x] = (dst[l * xsize * 3 + x] + dst[y * xsize * 3 + x] + dst[r * xsize * 3 + x]) / 3.0f;
+		}
+	}
+}
+
+static void synthStore(ARUint8 *pixel, int b, int g, int r)
+{
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA)
+	pixel[0] = (ARUint8)b; pixel[1] = (ARUint8)g; pixel[2] = (ARUint8)r; pixel[3] = 255;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGR)
+	pixel[0] = (ARUint8)b; pixel[1] = (ARUint8)g; pixel[2] = (ARUint8)r;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
+	pixel[0] = (ARUint8)r; pixel[1] = (ARUint8)g; pixel[2] = (ARUint8)b; pixel[3] = 255;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGB)
+	pixel[0] = (ARUint8)r; pixel[1] = (ARUint8)g; pixel[2] = (ARUint8)b;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
+	pixel[0] = 255; pixel[1] = (ARUint8)b; pixel[2] = (ARUint8)g; pixel[3] = (ARUint8)r;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
+	pixel[0] = 255; pixel[1] = (ARUint8)r; pixel[2] = (ARUint8)g; pixel[3] = (ARUint8)b;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
+	pixel[0] = 128; pixel[1] = (ARUint8)((b + g + r) / 3);
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
+	pixel[0] = (ARUint8)((b + g + r) / 3); pixel[1] = 128;
+#else
+	pixel[0] = (ARUint8)((b + g + r) / 3);
+#endif
+}
+
+void synthRender(Synth_T *synth, const SynthMarker_T *markers, int count, const SynthLook_T *look, ARUint8 *image)
+{
+	unsigned long state = look->seed;
+	double back, noise;
+	float *color;
+	int value[3];
+	int x, y, i, c;
+
+	for (x = 0; x < synth->xsize; x++) {
+		back = look->gain * (SYNTH_BACK_LEFT + (SYNTH_BACK_RIGHT - SYNTH_BACK_LEFT) * x / synth->xsize);
+		for (c = 0; c < 3; c++) synth->color[x * 3 + c] = (float)back;
+	}
+	for (y = 1; y < synth->ysize; y++) memcpy(synth->color + y * synth->xsize * 3, synth->color, synth->xsize * 3 * sizeof(float));
+
+	for (i = 0; i < count; i++) synthMarker(synth, &markers[i], look->gain);
+	for (i = 0; i < look->blur; i++) synthBlur(synth);
+
+	// Close to normal noise from the sum of four uniform numbers.
+	color = synth->color;
+	for (y = 0; y < synth->ysize; y++) {
+		for (x = 0; x < synth->xsize; x++, color += 3, image += AR_PIX_SIZE_DEFAULT) {
+			for (c = 0; c < 3; c++) {
+				noise = (synthRandom(&state) + synthRandom(&state) + synthRandom(&state) + synthRandom(&state) - 2.0) * 1.7320508;
+				value[c] = (int)floor(color[c] + look->noise * noise + 0.5);
+				if (value[c] < 0) value[c] = 0;
+				if (value[c] > 255) value[c] = 255;
+			}
+			synthStore(image, value[0], value[1], value[2]);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef __synth_h__
+#define __synth_h__
+
+// ============================================================================
+//	Synthetic camera frames of markers at known poses
+// ============================================================================
+//
+//	Renders printed markers into a frame the way the camera of an ARParam
+//	sees them. Every pixel is taken through the lens distortion to the
+//	ideal screen and from there onto the marker planes, 4x4 samples per
+//	pixel for the edges. The inner half of a marker shows the upright
+//	rotation of its pattern file, so arGetTransMat() of a marker rendered
+//	at trans returns trans. The frame is then blurred and noise is added.
+//
+//	Nothing depends on the time or on global state, the same arguments give
+//	the same frame.
+//
+
+#include <AR/config.h>
+#include <AR/param.h>
+#include <AR/ar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SYNTH_PAPER		1.5			// Width of the white paper around a marker, in marker widths.
+
+typedef struct {
+	const ARUint8	*pattern;		// Values of the pattern file, see SCENE_PATTERN_SIZE in scene.h.
+	double			width;			// Black square, as for arGetTransMat().
+	double			center[2];
+	double			trans[3][4];	// Marker to camera.
+} SynthMarker_T;
+
+typedef struct {
+	double			gain;			// Lighting, 1.0 for the printed gray levels.
+	double			noise;			// Standard deviation of the pixel noise.
+	int				blur;			// Passes of a 3x3 box filter.
+	unsigned long	seed;			// Of the noise.
+} SynthLook_T;
+
+typedef struct Synth_T Synth_T;
+
+Synth_T *synthCreate(const ARParam *cparam);
+void synthDestroy(Synth_T *synth);
+
+// Render the markers into image, a frame of the camera size in the
+// ARToolKit pixel format. Markers must not overlap.
+void synthRender(Synth_T *synth, const SynthMarker_T *markers, int count, const SynthLook_T *look, ARUint8 *image);
+
+// Observed image position of a point in camera coordinates. Returns FALSE
+// for a point not in front of the camera.
+int synthProject(const Synth_T *synth, const double p[3], double *x, double *y);
+
+// Uniform in [0, 1) from a generator state, the same sequence everywhere.
+double synthRandom(unsigned long *state);
+
+// Generator state of stream n of a seed, the streams of neighbouring n are
+// unrelated.
+unsigned long synthSeed(unsigned long seed, unsigned long n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __synth_h__
@@ -0,0 +1,70 @@
+// ============================================================================
+//	Scene compiler for the examples
+// ============================================================================
+//
+//	Checks an object file and an optional multi marker config together
+//	with every pattern and model file they name, and writes them to one
+//	compiled scene, see scene.h. Run it from the bin directory like the
+//	apps, the paths in the files are relative to it:
+//
+//	    SceneC.exe Data/object_data_mantis Data/multi/marker_mantis.dat Data/mantis.scene
+//
+
+// ============================================================================
+//	Includes
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#include "scene.h"
+
+// ============================================================================
+//	Functions
+// ============================================================================
+
+static void usage(const char *name)
+{
+	printf("Usage: %s <object file> [<multi marker config>] <scene file>\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	Scene_T			*scene;
+	const char		*objectFile, *multiFile = NULL, *sceneFile;
+	int				i, models = 0;
+
+	if (argc < 3 || argc > 4) {
+		usage(argv[0]);
+		return (1);
+	}
+	objectFile = argv[1];
+	if (argc == 4) multiFile = argv[2];
+	sceneFile = argv[argc - 1];
+
+	if ((scene = sceneOpen(objectFile, multiFile)) == NULL) return (1);
+	if (scene->compiled) {
+		fprintf(stderr, "main(): %s is compiled already.\n", objectFile);
+		sceneClose(scene);
+		return (1);
+	}
+	if (!sceneCompile(scene, sceneFile)) {
+		sceneClose(scene);
+		return (1);
+	}
+	for (i = 0; i < scene->objectCount; i++) {
+		if (scene->objects[i].type[0] != '\0') models++;
+	}
+	printf("%s: %d objects (%d with a model), %d markers, %d patterns\n", sceneFile,
+		   scene->objectCount, models, scene->markerCount, scene->patternCount);
+	sceneClose(scene);
+
+	// The file as the apps will see it.
+	if ((scene = sceneOpen(sceneFile, NULL)) == NULL) return (1);
+	sceneClose(scene);
+	return (0);
+}